@@ -0,0 +1,75 @@
+#include <coroserver/io_context.h>
+#include <coroserver/stream.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+//Connection storm benchmark. Many clients connect at once, measures accept rate
+//
+//usage: accept_bench [connections] [client_threads]
+
+using namespace coroserver;
+
+cocls::async<std::size_t> acceptor(cocls::generator<Stream> gen, std::size_t count) {
+    std::size_t n = 0;
+    while (n < count && co_await gen.next()) {
+        ++n;
+    }
+    co_return n;
+}
+
+static void storm(const PeerName &peer, std::size_t count) {
+    peer.use_sockaddr([&](const sockaddr *saddr, socklen_t slen) {
+        for (std::size_t i = 0; i < count; i++) {
+            int s = ::socket(saddr->sa_family, SOCK_STREAM|SOCK_CLOEXEC, 0);
+            if (s < 0) break;
+            if (::connect(s, saddr, slen) == 0) {
+                ::close(s);
+            } else {
+                ::close(s);
+                std::cerr << "connect failed: " << errno << std::endl;
+                break;
+            }
+        }
+        return 0;
+    });
+}
+
+static void run(const char *name, PollerType type, std::size_t batch, std::size_t connections, std::size_t threads) {
+    ContextIO ctx = ContextIO::create(1, type);
+    ctx.set_accept_batch(batch);
+    auto addr = PeerName::lookup("127.0.0.1", "*");
+    auto acc = acceptor(ctx.accept(addr), connections).start();
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (std::size_t i = 0; i < threads; i++) {
+        clients.emplace_back([&]{storm(addr[0], connections / threads);});
+    }
+    for (auto &t: clients) t.join();
+    std::size_t total = acc.wait();
+    auto stop = std::chrono::steady_clock::now();
+
+    ctx.stop();
+
+    double secs = std::chrono::duration<double>(stop - start).count();
+    std::cout << name << " batch=" << batch << ": " << total << " connections in " << secs << " s, "
+              << static_cast<std::size_t>(total / secs) << " accepts/s" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    std::size_t threads = argc > 2?std::strtoul(argv[2], nullptr, 10):4;
+    std::size_t connections = argc > 1?std::strtoul(argv[1], nullptr, 10):20000;
+    connections -= connections % threads;
+
+    run("epoll", PollerType::epoll, 1, connections, threads);
+    run("epoll", PollerType::epoll, 16, connections, threads);
+    run("epoll_edge", PollerType::epoll_edge, 16, connections, threads);
+    run("io_uring", PollerType::uring, 16, connections, threads);
+}
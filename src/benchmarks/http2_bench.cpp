@@ -0,0 +1,103 @@
+#include "../tests/http2_client.h"
+
+#include <coroserver/http_server.h>
+#include <coroserver/io_context.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+//Throughput of HTTP/1.1 keep-alive and HTTP/2 over one loopback connection.
+//HTTP/1.1 client sends requests one by one, HTTP/2 client keeps given count
+//of streams in flight
+//
+//usage: http2_bench [requests] [concurrent_streams]
+
+using namespace coroserver;
+
+template<typename Fn>
+static void measure(const char *name, std::size_t count, Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+    std::cout << name << ": " << count << " requests, " << static_cast<double>(ns) / count << " ns/request, "
+              << static_cast<double>(count) * 1e9 / static_cast<double>(ns) << " requests/s" << std::endl;
+}
+
+static std::pair<Stream, cocls::future<void> > connect(ContextIO &ctx, http::Server &server) {
+    auto addrs_listen = PeerName::lookup("127.0.0.1", "*");
+    auto listening = ctx.accept(addrs_listen);
+    auto addrs_connect = PeerName::lookup("localhost", addrs_listen[0].get_port());
+    auto wtconn = listening();
+    Stream s = ctx.connect(addrs_connect).join();
+    return {s, server.serve_req(wtconn.join())};
+}
+
+int main(int argc, char **argv) {
+    std::size_t count = argc > 1?std::strtoul(argv[1], nullptr, 10):20000;
+    std::size_t streams = argc > 2?std::strtoul(argv[2], nullptr, 10):50;
+    streams = std::max<std::size_t>(streams, 1);
+
+    ContextIO ctx = ContextIO::create(2);
+    http::Server server;
+    server.set_http2(true);
+    std::string body(1024, 'x');
+    server.set_handler("/", [&](http::ServerRequest &req) {
+        return req.send(std::string_view(body));
+    });
+
+    {
+        auto [s, served] = connect(ctx, server);
+        std::string request("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        std::size_t ok = 0;
+        measure("HTTP/1.1 keep-alive", count, [&]{
+            std::string resp;
+            for (std::size_t i = 0; i < count; i++) {
+                if (!s.write(request).join()) break;
+                resp.clear();
+                //response is complete, when it ends by the body
+                auto complete = [&]{
+                    return resp.size() >= body.size() && resp.compare(resp.size() - body.size(), body.size(), body) == 0;
+                };
+                while (!complete()) {
+                    std::string_view data = s.read().join();
+                    if (data.empty()) break;
+                    resp.append(data);
+                }
+                if (!complete()) break;
+                ++ok;
+            }
+        });
+        if (ok != count) std::cerr << "HTTP/1.1 failed after " << ok << " requests" << std::endl;
+        s = Stream::null_stream();
+        served.join();
+    }
+    {
+        auto [s, served] = connect(ctx, server);
+        std::size_t ok = 0;
+        {
+            Http2TestClient client(std::move(s));
+            measure("HTTP/2 multiplexed", count, [&]{
+                std::size_t sent = 0;
+                std::size_t in_flight = 0;
+                while (ok < count) {
+                    while (sent < count && in_flight < streams) {
+                        client.request("GET", "/");
+                        ++sent;
+                        ++in_flight;
+                    }
+                    if (!client.run(1)) break;
+                    for (auto id: client.completed()) {
+                        if (client[id].body.size() == body.size()) ++ok;
+                        --in_flight;
+                    }
+                    client.clear();
+                }
+            });
+        }
+        if (ok != count) std::cerr << "HTTP/2 failed after " << ok << " requests" << std::endl;
+        served.join();
+    }
+    ctx.stop();
+}
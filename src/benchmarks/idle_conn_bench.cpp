@@ -0,0 +1,88 @@
+#include <coroserver/io_context.h>
+#include <coroserver/stream.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Memory per idle connection. Opens many connections, each exchanges one
+//message and then stays idle (waits for next read), as keep-alive connection does.
+//Reports growth of RSS per connection and usage of the pool of read buffers
+//
+//usage: idle_conn_bench [connections]
+//
+//Note: raise the limit of open files (ulimit -n) for large counts
+
+using namespace coroserver;
+
+static std::size_t rss_bytes() {
+    std::size_t pages = 0, rss = 0;
+    std::ifstream("/proc/self/statm") >> pages >> rss;
+    return rss * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+static std::atomic<std::size_t> answered = 0;
+
+cocls::async<void> connection(Stream s) {
+    while (true) {
+        std::string_view data = co_await s.read();
+        if (data.empty()) break;
+        co_await s.write(data);
+        ++answered;
+    }
+}
+
+cocls::async<void> acceptor(cocls::generator<Stream> gen) {
+    while (co_await gen.next()) {
+        connection(std::move(gen.value())).detach();
+    }
+}
+
+int main(int argc, char **argv) {
+    std::size_t count = argc > 1?std::strtoul(argv[1], nullptr, 10):10000;
+    ContextIO ctx = ContextIO::create(1);
+    auto addr = PeerName::lookup("127.0.0.1", "*");
+    std::stop_source stop;
+    auto acc = acceptor(ctx.accept(addr, stop.get_token()));
+    acc.detach();
+
+    std::size_t rss_start = rss_bytes();
+    std::vector<int> clients;
+    std::string msg(512, 'x');
+    char buff[1024];
+    addr[0].use_sockaddr([&](const sockaddr *saddr, socklen_t slen) {
+        for (std::size_t i = 0; i < count; i++) {
+            int s = ::socket(saddr->sa_family, SOCK_STREAM|SOCK_CLOEXEC, 0);
+            if (s < 0 || ::connect(s, saddr, slen) != 0) {
+                std::cerr << "connect failed: " << errno << std::endl;
+                if (s >= 0) ::close(s);
+                break;
+            }
+            if (::send(s, msg.data(), msg.size(), MSG_NOSIGNAL) <= 0
+                || ::recv(s, buff, sizeof(buff), 0) <= 0) {
+                std::cerr << "exchange failed" << std::endl;
+            }
+            clients.push_back(s);
+        }
+        return 0;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    std::size_t rss_idle = rss_bytes();
+    auto st = ctx.get_buffer_pool_stats(0);
+
+    std::cout << clients.size() << " idle connections (" << answered << " answered)" << std::endl
+              << "RSS growth per connection: " << (rss_idle - rss_start) / std::max<std::size_t>(clients.size(), 1) << " bytes" << std::endl
+              << "read buffers borrowed: " << st.borrowed << " (" << st.borrowed_bytes << " bytes), "
+              << "kept free: " << st.free_bytes << " bytes" << std::endl;
+
+    for (int s: clients) ::close(s);
+    stop.request_stop();
+    ctx.stop();
+}
@@ -0,0 +1,74 @@
+#include <coroserver/io_context.h>
+#include <coroserver/stream.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+//Echo ping-pong benchmark. Compares throughput of available pollers
+//
+//usage: poller_bench [connections] [roundtrips] [threads]
+
+using namespace coroserver;
+
+static constexpr std::string_view message = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+
+cocls::async<void> echo_server(Stream s) {
+    while (true) {
+        std::string_view data = co_await s.read();
+        if (data.empty()) break;
+        if (!co_await s.write(data)) break;
+    }
+}
+
+cocls::async<void> listener(cocls::generator<Stream> gen) {
+    while (co_await gen.next()) {
+        echo_server(std::move(gen.value())).detach();
+    }
+}
+
+cocls::async<std::size_t> client(ContextIO ctx, std::string port, int roundtrips) {
+    Stream s = co_await ctx.connect(PeerName::lookup("127.0.0.1", port));
+    for (int i = 0; i < roundtrips; i++) {
+        if (!co_await s.write(message)) co_return i;
+        std::size_t rcv = 0;
+        while (rcv < message.size()) {
+            std::string_view data = co_await s.read();
+            if (data.empty()) co_return i;
+            rcv += data.size();
+        }
+    }
+    co_return roundtrips;
+}
+
+static void run(const char *name, PollerType type, int connections, int roundtrips, std::size_t threads) {
+    ContextIO ctx = ContextIO::create(threads, type);
+    auto addr = PeerName::lookup("127.0.0.1", "*");
+    auto lsn = listener(ctx.accept(addr)).start();
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<cocls::future<std::size_t> > clients;
+    clients.reserve(connections);
+    for (int i = 0; i < connections; i++) {
+        clients.push_back(client(ctx, addr[0].get_port(), roundtrips).start());
+    }
+    std::size_t total = 0;
+    for (auto &f: clients) total += f.wait();
+    auto stop = std::chrono::steady_clock::now();
+
+    ctx.stop();
+    lsn.wait();
+
+    double secs = std::chrono::duration<double>(stop - start).count();
+    std::cout << name << ": " << total << " roundtrips in " << secs << " s, "
+              << static_cast<std::size_t>(total / secs) << " roundtrips/s" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    int connections = argc > 1?std::atoi(argv[1]):64;
+    int roundtrips = argc > 2?std::atoi(argv[2]):10000;
+    std::size_t threads = argc > 3?std::strtoul(argv[3], nullptr, 10):1;
+
+    run("epoll", PollerType::epoll, connections, roundtrips, threads);
+    run("io_uring", PollerType::uring, connections, roundtrips, threads);
+}
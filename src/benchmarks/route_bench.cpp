@@ -0,0 +1,72 @@
+#include <coroserver/prefixmap.h>
+#include <coroserver/route_trie.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//Lookup of routes. Compares PrefixMap with RouteTrie on the same static routes,
+//then measures RouteTrie with parametrized routes
+//
+//usage: route_bench [routes] [lookups]
+
+using namespace coroserver;
+
+template<typename Fn>
+static void measure(const char *name, const std::vector<std::string> &paths, std::size_t count, Fn &&fn) {
+    std::size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < count; i++) found += fn(paths[i % paths.size()]);
+    auto stop = std::chrono::steady_clock::now();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+    std::cout << name << ": " << static_cast<double>(ns) / count << " ns/lookup, "
+              << found << " matches" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    std::size_t routes = argc > 1?std::strtoul(argv[1], nullptr, 10):5000;
+    std::size_t count = argc > 2?std::strtoul(argv[2], nullptr, 10):1000000;
+
+    static const char *services[] = {"users","orders","products","invoices","reports","settings","files","auth"};
+    std::vector<std::string> static_routes;
+    std::vector<std::string> param_routes;
+    std::vector<std::string> paths;
+    for (std::size_t i = 0; i < routes; i++) {
+        std::string svc = services[i % std::size(services)];
+        std::string ver = "/api/v" + std::to_string(i % 3 + 1) + "/";
+        static_routes.push_back(ver + svc + "/item" + std::to_string(i));
+        param_routes.push_back(ver + svc + std::to_string(i) + "/{id}/detail");
+        paths.push_back(static_routes.back() + "/details/" + std::to_string(i * 7));
+    }
+
+    PrefixMap<int> pmap;
+    RouteTrie<int> trie;
+    for (std::size_t i = 0; i < routes; i++) {
+        pmap.insert(static_routes[i], static_cast<int>(i));
+        trie.insert(static_routes[i]) = static_cast<int>(i);
+    }
+
+    std::cout << routes << " static routes" << std::endl;
+    measure("PrefixMap", paths, count, [&](std::string_view p) {
+        return pmap.find(p).size();
+    });
+    measure("RouteTrie", paths, count, [&](std::string_view p) {
+        return trie.find(p).size();
+    });
+
+    RouteTrie<int> ptrie;
+    std::vector<std::string> ppaths;
+    for (std::size_t i = 0; i < routes; i++) {
+        ptrie.insert(param_routes[i]) = static_cast<int>(i);
+        std::string p = param_routes[i];
+        p.replace(p.find("{id}"), 4, std::to_string(i * 13));
+        ppaths.push_back(std::move(p));
+    }
+    std::cout << routes << " routes with parameter" << std::endl;
+    measure("RouteTrie", ppaths, count, [&](std::string_view p) {
+        auto r = ptrie.find(p);
+        return r.empty()?0:r.top().param_count();
+    });
+}
@@ -0,0 +1,78 @@
+#include <coroserver/scheduler.h>
+#include <coroserver/timer_heap.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <random>
+
+//Benchmark of timers. Inserts timers, cancels half of them and expires the rest
+//
+//usage: timer_bench [count]
+
+using namespace coroserver;
+
+template<typename Fn>
+static void measure(const char *name, std::size_t count, Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+    std::cout << name << ": " << count << " ops, " << static_cast<double>(ns) / count << " ns/op" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    std::size_t count = argc > 1?std::strtoul(argv[1], nullptr, 10):1000000;
+
+    std::mt19937_64 rnd(12345);
+    std::uniform_int_distribution<int> dist(0, 60000);
+    Clock::time_point base;
+    std::vector<Clock::time_point> times;
+    times.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+        times.push_back(base + std::chrono::milliseconds(dist(rnd)));
+    }
+
+    {
+        TimerHeap<std::size_t> heap;
+        std::vector<TimerHeap<std::size_t>::Handle> handles;
+        handles.reserve(count);
+        measure("TimerHeap insert", count, [&]{
+            for (std::size_t i = 0; i < count; i++) handles.push_back(heap.insert(times[i], i));
+        });
+        measure("TimerHeap update", count, [&]{
+            for (std::size_t i = 0; i < count; i++) heap.update(handles[i], times[count - i - 1]);
+        });
+        measure("TimerHeap cancel", count / 2, [&]{
+            for (std::size_t i = 0; i < count; i+=2) heap.remove(handles[i]);
+        });
+        std::size_t left = heap.size();
+        measure("TimerHeap expire", left, [&]{
+            while (!heap.empty()) heap.pop();
+        });
+    }
+    {
+        //scheduler keyed by ident, cancel finds the timer by ident
+        Scheduler<std::optional<std::size_t> > sch;
+        measure("Scheduler schedule", count, [&]{
+            for (std::size_t i = 0; i < count; i++) sch.schedule(&times[i], i, times[i]);
+        });
+        measure("Scheduler cancel", count / 2, [&]{
+            for (std::size_t i = 0; i < count; i+=2) sch.cancel_schedule(&times[i]);
+        });
+        std::size_t expired = 0;
+        auto now = base + std::chrono::milliseconds(60001);
+        measure("Scheduler expire", count - count / 2, [&]{
+            auto r = sch.check_expired(now);
+            while (std::holds_alternative<std::optional<std::size_t> >(r)) {
+                ++expired;
+                r = sch.check_expired(now);
+            }
+        });
+        if (expired != count - count / 2) {
+            std::cerr << "Unexpected count of expired timers: " << expired << std::endl;
+            return 1;
+        }
+    }
+}
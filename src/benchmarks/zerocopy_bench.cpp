@@ -0,0 +1,91 @@
+#include <coroserver/io_context.h>
+#include <coroserver/stream.h>
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Measures CPU time spent to send 1 GB with and without MSG_ZEROCOPY for
+//various sizes of single write.
+//
+//usage: zerocopy_bench [discard_host:port]
+//
+//Without argument, data are sent to local sink thread. Note that the kernel
+//copies the data on loopback anyway, so the benefit is visible only when data are
+//sent to remote host (for example to discard service: socat TCP-LISTEN:9,fork,reuseaddr - >/dev/null)
+
+using namespace coroserver;
+
+static constexpr std::size_t total_bytes = std::size_t(1) << 30;
+
+static double cpu_time() {
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6
+         + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+}
+
+cocls::async<bool> sender(Stream s, std::string_view payload, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+        if (!co_await s.write(payload)) co_return false;
+    }
+    co_return co_await s.write_eof();
+}
+
+static void sink(int s) {
+    std::vector<char> buff(1 << 20);
+    while (::read(s, buff.data(), buff.size()) > 0);
+    ::close(s);
+}
+
+static void run(ContextIO ctx, std::vector<PeerName> target, std::size_t size, bool zerocopy) {
+    SocketOptions opts;
+    opts.zerocopy_threshold = zerocopy?size:0;
+    std::thread sink_thr;
+    bool local = target.empty();
+    if (local) {
+        int lsn = ::socket(AF_INET, SOCK_STREAM|SOCK_CLOEXEC, 0);
+        PeerName::lookup("127.0.0.1", "0")[0].use_sockaddr([&](const sockaddr *saddr, socklen_t slen) {
+            return ::bind(lsn, saddr, slen);
+        });
+        ::listen(lsn, 1);
+        target = {PeerName::from_socket(lsn, false)};
+        sink_thr = std::thread([lsn]{
+            int s = ::accept(lsn, nullptr, nullptr);
+            ::close(lsn);
+            if (s >= 0) sink(s);
+        });
+    }
+
+    std::string payload(size, 'x');
+    Stream s = ctx.connect(target, 5000, {10000,10000}, opts).wait();
+    double start = cpu_time();
+    auto wall = std::chrono::steady_clock::now();
+    bool ok = sender(s, payload, total_bytes / size).start().wait();
+    double cpu = cpu_time() - start;
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall).count();
+    if (local) sink_thr.join();
+
+    std::cout << "size=" << size << (zerocopy?" zerocopy":" copy    ")
+              << (ok?"":" (failed)")
+              << ": cpu " << cpu << " s/GB, wall " << secs << " s" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    ContextIO ctx = ContextIO::create(1);
+    std::vector<PeerName> target;
+    if (argc > 1) target = PeerName::lookup(argv[1], "9");
+
+    for (std::size_t size: {16384, 65536, 262144, 1048576}) {
+        run(ctx, target, size, false);
+        run(ctx, target, size, true);
+    }
+    ctx.stop();
+}
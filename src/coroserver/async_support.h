@@ -3,9 +3,15 @@
 #ifndef SRC_COROSERVER_SOCKET_SUPPORT_
 #define SRC_COROSERVER_SOCKET_SUPPORT_
 
+#include "buffer_pool.h"
+#include "clock.h"
+#include "coro_alloc.h"
 #include "defs.h"
 #include <cocls/future.h>
+#include <cerrno>
+#include <chrono>
 #include <memory>
+#include <string_view>
 
 
 namespace coroserver {
@@ -32,10 +38,28 @@ enum class AsyncOperation {
     accept,
     ///connect to a server
     connect,
+    ///message in socket's error queue (EPOLLERR), for example MSG_ZEROCOPY completion
+    errqueue,
 
 _count};  //contains count of states
 
 
+///Result of completion based I/O operation
+/**
+ * @see IAsyncSupport::io_read, IAsyncSupport::io_write
+ */
+struct IOResult {
+    ///state of the operation (complete, timeout, closed, error)
+    WaitResult state = WaitResult::closed;
+    ///count of transfered bytes for complete operation, errno for error
+    int result = 0;
+    ///contains read data. The buffer is borrowed from the context, it must be
+    ///released by release_buffer()
+    std::string_view data = {};
+    ///identifier of borrowed buffer, or -1 if there is no buffer
+    int buffer_id = -1;
+};
+
 
 class IAsyncSupport {
 public:
@@ -43,11 +67,23 @@ public:
     virtual ~IAsyncSupport() = default;
     virtual cocls::future<WaitResult> io_wait(SocketHandle handle,
                                              AsyncOperation op,
-                                             std::chrono::system_clock::time_point timeout) = 0;
+                                             TimePoint timeout) = 0;
     virtual cocls::suspend_point<void> mark_closing(SocketHandle handle) = 0;
     virtual void close(SocketHandle handle) = 0;
-    virtual cocls::future<WaitResult> wait_until(std::chrono::system_clock::time_point tp, const void *ident) = 0;
+    virtual cocls::future<WaitResult> wait_until(TimePoint tp, const void *ident) = 0;
     virtual cocls::suspend_point<bool> cancel_wait(const void *ident) = 0;
+    virtual bool completion_io() const {return false;}
+    virtual cocls::future<IOResult> io_read(SocketHandle, std::size_t, TimePoint) {
+        return cocls::future<IOResult>::set_value(IOResult{WaitResult::error, ENOTSUP});
+    }
+    virtual cocls::future<IOResult> io_write(SocketHandle, std::string_view, TimePoint) {
+        return cocls::future<IOResult>::set_value(IOResult{WaitResult::error, ENOTSUP});
+    }
+    virtual void release_buffer(int) {}
+    virtual BufferPool &get_buffer_pool() = 0;
+    virtual CoroArena create_coro_arena() {return {};}
+    ///Retrieve time of the current iteration of the reactor (see Clock::Source)
+    virtual TimePoint now() const {return Clock::now();}
 };
 
 /// Suppport context for sockets. (minimal interface)
@@ -79,7 +115,7 @@ public:
      */
     cocls::future<WaitResult> io_wait(SocketHandle handle,
                                       AsyncOperation op,
-                                      std::chrono::system_clock::time_point timeout) {
+                                      TimePoint timeout) {
                                         return _ptr->io_wait(handle, op, timeout);
                                       }
 
@@ -119,7 +155,7 @@ public:
      * @retval WaitResult::complete operation has been canceled (cancel request is complete)
      * @retval WaitResult::closed operation has been canceled because context has been stopped
      */
-    cocls::future<WaitResult> wait_until(std::chrono::system_clock::time_point tp, const void *ident) {
+    cocls::future<WaitResult> wait_until(TimePoint tp, const void *ident) {
         return _ptr->wait_until(tp,ident);;
     }
     ///Wait for specified duration
@@ -137,7 +173,16 @@ public:
      */
     template<typename Dur>
     cocls::future<WaitResult> wait_for(Dur duration, const void *ident) {
-        return wait_until(std::chrono::system_clock::now()+duration, ident);
+        return wait_until(now()+duration, ident);
+    }
+    ///Retrieve current time for deadlines
+    /**
+     * @return time of the current iteration of the reactor, which resumed the caller.
+     * It saves reading of the clock for each I/O operation. If the reactor is
+     * not running, the clock is read directly
+     */
+    TimePoint now() const {
+        return _ptr->now();
     }
     ///Cancels specified waiting
     /**
@@ -149,6 +194,77 @@ public:
         return _ptr->cancel_wait(ident);
     }
 
+    ///Determines whether context supports completion based I/O
+    /**
+     * @retval true context supports io_read() and io_write(). These functions
+     * performs whole I/O operation in the context, which saves syscalls
+     * @retval false context supports only io_wait(), so I/O operation must be performed
+     * by the caller when the handle is signaled
+     */
+    bool completion_io() const {
+        return _ptr->completion_io();
+    }
+
+    ///Perform completion based read
+    /**
+     * @param handle socket handle
+     * @param size maximum size of data to read
+     * @param timeout timeout
+     * @return future resolved once the read is complete. When state is WaitResult::complete,
+     * the field result contains count of bytes read (0 means EOF) and field data contains
+     * read data. The data are stored in a buffer borrowed from the context,
+     * you need to call release_buffer() once the data are processed.
+     *
+     * @note only available when completion_io() returns true. State WaitResult::error
+     * with result ENOBUFS means, that there is no free buffer, you need to use io_wait()
+     * and read the data into own buffer
+     */
+    cocls::future<IOResult> io_read(SocketHandle handle, std::size_t size,
+                                     TimePoint timeout) {
+        return _ptr->io_read(handle, size, timeout);
+    }
+
+    ///Perform completion based write
+    /**
+     * @param handle socket handle
+     * @param data data to write. The data must remain valid until the operation completes
+     * @param timeout timeout
+     * @return future resolved once the write is complete. When state is WaitResult::complete,
+     * the field result contains count of bytes written.
+     *
+     * @note only available when completion_io() returns true.
+     */
+    cocls::future<IOResult> io_write(SocketHandle handle, std::string_view data,
+                                      TimePoint timeout) {
+        return _ptr->io_write(handle, data, timeout);
+    }
+
+    ///Release buffer borrowed by io_read()
+    /**
+     * @param buffer_id id of the buffer
+     */
+    void release_buffer(int buffer_id) {
+        _ptr->release_buffer(buffer_id);
+    }
+
+    ///Retrieve pool of read buffers
+    /**
+     * Streams borrow the read buffer from the pool when data are ready and return
+     * it once the data are processed. Each reactor has own pool
+     */
+    BufferPool &get_buffer_pool() {
+        return _ptr->get_buffer_pool();
+    }
+
+    ///Create arena for coroutine frames of a connection
+    /**
+     * @return arena. If the context doesn't support arenas, returns empty arena, which
+     * allocates frames from the heap
+     */
+    CoroArena create_coro_arena() {
+        return _ptr->create_coro_arena();
+    }
+
 protected:
     std::shared_ptr<IAsyncSupport> _ptr;
 
@@ -0,0 +1,76 @@
+#include "buffer_pool.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace coroserver {
+
+BufferPool::~BufferPool() {
+    trim_to(0);
+}
+
+BufferPool::Buffer BufferPool::get(std::size_t size) {
+    std::lock_guard _(_mx);
+    std::size_t sz = std::bit_ceil(std::clamp<std::size_t>(size, _cfg.min_size, _cfg.max_size));
+    auto &lst = _free[std::bit_width(sz) - 1];
+    char *data;
+    if (lst.empty()) {
+        data = new char[sz];
+    } else {
+        data = lst.back();
+        lst.pop_back();
+        _stats.free_bytes -= sz;
+    }
+    ++_stats.borrowed;
+    _stats.borrowed_bytes += sz;
+    return Buffer(this, data, sz);
+}
+
+void BufferPool::put(char *data, std::size_t size) {
+    std::lock_guard _(_mx);
+    --_stats.borrowed;
+    _stats.borrowed_bytes -= size;
+    if (_stats.free_bytes + size > _cfg.max_free_bytes) {
+        delete [] data;
+    } else {
+        _free[std::bit_width(size) - 1].push_back(data);
+        _stats.free_bytes += size;
+    }
+}
+
+void BufferPool::set_config(const Config &cfg) {
+    std::lock_guard _(_mx);
+    _cfg = cfg;
+    _cfg.min_size = std::max<std::size_t>(_cfg.min_size, 1);
+    _cfg.max_size = std::max(_cfg.max_size, _cfg.min_size);
+    trim_to(_cfg.max_free_bytes);
+}
+
+BufferPool::Config BufferPool::get_config() const {
+    std::lock_guard _(_mx);
+    return _cfg;
+}
+
+BufferPool::Stats BufferPool::get_stats() const {
+    std::lock_guard _(_mx);
+    return _stats;
+}
+
+void BufferPool::trim() {
+    std::lock_guard _(_mx);
+    trim_to(0);
+}
+
+void BufferPool::trim_to(std::size_t limit) {
+    //release the largest buffers first
+    for (auto iter = _free.rbegin(); iter != _free.rend() && _stats.free_bytes > limit; ++iter) {
+        std::size_t sz = std::size_t(1) << (std::distance(iter, _free.rend()) - 1);
+        while (!iter->empty() && _stats.free_bytes > limit) {
+            delete [] iter->back();
+            iter->pop_back();
+            _stats.free_bytes -= sz;
+        }
+    }
+}
+
+}
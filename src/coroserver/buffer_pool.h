@@ -0,0 +1,138 @@
+/*
+ * buffer_pool.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_BUFFER_POOL_H_
+#define SRC_COROSERVER_BUFFER_POOL_H_
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace coroserver {
+
+///Pool of read buffers shared by streams of one reactor
+/**
+ * Streams borrow a buffer only when data are ready to be read and return it once
+ * the data has been processed, so idle connections don't occupy any buffer.
+ * Buffers are allocated in size classes (powers of two between min_size and max_size).
+ * Returned buffers are kept for reuse up to max_free_bytes, the rest is returned to
+ * the system.
+ *
+ * The pool is MT safe. The pool must outlive all borrowed buffers
+ */
+class BufferPool {
+public:
+
+    struct Config {
+        ///size of the smallest buffer
+        std::size_t min_size = 1024;
+        ///size of the largest buffer, larger requests are capped
+        std::size_t max_size = 65536;
+        ///maximum total size of free buffers kept in the pool
+        std::size_t max_free_bytes = 4*1024*1024;
+    };
+
+    struct Stats {
+        ///count of borrowed buffers
+        std::size_t borrowed = 0;
+        ///total size of borrowed buffers
+        std::size_t borrowed_bytes = 0;
+        ///total size of free buffers kept in the pool
+        std::size_t free_bytes = 0;
+    };
+
+    ///Borrowed buffer, returns itself to the pool when destroyed
+    class Buffer {
+    public:
+        Buffer() = default;
+        Buffer(Buffer &&other)
+            :_pool(other._pool), _data(other._data), _size(other._size) {
+            other._data = nullptr;
+            other._size = 0;
+        }
+        Buffer &operator=(Buffer &&other) {
+            if (this != &other) {
+                release();
+                _pool = other._pool;
+                _data = other._data;
+                _size = other._size;
+                other._data = nullptr;
+                other._size = 0;
+            }
+            return *this;
+        }
+        ~Buffer() {release();}
+
+        char *data() const {return _data;}
+        std::size_t size() const {return _size;}
+        bool empty() const {return _data == nullptr;}
+
+        ///Return the buffer to the pool
+        void release() {
+            if (_data) {
+                _pool->put(_data, _size);
+                _data = nullptr;
+                _size = 0;
+            }
+        }
+
+    protected:
+        friend class BufferPool;
+        Buffer(BufferPool *pool, char *data, std::size_t size)
+            :_pool(pool), _data(data), _size(size) {}
+
+        BufferPool *_pool = nullptr;
+        char *_data = nullptr;
+        std::size_t _size = 0;
+    };
+
+    BufferPool() = default;
+    explicit BufferPool(const Config &cfg):_cfg(cfg) {}
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+    ~BufferPool();
+
+    ///Borrow a buffer
+    /**
+     * @param size requested size. It is rounded up to the size class and capped
+     * by max_size
+     * @return buffer
+     */
+    Buffer get(std::size_t size);
+
+    ///Change configuration
+    /**
+     * Free buffers above the new limit are released immediately
+     */
+    void set_config(const Config &cfg);
+
+    ///Retrieve configuration
+    Config get_config() const;
+
+    ///Retrieve statistics
+    Stats get_stats() const;
+
+    ///Release all free buffers
+    void trim();
+
+protected:
+
+    ///index of size class (log2 of the size)
+    static constexpr std::size_t class_count = sizeof(std::size_t) * 8;
+
+    mutable std::mutex _mx;
+    Config _cfg;
+    Stats _stats;
+    std::array<std::vector<char *>, class_count> _free;
+
+    void put(char *data, std::size_t size);
+    void trim_to(std::size_t limit);
+};
+
+}
+
+#endif /* SRC_COROSERVER_BUFFER_POOL_H_ */
@@ -0,0 +1,142 @@
+/*
+ * buffered_stream.cpp
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#include "buffered_stream.h"
+#include "socket_stream.h"
+
+namespace coroserver {
+
+BufferedStream::BufferedStream(std::shared_ptr<IStream> proxied, const Config &cfg,
+        std::shared_ptr<SocketStream> socket)
+:AbstractProxyStream(std::move(proxied))
+,_cfg(cfg)
+,_socket(std::move(socket))
+{
+    _buffer.reserve(_cfg.buffer_size);
+}
+
+BufferedStream::~BufferedStream() {
+    if (!_buffer.empty()) _proxied->shutdown();
+    //data held by the cork must be pushed, otherwise the socket can be already used by other stream
+    if (_corked) _socket->set_cork(false);
+}
+
+cocls::future<std::string_view> BufferedStream::read() {
+    auto buff = read_putback_buffer();
+    if (!buff.empty()) return cocls::future<std::string_view>::set_value(buff);
+    return _proxied->read();
+}
+
+std::string_view BufferedStream::read_nb() {
+    auto buff = read_putback_buffer();
+    if (!buff.empty()) return buff;
+    return _proxied->read_nb();
+}
+
+cocls::future<bool> BufferedStream::write(std::string_view buffer) {
+    return write(std::span<const std::string_view>(&buffer, 1));
+}
+
+cocls::future<bool> BufferedStream::write(std::span<const std::string_view> buffers) {
+    std::size_t sz = 0;
+    for (const auto &b: buffers) sz += b.size();
+    bool buffered = false;
+    bool arm = false;
+    {
+        std::lock_guard _(_mx);
+        if (_failed) return cocls::future<bool>::set_value(false);
+        buffered = _buffer.size() + sz <= _cfg.buffer_size;
+        if (buffered) {
+            for (const auto &b: buffers) _buffer.append(b);
+            arm = !_buffer.empty() && !_timer_armed
+                    && _socket && _cfg.flush_delay.count() > 0;
+            if (arm) _timer_armed = true;
+        }
+    }
+    if (buffered) {
+        if (arm) delayed_flush(shared_from_this()).detach();
+        return cocls::future<bool>::set_value(true);
+    }
+    //buffer is full, send it with the data, more data are expected
+    _user_parts.assign(buffers.begin(), buffers.end());
+    return send_buffer(false, true);
+}
+
+cocls::future<bool> BufferedStream::write_eof() {
+    cancel_timer();
+    return finish();
+}
+
+cocls::future<bool> BufferedStream::flush() {
+    cancel_timer();
+    return send_buffer(true, false);
+}
+
+void BufferedStream::cancel_timer() {
+    bool armed;
+    {
+        std::lock_guard _(_mx);
+        armed = _timer_armed;
+    }
+    //the timer holds reference to the stream
+    if (armed) _socket->get_context().cancel_wait(this);
+}
+
+cocls::future<bool> BufferedStream::send_buffer(bool push, bool user_parts) {
+    [[maybe_unused]] auto own = co_await _wrmx.lock();
+    {
+        std::lock_guard _(_mx);
+        if (_failed) co_return false;
+        std::swap(_buffer, _sending);
+        _buffer.clear();
+    }
+    _write_parts.clear();
+    if (!_sending.empty()) _write_parts.push_back(_sending);
+    if (user_parts) _write_parts.insert(_write_parts.end(), _user_parts.begin(), _user_parts.end());
+    if (_socket && _cfg.cork) {
+        _socket->set_cork(!push);
+        _corked = !push;
+    }
+    if (_write_parts.empty()) co_return true;
+    bool ok = co_await _proxied->write(std::span<const std::string_view>(_write_parts));
+    _sending.clear();
+    if (!ok) {
+        std::lock_guard _(_mx);
+        _failed = true;
+    }
+    co_return ok;
+}
+
+cocls::future<bool> BufferedStream::finish() {
+    bool ok = co_await send_buffer(true, false);
+    if (!ok) co_return false;
+    co_return co_await _proxied->write_eof();
+}
+
+cocls::async<void> BufferedStream::delayed_flush(std::shared_ptr<BufferedStream>) {
+    //the argument keeps the stream alive until the timer fires
+    AsyncSupport ctx = _socket->get_context();
+    WaitResult w = co_await ctx.wait_until(ctx.now()+_cfg.flush_delay, this);
+    {
+        std::lock_guard _(_mx);
+        _timer_armed = false;
+        //canceled or the context is stopped
+        if (w != WaitResult::timeout || _buffer.empty()) co_return;
+    }
+    co_await send_buffer(true, false);
+}
+
+Stream BufferedStream::create(Stream target, const Config &cfg, std::shared_ptr<SocketStream> socket) {
+    return Stream(std::make_shared<BufferedStream>(target.getStreamDevice(), cfg, std::move(socket)));
+}
+
+cocls::future<bool> BufferedStream::flush(Stream s) {
+    auto bs = std::dynamic_pointer_cast<BufferedStream>(s.getStreamDevice());
+    if (!bs) return cocls::future<bool>::set_value(true);
+    return bs->flush();
+}
+
+}
@@ -0,0 +1,125 @@
+/*
+ * buffered_stream.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_BUFFERED_STREAM_H_
+#define SRC_COROSERVER_BUFFERED_STREAM_H_
+
+#include "async_support.h"
+#include "stream.h"
+
+#include <cocls/async.h>
+#include <cocls/mutex.h>
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace coroserver {
+
+class SocketStream;
+
+///Buffered (corked) output stream
+/**
+ * Collects small writes into a buffer and sends them to the proxied stream
+ * at once. Writes which fit into the buffer are resolved immediately. The buffer is
+ * sent when it is full, when flush() is called, when the flush delay elapses or on
+ * write_eof(). Write which doesn't fit into the buffer is sent together with content
+ * of the buffer in single (vectored) write.
+ *
+ * If the underlying socket is known, the data sent because the buffer is full are
+ * sent with MSG_MORE (TCP_CORK), so the kernel doesn't send partial segments. Data
+ * are pushed on flush, delayed flush and write_eof.
+ *
+ * Reading is passed to the proxied stream.
+ *
+ * @note Don't forget to call write_eof() or flush() at the end. Destroying the
+ * stream with unsent data shuts down the proxied stream
+ */
+class BufferedStream: public AbstractProxyStream, public std::enable_shared_from_this<BufferedStream> {
+public:
+
+    struct Config {
+        ///size of the buffer
+        std::size_t buffer_size = 16384;
+        ///flush delay. Buffered data are sent after this delay, even if the buffer is not full.
+        /** Value 0 disables delayed flush. Delayed flush requires the socket */
+        std::chrono::microseconds flush_delay = {};
+        ///use MSG_MORE/TCP_CORK on the socket
+        bool cork = true;
+    };
+
+    ///Construct the stream
+    /**
+     * @param proxied target stream
+     * @param cfg configuration
+     * @param socket underlying socket (optional). It is used for corking and as
+     * timer for delayed flush. It can be different from the proxied stream (for
+     * example, when the proxied stream is chunked stream writing to the socket)
+     */
+    BufferedStream(std::shared_ptr<IStream> proxied, const Config &cfg,
+            std::shared_ptr<SocketStream> socket = {});
+    ~BufferedStream();
+
+    virtual cocls::future<std::string_view> read() override;
+    virtual std::string_view read_nb() override;
+    virtual cocls::future<bool> write(std::string_view buffer) override;
+    virtual cocls::future<bool> write(std::span<const std::string_view> buffers) override;
+    virtual cocls::future<bool> write_eof() override;
+
+    ///Send buffered data
+    /**
+     * @return future resolved once the data are written
+     * @retval true success
+     * @retval false failed, the stream has been closed or timeouted
+     */
+    cocls::future<bool> flush();
+
+    ///Create buffered stream
+    /**
+     * @param target target stream
+     * @param cfg configuration
+     * @param socket underlying socket (optional)
+     * @return buffered stream
+     */
+    static Stream create(Stream target, const Config &cfg, std::shared_ptr<SocketStream> socket = {});
+
+    ///Flush the stream, if it is buffered stream
+    /**
+     * @param s stream
+     * @return future resolved once the data are written. If the stream is not
+     * buffered stream, it is resolved immediately with true
+     */
+    static cocls::future<bool> flush(Stream s);
+
+protected:
+    Config _cfg;
+    std::shared_ptr<SocketStream> _socket;
+    ///protects _buffer and flags
+    std::mutex _mx;
+    ///serializes writes to the proxied stream
+    cocls::mutex _wrmx;
+    ///collected data
+    std::string _buffer;
+    ///data being sent
+    std::string _sending;
+    ///copy of list of buffers of the write, which didn't fit into the buffer
+    std::vector<std::string_view> _user_parts;
+    ///list of buffers passed to the proxied stream
+    std::vector<std::string_view> _write_parts;
+    bool _timer_armed = false;
+    bool _failed = false;
+    ///last data were sent corked, the cork must be removed
+    bool _corked = false;
+
+    cocls::future<bool> send_buffer(bool push, bool user_parts);
+    cocls::future<bool> finish();
+    cocls::async<void> delayed_flush(std::shared_ptr<BufferedStream> me);
+    void cancel_timer();
+};
+
+}
+
+#endif /* SRC_COROSERVER_BUFFERED_STREAM_H_ */
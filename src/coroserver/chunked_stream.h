@@ -7,43 +7,118 @@
 
 #ifndef SRC_COROSERVER_CHUNKED_STREAM_H_
 #define SRC_COROSERVER_CHUNKED_STREAM_H_
-#include "stream.h"
+#include "static_stream.h"
 
 #include <cocls/generator.h>
 
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+
 namespace coroserver {
 
-///Chunked stream
+///Chunked stream layer
 /**
- * Creates or read chunked stream which is substream of existing stream
- *
- * To write valid chunked stream, you need to write_eof() after writting the data
- * To read chunked stream, you need to read whole stream, or discard rest of
- * unprocessed data. Breaking this rule can cause breaking connection
- * on target stream during destruction of this object
+ * Reads or writes chunked stream, which is substream of the lower layer
+ * @tparam Lower lower layer
+ * @see static_stream.h, ChunkedStream
  */
-class ChunkedStream: public AbstractProxyStream {
+template<typename Lower>
+class Chunked: public StreamLayer<Lower> {
 public:
 
-    ChunkedStream(std::shared_ptr<IStream> proxied, bool allow_read, bool allow_write);
-    virtual cocls::future<std::string_view> read() override;
-    virtual cocls::future<bool> write(std::string_view buffer) override;
-    virtual cocls::future<bool> write_eof() override;
+    ///Construct the layer
+    /**
+     * @param allow_read enable reading
+     * @param allow_write enable writing
+     * @param args arguments of the lower layer
+     */
+    template<typename ... Args>
+    Chunked(bool allow_read, bool allow_write, Args && ... args)
+        :StreamLayer<Lower>(std::forward<Args>(args)...)
+        ,_write_awt(*this)
+        ,_eof_written(!allow_write)
+        ,_read_awt(*this)
+        ,_rd_state(allow_read?ReadState::number:ReadState::eof) {}
 
-    ///Create chunked stream for reading
-    static Stream read(Stream target);
-    ///Create chunked stream for writing
-    static Stream write(Stream target);
-    ///Create chunked stream for both reading and writing
-    static Stream read_and_write(Stream target);
+    ///Unfinished stream breaks the lower stream, so it is shut down
+    ~Chunked() {
+        if (!is_complete()) this->_lower.shutdown();
+    }
+
+    ///Reinitialize the layer
+    void reset(bool allow_read, bool allow_write) {
+        _eof_written = !allow_write;
+        _rd_state = allow_read?ReadState::number:ReadState::eof;
+        _chunk_size = 0;
+        _new_chunk_write.clear();
+        _write_parts.clear();
+        this->_putback_buffer = {};
+    }
+
+    ///Determines, whether the stream has been read and written completely
+    bool is_complete() const {
+        return _rd_state == ReadState::eof && _eof_written;
+    }
+
+    cocls::future<std::string_view> read() {
+        auto buff = this->read_putback_buffer();
+        if (!buff.empty() || _rd_state == ReadState::eof) return cocls::future<std::string_view>::set_value(buff);
+        return [&](cocls::promise<std::string_view> p) {
+            _read_result = std::move(p);
+            _read_awt << [&]{return this->_lower.read();};
+        };
+    }
 
-    ~ChunkedStream();
+    cocls::future<bool> write(std::string_view buffer) {
+        return write(std::span<const std::string_view>(&buffer, 1));
+    }
+
+    ///Writes all buffers as single chunk
+    cocls::future<bool> write(std::span<const std::string_view> buffers) {
+        if (_eof_written) return cocls::future<bool>::set_value(false);
+        assert(_write_parts.empty() && "Write is still pending");
+        std::size_t sz = 0;
+        for (const auto &b: buffers) sz += b.size();
+        //empty chunk would terminate the stream
+        if (sz == 0) return cocls::future<bool>::set_value(true);
+        hex2str(sz, _new_chunk_write);
+        _new_chunk_write.append("\r\n");
+        //chunk header and the data are written at once
+        _write_parts.push_back(_new_chunk_write);
+        _write_parts.insert(_write_parts.end(), buffers.begin(), buffers.end());
+        return [&](cocls::promise<bool> p) {
+            _write_result = std::move(p);
+            _write_awt << [&]{return this->_lower.write(std::span<const std::string_view>(_write_parts));};
+        };
+    }
+
+    cocls::future<bool> write_eof() {
+        _eof_written = true;
+        _new_chunk_write.append("0\r\n\r\n");
+        return [&](cocls::promise<bool> p) {
+            _write_result = std::move(p);
+            _write_awt << [&]{return this->_lower.write(std::string_view(_new_chunk_write));};
+        };
+    }
 
 protected:
 //write part
-    cocls::suspend_point<void> join_write(cocls::future<bool> &f) noexcept;
-    cocls::call_fn_future_awaiter<&ChunkedStream::join_write> _write_awt;
-    std::string_view _data_to_write;
+    cocls::suspend_point<void> join_write(cocls::future<bool> &f) noexcept {
+        try {
+            bool res = f.value();
+            //the chunk is terminated by header of next chunk
+            _write_parts.clear();
+            _new_chunk_write.clear();
+            _new_chunk_write.append("\r\n");
+            return _write_result(res);
+        } catch (...) {
+            return _write_result(std::current_exception());
+        }
+    }
+    cocls::call_fn_future_awaiter<&Chunked::join_write> _write_awt;
+    ///chunk header followed by the data
+    std::vector<std::string_view> _write_parts;
     std::string _new_chunk_write;
     cocls::promise<bool> _write_result;
     bool _eof_written = false;
@@ -51,20 +126,152 @@ protected:
 //read part
     enum class ReadState {r1,n1,number,r2,n2,check_empty,data,r3,n3,eof};
     cocls::suspend_point<void> join_read(cocls::future<std::string_view> &f) noexcept;
-    cocls::call_fn_future_awaiter<&ChunkedStream::join_read> _read_awt;
+    cocls::call_fn_future_awaiter<&Chunked::join_read> _read_awt;
     cocls::promise<std::string_view> _read_result;
     ReadState _rd_state = ReadState::number;
     std::size_t _chunk_size = 0;
 
+    static void hex2str(std::size_t sz, std::string &out) {
+        static const char hextbl[16] = {'0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f'};
+        if (sz) {
+            hex2str(sz>>4, out);
+            out.push_back(hextbl[sz & 0xF]);
+        }
+    }
+};
+
+template<typename Lower>
+inline cocls::suspend_point<void> Chunked<Lower>::join_read(cocls::future<std::string_view> &f) noexcept {
+
+    auto error = []{
+            throw std::runtime_error("Invalid chunk format");
+    };
 
+    auto next_state = [](ReadState &rd) {
+        rd = static_cast<ReadState>(static_cast<int>(rd)+1);
+    };
 
+    try {
+        std::string_view buff = f.value();
+        if (buff.empty()) {
+            _rd_state = ReadState::eof;
+            return _read_result(buff);
+        }
+        auto itr = buff.begin();
+        auto beg = itr;
+        auto end = buff.end();
+        while (itr != end) {
+            switch(_rd_state) {
+                case ReadState::data: if (_chunk_size) {
+                        std::string_view result(buff.data()+std::distance(beg, itr), std::distance(itr,end));
+                        std::string_view out = result.substr(0,_chunk_size);
+                        this->_lower.put_back(result.substr(out.size()));
+                        _chunk_size-=out.size();
+                        return _read_result(out);
+                    } else {
+                        _rd_state = ReadState::r1;
+                    }break;
+                case ReadState::r1:
+                case ReadState::r2:
+                case ReadState::r3:
+                    if (*itr != '\r') error();
+                    ++itr;
+                    next_state(_rd_state);
+                    break;
+                case ReadState::n1:
+                case ReadState::n2:
+                case ReadState::n3:
+                    if (*itr != '\n') error();
+                    ++itr;
+                    next_state(_rd_state);
+                    break;
+                case ReadState::number: {
+                        int n = 0;
+                        switch (*itr) {
+                            case '0':n = 0;break;
+                            case '1':n = 1;break;
+                            case '2':n = 2;break;
+                            case '3':n = 3;break;
+                            case '4':n = 4;break;
+                            case '5':n = 5;break;
+                            case '6':n = 6;break;
+                            case '7':n = 7;break;
+                            case '8':n = 8;break;
+                            case '9':n = 9;break;
+                            case 'A':n = 10;break;
+                            case 'B':n = 11;break;
+                            case 'C':n = 12;break;
+                            case 'D':n = 13;break;
+                            case 'E':n = 14;break;
+                            case 'F':n = 15;break;
+                            case 'a':n = 10;break;
+                            case 'b':n = 11;break;
+                            case 'c':n = 12;break;
+                            case 'd':n = 13;break;
+                            case 'e':n = 14;break;
+                            case 'f':n = 15;break;
+                            default:
+                                next_state(_rd_state);
+                                continue;
+                        }
+                        _chunk_size = (_chunk_size << 4) | n;
+                        ++itr;
+                    }break;
+                case ReadState::check_empty: {
+                    if (_chunk_size == 0) {
+                        _rd_state = ReadState::r3;
+                    } else {
+                        _rd_state = ReadState::data;
+                    }
+                    break;
+                case ReadState::eof: {
+                        std::string_view pb(buff.data()+std::distance(beg, itr), std::distance(itr,end));
+                        this->_lower.put_back(pb);
+                        return _read_result();
+                }
+                default:
+                    error();
+                    break;
+                }
+            }
+        }
 
-//    cocls::generator<std::string_view> _reader;
+        if (_rd_state == ReadState::eof) return _read_result();
 
+        _read_awt << [&]{return this->_lower.read();};
+        return {};
 
-//    cocls::generator<std::string_view> start_reader();
 
-//    bool _eof_reached = false;
+
+    } catch (...) {
+        return _read_result(std::current_exception());
+    }
+}
+
+///Chunked stream
+/**
+ * Creates or read chunked stream which is substream of existing stream
+ *
+ * To write valid chunked stream, you need to write_eof() after writting the data
+ * To read chunked stream, you need to read whole stream, or discard rest of
+ * unprocessed data. Breaking this rule can cause breaking connection
+ * on target stream during destruction of this object
+ */
+class ChunkedStream: public StaticStream<Chunked<StreamRef> > {
+public:
+
+    ChunkedStream(std::shared_ptr<IStream> proxied, bool allow_read, bool allow_write)
+        :StaticStream(allow_read, allow_write, std::move(proxied)) {}
+
+    using StaticStream::read;
+    using StaticStream::write;
+
+    ///Create chunked stream for reading
+    static Stream read(Stream target);
+    ///Create chunked stream for writing
+    static Stream write(Stream target);
+    ///Create chunked stream for both reading and writing
+    static Stream read_and_write(Stream target);
 };
 
 }
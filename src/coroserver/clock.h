@@ -0,0 +1,85 @@
+/*
+ * clock.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_CLOCK_H_
+#define SRC_COROSERVER_CLOCK_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace coroserver {
+
+///Monotonic clock used for all deadlines
+/**
+ * The clock is compatible with std::chrono::steady_clock (CLOCK_MONOTONIC), so it
+ * doesn't jump when system time is adjusted. Clock::now() reads the clock directly.
+ *
+ * Each reactor publishes the time read once per loop iteration through its
+ * Clock::Source. Coroutines resumed by the reactor obtain this time through
+ * IAsyncSupport::now() (SocketStream, PipeStream, wait_for(), etc), so an I/O
+ * operation doesn't need to read the clock to calculate its deadline. The published
+ * time is never older than the current iteration of the reactor. When the reactor
+ * sleeps or releases its thread, the time is not published and the clock is read
+ * directly.
+ */
+class Clock {
+public:
+    using duration = std::chrono::steady_clock::duration;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::steady_clock::time_point;
+    static constexpr bool is_steady = true;
+
+    ///Retrieve current time
+    static time_point now() noexcept {
+        return std::chrono::steady_clock::now();
+    }
+
+    ///Time published by a reactor
+    class Source {
+    public:
+        ///Retrieve published time, or current time if nothing is published
+        time_point now() const noexcept {
+            rep t = _time.load(std::memory_order_relaxed);
+            if (t) return time_point(duration(t));
+            return Clock::now();
+        }
+
+        ///Read the clock and publish the time
+        /**
+         * @return current time
+         * @note called by the reactor's thread only, after it is woken up
+         */
+        time_point update() noexcept {
+            rep t = Clock::now().time_since_epoch().count();
+            //published time never goes back
+            t = std::max(t, _last);
+            _last = t;
+            _time.store(t, std::memory_order_relaxed);
+            return time_point(duration(t));
+        }
+
+        ///Stop publishing the time
+        /**
+         * @note called by the reactor before it starts to sleep or releases the thread
+         */
+        void invalidate() noexcept {
+            _time.store(0, std::memory_order_relaxed);
+        }
+
+    protected:
+        std::atomic<rep> _time = 0;
+        rep _last = 0;
+    };
+};
+
+///Time point of a deadline
+using TimePoint = Clock::time_point;
+
+}
+
+#endif /* SRC_COROSERVER_CLOCK_H_ */
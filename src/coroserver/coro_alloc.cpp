@@ -0,0 +1,170 @@
+#include "coro_alloc.h"
+
+#include <bit>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+namespace coroserver {
+
+void CoroArenaControl::set_config(const Config &cfg) {
+    _max_block_size.store(cfg.max_block_size, std::memory_order_relaxed);
+    _block_size.store(std::min(cfg.initial_block_size, cfg.max_block_size), std::memory_order_relaxed);
+}
+
+CoroArenaControl::Stats CoroArenaControl::get_stats() const {
+    Stats st;
+    st.arenas = _arenas.load(std::memory_order_relaxed);
+    st.arena_frames = _arena_frames.load(std::memory_order_relaxed);
+    st.heap_frames = _heap_frames.load(std::memory_order_relaxed);
+    st.block_size = _block_size.load(std::memory_order_relaxed);
+    return st;
+}
+
+void CoroArenaControl::report_demand(std::size_t sz) {
+    std::size_t total = std::min(std::bit_ceil(sz), _max_block_size.load(std::memory_order_relaxed));
+    std::size_t c = _block_size.load(std::memory_order_relaxed);
+    while (c < total && !_block_size.compare_exchange_weak(c, total, std::memory_order_relaxed));
+}
+
+///Frames are aligned as by the operator new
+static constexpr std::size_t frame_align = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+static constexpr std::size_t align_size(std::size_t sz) {
+    return (sz + frame_align - 1) & ~(frame_align - 1);
+}
+
+///Stored after each frame
+struct FrameFooter {
+    ///arena of the frame, nullptr if the frame was allocated from the heap
+    CoroArena::Block *blk;
+    ///size of the frame including the footer
+    std::uint32_t size;
+    ///frame has been released, but it is not on top of the arena
+    bool free;
+};
+
+static constexpr std::size_t footer_size = align_size(sizeof(FrameFooter));
+
+static FrameFooter *get_footer(void *ptr, std::size_t sz) {
+    return reinterpret_cast<FrameFooter *>(reinterpret_cast<char *>(ptr) + align_size(sz));
+}
+
+class CoroArena::Block {
+public:
+    Block(std::shared_ptr<CoroArenaControl> ctl)
+        :_ctl(std::move(ctl)) {
+        _stats.capacity = align_size(_ctl->_block_size.load(std::memory_order_relaxed));
+        _buff = reinterpret_cast<char *>(::operator new(_stats.capacity));
+        _ctl->_arenas.fetch_add(1, std::memory_order_relaxed);
+    }
+    ~Block() {
+        _ctl->_arena_frames.fetch_add(_stats.arena_frames, std::memory_order_relaxed);
+        _ctl->_arenas.fetch_sub(1, std::memory_order_relaxed);
+        ::operator delete(_buff);
+    }
+    Block(const Block &) = delete;
+    Block &operator=(const Block &) = delete;
+
+    void add_ref() {
+        _refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    void release() {
+        if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+
+    ///allocate the frame, returns nullptr if there is no space
+    void *alloc(std::size_t sz) {
+        std::size_t need = align_size(sz) + footer_size;
+        std::lock_guard _(_mx);
+        if (_stats.used + need > _stats.capacity) {
+            ++_stats.heap_frames;
+            _ctl->_heap_frames.fetch_add(1, std::memory_order_relaxed);
+            _ctl->report_demand(_stats.used + need);
+            return nullptr;
+        }
+        char *p = _buff + _stats.used;
+        _stats.used += need;
+        _stats.peak = std::max(_stats.peak, _stats.used);
+        ++_stats.arena_frames;
+        new(get_footer(p, sz)) FrameFooter{this, static_cast<std::uint32_t>(need), false};
+        add_ref();
+        return p;
+    }
+
+    void dealloc(FrameFooter *f) {
+        {
+            std::lock_guard _(_mx);
+            f->free = true;
+            //return all released frames on the top
+            while (_stats.used) {
+                auto top = reinterpret_cast<FrameFooter *>(_buff + _stats.used - footer_size);
+                if (!top->free) break;
+                _stats.used -= top->size;
+            }
+        }
+        release();
+    }
+
+    Stats get_stats() const {
+        std::lock_guard _(_mx);
+        return _stats;
+    }
+
+protected:
+    std::shared_ptr<CoroArenaControl> _ctl;
+    mutable std::mutex _mx;
+    std::atomic<unsigned int> _refs = 1;
+    char *_buff;
+    Stats _stats;
+};
+
+CoroArena::CoroArena(std::shared_ptr<CoroArenaControl> ctl)
+    :_blk(new Block(std::move(ctl))) {}
+
+CoroArena::CoroArena(const CoroArena &other):_blk(other._blk) {
+    if (_blk) _blk->add_ref();
+}
+
+CoroArena &CoroArena::operator=(const CoroArena &other) {
+    if (other._blk) other._blk->add_ref();
+    if (_blk) _blk->release();
+    _blk = other._blk;
+    return *this;
+}
+
+CoroArena &CoroArena::operator=(CoroArena &&other) {
+    if (this != &other) {
+        if (_blk) _blk->release();
+        _blk = other._blk;
+        other._blk = nullptr;
+    }
+    return *this;
+}
+
+CoroArena::~CoroArena() {
+    if (_blk) _blk->release();
+}
+
+void *CoroArena::alloc(std::size_t sz) {
+    if (_blk) {
+        void *p = _blk->alloc(sz);
+        if (p) return p;
+    }
+    void *p = ::operator new(align_size(sz) + footer_size);
+    new(get_footer(p, sz)) FrameFooter{nullptr, 0, false};
+    return p;
+}
+
+void CoroArena::dealloc(void *ptr, std::size_t sz) {
+    FrameFooter *f = get_footer(ptr, sz);
+    if (f->blk) f->blk->dealloc(f);
+    else ::operator delete(ptr);
+}
+
+CoroArena::Stats CoroArena::get_stats() const {
+    if (_blk) return _blk->get_stats();
+    return {};
+}
+
+}
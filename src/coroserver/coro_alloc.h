@@ -7,91 +7,125 @@
 
 #ifndef SRC_COROSERVER_CORO_ALLOC_H_
 #define SRC_COROSERVER_CORO_ALLOC_H_
+#include <algorithm>
 #include <atomic>
-#include <cassert>
 #include <cstddef>
+#include <memory>
 
 namespace coroserver {
 
-
-class stackful_storage {
+///Shared state of coroutine arenas - adaptive size of the block and statistics
+/**
+ * One instance is held by the ContextIO. All arenas created by the context
+ * share the size of the block, which grows to the highest demand observed
+ * (up to max_block_size), so in steady state all frames fit to the block
+ */
+class CoroArenaControl {
 public:
-    stackful_storage(std::atomic<std::size_t>  &max_alloc):_max_alloc(max_alloc) {}
-
-    void *alloc(std::size_t sz) {
-        void *ptr = alloc_block(sz+sizeof(stackful_storage *));
-        stackful_storage **x = reinterpret_cast<stackful_storage **>(reinterpret_cast<char *>(ptr)+sz);
-        *x = this;
-        return ptr;
-    }
-
-    static void dealloc(void *ptr, std::size_t sz) {
-        stackful_storage **x = reinterpret_cast<stackful_storage **>(reinterpret_cast<char *>(ptr)+sz);
-        auto inst = *x;
-        inst->dealloc_block(ptr, sz+sizeof(stackful_storage *));
-    }
-
-    stackful_storage(const stackful_storage &) = delete;
-    stackful_storage &operator=(const stackful_storage &) = delete;
-    stackful_storage(stackful_storage &o)
-            :buff(o.buff)
-            ,alloc_size(o.alloc_size)
-            ,capacity(o.capacity)
-            ,over_alloc(o.over_alloc)
-            ,_max_alloc(o._max_alloc) {
-        o.buff = nullptr;
-        o.alloc_size = 0;
-        o.capacity = 0;
-        o.over_alloc = 0;
-    }
-
-    ~stackful_storage() {
-        ::operator delete(buff);
-    }
 
+    struct Config {
+        ///initial size of the block
+        std::size_t initial_block_size = 2048;
+        ///maximum size of the block
+        std::size_t max_block_size = 65536;
+    };
+
+    struct Stats {
+        ///count of existing arenas (connections)
+        std::size_t arenas = 0;
+        ///count of frames allocated from arenas, updated when arena is released
+        std::size_t arena_frames = 0;
+        ///count of frames which didn't fit to the arena and were allocated from the heap
+        std::size_t heap_frames = 0;
+        ///size of the block of new arenas
+        std::size_t block_size = 0;
+    };
+
+    CoroArenaControl(const Config &cfg)
+        :_max_block_size(cfg.max_block_size)
+        ,_block_size(std::min(cfg.initial_block_size, cfg.max_block_size)) {}
+
+    ///Change configuration, affects newly created arenas
+    void set_config(const Config &cfg);
+
+    ///Retrieve statistics
+    Stats get_stats() const;
 
 protected:
-    char *buff = 0;
-    std::size_t alloc_size = 0;
-    std::size_t capacity = 0;
-    std::size_t over_alloc = 0;
-    std::atomic<std::size_t> &_max_alloc;
-
-    void *alloc_block(std::size_t sz) {
-        if (alloc_size == 0) {
-            std::size_t cap = std::max<std::size_t>(sz,_max_alloc.load(std::memory_order_relaxed));
-            if (cap > capacity) {
-                ::operator delete(buff);
-                capacity = cap;
-                buff = reinterpret_cast<char *>(::operator new(capacity));
-            }
-            alloc_size+=sz;
-            return buff;
-        } else if (alloc_size+sz < capacity) {
-            char *p = buff+alloc_size;
-            alloc_size += sz;
-            return p;
-        } else {
-            over_alloc += sz;
-            auto total = over_alloc + over_alloc;
-            std::size_t c = _max_alloc.load(std::memory_order_relaxed);
-            while (c < total && !_max_alloc.compare_exchange_weak(c, total, std::memory_order_relaxed));
-            return ::operator new(sz);
-        }
-    }
-
-    void dealloc_block(void *ptr, std::size_t sz) {
-        if (over_alloc) {
-            assert(over_alloc >= sz);
-            over_alloc-=sz;
-            ::operator delete(ptr);
-        } else {
-            assert(alloc_size >= sz);
-            assert(reinterpret_cast<char *>(ptr) >= buff && reinterpret_cast<char *>(ptr) <= buff+alloc_size-sz);
-            alloc_size-=sz;
-        }
-    }
+    friend class CoroArena;
 
+    std::atomic<std::size_t> _max_block_size;
+    std::atomic<std::size_t> _block_size;
+    std::atomic<std::size_t> _arenas = 0;
+    std::atomic<std::size_t> _arena_frames = 0;
+    std::atomic<std::size_t> _heap_frames = 0;
+
+    ///report demand of an arena - grows the block size
+    void report_demand(std::size_t sz);
+};
+
+///Arena for coroutine frames of one connection
+/**
+ * Frames are allocated by bumping a pointer in one block, which is allocated once
+ * for the connection. Released frames are returned back when they are on the top
+ * of the arena, frames released out of order are returned together with the
+ * frame above them. When the block is full, the frame is allocated from the heap
+ * and the size of blocks of future arenas is increased.
+ *
+ * The object is a handle, copies share the same arena. The block is released
+ * after all handles and all frames are released. Default constructed handle
+ * has no arena, all frames are allocated from the heap.
+ *
+ * Use it as storage of the coroutine (cocls::with_allocator<CoroArena, Coro>).
+ *
+ * The arena is MT safe, however it is intended to be used by coroutines of the
+ * same connection, so it is not contended
+ */
+class CoroArena {
+public:
+
+    struct Stats {
+        ///count of frames allocated from the arena
+        std::size_t arena_frames = 0;
+        ///count of frames allocated from the heap
+        std::size_t heap_frames = 0;
+        ///currently used bytes
+        std::size_t used = 0;
+        ///highest count of used bytes
+        std::size_t peak = 0;
+        ///size of the block
+        std::size_t capacity = 0;
+    };
+
+    ///Construct handle without arena (frames are allocated from the heap)
+    CoroArena() = default;
+    ///Create new arena
+    /**
+     * @param ctl shared control, determines size of the block
+     */
+    explicit CoroArena(std::shared_ptr<CoroArenaControl> ctl);
+    CoroArena(const CoroArena &other);
+    CoroArena(CoroArena &&other):_blk(other._blk) {other._blk = nullptr;}
+    CoroArena &operator=(const CoroArena &other);
+    CoroArena &operator=(CoroArena &&other);
+    ~CoroArena();
+
+    ///Allocate the frame
+    void *alloc(std::size_t sz);
+    ///Release the frame
+    static void dealloc(void *ptr, std::size_t sz);
+
+    ///Retrieve statistics of the arena
+    Stats get_stats() const;
+
+    ///Returns true, if the handle has an arena
+    explicit operator bool() const {return _blk != nullptr;}
+
+    ///implementation of the arena
+    class Block;
+
+protected:
+    Block *_blk = nullptr;
 };
 
 }
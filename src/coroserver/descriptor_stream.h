@@ -0,0 +1,46 @@
+/*
+ * descriptor_stream.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_DESCRIPTOR_STREAM_H_
+#define SRC_COROSERVER_DESCRIPTOR_STREAM_H_
+
+#include "async_support.h"
+
+#include <cstddef>
+
+namespace coroserver {
+
+///Stream backed by descriptors, which allows direct transfers (splice)
+/**
+ * Implemented by SocketStream and PipeStream. Direct transfer bypasses the
+ * stream, so it must not be used while other read or write is pending
+ */
+class IDescriptorStream {
+public:
+    virtual ~IDescriptorStream() = default;
+    ///descriptor used for reading, -1 if the stream can't be read
+    virtual int get_read_fd() const = 0;
+    ///descriptor used for writing, -1 if the stream can't be written
+    virtual int get_write_fd() const = 0;
+    ///context which handles the descriptors
+    virtual AsyncSupport get_context() const = 0;
+    ///Update counters of the stream after direct transfer
+    /**
+     * @param read bytes read from the read descriptor
+     * @param write bytes written to the write descriptor
+     */
+    virtual void add_counters(std::size_t read, std::size_t write) = 0;
+    ///Arena for coroutine frames of the connection
+    /**
+     * @return arena shared by the coroutines serving the connection, or empty arena
+     * (heap) if the stream has no arena
+     */
+    virtual CoroArena get_coro_arena() const {return {};}
+};
+
+}
+
+#endif /* SRC_COROSERVER_DESCRIPTOR_STREAM_H_ */
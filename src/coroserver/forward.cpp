@@ -0,0 +1,150 @@
+/*
+ * forward.cpp
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#include "forward.h"
+#include "descriptor_stream.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <system_error>
+
+namespace coroserver {
+
+///maximum size of single splice (default capacity of the pipe)
+static constexpr std::size_t splice_chunk = 65536;
+
+///Pipe used as intermediate buffer of splice()
+class SplicePipe {
+public:
+    SplicePipe() {
+        if (::pipe2(_fd, O_NONBLOCK|O_CLOEXEC) < 0) _fd[0] = _fd[1] = -1;
+    }
+    ~SplicePipe() {
+        if (valid()) {
+            ::close(_fd[0]);
+            ::close(_fd[1]);
+        }
+    }
+    SplicePipe(const SplicePipe &) = delete;
+    SplicePipe &operator=(const SplicePipe &) = delete;
+
+    bool valid() const {return _fd[0] >= 0;}
+    int read_end() const {return _fd[0];}
+    int write_end() const {return _fd[1];}
+
+protected:
+    int _fd[2];
+};
+
+///Result of splice
+enum class SpliceState {
+    ///some data transfered, or the descriptor is ready
+    ok,
+    ///end of stream, connection closed or timeout
+    closed,
+    ///splice is not supported by the descriptor
+    unsupported
+};
+
+///Process error of splice(), wait for the descriptor if needed
+static cocls::future<SpliceState> splice_error(int err, AsyncSupport ctx, int fd, AsyncOperation op, unsigned int timeout_ms) {
+    switch (err) {
+        case EAGAIN: {
+            WaitResult w = co_await ctx.io_wait(fd, op, TimeoutSettings::from_duration(ctx.now(), timeout_ms));
+            //on error, next splice reports the reason
+            co_return w == WaitResult::complete || w == WaitResult::error?SpliceState::ok:SpliceState::closed;
+        }
+        case EINVAL:
+            co_return SpliceState::unsupported;
+        case EPIPE:
+        case ECONNRESET:
+            co_return SpliceState::closed;
+        default:
+            throw std::system_error(err, std::system_category(), "splice()");
+    }
+}
+
+cocls::future<ForwardResult> forward(Stream from, Stream to, bool write_eof) {
+    ForwardResult res;
+    bool ok = true;
+    bool done = false;
+    auto src = std::dynamic_pointer_cast<IDescriptorStream>(from.getStreamDevice());
+    auto dst = std::dynamic_pointer_cast<IDescriptorStream>(to.getStreamDevice());
+    if (src && dst && src->get_read_fd() >= 0 && dst->get_write_fd() >= 0) {
+        //data already read by the source stream
+        for (std::string_view data = from.read_nb(); ok && !data.empty(); data = from.read_nb()) {
+            ok = co_await to.write(data);
+            if (ok) res.bytes += data.size();
+        }
+        SplicePipe pipe;
+        if (ok && pipe.valid()) {
+            int infd = src->get_read_fd();
+            int outfd = dst->get_write_fd();
+            std::size_t in_pipe = 0;
+            SpliceState st = SpliceState::ok;
+            res.zero_copy = true;
+            while (st == SpliceState::ok && (!done || in_pipe)) {
+                if (!done && !in_pipe) {
+                    ssize_t r = ::splice(infd, nullptr, pipe.write_end(), nullptr, splice_chunk,
+                                         SPLICE_F_MOVE|SPLICE_F_NONBLOCK);
+                    if (r > 0) {
+                        in_pipe = r;
+                        src->add_counters(r, 0);
+                    } else if (r == 0) {
+                        done = true;
+                    } else {
+                        st = co_await splice_error(errno, src->get_context(), infd,
+                                AsyncOperation::read, from.get_timeouts().read_timeout_ms);
+                    }
+                } else {
+                    ssize_t w = ::splice(pipe.read_end(), nullptr, outfd, nullptr, in_pipe,
+                                         SPLICE_F_MOVE|SPLICE_F_NONBLOCK);
+                    if (w > 0) {
+                        in_pipe -= w;
+                        res.bytes += w;
+                        dst->add_counters(0, w);
+                    } else {
+                        st = co_await splice_error(w < 0?errno:EPIPE, dst->get_context(), outfd,
+                                AsyncOperation::write, to.get_timeouts().write_timeout_ms);
+                    }
+                }
+            }
+            if (st == SpliceState::unsupported) {
+                //descriptor doesn't support splice, write what is in the pipe and copy the rest
+                res.zero_copy = false;
+                char buff[4096];
+                while (ok && in_pipe) {
+                    ssize_t r = ::read(pipe.read_end(), buff, std::min(sizeof(buff), in_pipe));
+                    if (r <= 0) break;
+                    in_pipe -= r;
+                    ok = co_await to.write(std::string_view(buff, r));
+                    if (ok) res.bytes += r;
+                }
+            } else {
+                ok = st == SpliceState::ok;
+            }
+        }
+    }
+    if (ok && !res.zero_copy) {
+        while (ok && !done) {
+            std::string_view data = co_await from.read();
+            if (data.empty()) {
+                done = !from.is_read_timeout();
+                ok = done;
+            } else {
+                ok = co_await to.write(data);
+                if (ok) res.bytes += data.size();
+            }
+        }
+    }
+    res.eof = ok && done;
+    if (res.eof && write_eof) co_await to.write_eof();
+    co_return res;
+}
+
+}
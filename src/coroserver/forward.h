@@ -0,0 +1,45 @@
+/*
+ * forward.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_FORWARD_H_
+#define SRC_COROSERVER_FORWARD_H_
+
+#include "stream.h"
+
+#include <cstdint>
+
+namespace coroserver {
+
+///Result of forward()
+struct ForwardResult {
+    ///count of bytes transfered
+    std::uint64_t bytes = 0;
+    ///true, if source stream reached EOF. False means error, timeout or closed target
+    bool eof = false;
+    ///true, if the data were transfered by splice() without copying to the user space
+    bool zero_copy = false;
+};
+
+///Forward data from one stream to other until EOF
+/**
+ * When both streams are backed by descriptors (SocketStream, PipeStream), the data
+ * are moved by splice() through a pipe, so they are never copied to the user space.
+ * Otherwise, the data are copied by read and write. Timeouts of the streams are respected.
+ *
+ * Data which are already buffered in the source stream (put back) are written first.
+ *
+ * @param from source stream. Don't read the stream while forwarding is in progress
+ * @param to target stream. Don't write to the stream while forwarding is in progress
+ * @param write_eof call write_eof() on target stream, when source stream reaches EOF
+ * @return future resolved when forwarding is finished
+ *
+ * @note to forward both directions, call the function twice with swapped streams
+ */
+cocls::future<ForwardResult> forward(Stream from, Stream to, bool write_eof = true);
+
+}
+
+#endif /* SRC_COROSERVER_FORWARD_H_ */
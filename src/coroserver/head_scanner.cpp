@@ -0,0 +1,183 @@
+#include "head_scanner.h"
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define COROSERVER_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace coroserver {
+
+static bool is_head_end(const char *p) {
+    return std::memcmp(p, "\r\n\r\n", 4) == 0;
+}
+
+///Scalar code - only the tail loops are used
+struct ScalarOps {
+    static constexpr std::size_t width = 0;
+    static std::uint32_t match(const char *, char) {return 0;}
+    static std::uint32_t match2(const char *, char, char) {return 0;}
+};
+
+#ifdef COROSERVER_SCAN_X86
+
+struct SSE2Ops {
+    static constexpr std::size_t width = 16;
+    static std::uint32_t match(const char *p, char c) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+    }
+    static std::uint32_t match2(const char *p, char c1, char c2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        return _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(c1)),
+                                              _mm_cmpeq_epi8(v, _mm_set1_epi8(c2))));
+    }
+};
+
+struct AVX2Ops {
+    static constexpr std::size_t width = 32;
+    __attribute__((target("avx2")))
+    static std::uint32_t match(const char *p, char c) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        return _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+    }
+    __attribute__((target("avx2")))
+    static std::uint32_t match2(const char *p, char c1, char c2) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        return _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c1)),
+                                                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c2))));
+    }
+};
+
+#endif
+
+//the separator is found by its last '\n'
+template<typename Ops>
+static std::size_t find_end_impl(const char *data, std::size_t len, std::size_t from) {
+    std::size_t i = from;
+    if constexpr(Ops::width > 0) {
+        for (; i + Ops::width <= len; i += Ops::width) {
+            std::uint32_t m = Ops::match(data + i, '\n');
+            while (m) {
+                std::size_t p = i + std::countr_zero(m);
+                if (p >= 3 && is_head_end(data + p - 3)) return p + 1;
+                m &= m - 1;
+            }
+        }
+    }
+    for (; i < len; ++i) {
+        if (data[i] == '\n' && i >= 3 && is_head_end(data + i - 3)) return i + 1;
+    }
+    return HeadScanner::npos;
+}
+
+template<typename Ops>
+static bool scan_lines_impl(const char *data, std::size_t len, void *ctx, HeadScanner::LineFn fn) {
+    std::size_t line_start = 0;
+    std::size_t colon = HeadScanner::npos;
+    auto emit = [&](std::size_t end) {
+        if (end > line_start && data[end - 1] == '\r') --end;
+        return fn(ctx, std::string_view(data + line_start, end - line_start), colon);
+    };
+    //called for each ':' and '\n'
+    auto on_char = [&](std::size_t p) {
+        if (data[p] == ':') {
+            if (colon == HeadScanner::npos) colon = p - line_start;
+            return true;
+        }
+        bool r = emit(p);
+        line_start = p + 1;
+        colon = HeadScanner::npos;
+        return r;
+    };
+    std::size_t i = 0;
+    if constexpr(Ops::width > 0) {
+        for (; i + Ops::width <= len; i += Ops::width) {
+            std::uint32_t m = Ops::match2(data + i, '\n', ':');
+            while (m) {
+                if (!on_char(i + std::countr_zero(m))) return false;
+                m &= m - 1;
+            }
+        }
+    }
+    for (; i < len; ++i) {
+        char c = data[i];
+        if ((c == '\n' || c == ':') && !on_char(i)) return false;
+    }
+    //last line without separator
+    if (line_start < len) return emit(len);
+    return true;
+}
+
+#ifdef COROSERVER_SCAN_X86
+
+//flatten - the whole loop is compiled for AVX2
+__attribute__((target("avx2"), flatten))
+static std::size_t find_end_avx2(const char *data, std::size_t len, std::size_t from) {
+    return find_end_impl<AVX2Ops>(data, len, from);
+}
+
+__attribute__((target("avx2"), flatten))
+static bool scan_lines_avx2(const char *data, std::size_t len, void *ctx, HeadScanner::LineFn fn) {
+    return scan_lines_impl<AVX2Ops>(data, len, ctx, fn);
+}
+
+static bool has_avx2() {
+    static const bool r = __builtin_cpu_supports("avx2");
+    return r;
+}
+
+#endif
+
+static std::atomic<HeadScanner::Impl> forced_impl = HeadScanner::Impl::automatic;
+
+static HeadScanner::Impl selected_impl() {
+    HeadScanner::Impl impl = forced_impl.load(std::memory_order_relaxed);
+    if (impl != HeadScanner::Impl::automatic) return impl;
+#ifdef COROSERVER_SCAN_X86
+    return has_avx2()?HeadScanner::Impl::avx2:HeadScanner::Impl::sse2;
+#else
+    return HeadScanner::Impl::scalar;
+#endif
+}
+
+bool HeadScanner::force_impl(Impl impl) {
+    switch (impl) {
+#ifdef COROSERVER_SCAN_X86
+        case Impl::avx2: if (!has_avx2()) return false; break;
+        case Impl::sse2: break;
+#else
+        case Impl::avx2:
+        case Impl::sse2: return false;
+#endif
+        default: break;
+    }
+    forced_impl.store(impl, std::memory_order_relaxed);
+    return true;
+}
+
+std::size_t HeadScanner::find_end(std::string_view text, std::size_t from) {
+    switch (selected_impl()) {
+#ifdef COROSERVER_SCAN_X86
+        case Impl::avx2: return find_end_avx2(text.data(), text.size(), from);
+        case Impl::sse2: return find_end_impl<SSE2Ops>(text.data(), text.size(), from);
+#endif
+        default: return find_end_impl<ScalarOps>(text.data(), text.size(), from);
+    }
+}
+
+bool HeadScanner::scan_lines(std::string_view head, void *ctx, LineFn fn) {
+    switch (selected_impl()) {
+#ifdef COROSERVER_SCAN_X86
+        case Impl::avx2: return scan_lines_avx2(head.data(), head.size(), ctx, fn);
+        case Impl::sse2: return scan_lines_impl<SSE2Ops>(head.data(), head.size(), ctx, fn);
+#endif
+        default: return scan_lines_impl<ScalarOps>(head.data(), head.size(), ctx, fn);
+    }
+}
+
+}
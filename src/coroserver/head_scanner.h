@@ -0,0 +1,91 @@
+/*
+ * head_scanner.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_HEAD_SCANNER_H_
+#define SRC_COROSERVER_HEAD_SCANNER_H_
+
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+
+namespace coroserver {
+
+///Scanner of the head of HTTP message (request line, status line and headers)
+/**
+ * The text is scanned by blocks of 32 bytes (AVX2) or 16 bytes (SSE2), the
+ * instruction set is selected at runtime. Other platforms use scalar code
+ */
+class HeadScanner {
+public:
+
+    static constexpr std::size_t npos = std::string_view::npos;
+
+    ///Implementation of the scanner
+    enum class Impl {
+        ///selected by the CPU
+        automatic,
+        scalar,
+        sse2,
+        avx2
+    };
+
+    ///Force the implementation (for testing)
+    /**
+     * @param impl implementation to use. Affects all threads
+     * @retval true set
+     * @retval false implementation is not supported by this CPU, no change
+     */
+    static bool force_impl(Impl impl);
+
+    ///Find end of the head (empty line - "\r\n\r\n")
+    /**
+     * @param text text to search
+     * @param from offset where to start. The separator is also found, when it
+     * starts up to 3 bytes before this offset (so the text can be searched
+     * incrementally as it is received)
+     * @return offset of the first byte after the separator, or npos if not found
+     */
+    static std::size_t find_end(std::string_view text, std::size_t from = 0);
+
+    ///Function called for each line
+    /**
+     * @param ctx context
+     * @param line line without line separator
+     * @param colon position of the first colon in the line, or npos
+     * @retval true continue
+     * @retval false stop
+     */
+    using LineFn = bool (*)(void *ctx, std::string_view line, std::size_t colon);
+
+    ///Split the head to lines, find the first colon of each line
+    /**
+     * Lines are separated by "\r\n" or "\n"
+     * @param head text of the head
+     * @param ctx context passed to the function
+     * @param fn function called for each line
+     * @retval true all lines processed
+     * @retval false stopped by the function
+     */
+    static bool scan_lines(std::string_view head, void *ctx, LineFn fn);
+
+    ///Split the head to lines, find the first colon of each line
+    /**
+     * @param head text of the head
+     * @param fn function called for each line (std::string_view line, std::size_t colon) -> bool
+     * @retval true all lines processed
+     * @retval false stopped by the function
+     */
+    template<typename Fn>
+    static bool for_each_line(std::string_view head, Fn &&fn) {
+        return scan_lines(head, &fn, [](void *ctx, std::string_view line, std::size_t colon) -> bool {
+            return (*static_cast<std::remove_reference_t<Fn> *>(ctx))(line, colon);
+        });
+    }
+};
+
+}
+
+#endif /* SRC_COROSERVER_HEAD_SCANNER_H_ */
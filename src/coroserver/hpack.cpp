@@ -0,0 +1,430 @@
+#include "hpack.h"
+
+#include <algorithm>
+
+namespace coroserver {
+
+namespace http2 {
+
+namespace {
+
+struct HuffCode {
+    std::uint32_t code;
+    std::uint8_t bits;
+};
+
+//RFC 7541 Appendix B, index is the symbol, 256 is EOS
+const HuffCode huffman_table[257] = {
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},
+    {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+    {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+    {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+    {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+    {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+    {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},
+    {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+    {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+    {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},
+    {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},
+    {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+    {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6},
+    {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6},
+    {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+    {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},
+    {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7},
+    {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+    {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7},
+    {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},
+    {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+    {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7},
+    {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13},
+    {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+    {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5},
+    {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6},
+    {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+    {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},
+    {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5},
+    {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+    {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15},
+    {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+    {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+    {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23},
+    {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23},
+    {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+    {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23},
+    {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23},
+    {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+    {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24},
+    {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22},
+    {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+    {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24},
+    {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},
+    {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+    {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23},
+    {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22},
+    {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+    {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19},
+    {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25},
+    {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+    {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25},
+    {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27},
+    {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+    {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26},
+    {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27},
+    {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+    {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},
+    {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25},
+    {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+    {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26},
+    {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27},
+    {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+    {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+    {0x3fffffff, 30},
+};
+
+//The code is canonical - codes of the same length are consecutive and ordered by the symbol
+struct HuffDecodeTable {
+    std::uint32_t first_code[31] = {};
+    std::uint16_t first_index[31] = {};
+    std::uint16_t count[31] = {};
+    std::uint16_t symbols[257] = {};
+
+    HuffDecodeTable() {
+        std::uint16_t idx = 0;
+        for (unsigned int len = 1; len <= 30; ++len) {
+            first_index[len] = idx;
+            for (std::uint16_t s = 0; s < 257; ++s) {
+                if (huffman_table[s].bits == len) {
+                    if (count[len] == 0) first_code[len] = huffman_table[s].code;
+                    symbols[idx++] = s;
+                    ++count[len];
+                }
+            }
+        }
+    }
+};
+
+const HuffDecodeTable huffman_decode_table;
+
+const HeaderField static_table[HPackTable::static_count] = {
+        {":authority",""},
+        {":method","GET"},
+        {":method","POST"},
+        {":path","/"},
+        {":path","/index.html"},
+        {":scheme","http"},
+        {":scheme","https"},
+        {":status","200"},
+        {":status","204"},
+        {":status","206"},
+        {":status","304"},
+        {":status","400"},
+        {":status","404"},
+        {":status","500"},
+        {"accept-charset",""},
+        {"accept-encoding","gzip, deflate"},
+        {"accept-language",""},
+        {"accept-ranges",""},
+        {"accept",""},
+        {"access-control-allow-origin",""},
+        {"age",""},
+        {"allow",""},
+        {"authorization",""},
+        {"cache-control",""},
+        {"content-disposition",""},
+        {"content-encoding",""},
+        {"content-language",""},
+        {"content-length",""},
+        {"content-location",""},
+        {"content-range",""},
+        {"content-type",""},
+        {"cookie",""},
+        {"date",""},
+        {"etag",""},
+        {"expect",""},
+        {"expires",""},
+        {"from",""},
+        {"host",""},
+        {"if-match",""},
+        {"if-modified-since",""},
+        {"if-none-match",""},
+        {"if-range",""},
+        {"if-unmodified-since",""},
+        {"last-modified",""},
+        {"link",""},
+        {"location",""},
+        {"max-forwards",""},
+        {"proxy-authenticate",""},
+        {"proxy-authorization",""},
+        {"range",""},
+        {"referer",""},
+        {"refresh",""},
+        {"retry-after",""},
+        {"server",""},
+        {"set-cookie",""},
+        {"strict-transport-security",""},
+        {"transfer-encoding",""},
+        {"user-agent",""},
+        {"vary",""},
+        {"via",""},
+        {"www-authenticate",""},
+};
+
+constexpr std::size_t entry_overhead = 32;
+
+bool decode_int(const unsigned char *&p, const unsigned char *end, unsigned int prefix, std::size_t &out) {
+    std::size_t mask = (1U << prefix) - 1;
+    out = *p++ & mask;
+    if (out < mask) return true;
+    unsigned int shift = 0;
+    while (p != end) {
+        unsigned char b = *p++;
+        out += static_cast<std::size_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+        shift += 7;
+        //larger numbers are not used
+        if (shift > 28) return false;
+    }
+    return false;
+}
+
+bool decode_str(const unsigned char *&p, const unsigned char *end, std::string &out) {
+    out.clear();
+    if (p == end) return false;
+    bool huffman = (*p & 0x80) != 0;
+    std::size_t len;
+    if (!decode_int(p, end, 7, len)) return false;
+    if (static_cast<std::size_t>(end - p) < len) return false;
+    std::string_view data(reinterpret_cast<const char *>(p), len);
+    p += len;
+    if (huffman) return Huffman::decode(data, out);
+    out.append(data);
+    return true;
+}
+
+void encode_int(std::string &out, unsigned char flags, unsigned int prefix, std::size_t value) {
+    std::size_t mask = (1U << prefix) - 1;
+    if (value < mask) {
+        out.push_back(static_cast<char>(flags | value));
+        return;
+    }
+    out.push_back(static_cast<char>(flags | mask));
+    value -= mask;
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void encode_str(std::string &out, std::string_view str) {
+    std::size_t hsz = Huffman::encoded_size(str);
+    if (hsz < str.size()) {
+        encode_int(out, 0x80, 7, hsz);
+        Huffman::encode(str, out);
+    } else {
+        encode_int(out, 0, 7, str.size());
+        out.append(str);
+    }
+}
+
+}
+
+bool Huffman::decode(std::string_view in, std::string &out) {
+    const auto &tbl = huffman_decode_table;
+    std::uint32_t code = 0;
+    unsigned int len = 0;
+    for (char c: in) {
+        auto b = static_cast<unsigned char>(c);
+        for (int i = 7; i >= 0; --i) {
+            code = (code << 1) | ((b >> i) & 1);
+            ++len;
+            std::uint32_t ofs = code - tbl.first_code[len];
+            if (ofs < tbl.count[len]) {
+                std::uint16_t sym = tbl.symbols[tbl.first_index[len] + ofs];
+                //EOS is not allowed in the string
+                if (sym == 256) return false;
+                out.push_back(static_cast<char>(sym));
+                code = 0;
+                len = 0;
+            } else if (len == 30) {
+                return false;
+            }
+        }
+    }
+    //padding - most significant bits of EOS, at most 7 bits
+    return len < 8 && code == (1U << len) - 1;
+}
+
+std::size_t Huffman::encoded_size(std::string_view in) {
+    std::size_t bits = 0;
+    for (char c: in) bits += huffman_table[static_cast<unsigned char>(c)].bits;
+    return (bits + 7) / 8;
+}
+
+void Huffman::encode(std::string_view in, std::string &out) {
+    std::uint64_t acc = 0;
+    unsigned int bits = 0;
+    for (char c: in) {
+        const HuffCode &h = huffman_table[static_cast<unsigned char>(c)];
+        acc = (acc << h.bits) | h.code;
+        bits += h.bits;
+        while (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<char>(acc >> bits));
+        }
+    }
+    if (bits) {
+        //pad by ones (prefix of EOS)
+        out.push_back(static_cast<char>((acc << (8 - bits)) | (0xFF >> bits)));
+    }
+}
+
+const HeaderField *HPackTable::get(std::size_t index) const {
+    if (index == 0) return nullptr;
+    if (index <= static_count) return &static_table[index-1];
+    index -= static_count + 1;
+    if (index >= _table.size()) return nullptr;
+    return &_table[index];
+}
+
+void HPackTable::evict(std::size_t space) {
+    while (!_table.empty() && _size + space > _max_size) {
+        const HeaderField &f = _table.back();
+        _size -= f.name.size() + f.value.size() + entry_overhead;
+        _table.pop_back();
+    }
+}
+
+void HPackTable::add(std::string_view name, std::string_view value) {
+    std::size_t sz = name.size() + value.size() + entry_overhead;
+    if (sz > _max_size) {
+        //entry larger than the table empties the table
+        _table.clear();
+        _size = 0;
+        return;
+    }
+    evict(sz);
+    _table.push_front(HeaderField{std::string(name), std::string(value)});
+    _size += sz;
+}
+
+void HPackTable::set_max_size(std::size_t sz) {
+    _max_size = sz;
+    evict(0);
+}
+
+std::size_t HPackTable::find(std::string_view name, std::string_view value, bool &name_only) const {
+    std::size_t name_idx = 0;
+    for (std::size_t i = 0; i < static_count; ++i) {
+        const HeaderField &f = static_table[i];
+        if (f.name == name) {
+            if (f.value == value) {
+                name_only = false;
+                return i + 1;
+            }
+            if (!name_idx) name_idx = i + 1;
+        }
+    }
+    for (std::size_t i = 0; i < _table.size(); ++i) {
+        const HeaderField &f = _table[i];
+        if (f.name == name) {
+            if (f.value == value) {
+                name_only = false;
+                return i + static_count + 1;
+            }
+            if (!name_idx) name_idx = i + static_count + 1;
+        }
+    }
+    name_only = true;
+    return name_idx;
+}
+
+bool HPackDecoder::decode(std::string_view block, std::vector<HeaderField> &out) {
+    auto p = reinterpret_cast<const unsigned char *>(block.data());
+    auto end = p + block.size();
+    std::size_t idx;
+    std::size_t list_size = 0;
+    _list_too_large = false;
+    //counts size of the field, returns false, if the field can't be stored
+    auto fits = [&](const HeaderField &f) {
+        if (!_list_too_large) {
+            list_size += f.name.size() + f.value.size() + entry_overhead;
+            _list_too_large = list_size > _max_list_size;
+        }
+        return !_list_too_large;
+    };
+    while (p != end) {
+        unsigned char b = *p;
+        if (b & 0x80) {
+            //indexed field
+            if (!decode_int(p, end, 7, idx)) return false;
+            const HeaderField *f = _table.get(idx);
+            if (!f) return false;
+            if (fits(*f)) out.push_back(*f);
+        } else if ((b & 0xE0) == 0x20) {
+            //dynamic table size update
+            if (!decode_int(p, end, 5, idx) || idx > _max_table_size) return false;
+            _table.set_max_size(idx);
+        } else {
+            //literal, 01 - with incremental indexing, 0000 - without indexing, 0001 - never indexed
+            bool indexing = (b & 0x40) != 0;
+            if (!decode_int(p, end, indexing?6:4, idx)) return false;
+            HeaderField fld;
+            if (idx) {
+                const HeaderField *f = _table.get(idx);
+                if (!f) return false;
+                //field which is not stored doesn't need the name
+                if (indexing || !_list_too_large) fld.name = f->name;
+            } else if (!decode_str(p, end, fld.name)) {
+                return false;
+            }
+            if (!decode_str(p, end, fld.value)) return false;
+            if (indexing) _table.add(fld.name, fld.value);
+            if (fits(fld)) out.push_back(std::move(fld));
+        }
+    }
+    return true;
+}
+
+void HPackEncoder::set_max_table_size(std::size_t sz) {
+    //the encoder never uses more than the default size
+    sz = std::min<std::size_t>(sz, 4096);
+    if (sz != _table.get_max_size()) {
+        _table.set_max_size(sz);
+        _size_update = true;
+    }
+}
+
+void HPackEncoder::encode(std::string_view name, std::string_view value, std::string &out) {
+    if (_size_update) {
+        encode_int(out, 0x20, 5, _table.get_max_size());
+        _size_update = false;
+    }
+    bool name_only;
+    std::size_t idx = _table.find(name, value, name_only);
+    if (idx && !name_only) {
+        encode_int(out, 0x80, 7, idx);
+        return;
+    }
+    if (name == "set-cookie" || name == "authorization") {
+        //never indexed
+        encode_int(out, 0x10, 4, idx);
+    } else if (name == "date" || name == "content-length"
+            || name.size() + value.size() + entry_overhead > _table.get_max_size() / 2) {
+        //values which are rarely repeated are not indexed
+        encode_int(out, 0x00, 4, idx);
+    } else {
+        encode_int(out, 0x40, 6, idx);
+        if (!idx) encode_str(out, name);
+        encode_str(out, value);
+        _table.add(name, value);
+        return;
+    }
+    if (!idx) encode_str(out, name);
+    encode_str(out, value);
+}
+
+}
+
+}
@@ -0,0 +1,153 @@
+/*
+ * hpack.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_HPACK_H_
+#define SRC_COROSERVER_HPACK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace coroserver {
+
+namespace http2 {
+
+///Header field
+struct HeaderField {
+    std::string name;
+    std::string value;
+};
+
+///Huffman code of HPACK (RFC 7541 Appendix B)
+class Huffman {
+public:
+    ///Decode the string
+    /**
+     * @param in encoded string
+     * @param out decoded string is appended
+     * @retval true success
+     * @retval false invalid code
+     */
+    static bool decode(std::string_view in, std::string &out);
+    ///Encode the string
+    /**
+     * @param in string to encode
+     * @param out encoded string is appended
+     */
+    static void encode(std::string_view in, std::string &out);
+    ///Calculate size of encoded string
+    static std::size_t encoded_size(std::string_view in);
+};
+
+///Dynamic table of HPACK
+class HPackTable {
+public:
+    HPackTable(std::size_t max_size):_max_size(max_size) {}
+
+    ///Retrieve field by index (including the static table)
+    /**
+     * @param index index starting by 1
+     * @return pointer to the field, or nullptr, if index is invalid
+     */
+    const HeaderField *get(std::size_t index) const;
+    ///Add field to the dynamic table
+    void add(std::string_view name, std::string_view value);
+    ///Change maximum size of the table
+    void set_max_size(std::size_t sz);
+    std::size_t get_max_size() const {return _max_size;}
+
+    ///Find field
+    /**
+     * @param name name
+     * @param value value
+     * @param name_only receives true, if only the name matches
+     * @return index of the field, or 0 if not found
+     */
+    std::size_t find(std::string_view name, std::string_view value, bool &name_only) const;
+
+    ///Count of entries of the static table
+    static constexpr std::size_t static_count = 61;
+
+protected:
+    std::deque<HeaderField> _table;
+    std::size_t _size = 0;
+    std::size_t _max_size;
+
+    void evict(std::size_t space);
+};
+
+///Decodes header blocks
+class HPackDecoder {
+public:
+
+    ///Construct decoder
+    /**
+     * @param max_table_size maximum size of the dynamic table (SETTINGS_HEADER_TABLE_SIZE
+     * announced to the peer)
+     */
+    HPackDecoder(std::size_t max_table_size = 4096)
+        :_table(max_table_size),_max_table_size(max_table_size) {}
+
+    ///Decode header block
+    /**
+     * @param block complete header block
+     * @param out decoded fields are appended
+     * @retval true success
+     * @retval false compression error, the connection must be closed
+     *
+     * @note when the decoded fields exceed maximum size of the header list, the rest of
+     * fields is not stored (but the block is processed to keep the dynamic table in sync).
+     * Check list_too_large() after successful decoding
+     */
+    bool decode(std::string_view block, std::vector<HeaderField> &out);
+
+    ///Set maximum size of decoded header list (SETTINGS_MAX_HEADER_LIST_SIZE)
+    /**
+     * @param sz maximum size, counted as name + value + 32 for each field
+     */
+    void set_max_list_size(std::size_t sz) {_max_list_size = sz;}
+
+    ///Determines whether the last decoded block exceeded maximum size of the header list
+    bool list_too_large() const {return _list_too_large;}
+
+protected:
+    HPackTable _table;
+    std::size_t _max_table_size;
+    std::size_t _max_list_size = static_cast<std::size_t>(-1);
+    bool _list_too_large = false;
+};
+
+///Encodes header blocks
+class HPackEncoder {
+public:
+
+    HPackEncoder():_table(4096) {}
+
+    ///Encode field
+    /**
+     * @param name name, must be in lower case
+     * @param value value
+     * @param out encoded field is appended
+     */
+    void encode(std::string_view name, std::string_view value, std::string &out);
+
+    ///Change maximum size of the dynamic table (SETTINGS_HEADER_TABLE_SIZE from the peer)
+    void set_max_table_size(std::size_t sz);
+
+protected:
+    HPackTable _table;
+    bool _size_update = false;
+};
+
+
+}
+
+}
+
+#endif /* SRC_COROSERVER_HPACK_H_ */
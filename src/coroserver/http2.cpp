@@ -0,0 +1,1102 @@
+#include "http2.h"
+
+#include "head_scanner.h"
+
+#include <algorithm>
+#include <charconv>
+#include <optional>
+
+namespace coroserver {
+
+namespace http2 {
+
+///Limit of the output buffer, writers of DATA wait when it is reached
+static constexpr std::size_t output_limit = 65536;
+///Maximum size of the head of the response written by the handler
+static constexpr std::size_t max_response_head = 65536;
+static constexpr std::int64_t max_window = 0x7FFFFFFF;
+
+static std::uint32_t get_u32(std::string_view data) {
+    auto b = [&](std::size_t i) {return static_cast<std::uint32_t>(static_cast<unsigned char>(data[i]));};
+    return (b(0) << 24) | (b(1) << 16) | (b(2) << 8) | b(3);
+}
+
+static std::uint16_t get_u16(std::string_view data) {
+    auto b = [&](std::size_t i) {return static_cast<std::uint16_t>(static_cast<unsigned char>(data[i]));};
+    return static_cast<std::uint16_t>((b(0) << 8) | b(1));
+}
+
+static void put_u32(std::string &out, std::uint32_t v) {
+    out.push_back(static_cast<char>((v >> 24) & 0xFF));
+    out.push_back(static_cast<char>((v >> 16) & 0xFF));
+    out.push_back(static_cast<char>((v >> 8) & 0xFF));
+    out.push_back(static_cast<char>(v & 0xFF));
+}
+
+static void put_u16(std::string &out, std::uint16_t v) {
+    out.push_back(static_cast<char>((v >> 8) & 0xFF));
+    out.push_back(static_cast<char>(v & 0xFF));
+}
+
+static bool strip_padding(const FrameHeader &fh, std::string_view &payload) {
+    if (!(fh.flags & flags::padded)) return true;
+    if (payload.empty()) return false;
+    std::size_t pad = static_cast<unsigned char>(payload[0]);
+    payload.remove_prefix(1);
+    if (pad > payload.size()) return false;
+    payload.remove_suffix(pad);
+    return true;
+}
+
+///Headers which are not allowed in HTTP/2 (RFC 9113 8.2.2)
+static bool is_connection_specific(std::string_view name) {
+    return name == "connection" || name == "keep-alive" || name == "proxy-connection"
+            || name == "transfer-encoding" || name == "upgrade";
+}
+
+static bool valid_field(std::string_view name, std::string_view value) {
+    if (name.empty()) return false;
+    for (std::size_t i = 0; i < name.size(); i++) {
+        char c = name[i];
+        if ((c >= 'A' && c <= 'Z') || static_cast<unsigned char>(c) <= ' ' || c == 0x7F || (c == ':' && i)) return false;
+    }
+    return value.find_first_of(std::string_view("\0\r\n", 3)) == value.npos;
+}
+
+///Method must be a token (RFC 9110)
+static bool valid_method(std::string_view method) {
+    if (method.empty()) return false;
+    for (char c: method) {
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) continue;
+        if (std::string_view("!#$%&'*+-.^_`|~").find(c) == std::string_view::npos) return false;
+    }
+    return true;
+}
+
+///Path is copied to the request line, it can't contain spaces and control characters
+static bool valid_path(std::string_view path) {
+    if (path.empty()) return false;
+    for (char c: path) {
+        if (static_cast<unsigned char>(c) <= ' ' || c == 0x7F) return false;
+    }
+    return true;
+}
+
+static std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+static std::string lowercase(std::string_view s) {
+    std::string out(s);
+    for (char &c: out) if (c >= 'A' && c <= 'Z') c = static_cast<char>(c + ('a' - 'A'));
+    return out;
+}
+
+FrameHeader FrameHeader::parse(std::string_view data) {
+    FrameHeader fh;
+    auto b = [&](std::size_t i) {return static_cast<std::uint32_t>(static_cast<unsigned char>(data[i]));};
+    fh.length = (b(0) << 16) | (b(1) << 8) | b(2);
+    fh.type = static_cast<FrameType>(b(3));
+    fh.flags = static_cast<std::uint8_t>(b(4));
+    fh.stream_id = get_u32(data.substr(5)) & 0x7FFFFFFF;
+    return fh;
+}
+
+void FrameHeader::write(std::string &out) const {
+    out.push_back(static_cast<char>((length >> 16) & 0xFF));
+    out.push_back(static_cast<char>((length >> 8) & 0xFF));
+    out.push_back(static_cast<char>(length & 0xFF));
+    out.push_back(static_cast<char>(type));
+    out.push_back(static_cast<char>(flags));
+    put_u32(out, stream_id & 0x7FFFFFFF);
+}
+
+///State of the stream, guarded by the mutex of the connection
+struct ServerConnection::StreamState {
+    enum class InMode {
+        ///data are passed as they are (content-length is known)
+        raw,
+        ///data are passed in chunked format
+        chunked,
+        ///data are discarded (GET and HEAD)
+        discard
+    };
+
+    ///Received data with amount of flow control credit returned when the data are consumed
+    struct Piece {
+        std::string data;
+        std::uint32_t credit;
+    };
+
+    std::uint32_t id;
+    InMode in_mode = InMode::raw;
+    std::deque<Piece> in;
+    ///piece returned by the last read
+    std::string cur;
+    std::uint32_t cur_credit = 0;
+    ///no more data will be received
+    bool in_eof = false;
+    cocls::promise<std::string_view> read_promise;
+    std::size_t received = 0;
+    std::int64_t send_window;
+    std::int64_t recv_window;
+    std::uint32_t recv_credit = 0;
+    bool reset = false;
+    bool end_sent = false;
+    bool head_request = false;
+    ///remaining length of the body declared by content-length, -1 if not declared
+    std::int64_t remain_length = -1;
+
+    StreamState(std::uint32_t id, std::int64_t send_window, std::int64_t recv_window)
+        :id(id), send_window(send_window), recv_window(recv_window) {}
+};
+
+///Stream of one request, carries the request and the response in HTTP/1.1 format
+class ServerConnection::RequestStream: public AbstractProxyStream,
+                                       public std::enable_shared_from_this<RequestStream> {
+public:
+    RequestStream(std::shared_ptr<ServerConnection> conn, std::shared_ptr<StreamState> st)
+        :AbstractProxyStream(conn->_target.getStreamDevice())
+        ,_conn(std::move(conn))
+        ,_st(std::move(st)) {}
+    ~RequestStream();
+
+    virtual cocls::future<std::string_view> read() override;
+    virtual bool is_read_timeout() const override {
+        return false;
+    }
+    virtual cocls::future<bool> write(std::string_view buffer) override {
+        return write(std::span<const std::string_view>(&buffer, 1));
+    }
+    virtual cocls::future<bool> write(std::span<const std::string_view> buffers) override;
+    virtual cocls::future<bool> write_eof() override;
+    ///Timeouts are shared by all streams of the connection, they can't be changed here
+    virtual void set_timeouts(const TimeoutSettings &) override {}
+    virtual Counters get_counters() const noexcept override;
+    virtual cocls::suspend_point<void> shutdown() override;
+
+protected:
+
+    enum class Output {
+        ///waiting for the head of the response
+        head,
+        ///body with content-length
+        length,
+        ///body in chunked format
+        chunked,
+        ///body until write_eof()
+        until_eof,
+        ///response is complete
+        done
+    };
+
+    enum class Chunk {
+        size,
+        extension,
+        data,
+        data_end,
+        trailer,
+        trailer_line
+    };
+
+    std::shared_ptr<ServerConnection> _conn;
+    std::shared_ptr<StreamState> _st;
+    std::size_t _written = 0;
+    std::vector<std::string_view> _parts;
+    std::string _head;
+    std::vector<HeaderField> _fields;
+    Output _output = Output::head;
+    Chunk _chunk = Chunk::size;
+    std::uint64_t _remain = 0;
+
+    cocls::with_allocator<CoroArena, cocls::async<bool> > write_coro(CoroArena &, std::shared_ptr<RequestStream> me);
+    bool parse_head(bool &end_stream);
+    std::string_view dechunk(std::string_view &data, bool &end);
+    void reset(ErrorCode code);
+};
+
+ServerConnection::ServerConnection(Stream target, CoroArena arena, const Settings &settings)
+    :_target(std::move(target))
+    ,_arena(std::move(arena))
+    ,_settings(settings) {
+    _settings.max_frame_size = std::clamp<std::uint32_t>(_settings.max_frame_size, 16384, 16777215);
+    _settings.initial_window_size = std::min<std::uint32_t>(_settings.initial_window_size, max_window);
+    _settings.connection_window_size = std::clamp<std::uint32_t>(_settings.connection_window_size, 65535, max_window);
+    _decoder.set_max_list_size(_settings.max_header_list_size);
+}
+
+bool ServerConnection::is_preface(std::string_view data) {
+    if (data.size() < 4) return false;
+    auto sz = std::min(data.size(), client_preface.size());
+    return data.substr(0, sz) == client_preface.substr(0, sz);
+}
+
+cocls::future<void> ServerConnection::serve(StreamHandler handler) {
+    _handler = std::move(handler);
+    return serve_coro(_arena, shared_from_this());
+}
+
+bool ServerConnection::has_streams() {
+    std::lock_guard _(_mx);
+    return !_streams.empty();
+}
+
+cocls::with_allocator<CoroArena, cocls::async<void> > ServerConnection::serve_coro(CoroArena &, std::shared_ptr<ServerConnection>) {
+    send_settings();
+    //incomplete frame
+    std::string buffer;
+    ErrorCode err = ErrorCode::no_error;
+    bool timeout = false;
+    while (true) {
+        std::string_view data = co_await _target.read();
+        if (data.empty()) {
+            timeout = _target.is_read_timeout();
+            //the connection is not idle while streams are processed
+            if (timeout && has_streams()) continue;
+            break;
+        }
+        std::string_view input = data;
+        if (!buffer.empty()) {
+            buffer.append(data);
+            input = buffer;
+        }
+        err = process_input(input);
+        if (err != ErrorCode::no_error) break;
+        if (input.empty()) {
+            buffer.clear();
+        } else if (buffer.empty()) {
+            buffer.append(input);
+        } else {
+            buffer.erase(0, buffer.size() - input.size());
+        }
+    }
+    if (err != ErrorCode::no_error || timeout) {
+        close(err);
+    } else {
+        finish_reading();
+    }
+}
+
+ErrorCode ServerConnection::process_input(std::string_view &data) {
+    if (!_preface_received) {
+        auto sz = std::min(data.size(), client_preface.size());
+        if (data.substr(0, sz) != client_preface.substr(0, sz)) return ErrorCode::protocol_error;
+        if (sz < client_preface.size()) return ErrorCode::no_error;
+        data.remove_prefix(sz);
+        _preface_received = true;
+    }
+    while (data.size() >= FrameHeader::size) {
+        FrameHeader fh = FrameHeader::parse(data);
+        if (fh.length > _settings.max_frame_size) return ErrorCode::frame_size_error;
+        if (data.size() < FrameHeader::size + fh.length) break;
+        ErrorCode err = process_frame(fh, data.substr(FrameHeader::size, fh.length));
+        if (err != ErrorCode::no_error) return err;
+        data.remove_prefix(FrameHeader::size + fh.length);
+    }
+    return ErrorCode::no_error;
+}
+
+ErrorCode ServerConnection::process_frame(const FrameHeader &fh, std::string_view payload) {
+    //header block can't be interrupted by other frames
+    if (_header_stream && (fh.type != FrameType::continuation || fh.stream_id != _header_stream)) {
+        return ErrorCode::protocol_error;
+    }
+    switch (fh.type) {
+        case FrameType::data: return on_data(fh, payload);
+        case FrameType::headers: return on_headers(fh, payload);
+        case FrameType::priority: return fh.stream_id?ErrorCode::no_error:ErrorCode::protocol_error;
+        case FrameType::rst_stream: return on_rst_stream(fh, payload);
+        case FrameType::settings: return on_settings(fh, payload);
+        case FrameType::push_promise: return ErrorCode::protocol_error;
+        case FrameType::ping: return on_ping(fh, payload);
+        case FrameType::goaway: return fh.stream_id?ErrorCode::protocol_error:ErrorCode::no_error;
+        case FrameType::window_update: return on_window_update(fh, payload);
+        case FrameType::continuation: return on_continuation(fh, payload);
+        //unknown frames are ignored
+        default: return ErrorCode::no_error;
+    }
+}
+
+ErrorCode ServerConnection::on_data(const FrameHeader &fh, std::string_view payload) {
+    if (fh.stream_id == 0) return ErrorCode::protocol_error;
+    std::uint32_t flow = fh.length;
+    if (!strip_padding(fh, payload)) return ErrorCode::protocol_error;
+    Notify ntf;
+    std::unique_lock lk(_mx);
+    _recv_window -= flow;
+    if (_recv_window < 0) return ErrorCode::flow_control_error;
+    auto iter = _streams.find(fh.stream_id);
+    if (iter == _streams.end() || iter->second->in_eof) {
+        if (fh.stream_id > _last_stream_id) return ErrorCode::protocol_error;
+        //stream is closed, data are dropped
+        if (iter != _streams.end()) reset_stream(*iter->second, ErrorCode::stream_closed, ntf);
+        consumed(nullptr, flow, ntf);
+    } else {
+        StreamState &st = *iter->second;
+        st.recv_window -= flow;
+        if (st.recv_window < 0) {
+            reset_stream(st, ErrorCode::flow_control_error, ntf);
+            consumed(nullptr, flow, ntf);
+        } else {
+            std::uint32_t size = static_cast<std::uint32_t>(payload.size());
+            bool length_error = false;
+            if (st.remain_length >= 0) {
+                st.remain_length -= size;
+                length_error = st.remain_length < 0 || ((fh.flags & flags::end_stream) && st.remain_length > 0);
+            }
+            if (length_error) {
+                //data don't match the content-length
+                reset_stream(st, ErrorCode::protocol_error, ntf);
+                consumed(nullptr, flow, ntf);
+                lk.unlock();
+                notify(ntf);
+                return ErrorCode::no_error;
+            }
+            //padding is consumed immediately
+            consumed(&st, flow - size, ntf);
+            if (st.in_mode == StreamState::InMode::discard) {
+                consumed(&st, size, ntf);
+            } else if (size) {
+                std::string piece;
+                if (st.in_mode == StreamState::InMode::chunked) {
+                    char buff[20];
+                    auto r = std::to_chars(buff, buff+sizeof(buff), size, 16);
+                    piece.reserve(size + 24);
+                    piece.append(buff, r.ptr);
+                    piece.append("\r\n");
+                    piece.append(payload);
+                    piece.append("\r\n");
+                } else {
+                    piece.append(payload);
+                }
+                st.in.push_back({std::move(piece), size});
+            }
+            if (fh.flags & flags::end_stream) end_input(st, ntf);
+            else deliver(st, ntf);
+        }
+    }
+    lk.unlock();
+    notify(ntf);
+    return ErrorCode::no_error;
+}
+
+ErrorCode ServerConnection::on_headers(const FrameHeader &fh, std::string_view payload) {
+    if (fh.stream_id == 0 || (fh.stream_id & 1) == 0) return ErrorCode::protocol_error;
+    if (!strip_padding(fh, payload)) return ErrorCode::protocol_error;
+    if (fh.flags & flags::priority) {
+        if (payload.size() < 5) return ErrorCode::protocol_error;
+        payload.remove_prefix(5);
+    }
+    if (payload.size() > _settings.max_header_block) return ErrorCode::enhance_your_calm;
+    _header_stream = fh.stream_id;
+    _header_end_stream = (fh.flags & flags::end_stream) != 0;
+    _header_block.assign(payload);
+    if (fh.flags & flags::end_headers) return end_header_block();
+    return ErrorCode::no_error;
+}
+
+ErrorCode ServerConnection::on_continuation(const FrameHeader &fh, std::string_view payload) {
+    if (!_header_stream) return ErrorCode::protocol_error;
+    if (_header_block.size() + payload.size() > _settings.max_header_block) return ErrorCode::enhance_your_calm;
+    _header_block.append(payload);
+    if (fh.flags & flags::end_headers) return end_header_block();
+    return ErrorCode::no_error;
+}
+
+ErrorCode ServerConnection::end_header_block() {
+    std::uint32_t id = std::exchange(_header_stream, 0);
+    _fields.clear();
+    //the block must be decoded in all cases to keep the dynamic table in sync
+    if (!_decoder.decode(_header_block, _fields)) return ErrorCode::compression_error;
+    Notify ntf;
+    std::unique_lock lk(_mx);
+    if (id <= _last_stream_id) {
+        //trailers of the request, they are not passed to the handler
+        auto iter = _streams.find(id);
+        if (iter != _streams.end() && !iter->second->in_eof) {
+            StreamState &st = *iter->second;
+            if (_decoder.list_too_large()) reset_stream(st, ErrorCode::enhance_your_calm, ntf);
+            else if (_header_end_stream && st.remain_length > 0) reset_stream(st, ErrorCode::protocol_error, ntf);
+            else if (_header_end_stream) end_input(st, ntf);
+            else reset_stream(st, ErrorCode::protocol_error, ntf);
+        }
+        lk.unlock();
+        notify(ntf);
+        return ErrorCode::no_error;
+    }
+    _last_stream_id = id;
+    if (_closed) return ErrorCode::no_error;
+    auto st = std::make_shared<StreamState>(id, _peer_initial_window, _settings.initial_window_size);
+    std::string head;
+    if (_streams.size() >= _settings.max_concurrent_streams) {
+        reset_stream(*st, ErrorCode::refused_stream, ntf);
+    } else if (_decoder.list_too_large()) {
+        //headers exceed the announced limit
+        reset_stream(*st, ErrorCode::enhance_your_calm, ntf);
+    } else if (!build_request(*st, head)) {
+        reset_stream(*st, ErrorCode::protocol_error, ntf);
+    } else {
+        st->in.push_back({std::move(head), 0});
+        if (_header_end_stream) st->in_eof = true;
+        _streams.emplace(id, st);
+    }
+    lk.unlock();
+    notify(ntf);
+    if (!st->reset) {
+        _handler(Stream(std::make_shared<RequestStream>(shared_from_this(), std::move(st))));
+    }
+    return ErrorCode::no_error;
+}
+
+bool ServerConnection::build_request(StreamState &st, std::string &head) {
+    std::string_view method, scheme, path, authority;
+    std::string headers;
+    std::string cookie;
+    bool regular = false;
+    bool has_host = false;
+    bool has_length = false;
+    for (const auto &f: _fields) {
+        std::string_view name = f.name;
+        if (!valid_field(name, f.value)) return false;
+        if (name.front() == ':') {
+            //pseudo-headers must precede regular headers
+            if (regular) return false;
+            if (name == ":method") method = f.value;
+            else if (name == ":scheme") scheme = f.value;
+            else if (name == ":path") path = f.value;
+            else if (name == ":authority") authority = f.value;
+            else return false;
+            continue;
+        }
+        regular = true;
+        if (is_connection_specific(name)) return false;
+        //te can contain only "trailers", it has no meaning for the handler
+        if (name == "te") continue;
+        if (name == "cookie") {
+            //cookies can be split to multiple fields
+            if (!cookie.empty()) cookie.append("; ");
+            cookie.append(f.value);
+            continue;
+        }
+        if (name == "host") has_host = true;
+        if (name == "content-length") {
+            std::int64_t v = 0;
+            auto r = std::from_chars(f.value.data(), f.value.data()+f.value.size(), v);
+            if (r.ec != std::errc() || r.ptr != f.value.data()+f.value.size() || v < 0) return false;
+            //repeated content-length must have the same value
+            if (has_length && v != st.remain_length) return false;
+            has_length = true;
+            st.remain_length = v;
+            //body is declared, but the stream has ended
+            if (_header_end_stream && v > 0) return false;
+        }
+        headers.append(name).append(": ").append(f.value).append("\r\n");
+    }
+    //CONNECT is not supported
+    if (!valid_method(method) || method == "CONNECT" || scheme.empty() || !valid_path(path)) return false;
+    st.head_request = method == "HEAD";
+    head.append(method).append(" ").append(path).append(" HTTP/1.1\r\n");
+    if (!has_host && !authority.empty()) head.append("Host: ").append(authority).append("\r\n");
+    head.append(headers);
+    if (!cookie.empty()) head.append("Cookie: ").append(cookie).append("\r\n");
+    if (method == "GET" || method == "HEAD") {
+        //body is not expected
+        if (!_header_end_stream) st.in_mode = StreamState::InMode::discard;
+    } else if (!has_length) {
+        //length of the body is not known, pass it as chunked
+        if (_header_end_stream) {
+            head.append("Content-Length: 0\r\n");
+        } else {
+            head.append("Transfer-Encoding: chunked\r\n");
+            st.in_mode = StreamState::InMode::chunked;
+        }
+    }
+    head.append("\r\n");
+    return true;
+}
+
+ErrorCode ServerConnection::on_rst_stream(const FrameHeader &fh, std::string_view payload) {
+    if (fh.stream_id == 0) return ErrorCode::protocol_error;
+    if (payload.size() != 4) return ErrorCode::frame_size_error;
+    Notify ntf;
+    std::unique_lock lk(_mx);
+    auto iter = _streams.find(fh.stream_id);
+    if (iter == _streams.end()) {
+        return fh.stream_id > _last_stream_id?ErrorCode::protocol_error:ErrorCode::no_error;
+    }
+    StreamState &st = *iter->second;
+    if (!st.reset) {
+        st.reset = true;
+        discard_input(st, ntf);
+        ntf.wake = true;
+    }
+    lk.unlock();
+    notify(ntf);
+    return ErrorCode::no_error;
+}
+
+ErrorCode ServerConnection::on_settings(const FrameHeader &fh, std::string_view payload) {
+    if (fh.stream_id) return ErrorCode::protocol_error;
+    if (fh.flags & flags::ack) return payload.empty()?ErrorCode::no_error:ErrorCode::frame_size_error;
+    if (payload.size() % 6) return ErrorCode::frame_size_error;
+    Notify ntf;
+    std::unique_lock lk(_mx);
+    for (std::size_t i = 0; i < payload.size(); i+=6) {
+        auto id = static_cast<SettingID>(get_u16(payload.substr(i)));
+        std::uint32_t v = get_u32(payload.substr(i+2));
+        switch (id) {
+            case SettingID::header_table_size:
+                _encoder.set_max_table_size(v);
+                break;
+            case SettingID::enable_push:
+                if (v > 1) return ErrorCode::protocol_error;
+                break;
+            case SettingID::initial_window_size: {
+                if (v > max_window) return ErrorCode::flow_control_error;
+                std::int64_t delta = static_cast<std::int64_t>(v) - _peer_initial_window;
+                _peer_initial_window = v;
+                for (auto &[sid, st]: _streams) {
+                    st->send_window += delta;
+                    if (st->send_window > max_window) return ErrorCode::flow_control_error;
+                }
+                ntf.wake = true;
+            } break;
+            case SettingID::max_frame_size:
+                if (v < 16384 || v > 16777215) return ErrorCode::protocol_error;
+                _peer_max_frame = v;
+                break;
+            default:
+                break;
+        }
+    }
+    ntf.start_writer |= append_frame(FrameType::settings, flags::ack, 0, {});
+    lk.unlock();
+    notify(ntf);
+    return ErrorCode::no_error;
+}
+
+ErrorCode ServerConnection::on_ping(const FrameHeader &fh, std::string_view payload) {
+    if (fh.stream_id) return ErrorCode::protocol_error;
+    if (payload.size() != 8) return ErrorCode::frame_size_error;
+    if (fh.flags & flags::ack) return ErrorCode::no_error;
+    Notify ntf;
+    {
+        std::lock_guard _(_mx);
+        ntf.start_writer |= append_frame(FrameType::ping, flags::ack, 0, payload);
+    }
+    notify(ntf);
+    return ErrorCode::no_error;
+}
+
+ErrorCode ServerConnection::on_window_update(const FrameHeader &fh, std::string_view payload) {
+    if (payload.size() != 4) return ErrorCode::frame_size_error;
+    std::uint32_t inc = get_u32(payload) & 0x7FFFFFFF;
+    Notify ntf;
+    std::unique_lock lk(_mx);
+    if (fh.stream_id == 0) {
+        if (inc == 0) return ErrorCode::protocol_error;
+        _send_window += inc;
+        if (_send_window > max_window) return ErrorCode::flow_control_error;
+    } else {
+        auto iter = _streams.find(fh.stream_id);
+        if (iter != _streams.end()) {
+            StreamState &st = *iter->second;
+            st.send_window += inc;
+            if (inc == 0) reset_stream(st, ErrorCode::protocol_error, ntf);
+            else if (st.send_window > max_window) reset_stream(st, ErrorCode::flow_control_error, ntf);
+        } else if (fh.stream_id > _last_stream_id) {
+            return ErrorCode::protocol_error;
+        }
+    }
+    ntf.wake = true;
+    lk.unlock();
+    notify(ntf);
+    return ErrorCode::no_error;
+}
+
+void ServerConnection::send_settings() {
+    std::string payload;
+    auto add = [&](SettingID id, std::uint32_t v) {
+        put_u16(payload, static_cast<std::uint16_t>(id));
+        put_u32(payload, v);
+    };
+    add(SettingID::enable_push, 0);
+    add(SettingID::max_concurrent_streams, _settings.max_concurrent_streams);
+    add(SettingID::initial_window_size, _settings.initial_window_size);
+    add(SettingID::max_frame_size, _settings.max_frame_size);
+    add(SettingID::max_header_list_size, _settings.max_header_list_size);
+    Notify ntf;
+    {
+        std::lock_guard _(_mx);
+        ntf.start_writer |= append_frame(FrameType::settings, 0, 0, payload);
+        std::uint32_t inc = _settings.connection_window_size - 65535;
+        if (inc) ntf.start_writer |= append_window_update(0, inc);
+        _recv_window = _settings.connection_window_size;
+    }
+    notify(ntf);
+}
+
+void ServerConnection::close(ErrorCode err) {
+    Notify ntf;
+    {
+        std::lock_guard _(_mx);
+        if (!_closed) {
+            _closed = true;
+            std::string payload;
+            put_u32(payload, _last_stream_id);
+            put_u32(payload, static_cast<std::uint32_t>(err));
+            ntf.start_writer |= append_frame(FrameType::goaway, 0, 0, payload);
+        }
+        for (auto &[id, st]: _streams) {
+            st->reset = true;
+            discard_input(*st, ntf);
+        }
+    }
+    ntf.wake = true;
+    notify(ntf);
+}
+
+void ServerConnection::finish_reading() {
+    Notify ntf;
+    {
+        std::lock_guard _(_mx);
+        _read_closed = true;
+        for (auto &[id, st]: _streams) {
+            if (!st->in_eof) {
+                st->in_eof = true;
+                deliver(*st, ntf);
+            }
+        }
+    }
+    //writers waiting for the window will never get it
+    ntf.wake = true;
+    notify(ntf);
+}
+
+bool ServerConnection::append_frame(FrameType type, std::uint8_t flags, std::uint32_t stream_id, std::string_view payload) {
+    if (_broken) return false;
+    FrameHeader{static_cast<std::uint32_t>(payload.size()), type, flags, stream_id}.write(_out);
+    _out.append(payload);
+    if (_writing) return false;
+    _writing = true;
+    return true;
+}
+
+bool ServerConnection::append_window_update(std::uint32_t stream_id, std::uint32_t inc) {
+    std::string payload;
+    put_u32(payload, inc);
+    return append_frame(FrameType::window_update, 0, stream_id, payload);
+}
+
+void ServerConnection::notify(Notify &ntf) {
+    if (ntf.start_writer) writer(_arena, shared_from_this()).detach();
+    if (ntf.wake) wake_blocked();
+    for (auto &[p, data]: ntf.reads) p(data);
+}
+
+cocls::with_allocator<CoroArena, cocls::async<void> > ServerConnection::writer(CoroArena &, std::shared_ptr<ServerConnection>) {
+    std::string buffer;
+    while (true) {
+        {
+            std::lock_guard _(_mx);
+            if (_out.empty()) {
+                _writing = false;
+                break;
+            }
+            //collected frames are written at once, new frames are collected to the other buffer
+            std::swap(buffer, _out);
+            _out.clear();
+        }
+        wake_blocked();
+        if (!co_await _target.write(buffer)) {
+            {
+                std::lock_guard _(_mx);
+                _broken = true;
+                _out.clear();
+                _writing = false;
+            }
+            close(ErrorCode::internal_error);
+            break;
+        }
+    }
+}
+
+void ServerConnection::wake_blocked() {
+    std::vector<cocls::promise<bool> > blocked;
+    {
+        std::lock_guard _(_mx);
+        std::swap(blocked, _blocked);
+    }
+    for (auto &p: blocked) p(true);
+}
+
+void ServerConnection::deliver(StreamState &st, Notify &ntf) {
+    if (!st.read_promise) return;
+    if (!st.in.empty()) {
+        auto &p = st.in.front();
+        st.cur = std::move(p.data);
+        st.cur_credit = p.credit;
+        st.in.pop_front();
+        st.received += st.cur.size();
+        ntf.reads.emplace_back(std::move(st.read_promise), st.cur);
+    } else if (st.in_eof) {
+        ntf.reads.emplace_back(std::move(st.read_promise), std::string_view());
+    }
+}
+
+void ServerConnection::end_input(StreamState &st, Notify &ntf) {
+    if (st.in_mode == StreamState::InMode::chunked) st.in.push_back({"0\r\n\r\n", 0});
+    st.in_eof = true;
+    deliver(st, ntf);
+}
+
+void ServerConnection::discard_input(StreamState &st, Notify &ntf) {
+    std::uint32_t credit = 0;
+    for (const auto &p: st.in) credit += p.credit;
+    st.in.clear();
+    st.in_eof = true;
+    consumed(nullptr, credit, ntf);
+    deliver(st, ntf);
+}
+
+void ServerConnection::reset_stream(StreamState &st, ErrorCode code, Notify &ntf) {
+    if (st.reset) return;
+    st.reset = true;
+    std::string payload;
+    put_u32(payload, static_cast<std::uint32_t>(code));
+    ntf.start_writer |= append_frame(FrameType::rst_stream, 0, st.id, payload);
+    discard_input(st, ntf);
+    ntf.wake = true;
+}
+
+void ServerConnection::consumed(StreamState *st, std::uint32_t size, Notify &ntf) {
+    if (!size || _closed || _read_closed) return;
+    //window is updated when half of the window has been consumed
+    _recv_credit += size;
+    if (_recv_credit >= _settings.connection_window_size / 2) {
+        ntf.start_writer |= append_window_update(0, _recv_credit);
+        _recv_window += _recv_credit;
+        _recv_credit = 0;
+    }
+    if (st && !st->in_eof) {
+        st->recv_credit += size;
+        if (st->recv_credit >= _settings.initial_window_size / 2) {
+            ntf.start_writer |= append_window_update(st->id, st->recv_credit);
+            st->recv_window += st->recv_credit;
+            st->recv_credit = 0;
+        }
+    }
+}
+
+bool ServerConnection::send_headers(StreamState &st, const std::vector<HeaderField> &fields, bool end_stream) {
+    Notify ntf;
+    std::unique_lock lk(_mx);
+    if (_closed || st.reset) return false;
+    //encoded under the lock, the blocks must be sent in the order of encoding
+    _header_out.clear();
+    for (const auto &f: fields) _encoder.encode(f.name, f.value, _header_out);
+    std::string_view block(_header_out);
+    FrameType type = FrameType::headers;
+    std::uint8_t fl = end_stream?flags::end_stream:0;
+    do {
+        std::string_view part = block.substr(0, _peer_max_frame);
+        block.remove_prefix(part.size());
+        if (block.empty()) fl |= flags::end_headers;
+        ntf.start_writer |= append_frame(type, fl, st.id, part);
+        type = FrameType::continuation;
+        fl = 0;
+    } while (!block.empty());
+    st.end_sent = end_stream;
+    lk.unlock();
+    notify(ntf);
+    return true;
+}
+
+cocls::with_allocator<CoroArena, cocls::async<bool> > ServerConnection::send_data(CoroArena &, std::shared_ptr<StreamState> stptr,
+                                                                                 std::string_view data, bool end_stream) {
+    StreamState &st = *stptr;
+    while (true) {
+        Notify ntf;
+        std::unique_lock lk(_mx);
+        bool fail = _closed || st.reset;
+        if (!fail) {
+            while (_out.size() < output_limit) {
+                if (data.empty()) {
+                    if (end_stream && !st.end_sent) {
+                        ntf.start_writer |= append_frame(FrameType::data, flags::end_stream, st.id, {});
+                        st.end_sent = true;
+                    }
+                    break;
+                }
+                std::int64_t avail = std::min<std::int64_t>({_send_window, st.send_window, _peer_max_frame});
+                if (avail <= 0) break;
+                std::string_view part = data.substr(0, static_cast<std::size_t>(avail));
+                data.remove_prefix(part.size());
+                bool fin = end_stream && data.empty();
+                ntf.start_writer |= append_frame(FrameType::data, fin?flags::end_stream:0, st.id, part);
+                _send_window -= part.size();
+                st.send_window -= part.size();
+                if (fin) st.end_sent = true;
+            }
+        }
+        bool done = !fail && data.empty() && (!end_stream || st.end_sent);
+        //when the reading is closed, window can't be updated
+        bool stuck = _read_closed && _out.size() < output_limit;
+        if (fail || done || stuck) {
+            lk.unlock();
+            notify(ntf);
+            co_return done;
+        }
+        //wait for the window or for the space in the output buffer
+        co_await cocls::future<bool>([&](cocls::promise<bool> p) {
+            _blocked.push_back(std::move(p));
+            lk.unlock();
+            notify(ntf);
+        });
+    }
+}
+
+ServerConnection::RequestStream::~RequestStream() {
+    Notify ntf;
+    {
+        std::lock_guard _(_conn->_mx);
+        _conn->_streams.erase(_st->id);
+        if (!_st->end_sent) {
+            //response is incomplete
+            _conn->reset_stream(*_st, ErrorCode::cancel, ntf);
+        } else if (!_st->in_eof) {
+            //response is complete, the rest of the request is not needed
+            _conn->reset_stream(*_st, ErrorCode::no_error, ntf);
+        }
+        //return credit of unread data to the connection
+        std::uint32_t credit = std::exchange(_st->cur_credit, 0);
+        for (const auto &p: _st->in) credit += p.credit;
+        _st->in.clear();
+        _conn->consumed(nullptr, credit, ntf);
+    }
+    _conn->notify(ntf);
+}
+
+cocls::future<std::string_view> ServerConnection::RequestStream::read() {
+    return [&](cocls::promise<std::string_view> p) {
+        auto pb = read_putback_buffer();
+        if (!pb.empty()) {
+            p(pb);
+            return;
+        }
+        Notify ntf;
+        {
+            std::lock_guard _(_conn->_mx);
+            //data returned by the previous read are consumed now
+            _conn->consumed(_st.get(), std::exchange(_st->cur_credit, 0), ntf);
+            _st->read_promise = std::move(p);
+            _conn->deliver(*_st, ntf);
+        }
+        _conn->notify(ntf);
+    };
+}
+
+IStream::Counters ServerConnection::RequestStream::get_counters() const noexcept {
+    std::lock_guard _(_conn->_mx);
+    return {_st->received, _written};
+}
+
+cocls::future<bool> ServerConnection::RequestStream::write(std::span<const std::string_view> buffers) {
+    _parts.assign(buffers.begin(), buffers.end());
+    for (const auto &b: buffers) _written += b.size();
+    return write_coro(_conn->_arena, shared_from_this());
+}
+
+cocls::with_allocator<CoroArena, cocls::async<bool> > ServerConnection::RequestStream::write_coro(CoroArena &, std::shared_ptr<RequestStream>) {
+    for (std::string_view data: _parts) {
+        while (!data.empty()) {
+            switch (_output) {
+                case Output::head: {
+                    std::size_t prev = _head.size();
+                    _head.append(data);
+                    std::size_t end = HeadScanner::find_end(_head, prev);
+                    if (end == HeadScanner::npos) {
+                        data = {};
+                        if (_head.size() > max_response_head) {
+                            reset(ErrorCode::internal_error);
+                            co_return false;
+                        }
+                        break;
+                    }
+                    data.remove_prefix(end - prev);
+                    _head.resize(end);
+                    bool end_stream = false;
+                    if (!parse_head(end_stream)) {
+                        reset(ErrorCode::internal_error);
+                        co_return false;
+                    }
+                    _head.clear();
+                    //informational response is not forwarded
+                    if (_output == Output::head) break;
+                    if (!_conn->send_headers(*_st, _fields, end_stream)) co_return false;
+                } break;
+                case Output::length: {
+                    std::string_view part = data.substr(0, static_cast<std::size_t>(std::min<std::uint64_t>(data.size(), _remain)));
+                    data.remove_prefix(part.size());
+                    _remain -= part.size();
+                    if (_remain == 0) _output = Output::done;
+                    if (!co_await _conn->send_data(_conn->_arena, _st, part, _remain == 0)) co_return false;
+                } break;
+                case Output::chunked: {
+                    bool end = false;
+                    std::string_view part = dechunk(data, end);
+                    if ((!part.empty() || end) && !co_await _conn->send_data(_conn->_arena, _st, part, end)) co_return false;
+                } break;
+                case Output::until_eof:
+                    if (!co_await _conn->send_data(_conn->_arena, _st, data, false)) co_return false;
+                    data = {};
+                    break;
+                default:
+                    //data after the end of the response are ignored
+                    data = {};
+                    break;
+            }
+        }
+    }
+    co_return true;
+}
+
+bool ServerConnection::RequestStream::parse_head(bool &end_stream) {
+    _fields.clear();
+    int status = 0;
+    bool first = true;
+    bool chunked = false;
+    std::optional<std::uint64_t> length;
+    bool ok = HeadScanner::for_each_line(_head, [&](std::string_view line, std::size_t colon) -> bool {
+        if (first) {
+            //HTTP/1.1 200 OK
+            first = false;
+            auto sp = line.find(' ');
+            if (sp == line.npos) return false;
+            std::string_view code = line.substr(sp+1, 3);
+            auto r = std::from_chars(code.data(), code.data()+code.size(), status);
+            return r.ec == std::errc() && r.ptr == code.data()+code.size() && status >= 100;
+        }
+        if (line.empty()) return true;
+        if (colon == line.npos) return false;
+        std::string name = lowercase(trim(line.substr(0, colon)));
+        std::string_view value = trim(line.substr(colon+1));
+        if (name == "transfer-encoding") {
+            chunked = lowercase(value) == "chunked";
+            return true;
+        }
+        if (is_connection_specific(name)) return true;
+        if (name == "content-length") {
+            std::uint64_t v = 0;
+            auto r = std::from_chars(value.data(), value.data()+value.size(), v);
+            if (r.ec != std::errc() || r.ptr != value.data()+value.size()) return false;
+            length = v;
+        }
+        _fields.push_back({std::move(name), std::string(value)});
+        return true;
+    });
+    if (!ok || first) return false;
+    if (status < 200) return true;
+    _fields.insert(_fields.begin(), HeaderField{":status", std::to_string(status)});
+    if (_st->head_request || status == 204 || status == 304 || (!chunked && length && *length == 0)) {
+        _output = Output::done;
+    } else if (chunked) {
+        _output = Output::chunked;
+        _chunk = Chunk::size;
+        _remain = 0;
+    } else if (length) {
+        _output = Output::length;
+        _remain = *length;
+    } else {
+        _output = Output::until_eof;
+    }
+    end_stream = _output == Output::done;
+    return true;
+}
+
+std::string_view ServerConnection::RequestStream::dechunk(std::string_view &data, bool &end) {
+    while (!data.empty()) {
+        char c = data.front();
+        switch (_chunk) {
+            case Chunk::data: {
+                std::string_view part = data.substr(0, static_cast<std::size_t>(std::min<std::uint64_t>(data.size(), _remain)));
+                data.remove_prefix(part.size());
+                _remain -= part.size();
+                if (_remain == 0) _chunk = Chunk::data_end;
+                return part;
+            }
+            case Chunk::size:
+                if (c >= '0' && c <= '9') _remain = _remain * 16 + (c - '0');
+                else if (c >= 'a' && c <= 'f') _remain = _remain * 16 + (c - 'a' + 10);
+                else if (c >= 'A' && c <= 'F') _remain = _remain * 16 + (c - 'A' + 10);
+                else if (c == ';') _chunk = Chunk::extension;
+                else if (c == '\n') _chunk = _remain?Chunk::data:Chunk::trailer;
+                break;
+            case Chunk::extension:
+                if (c == '\n') _chunk = _remain?Chunk::data:Chunk::trailer;
+                break;
+            case Chunk::data_end:
+                if (c == '\n') {
+                    _chunk = Chunk::size;
+                    _remain = 0;
+                }
+                break;
+            case Chunk::trailer:
+                //empty line ends the body, trailer fields are not forwarded
+                if (c == '\n') {
+                    data.remove_prefix(1);
+                    _output = Output::done;
+                    end = true;
+                    return {};
+                }
+                if (c != '\r') _chunk = Chunk::trailer_line;
+                break;
+            case Chunk::trailer_line:
+                if (c == '\n') _chunk = Chunk::trailer;
+                break;
+        }
+        data.remove_prefix(1);
+    }
+    return {};
+}
+
+cocls::future<bool> ServerConnection::RequestStream::write_eof() {
+    switch (_output) {
+        case Output::done:
+            return cocls::future<bool>::set_value(true);
+        case Output::until_eof:
+            _output = Output::done;
+            return _conn->send_data(_conn->_arena, _st, {}, true);
+        default:
+            //response is incomplete
+            reset(ErrorCode::internal_error);
+            return cocls::future<bool>::set_value(false);
+    }
+}
+
+cocls::suspend_point<void> ServerConnection::RequestStream::shutdown() {
+    Notify ntf;
+    {
+        std::lock_guard _(_conn->_mx);
+        if (!_st->end_sent || !_st->in_eof) {
+            _conn->reset_stream(*_st, _st->end_sent?ErrorCode::no_error:ErrorCode::cancel, ntf);
+        }
+    }
+    _conn->notify(ntf);
+    return {};
+}
+
+void ServerConnection::RequestStream::reset(ErrorCode code) {
+    Notify ntf;
+    {
+        std::lock_guard _(_conn->_mx);
+        _conn->reset_stream(*_st, code, ntf);
+    }
+    _conn->notify(ntf);
+}
+
+}
+
+}
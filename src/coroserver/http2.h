@@ -0,0 +1,280 @@
+/*
+ * http2.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_HTTP2_H_
+#define SRC_COROSERVER_HTTP2_H_
+
+#include "coro_alloc.h"
+#include "hpack.h"
+#include "stream.h"
+
+#include <cocls/async.h>
+#include <cocls/with_allocator.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace coroserver {
+
+namespace http2 {
+
+///Connection preface sent by the client
+constexpr std::string_view client_preface("PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n");
+
+enum class FrameType: std::uint8_t {
+    data = 0,
+    headers = 1,
+    priority = 2,
+    rst_stream = 3,
+    settings = 4,
+    push_promise = 5,
+    ping = 6,
+    goaway = 7,
+    window_update = 8,
+    continuation = 9
+};
+
+namespace flags {
+    constexpr std::uint8_t end_stream = 0x1;
+    constexpr std::uint8_t ack = 0x1;
+    constexpr std::uint8_t end_headers = 0x4;
+    constexpr std::uint8_t padded = 0x8;
+    constexpr std::uint8_t priority = 0x20;
+}
+
+enum class ErrorCode: std::uint32_t {
+    no_error = 0,
+    protocol_error = 1,
+    internal_error = 2,
+    flow_control_error = 3,
+    settings_timeout = 4,
+    stream_closed = 5,
+    frame_size_error = 6,
+    refused_stream = 7,
+    cancel = 8,
+    compression_error = 9,
+    connect_error = 10,
+    enhance_your_calm = 11,
+    inadequate_security = 12,
+    http_1_1_required = 13
+};
+
+enum class SettingID: std::uint16_t {
+    header_table_size = 1,
+    enable_push = 2,
+    max_concurrent_streams = 3,
+    initial_window_size = 4,
+    max_frame_size = 5,
+    max_header_list_size = 6
+};
+
+///Header of a frame
+struct FrameHeader {
+    static constexpr std::size_t size = 9;
+
+    std::uint32_t length = 0;
+    FrameType type = FrameType::data;
+    std::uint8_t flags = 0;
+    std::uint32_t stream_id = 0;
+
+    ///Parse header, the data must have at least 9 bytes
+    static FrameHeader parse(std::string_view data);
+    ///Append serialized header
+    void write(std::string &out) const;
+};
+
+///Settings of the server side of the connection
+struct Settings {
+    ///maximum count of streams processed at the same time
+    std::uint32_t max_concurrent_streams = 100;
+    ///flow control window of a stream (amount of request body buffered per stream)
+    std::uint32_t initial_window_size = 65535;
+    ///flow control window of the connection
+    std::uint32_t connection_window_size = 1048576;
+    ///maximum size of received frame
+    std::uint32_t max_frame_size = 16384;
+    ///maximum size of received header block
+    std::size_t max_header_block = 65536;
+    ///maximum size of decoded headers of a request (name + value + 32 for each field)
+    std::uint32_t max_header_list_size = 65536;
+};
+
+///Server side of HTTP/2 connection
+/**
+ * The connection is served after the client preface is detected (prior knowledge h2c, or
+ * after "h2" was negotiated by ALPN). Each request is passed to the handler as a stream,
+ * which carries request in HTTP/1.1 format. The response written to the stream is
+ * expected in HTTP/1.1 format and it is converted to the HTTP/2 frames. This
+ * allows to process the stream by ServerRequest without change.
+ *
+ * - the request head contains headers of the HTTP/2 request, the pseudo-header :authority
+ * is converted to the Host header. If the request has body without content-length, it
+ * is passed as chunked. The stream is reset when DATA frames don't match the content-length
+ * - the head of response is converted to HEADERS frame, the body is passed in DATA frames,
+ * chunked encoding is removed. Hop-by-hop headers are removed
+ *
+ * Streams are multiplexed, flow control is applied in both directions, all frames are
+ * written by single writer, so frames of multiple streams are sent in single write
+ * when possible.
+ */
+class ServerConnection: public std::enable_shared_from_this<ServerConnection> {
+public:
+
+    ///Handles new request
+    using StreamHandler = std::function<void(Stream)>;
+
+    ///Construct the connection
+    /**
+     * @param target stream of the connection. The preface must be still unread
+     * @param arena arena of the connection, used to allocate coroutine frames
+     * @param settings settings
+     */
+    ServerConnection(Stream target, CoroArena arena, const Settings &settings = {});
+
+    ///Serve the connection
+    /**
+     * @param handler function called for each request
+     * @return future resolved when the connection is closed. Streams which are still
+     * in use are closed as well, pending operations are finished with failure
+     */
+    cocls::future<void> serve(StreamHandler handler);
+
+    ///Determines whether data starts with the client preface
+    /**
+     * @param data first data received from the client. It must have at least 4 bytes to
+     * make decision
+     * @retval true HTTP/2 client
+     * @retval false not HTTP/2 client
+     */
+    static bool is_preface(std::string_view data);
+
+protected:
+
+    class RequestStream;
+    struct StreamState;
+
+    ///Actions performed after the lock is released
+    struct Notify {
+        ///start the writer
+        bool start_writer = false;
+        ///wake blocked writers
+        bool wake = false;
+        ///resolve pending reads
+        std::vector<std::pair<cocls::promise<std::string_view>, std::string_view> > reads;
+    };
+
+    Stream _target;
+    CoroArena _arena;
+    Settings _settings;
+    StreamHandler _handler;
+
+    std::mutex _mx;
+    ///active streams (guarded)
+    std::unordered_map<std::uint32_t, std::shared_ptr<StreamState> > _streams;
+    ///frames waiting to be written (guarded)
+    std::string _out;
+    ///writer is running (guarded)
+    bool _writing = false;
+    ///write failed, nothing can be sent (guarded)
+    bool _broken = false;
+    ///GOAWAY has been sent (guarded)
+    bool _closed = false;
+    ///client closed the connection, no more frames will be received (guarded)
+    bool _read_closed = false;
+    ///send window of the connection (guarded)
+    std::int64_t _send_window = 65535;
+    ///receive window of the connection (guarded)
+    std::int64_t _recv_window = 65535;
+    ///consumed data not yet announced by WINDOW_UPDATE (guarded)
+    std::uint32_t _recv_credit = 0;
+    ///initial window of streams announced by the peer (guarded)
+    std::int64_t _peer_initial_window = 65535;
+    ///maximum frame size announced by the peer (guarded)
+    std::uint32_t _peer_max_frame = 16384;
+    ///writers waiting for the window or for the space in the output buffer (guarded)
+    std::vector<cocls::promise<bool> > _blocked;
+    ///encoder of headers (guarded)
+    HPackEncoder _encoder;
+    std::string _header_out;
+    ///highest id of the stream opened by the client (guarded)
+    std::uint32_t _last_stream_id = 0;
+
+    //state of the reader
+    HPackDecoder _decoder;
+    bool _preface_received = false;
+    std::uint32_t _header_stream = 0;
+    bool _header_end_stream = false;
+    std::string _header_block;
+    std::vector<HeaderField> _fields;
+
+    cocls::with_allocator<CoroArena, cocls::async<void> > serve_coro(CoroArena &, std::shared_ptr<ServerConnection> me);
+    cocls::with_allocator<CoroArena, cocls::async<void> > writer(CoroArena &, std::shared_ptr<ServerConnection> me);
+
+    bool has_streams();
+    ///Process received data, complete frames are removed
+    ErrorCode process_input(std::string_view &data);
+    ErrorCode process_frame(const FrameHeader &fh, std::string_view payload);
+    ErrorCode on_data(const FrameHeader &fh, std::string_view payload);
+    ErrorCode on_headers(const FrameHeader &fh, std::string_view payload);
+    ErrorCode on_continuation(const FrameHeader &fh, std::string_view payload);
+    ErrorCode on_rst_stream(const FrameHeader &fh, std::string_view payload);
+    ErrorCode on_settings(const FrameHeader &fh, std::string_view payload);
+    ErrorCode on_ping(const FrameHeader &fh, std::string_view payload);
+    ErrorCode on_window_update(const FrameHeader &fh, std::string_view payload);
+    ErrorCode end_header_block();
+    ///Convert decoded header block to the head of HTTP/1.1 request
+    bool build_request(StreamState &st, std::string &head);
+    void send_settings();
+    ///Send GOAWAY, fail all pending operations
+    void close(ErrorCode err);
+    ///Client closed the connection, finish pending requests
+    void finish_reading();
+
+    ///Append frame to the output (lock must be held)
+    /**
+     * @return true, if the writer must be started
+     */
+    bool append_frame(FrameType type, std::uint8_t flags, std::uint32_t stream_id, std::string_view payload);
+    bool append_window_update(std::uint32_t stream_id, std::uint32_t inc);
+    ///Perform actions collected under the lock (lock must not be held)
+    void notify(Notify &ntf);
+    void wake_blocked();
+
+    //following functions must be called under the lock
+
+    ///Pass received data to the pending read
+    void deliver(StreamState &st, Notify &ntf);
+    ///END_STREAM received
+    void end_input(StreamState &st, Notify &ntf);
+    ///Drop unread data, reading reports eof
+    void discard_input(StreamState &st, Notify &ntf);
+    ///Send RST_STREAM
+    void reset_stream(StreamState &st, ErrorCode code, Notify &ntf);
+    ///Received data have been consumed, update windows
+    void consumed(StreamState *st, std::uint32_t size, Notify &ntf);
+
+    ///Send HEADERS (and CONTINUATION) frames
+    bool send_headers(StreamState &st, const std::vector<HeaderField> &fields, bool end_stream);
+    ///Send DATA frames
+    /**
+     * Sends data as allowed by the flow control, waits for the window when needed
+     * @param st stream
+     * @param data data to send
+     * @param end_stream set true to end the stream with the last data
+     * @retval true sent
+     * @retval false stream or connection has been closed
+     */
+    cocls::with_allocator<CoroArena, cocls::async<bool> > send_data(CoroArena &, std::shared_ptr<StreamState> st,
+                                                                   std::string_view data, bool end_stream);
+};
+
+}
+
+}
+
+#endif /* SRC_COROSERVER_HTTP2_H_ */
@@ -12,15 +12,17 @@
 #include <cocls/function.h>
 
 #include "io_context.h"
+#include "resolver.h"
 namespace coroserver{
 
 namespace http {
 
 
 inline ConnectionFactory connectionFactory(ContextIO ctx, int timeout_ms, TimeoutSettings tms) {
-    return [ctx  = std::move(ctx), timeout_ms, tms](std::string_view host) mutable ->cocls::future<Stream> {
-        auto list = PeerName::lookup(host, "80");
-        return ctx.connect(std::move(list), timeout_ms, tms);
+    Resolver resolver(ctx);
+    return [ctx  = std::move(ctx), resolver = std::move(resolver), timeout_ms, tms](std::string_view host) mutable ->cocls::future<Stream> {
+        auto list = co_await resolver.lookup(host, "80");
+        co_return co_await ctx.connect(std::move(list), timeout_ms, tms);
     };
 }
 
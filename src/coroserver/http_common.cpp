@@ -1,4 +1,5 @@
 #include "http_common.h"
+#include "head_scanner.h"
 #include "http_stringtables.h"
 #include "strutils.h"
 #include <algorithm>
@@ -16,27 +17,39 @@ ContentType extensionToContentType(const std::string_view &txt) {
 
 bool HeaderMap::headers(const std::string_view hdrstr, HeaderMap &hdrmap, std::string_view &firstLine) {
     hdrmap.clear();
-    auto lnsplt = splitAt(hdrstr, "\r\n");
-    firstLine = lnsplt();
-    if (firstLine.empty()) {
-        return false;
-    }
-    auto ln = lnsplt();
-    while (!ln.empty()) {
+    firstLine = {};
+    bool first = true;
+    bool ok = true;
+    HeadScanner::for_each_line(hdrstr, [&](std::string_view ln, std::size_t colon) {
+        if (first) {
+            first = false;
+            firstLine = ln;
+            return !ln.empty();
+        }
+        //empty line - end of headers
+        if (ln.empty()) return false;
         // An HTTP header consists of its case-insensitive name followed by a colon (:),
-        auto ddsplt = splitAt(ln,":");
-        std::string_view key = ddsplt();
-        std::string_view value = trim(ddsplt);
-        if (key.empty()) return false;
+        std::string_view key = ln.substr(0, colon);
+        std::string_view value = colon == ln.npos?std::string_view():trim(ln.substr(colon+1));
+        if (key.empty()) {
+            ok = false;
+            return false;
+        }
         hdrmap.push_back({key,value});
-        ln = lnsplt();
-    }
-
-    std::stable_sort(hdrmap.begin(), hdrmap.end(), [](const auto &a, const auto &b) {
-        return strILess()(a.first, b.first);
+        return true;
     });
-
-
+    if (!ok || firstLine.empty()) return false;
+
+    //headers are sorted by name, headers with the same name keep order
+    if (hdrmap.size() <= 32) {
+        //insertion sort, usually few headers, doesn't allocate a buffer
+        for (auto iter = hdrmap.begin(); iter != hdrmap.end(); ++iter) {
+            auto pos = std::upper_bound(hdrmap.begin(), iter, *iter, cmpfn_up);
+            std::rotate(pos, iter, iter+1);
+        }
+    } else {
+        std::stable_sort(hdrmap.begin(), hdrmap.end(), cmpfn_up);
+    }
     return true;
 
 }
@@ -0,0 +1,178 @@
+#include "http_pipeline.h"
+
+#include <cassert>
+
+namespace coroserver {
+
+namespace http {
+
+///Stream of one response
+/**
+ * Reading is forwarded to the target stream, writing goes through the pipeline
+ */
+class ResponsePipeline::Slot: public AbstractProxyStream, public IMultiplexedStream {
+public:
+    Slot(std::shared_ptr<ResponsePipeline> owner, std::size_t id)
+        :AbstractProxyStream(owner->_target.getStreamDevice())
+        ,_owner(std::move(owner))
+        ,_id(id) {}
+
+    virtual cocls::future<std::string_view> read() override {
+        return _proxied->read();
+    }
+    virtual std::string_view read_nb() override {
+        return _proxied->read_nb();
+    }
+    virtual void put_back(std::string_view buff) override {
+        _proxied->put_back(buff);
+    }
+    virtual cocls::future<bool> write(std::string_view buffer) override {
+        return _owner->write(_id, std::span<const std::string_view>(&buffer, 1));
+    }
+    virtual cocls::future<bool> write(std::span<const std::string_view> buffers) override {
+        return _owner->write(_id, buffers);
+    }
+    virtual cocls::future<bool> write_eof() override {
+        //end of the response is marked by finish()
+        return cocls::future<bool>::set_value(true);
+    }
+
+protected:
+    std::shared_ptr<ResponsePipeline> _owner;
+    std::size_t _id;
+};
+
+ResponsePipeline::ResponsePipeline(Stream target, CoroArena arena, std::size_t buffer_limit)
+    :_target(std::move(target))
+    ,_arena(std::move(arena))
+    ,_buffer_limit(buffer_limit) {}
+
+std::size_t ResponsePipeline::add_direct() {
+    std::lock_guard _(_mx);
+    assert(_queue.empty() && "Direct response must be first");
+    _queue.emplace_back(_next_id);
+    return _next_id++;
+}
+
+Stream ResponsePipeline::add(std::size_t &id) {
+    {
+        std::lock_guard _(_mx);
+        id = _next_id++;
+        _queue.emplace_back(id);
+    }
+    return Stream(std::make_shared<Slot>(shared_from_this(), id));
+}
+
+ResponsePipeline::Response *ResponsePipeline::find(std::size_t id) {
+    if (_queue.empty() || id < _queue.front().id) return nullptr;
+    std::size_t idx = id - _queue.front().id;
+    return idx < _queue.size()?&_queue[idx]:nullptr;
+}
+
+cocls::future<bool> ResponsePipeline::write(std::size_t id, std::span<const std::string_view> buffers) {
+    std::unique_lock lk(_mx);
+    Response *r = find(id);
+    if (!r || r->finished || _failed) return cocls::future<bool>::set_value(false);
+    if (r == &_queue.front() && !_writing && r->data.empty()) {
+        //the head writes directly
+        _writing = true;
+        lk.unlock();
+        return write_direct(_arena, shared_from_this(), buffers);
+    }
+    for (const auto &b: buffers) r->data.append(b);
+    if (r->data.size() < _buffer_limit) return cocls::future<bool>::set_value(true);
+    //buffer is full, wait until the data are written
+    return [&](cocls::promise<bool> p) {
+        r->written = std::move(p);
+    };
+}
+
+cocls::with_allocator<CoroArena, cocls::async<bool> > ResponsePipeline::write_direct(CoroArena &, std::shared_ptr<ResponsePipeline>, std::span<const std::string_view> buffers) {
+    //the coroutine starts immediately, so buffers are passed to the target before write() returns
+    bool ok = co_await _target.write(buffers);
+    write_done(ok);
+    co_return ok;
+}
+
+cocls::with_allocator<CoroArena, cocls::async<void> > ResponsePipeline::flush(CoroArena &, std::shared_ptr<ResponsePipeline>) {
+    std::vector<std::string> data;
+    std::vector<cocls::promise<bool> > written;
+    {
+        std::lock_guard _(_mx);
+        //collect data of the head and all following finished responses
+        while (!_queue.empty()) {
+            Response &r = _queue.front();
+            if (!r.data.empty()) {
+                data.push_back(std::move(r.data));
+                r.data.clear();
+            }
+            if (r.written) written.push_back(std::move(r.written));
+            if (!r.finished) break;
+            _queue.pop_front();
+        }
+    }
+    bool ok = true;
+    if (!data.empty()) {
+        std::vector<std::string_view> buffers(data.begin(), data.end());
+        ok = co_await _target.write(std::span<const std::string_view>(buffers));
+    }
+    for (auto &p: written) p(ok);
+    write_done(ok);
+}
+
+void ResponsePipeline::write_done(bool ok) {
+    std::vector<cocls::promise<bool> > waiting;
+    std::unique_lock lk(_mx);
+    _writing = false;
+    if (!ok && !_failed) {
+        _failed = true;
+        for (auto &r: _queue) if (r.written) waiting.push_back(std::move(r.written));
+    }
+    bool fl = check_flush();
+    auto drained = check_drained();
+    bool res = !_failed;
+    lk.unlock();
+    for (auto &p: waiting) p(false);
+    if (fl) flush(_arena, shared_from_this()).detach();
+    if (drained) drained(res);
+}
+
+bool ResponsePipeline::check_flush() {
+    if (_writing || _failed || _queue.empty()) return false;
+    const Response &r = _queue.front();
+    if (r.data.empty() && !r.finished) return false;
+    _writing = true;
+    return true;
+}
+
+cocls::promise<bool> ResponsePipeline::check_drained() {
+    if (_writing || (!_failed && !_queue.empty())) return {};
+    return std::move(_drained);
+}
+
+void ResponsePipeline::finish(std::size_t id) {
+    std::unique_lock lk(_mx);
+    Response *r = find(id);
+    if (r) r->finished = true;
+    bool fl = check_flush();
+    auto drained = check_drained();
+    bool res = !_failed;
+    lk.unlock();
+    if (fl) flush(_arena, shared_from_this()).detach();
+    if (drained) drained(res);
+}
+
+cocls::future<bool> ResponsePipeline::drain() {
+    return [&](cocls::promise<bool> p) {
+        std::unique_lock lk(_mx);
+        _drained = std::move(p);
+        auto drained = check_drained();
+        bool res = !_failed;
+        lk.unlock();
+        if (drained) drained(res);
+    };
+}
+
+}
+
+}
@@ -0,0 +1,123 @@
+/*
+ * http_pipeline.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_HTTP_PIPELINE_H_
+#define SRC_COROSERVER_HTTP_PIPELINE_H_
+
+#include "coro_alloc.h"
+#include "stream.h"
+
+#include <cocls/async.h>
+#include <cocls/with_allocator.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace coroserver {
+
+namespace http {
+
+///Keeps order of responses of pipelined requests
+/**
+ * Each pipelined request writes its response to own stream. The response of
+ * the oldest unfinished request (the head) is written directly to the target stream,
+ * responses of the following requests are buffered until all previous responses
+ * are finished. Buffered responses are written together, so several small responses
+ * are sent by single write.
+ *
+ * Streams of the responses forward reading to the target stream. Requests must
+ * read the target stream in order.
+ *
+ * The object is MT safe. Responses can be written from different threads
+ */
+class ResponsePipeline: public std::enable_shared_from_this<ResponsePipeline> {
+public:
+
+    ///Construct pipeline
+    /**
+     * @param target target stream
+     * @param arena arena of the connection, used to allocate frames of write operations
+     * @param buffer_limit size of buffered data of single response. When the limit is reached,
+     * the write is blocked until the data are written
+     */
+    ResponsePipeline(Stream target, CoroArena arena, std::size_t buffer_limit = 65536);
+
+    ///Add response written directly to the target stream by the caller
+    /**
+     * The response must be first in the pipeline. The caller must not
+     * write to the target stream after the response is finished
+     * @return id of the response
+     */
+    std::size_t add_direct();
+
+    ///Add response
+    /**
+     * @param id receives id of the response
+     * @return stream to write the response. The function write_eof() of the stream
+     * does nothing, the end of the response is marked by finish()
+     */
+    Stream add(std::size_t &id);
+
+    ///Mark response finished
+    /**
+     * Once all previous responses are finished, the response is written and removed.
+     * @param id id of the response
+     */
+    void finish(std::size_t id);
+
+    ///Wait until all finished responses are written
+    /**
+     * @retval true all written
+     * @retval false failed to write (connection closed)
+     */
+    cocls::future<bool> drain();
+
+protected:
+    class Slot;
+
+    struct Response {
+        Response(std::size_t id):id(id) {}
+        std::size_t id;
+        ///buffered data
+        std::string data;
+        ///response is complete
+        bool finished = false;
+        ///resolved when buffered data are written (when the buffer is full)
+        cocls::promise<bool> written;
+    };
+
+    Stream _target;
+    CoroArena _arena;
+    std::size_t _buffer_limit;
+    std::mutex _mx;
+    ///pending responses, the first is the head
+    std::deque<Response> _queue;
+    std::size_t _next_id = 0;
+    ///write to the target is in progress
+    bool _writing = false;
+    ///write to the target failed
+    bool _failed = false;
+    cocls::promise<bool> _drained;
+
+    cocls::future<bool> write(std::size_t id, std::span<const std::string_view> buffers);
+    cocls::with_allocator<CoroArena, cocls::async<bool> > write_direct(CoroArena &, std::shared_ptr<ResponsePipeline> me, std::span<const std::string_view> buffers);
+    cocls::with_allocator<CoroArena, cocls::async<void> > flush(CoroArena &, std::shared_ptr<ResponsePipeline> me);
+    ///Find response (lock must be held)
+    Response *find(std::size_t id);
+    ///Start flush, if needed (lock must be held, returns true if flush has to be started)
+    bool check_flush();
+    ///Retrieve drain promise, if drained (lock must be held)
+    cocls::promise<bool> check_drained();
+    ///Write is done, start next flush and resolve drain
+    void write_done(bool ok);
+};
+}
+
+}
+
+#endif /* SRC_COROSERVER_HTTP_PIPELINE_H_ */
@@ -6,9 +6,7 @@ namespace http {
 
 std::string_view Server::error_handler_prefix ( "error_");
 
-IHandler::Ret Server::send_error_page(ServerRequest &req) {
-    //lock the lock
-    std::shared_lock lk(_mx);
+IHandler::Ret Server::send_error_page(ServerRequest &req, const Router &routes) {
     //retrieve status
     int status = req.get_status();
     //zero status is set to 404
@@ -21,16 +19,7 @@ IHandler::Ret Server::send_error_page(ServerRequest &req) {
     std::string custom_page_name (error_handler_prefix);
     custom_page_name.append(std::to_string(status));
     //find whether there is such handler
-    auto r = _endpoints.find(custom_page_name);
-    Handler h;
-    //process results and finish with empty container or with handler
-    while (!h && !r.empty()) {
-        auto m = r.top();
-        h = m.payload.get(req.get_method());
-        if (!h) {
-            h = m.payload.get(Method::not_set);
-        }
-    }
+    const Handler *h = routes.find_handler(custom_page_name, req.get_method());
     //we did not find error handler
     if (!h){
         //generate own version of error page
@@ -50,7 +39,7 @@ IHandler::Ret Server::send_error_page(ServerRequest &req) {
         //send the stream
         return [&]{return req.send(text);};
     }
-    return h.call(req, req.get_path());
+    return h->call(req, req.get_path());
 }
 
 void Router::set_handler(std::string_view path, Handler h) {
@@ -58,40 +47,22 @@ void Router::set_handler(std::string_view path, Handler h) {
 }
 
 void Router::set_handler(std::string_view path, Method m, Handler h) {
-    MethodMap *mm = _endpoints.find_exact(path);
-    if (mm) {
-        mm->set(m, std::move(h));
-    } else {
-        MethodMap smm;
-        smm.set(m, std::move(h));
-        _endpoints.insert(std::string(path), std::move(smm));
-    }
+    _endpoints.insert(path).set(m, std::move(h));
 }
 
 void Router::set_handler(std::string_view path, std::initializer_list<Method> methods, Handler h) {
-    MethodMap *mm = _endpoints.find_exact(path);
-    if (mm) {
-        for (auto x: methods) {
-            mm->set(x, h);
-        }
-    } else {
-        MethodMap smm;
-        for (auto x: methods) {
-            smm.set(x, h);
-        }
-        _endpoints.insert(std::string(path), std::move(smm));
-    }
+    _endpoints.insert(path).set(methods, std::move(h));
 }
 
-std::size_t Router::call_handler(ServerRequest &req, IHandler::Ret &fut) {
+std::size_t Router::call_handler(ServerRequest &req, IHandler::Ret &fut) const {
     return call_handler(req, req.get_path(), fut);
 }
 
-std::size_t Router::call_handler(ServerRequest &req, std::string_view vpath, IHandler::Ret &fut) {
+std::size_t Router::call_handler(ServerRequest &req, std::string_view vpath, IHandler::Ret &fut) const {
     return call_handler(req, req.get_method(), vpath, fut);
 }
 
-std::size_t Router::call_handler(ServerRequest &req, Method method, std::string_view path, IHandler::Ret &fut) {
+std::size_t Router::call_handler(ServerRequest &req, Method method, std::string_view path, IHandler::Ret &fut) const {
     if (path.empty()) return 1;
     //try to find all matching endpoint
     auto hfnd = _endpoints.find(path);
@@ -105,23 +76,27 @@ std::size_t Router::call_handler(ServerRequest &req, Method method, std::string_
         //pop it (however it is valid operation, has the reference is still exists)
         hfnd.pop();
         //calculate vpath
-        std::string_view vpath = path.substr(ep.path.length());
+        std::string_view vpath = path.substr(ep.length);
         //retrieve handler for given method
-        Handler h = ep.payload.get(method);
+        const Handler *h = &ep.value->payload.get(method);
         //if no handler registered
-        if (!h) {
+        if (!*h) {
             //try to retrieve global handler
-            h = ep.payload.get(Method::not_set);
+            h = &ep.value->payload.get(Method::not_set);
             //if not set either
-            if (!h) {
+            if (!*h) {
                 //record method to bitvector
-                allow_bitvector |= ep.payload.allowed_bitvector();
+                allow_bitvector |= ep.value->payload.allowed_bitvector();
                 //continue by next handler
                 continue;
             }
         }
+        //pass parameters of the route
+        std::array<RouteParam, max_route_params> params;
+        for (std::size_t i = 0; i < ep.param_count(); ++i) params[i] = ep.param(i);
+        req.set_route_params(params.data(), ep.param_count());
         //call handler
-        fut << [&]{return h.call(req, vpath);};
+        fut << [&]{return h->call(req, vpath);};
         //explore result
         //if the result is not ready  (continued asynchronously) or is touched (modified state)
         if (!fut.ready() || !req.untouched()) {
@@ -137,20 +112,51 @@ std::size_t Router::call_handler(ServerRequest &req, Method method, std::string_
 
 }
 
-void Server::select_handler(ServerRequest &req, IHandler::Ret &fut) {
-    //everything under shared lock
-    std::shared_lock lk(_mx);
+const Handler *Router::find_handler(std::string_view path, Method method) const {
+    auto r = _endpoints.find(path);
+    //process results from the longest match
+    while (!r.empty()) {
+        const MethodMap &mm = r.top().value->payload;
+        const Handler &h = mm.get(method);
+        if (h) return &h;
+        const Handler &g = mm.get(Method::not_set);
+        if (g) return &g;
+        r.pop();
+    }
+    return nullptr;
+}
+
+void Server::acquire_routes(RoutesRef &ref) {
+    std::lock_guard lk(_mx);
+    if (!_current) {
+        _current = std::make_shared<const Router>(static_cast<const Router &>(*this));
+        std::erase_if(_snapshots, [](const auto &x) {return x.expired();});
+        _snapshots.push_back(_current);
+        _routes.store(_current.get(), std::memory_order_release);
+    }
+    //the connection gets own counter, so its copies of the reference don't
+    //touch the counter shared by all connections
+    ref = RoutesRef(_current.get(), [keep = _current](const Router *) {});
+}
+
+void Server::routes_changed() {
+    _routes.store(nullptr, std::memory_order_release);
+    //the copy is released by the last connection which holds it
+    _current.reset();
+}
 
+void Server::select_handler(ServerRequest &req, IHandler::Ret &fut, const Router &routes) {
+    //the copy of the routing table is never modified, no lock is needed
     std::size_t r;
 
     std::string_view prefix = req[strtable::hdr_x_forwarded_prefix];
 
     if (prefix.empty()) {
-        r = call_handler(req, fut);
+        r = routes.call_handler(req, fut);
     } else {
         std::string_view path = req.get_path();
         if (path.substr(0, prefix.size()) == prefix) {
-            r = call_handler(req, path, fut);
+            r = routes.call_handler(req, path, fut);
         } else {
             r = 1;
         }
@@ -168,10 +174,8 @@ void Server::select_handler(ServerRequest &req, IHandler::Ret &fut) {
     } else {
         req.set_status(404);
     }
-    //unlock the lock, as send_error_page is need it
-    lk.unlock();
     //generate error page
-    fut << [&]{return send_error_page(req);};
+    fut << [&]{return send_error_page(req, routes);};
 
 }
 
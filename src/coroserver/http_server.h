@@ -2,13 +2,19 @@
 #ifndef SRC_COROSERVER_HTTP_SERVER_H_
 #define SRC_COROSERVER_HTTP_SERVER_H_
 
+#include "descriptor_stream.h"
+#include "http2.h"
+#include "http_pipeline.h"
 #include "http_server_request.h"
 #include "http_stringtables.h"
-#include "prefixmap.h"
+#include "route_trie.h"
 
 #include <cocls/function.h>
 #include <cocls/generator.h>
-#include <shared_mutex>
+#include <cocls/with_allocator.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <memory>
 #include <functional>
 
@@ -161,7 +167,7 @@ public:
     void set(std::initializer_list<Method> m, Handler h) {
         for (auto x: m) set(x,h);
     }
-    Handler get(Method m) const {return methods[static_cast<int>(m)];}
+    const Handler &get(Method m) const {return methods[static_cast<int>(m)];}
     void clear() {
         std::fill(methods.begin(), methods.end(), Handler());
     }
@@ -204,6 +210,16 @@ protected:
 ///Base routing, base class for Server
 /**
  * You can create additional routing tables for cascade routing
+ *
+ * The path of the handler is a prefix of the path of the request, the rest of the path
+ * is passed to the handler as vpath. The path can contain parameters, which are
+ * available through ServerRequest::get_route_param()
+ *
+ * - {name} - matches one segment of the path (up to next /)
+ * - {name*} - matches rest of the path, it must be at the end of the path
+ *
+ * When more handlers match, the longest match is tried first. When the handler
+ * rejects the request, next shorter match is tried.
  */
 class Router {
 public:
@@ -211,10 +227,12 @@ public:
     ///Register a handler to a given path
     /**
      * @param path Path to register. Note that path is always starts with /. To register
-     * custom error page, use error_<code> to handle custom error page handler
+     * custom error page, use error_<code> to handle custom error page handler. The path
+     * can contain parameters ({name}, {name*})
      * @param h handler. Set empty to remove handler
      *
      * @note It registers handler for all methods.
+     * @exception std::invalid_argument invalid declaration of parameters
      */
     void set_handler(std::string_view path, Handler h);
     ///Register a handler to given path and method
@@ -243,7 +261,7 @@ public:
      * @retval 1 handler was not found
      * @retval >1 found handler, but for different method. The value contains bitmask of all found methods (bit 0 is always set)
      */
-    std::size_t call_handler(ServerRequest &req, IHandler::Ret &fut);
+    std::size_t call_handler(ServerRequest &req, IHandler::Ret &fut) const;
     ///Calls handler for given request
     /**
      * @param req request
@@ -253,7 +271,7 @@ public:
      * @retval 1 handler was not found (or handler rejected the request)
      * @retval >1 found handler, but for different method. The value contains bitmask of all found methods (bit 0 is always set)
      */
-    std::size_t call_handler(ServerRequest &req, std::string_view vpath, IHandler::Ret &fut);
+    std::size_t call_handler(ServerRequest &req, std::string_view vpath, IHandler::Ret &fut) const;
     ///Calls handler for given request
     /**
      * @param req request
@@ -265,10 +283,19 @@ public:
      * @retval 1 handler was not found (or handler rejected the request)
      * @retval >1 found handler, but for different method. The value contains bitmask of all found methods (bit 0 is always set)
      */
-    std::size_t call_handler(ServerRequest &req, Method methodOverride, std::string_view vpath, IHandler::Ret &fut);
+    std::size_t call_handler(ServerRequest &req, Method methodOverride, std::string_view vpath, IHandler::Ret &fut) const;
+
+    ///Find handler without calling it
+    /**
+     * @param path path
+     * @param method method
+     * @return pointer to the handler of the longest matching path, or nullptr if not found. The
+     * pointer is valid until the router is modified
+     */
+    const Handler *find_handler(std::string_view path, Method method) const;
 
 protected:
-    PrefixMap<MethodMap> _endpoints;
+    RouteTrie<MethodMap> _endpoints;
 
 };
 
@@ -300,6 +327,9 @@ public:
      * as protocol. However you can perform any complex preprocessing
      * if you pass a custom function, which returns ServerRequest as result
      *
+     * The factory is called for each connection. It is also called for each
+     * pipelined request and each HTTP/2 request, their streams implement
+     * IMultiplexedStream, so the factory must not wrap them again (for example to SSL)
      */
     Server(RequestFactory factory):_factory(std::move(factory)) {}
     Server() = default;
@@ -307,6 +337,9 @@ public:
 
     static std::string_view error_handler_prefix;
 
+    ///Count of bytes needed to detect HTTP/2 preface
+    static constexpr std::size_t preface_check_size = 4;
+
 
     ///Start the server (serve requests)
     /**
@@ -356,7 +389,8 @@ public:
      *
      */
     cocls::future<void> serve_req(Stream s) {
-        return serve_req_coro(std::move(s), [](TraceEvent, ServerRequest &) {});
+        auto arena = connection_arena(s);
+        return serve_req_coro(arena, std::move(s), [](TraceEvent, ServerRequest &) {});
     }
     ///Manually serve on given connection
     /**
@@ -367,29 +401,95 @@ public:
      */
     template<typename Tracer>
     cocls::future<void> serve_req(Stream s, Tracer tracer) {
-        return serve_req_coro(std::move(s), std::move(tracer));
+        auto arena = connection_arena(s);
+        return serve_req_coro(arena, std::move(s), std::move(tracer));
     }
 
+    ///Register a handler
+    /**
+     * See Router::set_handler(). Requests are dispatched by an immutable copy of the routing
+     * table, which is created by first request after the change. So changes made
+     * together are published at once and requests don't need any lock to find a handler.
+     *
+     * Each connection holds the copy it has loaded and checks for a newer copy before
+     * each request (HTTP/1.1) or stream (HTTP/2). A replaced copy is released once all
+     * connections which hold it have moved to the newer copy or have been closed.
+     */
     void set_handler(std::string_view path, Handler h) {
-        std::unique_lock lk(_mx);
+        std::lock_guard lk(_mx);
         Router::set_handler(path, std::move(h));
+        routes_changed();
     }
     void set_handler(std::string_view path, Method m, Handler h) {
-        std::unique_lock lk(_mx);
+        std::lock_guard lk(_mx);
         Router::set_handler(path, m, std::move(h));
+        routes_changed();
     }
     void set_handler(std::string_view path, std::initializer_list<Method> methods, Handler h) {
-        std::unique_lock lk(_mx);
+        std::lock_guard lk(_mx);
         Router::set_handler(path, methods, std::move(h));
+        routes_changed();
+    }
+
+    ///Count of copies of the routing table which are still alive (for testing)
+    std::size_t get_routes_copies() {
+        std::lock_guard lk(_mx);
+        return std::count_if(_snapshots.begin(), _snapshots.end(), [](const auto &x) {
+            return !x.expired();
+        });
+    }
+
+    ///Set depth of HTTP/1.1 pipelining
+    /**
+     * When the client sends next requests without waiting for the response, the
+     * server loads and processes them in parallel, the responses are sent in order
+     * of requests. Small responses of completed requests are sent together.
+     *
+     * @param depth count of requests loaded ahead. Default is 16. Set 0 to disable pipelining
+     *
+     * @note requests with a body are not processed in parallel with following requests
+     * @note while pipelining, each request loaded ahead uses own copy of the tracer. The
+     * copies can be called from multiple threads at the same time
+     */
+    void set_pipeline_depth(std::size_t depth) {
+        _pipeline_depth = depth;
+    }
+
+    ///Enable or disable HTTP/2
+    /**
+     * When enabled, connections which start with HTTP/2 preface are served as HTTP/2. This
+     * covers clients with prior knowledge (h2c) and TLS connections where "h2" was
+     * negotiated by ALPN (see ssl::Context::set_alpn_http()). Requests are passed to the
+     * handlers as ServerRequest, the same way as HTTP/1.1 requests. Upgrade from HTTP/1.1
+     * is not supported
+     *
+     * @param enable true to enable, false to disable (default)
+     * @param settings settings of HTTP/2 connections
+     */
+    void set_http2(bool enable, const http2::Settings &settings = {}) {
+        _http2 = enable;
+        _http2_settings = settings;
     }
 
 
 protected:
+    ///Reference to a copy of the routing table held by a connection
+    using RoutesRef = std::shared_ptr<const Router>;
+
     RequestFactory _factory;
-    std::shared_mutex _mx;
-    PrefixMap<MethodMap> _endpoints;
+    ///guards the routing table and _snapshots
+    std::mutex _mx;
+    ///current copy of the routing table, nullptr when it must be created
+    std::atomic<const Router *> _routes = nullptr;
+    ///current copy of the routing table (guarded)
+    std::shared_ptr<const Router> _current;
+    ///copies of the routing table created by the server (guarded, for testing)
+    std::vector<std::weak_ptr<const Router> > _snapshots;
     cocls::promise<void> _exit_promise;
     std::atomic<int> _requests = 0;
+    std::size_t _pipeline_depth = 16;
+    bool _http2 = false;
+    http2::Settings _http2_settings;
 
     friend class std::lock_guard<Server>;
 
@@ -406,7 +506,8 @@ protected:
     cocls::async<void> serve_gen(cocls::generator<Stream> tcp_server, Tracer tracer) {
         std::lock_guard _(*this);
         while (co_await tcp_server.next()) {
-            serve_req_coro(std::move(tcp_server.value()), tracer).detach();
+            auto arena = connection_arena(tcp_server.value());
+            serve_req_coro(arena, std::move(tcp_server.value()), tracer).detach();
         }
         co_return;
     }
@@ -421,10 +522,32 @@ protected:
         logger.user_ctx = &tracer;
     }
 
+    ///Retrieve arena of the connection
+    /**
+     * Frame of the coroutine which serves the connection is allocated from the same
+     * arena as the frames of the stream, so keep-alive requests don't allocate frames
+     * from the heap
+     */
+    static CoroArena connection_arena(const Stream &s) {
+        auto dsc = std::dynamic_pointer_cast<IDescriptorStream>(s.getStreamDevice());
+        return dsc?dsc->get_coro_arena():CoroArena();
+    }
+
+    ///Create request through the factory, if set
+    ServerRequest create_request(Stream s, bool secure) {
+        return _factory?_factory(std::move(s)):ServerRequest(std::move(s), secure);
+    }
+
     template<typename Tracer>
-    cocls::async<void> serve_req_coro(Stream s, Tracer tracer) {
+    cocls::with_allocator<CoroArena, cocls::async<void> > serve_req_coro(CoroArena &, Stream s, Tracer tracer) {
+        //handle to the arena - the argument refers to a variable of the caller
+        CoroArena arena = connection_arena(s);
         //prepare server request
-        ServerRequest req = _factory?_factory(std::move(s)):ServerRequest(std::move(s));
+        ServerRequest req = create_request(std::move(s), false);
+        //first data of the connection when they arrived in short reads
+        std::string first_data;
+        //copy of the routing table used by this connection
+        RoutesRef routes;
 
         try {
             //lock this object - count request - this is called in context of serve()
@@ -434,60 +557,44 @@ protected:
             //enable and setup request's logger to the tracer
             setup_logger(req, tracer);
 
+            if (_http2) {
+                //HTTP/2 client starts with the preface (prior knowledge or negotiated by ALPN)
+                Stream rs = req.get_stream();
+                std::string_view data = co_await rs.read();
+                if (data.empty()) {
+                    tracer(TraceEvent::close, req);
+                    co_return;
+                }
+                //4 bytes are needed to make decision, collect short reads
+                while (data.size() < preface_check_size) {
+                    first_data.append(data);
+                    data = co_await rs.read();
+                    if (data.empty()) break;
+                }
+                if (!first_data.empty()) {
+                    first_data.append(data);
+                    data = first_data;
+                }
+                rs.put_back(data);
+                if (http2::ServerConnection::is_preface(data)) {
+                    co_await serve_http2(arena, req, tracer, routes);
+                    tracer(TraceEvent::close, req);
+                    co_return;
+                }
+            }
+
             //load requests from the stream - return false if error
             while (co_await req.load()) {
-                //future to await handler
-                IHandler::Ret fut;
-                try {
-                    //report that request has been loaded
-                    tracer(TraceEvent::load, req);
-                    //select matching handler and call it, set future with result
-                    select_handler(req, fut);
-                    //await for future
-                    co_await fut;
-                    //handler can optionally not send the request
-                    //if the request is error page
-                    //if headers was sent - so request is complete
-                    if (req.headers_sent()) {
-                        //report that request is complete
-                        tracer(TraceEvent::finish, req);
-                        //close request if keep alive is not active
-                        if (!req.keep_alive()) {
-                            //report closed
-                            tracer(TraceEvent::close, req);
-                            //exit
-                            co_return;
-                        }
-                        //keep alive is active, load next request
-                        continue;
-                    }
-                    //here if the response was not send
-                } catch (...){
-                    //in case of exception
-                    tracer(TraceEvent::exception, req);
-                    //exception has been thrown after response has been sent
-                    //we has no idea in which state this happened
-                    //so the best solution is to close the connection
-                    if (req.headers_sent()) {
-                        //report that request is being closed
-                        tracer(TraceEvent::close, req);
-                        //exit now - connection will be closed
-                        co_return;
-                    }
-                    //exception was thrown during processing the request
-                    //before response has been sent
-                    //so set status to 500
-                    req.set_status(500);
-                    //clear any headers
-                    req.clear_headers();
+                bool keep;
+                //pick up changes of the routing table made since the last request
+                const Router &rt = get_routes(routes);
+                //if the client already sent next request, process requests in parallel
+                if (_pipeline_depth && can_pipeline(req)) {
+                    keep = co_await serve_pipelined(arena, req, tracer, rt);
+                } else {
+                    keep = co_await process_request(arena, req, tracer, rt);
                 }
-                //we are here, when request is processed, but response was not sent
-                //so explore status and generate error page
-                co_await send_error_page(req);
-                //report finish request
-                tracer(TraceEvent::finish, req);
-                //if keep alive isn't active
-                if (!req.keep_alive()) {
+                if (!keep) {
                     //report closed
                     tracer(TraceEvent::close, req);
                     //exit
@@ -497,15 +604,7 @@ protected:
             }
             //in this case, load fails
             //but status can be set indicating that error page should be returned to the client
-            if (req.get_status()) {
-                //this is considered as load.
-                tracer(TraceEvent::load, req);
-                //send error page
-                co_await send_error_page(req);
-                //and report finish
-                tracer(TraceEvent::finish, req);
-                //keep alive is impossible here
-            }
+            co_await load_failed(req, tracer, get_routes(routes));
             //so report close
             tracer(TraceEvent::close, req);
             //and exit
@@ -517,8 +616,224 @@ protected:
         }
     }
 
-    IHandler::Ret send_error_page(ServerRequest &req);
-    void select_handler(ServerRequest &req, IHandler::Ret &fut);
+    ///Process loaded request
+    /**
+     * @return true to continue with next request (keep alive), false to close the connection
+     */
+    template<typename Tracer>
+    cocls::with_allocator<CoroArena, cocls::async<bool> > process_request(CoroArena &, ServerRequest &req, Tracer &tracer,
+                                                                            const Router &routes) {
+        //future to await handler
+        IHandler::Ret fut;
+        try {
+            //report that request has been loaded
+            tracer(TraceEvent::load, req);
+            //select matching handler and call it, set future with result
+            select_handler(req, fut, routes);
+            //await for future
+            co_await fut;
+            //handler can optionally not send the request
+            //if the request is error page
+            //if headers was sent - so request is complete
+            if (req.headers_sent()) {
+                //report that request is complete
+                tracer(TraceEvent::finish, req);
+                //close request if keep alive is not active
+                co_return req.keep_alive();
+            }
+            //here if the response was not send
+        } catch (...){
+            //in case of exception
+            tracer(TraceEvent::exception, req);
+            //exception has been thrown after response has been sent
+            //we has no idea in which state this happened
+            //so the best solution is to close the connection
+            if (req.headers_sent()) {
+                co_return false;
+            }
+            //exception was thrown during processing the request
+            //before response has been sent
+            //so set status to 500
+            req.set_status(500);
+            //clear any headers
+            req.clear_headers();
+        }
+        //we are here, when request is processed, but response was not sent
+        //so explore status and generate error page
+        co_await send_error_page(req, routes);
+        //report finish request
+        tracer(TraceEvent::finish, req);
+        co_return req.keep_alive();
+    }
+
+    ///Handle failed load - send error page, if status is set
+    template<typename Tracer>
+    cocls::async<void> load_failed(ServerRequest &req, Tracer &tracer, const Router &routes) {
+        if (req.get_status()) {
+            //this is considered as load.
+            tracer(TraceEvent::load, req);
+            //send error page
+            co_await send_error_page(req, routes);
+            //and report finish
+            tracer(TraceEvent::finish, req);
+            //keep alive is impossible here
+        }
+    }
+
+    ///Determines, whether next request can be loaded while the request is processed
+    /**
+     * The request must not read the connection (no body, no upgrade) and the
+     * next request must be already received (at least partially) by the read, which
+     * completed the head of the request. The connection is not read here, so requests
+     * of clients which don't pipeline don't pay for extra syscall
+     */
+    static bool can_pipeline(ServerRequest &req) {
+        if (!req.keep_alive() || req.has_body() || req.is_method(Method::CONNECT)
+                || req[strtable::hdr_upgrade].has_value()) return false;
+        return req.has_pending_input();
+    }
+
+    ///Tracks requests processed in parallel
+    struct PipelineBurst {
+        std::atomic<std::size_t> pending = 1;
+        std::atomic<bool> keep = true;
+        cocls::promise<void> done;
+
+        void add() {++pending;}
+        void release(bool k) {
+            if (!k) keep = false;
+            if (--pending == 0) done();
+        }
+    };
+
+    template<typename Tracer>
+    cocls::with_allocator<CoroArena, cocls::async<void> > process_pipelined(CoroArena &arena, ServerRequest &req,
+                Tracer &tracer, ResponsePipeline &pipeline, std::size_t id, PipelineBurst &burst,
+                const Router &routes) {
+        bool keep;
+        try {
+            keep = co_await process_request(arena, req, tracer, routes);
+        } catch (...) {
+            tracer(TraceEvent::exception, req);
+            keep = false;
+        }
+        pipeline.finish(id);
+        burst.release(keep);
+    }
+
+    ///Request loaded ahead, has own copy of the tracer, as it runs in parallel
+    template<typename Tracer>
+    struct PipelinedRequest {
+        ServerRequest req;
+        Tracer tracer;
+        PipelinedRequest(Server &srv, Stream s, bool secure, const Tracer &tracer)
+            :req(srv.create_request(std::move(s), secure)), tracer(tracer) {}
+    };
+
+    ///Serve pipelined requests
+    /**
+     * Handler of the request is started and following requests are loaded and
+     * processed in parallel. Responses are sent in order of requests. Loading stops,
+     * when there is no more received data, the depth of the pipeline is reached or
+     * when the request reads the connection (has body). Function waits until
+     * all requests are processed. All requests use the same copy of the routing table.
+     *
+     * @return true to continue with next request (keep alive), false to close the connection
+     */
+    template<typename Tracer>
+    cocls::with_allocator<CoroArena, cocls::async<bool> > serve_pipelined(CoroArena &arena, ServerRequest &req, Tracer &tracer,
+                                                                            const Router &routes) {
+        auto pipeline = std::make_shared<ResponsePipeline>(req.get_stream(), arena);
+        std::vector<std::unique_ptr<PipelinedRequest<Tracer> > > reqs;
+        PipelineBurst burst;
+        bool loaded = true;
+        burst.add();
+        process_pipelined(arena, req, tracer, *pipeline, pipeline->add_direct(), burst, routes).detach();
+        ServerRequest *last = &req;
+        while (reqs.size() < _pipeline_depth && can_pipeline(*last)) {
+            std::size_t id;
+            reqs.push_back(std::make_unique<PipelinedRequest<Tracer> >(*this, pipeline->add(id), req.is_secure(), tracer));
+            auto &pr = *reqs.back();
+            setup_logger(pr.req, pr.tracer);
+            if (!co_await pr.req.load()) {
+                co_await load_failed(pr.req, pr.tracer, routes);
+                pipeline->finish(id);
+                loaded = false;
+                break;
+            }
+            burst.add();
+            process_pipelined(arena, pr.req, pr.tracer, *pipeline, id, burst, routes).detach();
+            last = &pr.req;
+        }
+        //wait for all requests
+        co_await cocls::future<void>([&](auto promise){
+            burst.done = std::move(promise);
+            burst.release(true);
+        });
+        bool ok = co_await pipeline->drain();
+        co_return ok && loaded && burst.keep;
+    }
+
+    ///Serve HTTP/2 connection
+    /**
+     * Each stream is served as a request in parallel with other streams. Function
+     * waits until the connection is closed and all requests are processed. Each stream
+     * holds the copy of the routing table, which was current when the stream was opened
+     */
+    template<typename Tracer>
+    cocls::with_allocator<CoroArena, cocls::async<void> > serve_http2(CoroArena &arena, ServerRequest &req, Tracer &tracer,
+                RoutesRef &routes) {
+        auto conn = std::make_shared<http2::ServerConnection>(req.get_stream(), arena, _http2_settings);
+        PipelineBurst burst;
+        bool secure = req.is_secure();
+        co_await conn->serve([&](Stream s) {
+            burst.add();
+            get_routes(routes);
+            serve_http2_stream(arena, std::move(s), secure, tracer, burst, routes).detach();
+        });
+        //wait for all requests
+        co_await cocls::future<void>([&](auto promise){
+            burst.done = std::move(promise);
+            burst.release(true);
+        });
+    }
+
+    ///Serve request of HTTP/2 stream, the request has own copy of the tracer
+    template<typename Tracer>
+    cocls::with_allocator<CoroArena, cocls::async<void> > serve_http2_stream(CoroArena &arena, Stream s, bool secure,
+                Tracer tracer, PipelineBurst &burst, RoutesRef routes) {
+        ServerRequest req = create_request(std::move(s), secure);
+        setup_logger(req, tracer);
+        try {
+            if (co_await req.load()) {
+                co_await process_request(arena, req, tracer, *routes);
+            } else {
+                co_await load_failed(req, tracer, *routes);
+            }
+        } catch (...) {
+            tracer(TraceEvent::exception, req);
+        }
+        burst.release(true);
+    }
+
+    IHandler::Ret send_error_page(ServerRequest &req, const Router &routes);
+    void select_handler(ServerRequest &req, IHandler::Ret &fut, const Router &routes);
+
+    ///Refresh copy of the routing table held by a connection
+    /**
+     * @param ref reference held by the connection. It is replaced when the routing
+     * table has changed, otherwise nothing is written, only the current pointer is read
+     * @return current copy of the routing table
+     */
+    const Router &get_routes(RoutesRef &ref) {
+        const Router *cur = _routes.load(std::memory_order_acquire);
+        if (!cur || cur != ref.get()) acquire_routes(ref);
+        return *ref;
+    }
+    ///Load current copy of the routing table, create it when needed
+    void acquire_routes(RoutesRef &ref);
+    ///Drop current copy of the routing table after change (must be locked)
+    void routes_changed();
 };
 
 template<typename Output>
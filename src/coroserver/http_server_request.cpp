@@ -1,7 +1,13 @@
 #include "http_server_request.h"
+#include "head_scanner.h"
 #include "limited_stream.h"
 #include "chunked_stream.h"
 #include "http_stringtables.h"
+#include "socket_stream.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <fstream>
 namespace coroserver {
@@ -13,7 +19,6 @@ std::string ServerRequest::server_name = "CoroServer 1.0 (C++20)";
 
 static constexpr std::size_t status_response_max_len=64;
 
-static constexpr search_kmp search_hdr_sep("\r\n\r\n");
 
 
 ServerRequest::ServerRequest(Stream s, bool secure)
@@ -25,17 +30,42 @@ ServerRequest::ServerRequest(Stream s, bool secure)
     ,_discard_body_awt(this)
     ,_send_resp_awt(this)
     ,_send_resp_body_awt(this)
+    ,_send_headers_and_body_awt(this)
     {}
 
 ServerRequest::~ServerRequest() {
 }
 
+///Releases the device, if it is still used, or if it was not finished (this shuts down the connection)
+template<typename Dev>
+static void release_unfinished(std::shared_ptr<Dev> &dev) {
+    if (dev && (dev.use_count() > 1 || !dev->get_stack().is_complete())) dev.reset();
+}
+
+///Reuses the device, if it is not used by anyone else. Otherwise creates new device
+template<typename Dev, typename ... Args>
+static Stream reuse_device(std::shared_ptr<Dev> &dev, const Stream &target, Args ... args) {
+    if (dev && dev.use_count() == 1 && dev->get_stack().is_complete()) {
+        dev->reset(args...);
+    } else {
+        dev = std::make_shared<Dev>(target.getStreamDevice(), args...);
+    }
+    return Stream(dev);
+}
+
 cocls::future<bool> ServerRequest::load() {
     _status_code = 0;
+    _route_param_count = 0;
     _status_message = {};
-    _search_hdr_state = 0;
     _body_processed = false;
     _headers_sent = false;
+    _pending_input = false;
+    _output_buffering.reset();
+    _body_stream = Stream(nullptr);
+    release_unfinished(_body_limited);
+    release_unfinished(_body_chunked);
+    release_unfinished(_resp_limited);
+    release_unfinished(_resp_chunked);
     _header_data.clear();
     _header_data.reserve(256);
     _output_headers.clear();
@@ -48,19 +78,33 @@ cocls::future<bool> ServerRequest::load() {
 
 cocls::suspend_point<void> ServerRequest::load_coro(std::string_view &data, cocls::promise<bool> &res) {
     if (data.empty()) return res(false);
-    for (std::size_t cnt = data.size(), i = 0; i < cnt; i++) {
-        char c= data[i];
-        _header_data.push_back(c);
-        if (search_hdr_sep(_search_hdr_state,c)) {
-            _cur_stream.put_back(data.substr(i+1));
-            _header_data.resize(_header_data.size()-search_hdr_sep.length());
-            bool b = parse_request({_header_data.data(), _header_data.size()});
-            if (!b) _keep_alive = false;
-            return res(b);
+    std::size_t prev = _header_data.size();
+    std::size_t end;
+    if (prev == 0) {
+        //usually whole head is in the first read, copy just the head
+        end = HeadScanner::find_end(data);
+        _header_data.insert(_header_data.end(), data.data(), data.data()+std::min(end, data.size()));
+    } else {
+        //separator can start in previous read
+        _header_data.insert(_header_data.end(), data.begin(), data.end());
+        end = HeadScanner::find_end({_header_data.data(), _header_data.size()}, prev);
+        if (end != HeadScanner::npos) {
+            _header_data.resize(end);
+            end -= prev;
         }
     }
-    _load_awt(std::move(res)) << [&]{return _cur_stream.read();};
-    return {};
+    if (end == HeadScanner::npos) {
+        _load_awt(std::move(res)) << [&]{return _cur_stream.read();};
+        return {};
+    }
+    //the head is copied, because the read buffer is reused by next read (body)
+    _pending_input = end < data.size();
+    _cur_stream.put_back(data.substr(end));
+    //remove the empty line
+    _header_data.resize(_header_data.size()-4);
+    bool b = parse_request({_header_data.data(), _header_data.size()});
+    if (!b) _keep_alive = false;
+    return res(b);
 }
 
 
@@ -152,7 +196,7 @@ bool ServerRequest::parse_headers() {
         }
         if (len) {
             _has_body = true;
-            _body_stream = LimitedStream::read(_cur_stream, len);
+            _body_stream = reuse_device(_body_limited, _cur_stream, len, std::size_t(0));
         }
         return true;
     }
@@ -162,7 +206,7 @@ bool ServerRequest::parse_headers() {
         _has_body = true;
         //only chunked is supported
         if (hv == val_chunked) {
-            _body_stream = ChunkedStream::read(_cur_stream);
+            _body_stream = reuse_device(_body_chunked, _cur_stream, true, false);
             return true;
         } else {
             set_status(501);
@@ -363,10 +407,23 @@ cocls::suspend_point<void> ServerRequest::send_resp_body(Stream &s, cocls::promi
 cocls::future<bool> ServerRequest::send(std::string_view body) {
     _send_body_data = body;
     add_header(strtable::hdr_content_length, body.size());
-    return _send_resp_body_awt << [&]{return send();};
+    if (_headers_sent) return _send_resp_body_awt << [&]{return send();};
+    return _send_headers_and_body_awt << [&]{return discard_body_intr();};
     //return send_coro(_coro_storage, body);
 }
 
+cocls::suspend_point<void> ServerRequest::send_headers_and_body(bool &st, cocls::promise<bool> &res) {
+    if (!st) {
+        //same result as writing the body to the closed stream
+        return res(_send_body_data.empty());
+    }
+    _headers_sent = true;
+    //headers and body are sent by single write
+    std::string_view parts[] = {prepare_output_headers(), _send_body_data};
+    _forward_awt(std::move(res)) << [&]{return _cur_stream.write(std::span<const std::string_view>(parts));};
+    return {};
+}
+
 cocls::future<bool> ServerRequest::send(std::ostringstream &body) {
     _user_buffer = body.str();
     return send(std::string_view(_user_buffer));
@@ -374,24 +431,31 @@ cocls::future<bool> ServerRequest::send(std::ostringstream &body) {
 
 cocls::suspend_point<void> ServerRequest::send_resp(bool &st, cocls::promise<Stream> &res) {
     if (!st) {
-        return res(LimitedStream::write(_cur_stream, 0));
+        return res(reuse_device(_resp_limited, _cur_stream, std::size_t(0), std::size_t(0)));
     }
     if (!_headers_sent) {
         _headers_sent = true;
         _send_resp_awt(std::move(res)) << [&]{return _cur_stream.write(prepare_output_headers());};
     } else {
         if (_output_headers_summary._has_te && _output_headers_summary._has_te_chunked) {
-            return res(ChunkedStream::write(_cur_stream));
+            return res(buffered_output(reuse_device(_resp_chunked, _cur_stream, false, true)));
         } else if (_output_headers_summary._has_ctlen) {
-            return res(LimitedStream::write(_cur_stream, _output_headers_summary._ctlen));
+            return res(buffered_output(reuse_device(_resp_limited, _cur_stream, std::size_t(0), std::size_t(_output_headers_summary._ctlen))));
         } else {
-            return res(_cur_stream);
+            return res(buffered_output(_cur_stream));
         }
     }
     return {};
 }
 
 
+Stream ServerRequest::buffered_output(Stream s) {
+    if (!_output_buffering.has_value()) return s;
+    //socket is used for corking and delayed flush
+    return BufferedStream::create(std::move(s), *_output_buffering,
+            std::dynamic_pointer_cast<SocketStream>(_cur_stream.getStreamDevice()));
+}
+
 cocls::future<Stream> ServerRequest::send() {
     return _send_resp_awt << [&]{return discard_body_intr();};
 }
@@ -464,6 +528,22 @@ cocls::suspend_point<void> ServerRequest::discard_body_coro(std::string_view &da
 
 
 cocls::future<bool> ServerRequest::send_file(const std::string &path, bool use_chunked) {
+    if (!use_chunked && !_headers_sent) {
+        //zero copy is possible only if there is no other stream between the socket and the response
+        auto sock = std::dynamic_pointer_cast<SocketStream>(_cur_stream.getStreamDevice());
+        if (sock) {
+            int fd = ::open(path.c_str(), O_RDONLY|O_CLOEXEC);
+            if (fd < 0) return cocls::future<bool>::set_value(false);
+            struct stat st;
+            if (::fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+                ::close(fd);
+                return cocls::future<bool>::set_value(false);
+            }
+            add_header(strtable::hdr_content_length, static_cast<std::size_t>(st.st_size));
+            auto arena = sock->get_coro_arena();
+            return send_file_direct(arena, std::move(sock), fd, st.st_size);
+        }
+    }
     std::ifstream f(path);
     if (!f) return cocls::future<bool>::set_value(false);
     if (!use_chunked) {
@@ -476,19 +556,31 @@ cocls::future<bool> ServerRequest::send_file(const std::string &path, bool use_c
 }
 
 
+cocls::with_allocator<CoroArena, cocls::async<bool> > ServerRequest::send_file_direct(CoroArena &, std::shared_ptr<SocketStream> sock, int fd, std::uint64_t size) {
+    struct FileCloser {
+        int fd;
+        ~FileCloser() {::close(fd);}
+    } closer{fd};
+    bool ok = co_await discard_body_intr();
+    if (!ok) co_return false;
+    _headers_sent = true;
+    ok = co_await _cur_stream.write(prepare_output_headers());
+    if (!ok) co_return false;
+    co_return co_await sock->write_file(fd, 0, size);
+}
 
 Stream ServerRequest::get_body_coro(bool &res) {
     if (res) {
         return _body_stream;
     } else {
-        return Stream(LimitedStream::read(_cur_stream,0));
+        return reuse_device(_body_limited, _cur_stream, std::size_t(0), std::size_t(0));
     }
 }
 
 
 cocls::future<Stream> ServerRequest::get_body() {
     if (!_has_body) {
-        return cocls::future<Stream>::set_value(LimitedStream::read(_cur_stream, 0));
+        return cocls::future<Stream>::set_value(reuse_device(_body_limited, _cur_stream, std::size_t(0), std::size_t(0)));
     }
     if (_expect_100_continue) {
         auto iter = _output_headers.begin();
@@ -8,16 +8,27 @@
 #ifndef SRC_COROSERVER_HTTP_SERVER_REQUEST_H_
 #define SRC_COROSERVER_HTTP_SERVER_REQUEST_H_
 
+#include "buffered_stream.h"
+#include "coro_alloc.h"
 #include "stream.h"
 #include "http_common.h"
+#include "route_trie.h"
 
+#include <cocls/async.h>
 #include <cocls/common.h>
 #include <cocls/future_conv.h>
 #include <cocls/coro_storage.h>
+#include <cocls/with_allocator.h>
+
+#include <optional>
 
 
 namespace coroserver {
 
+class SocketStream;
+class LimitedStream;
+class ChunkedStream;
+
 namespace http {
 
 
@@ -60,6 +71,32 @@ public:
      */
     void set_path(std::string_view path) {_path = path;}
 
+    ///Retrieve value of a parameter of the route
+    /**
+     * @param name name of the parameter as declared by the route of the handler ({name})
+     * @return value of the parameter. Returns empty string, if there is no such parameter.
+     * The value is part of the path, it is not url-decoded
+     */
+    std::string_view get_route_param(std::string_view name) const {
+        for (std::size_t i = 0; i < _route_param_count; ++i) {
+            if (_route_params[i].name == name) return _route_params[i].value;
+        }
+        return {};
+    }
+
+    ///Set parameters of the route (called by the router before the handler is called)
+    /**
+     * @param params pointer to array of parameters
+     * @param count count of parameters. Excess parameters are ignored
+     *
+     * @note Parameters are copied, however names and values are not. They must stay valid
+     * until the request is finished
+     */
+    void set_route_params(const RouteParam *params, std::size_t count) {
+        _route_param_count = std::min(count, max_route_params);
+        std::copy(params, params + _route_param_count, _route_params.begin());
+    }
+
     ///retrieve set status
     int get_status() const {return _status_code;}
 
@@ -172,6 +209,31 @@ public:
         return _cur_stream.get_counters();
     }
 
+    ///Retrieve stream of the connection
+    Stream get_stream() const {
+        return _cur_stream;
+    }
+
+    ///Determines, whether the request came through secure connection
+    bool is_secure() const {
+        return _secure;
+    }
+
+    ///Determines, whether the request has a body
+    bool has_body() const {
+        return _has_body;
+    }
+
+    ///Determines, whether data after the head of the request has been received
+    /**
+     * @retval true the read which completed the head contained more data (the body or
+     * the next request). The data has been put back to the stream
+     * @retval false no more data has been received yet
+     */
+    bool has_pending_input() const {
+        return _pending_input;
+    }
+
     ///clear all output headers
     void clear_headers();
 
@@ -209,6 +271,18 @@ public:
     cocls::future<bool> send(std::string_view body);
     ///Send response and retrieve stream to send response body
     cocls::future<Stream> send();
+    ///Enable buffering of the stream returned by send()
+    /**
+     * The stream is wrapped into BufferedStream, so small writes are collected
+     * and sent at once. Use BufferedStream::flush(stream) to send buffered data
+     * immediately. The response must be finished by write_eof(). The setting is
+     * valid for current request only
+     *
+     * @param cfg configuration of the buffer
+     */
+    void set_output_buffering(const BufferedStream::Config &cfg) {
+        _output_buffering = cfg;
+    }
     ///Send response prepared in content of std::ostringstream
     /**
      * @param body in stringstream. Function moves the content to the internal buffer
@@ -257,6 +331,8 @@ public:
      * @param use_chunked set true to use chunked format (otherwise it is used content-length)
      * @note it is possible to set headers before. You should set
      * Content-Type, catching, last-modified, etc
+     * @note if the request is served directly by the socket and use_chunked is false,
+     * the file is sent by sendfile() without copying the data to the user space
      * @return a future
      */
     cocls::future<bool> send_file(const std::string &path, bool use_chunked = false);
@@ -378,20 +454,26 @@ protected:
     std::string_view _vpath;
     std::string_view _host;
     std::string_view _status_message;
+    std::array<RouteParam, max_route_params> _route_params;
+    std::size_t _route_param_count = 0;
     bool _secure;
     bool _keep_alive = false;
     bool _expect_100_continue = false;
     bool _has_body = false;
+    bool _pending_input = false;
     bool _body_processed = false;
     bool _headers_sent = false;
 
     Stream _body_stream;
+    ///body and response devices, reused by next request on the connection
+    std::shared_ptr<LimitedStream> _body_limited, _resp_limited;
+    std::shared_ptr<ChunkedStream> _body_chunked, _resp_chunked;
     Logger _logger;
+    std::optional<BufferedStream::Config> _output_buffering;
 
 
     cocls::suspend_point<void> load_coro(std::string_view &data, cocls::promise<bool> &res);
     cocls::future_conv<&ServerRequest::load_coro> _load_awt;
-    unsigned int _search_hdr_state = 0;
 
     Stream get_body_coro(bool &res);
     cocls::future_conv<&ServerRequest::get_body_coro> _get_body_awt;
@@ -409,12 +491,18 @@ protected:
     cocls::future_conv<&ServerRequest::send_resp_body> _send_resp_body_awt;
     std::string_view _send_body_data;
 
+    cocls::suspend_point<void> send_headers_and_body(bool &st, cocls::promise<bool> &res);
+    cocls::future_conv<&ServerRequest::send_headers_and_body> _send_headers_and_body_awt;
+
     static bool future_forward(bool &b) {return b;}
     cocls::future_conv<future_forward> _forward_awt;
 
 
 
     std::string_view prepare_output_headers();
+    Stream buffered_output(Stream s);
+
+    cocls::with_allocator<CoroArena, cocls::async<bool> > send_file_direct(CoroArena &, std::shared_ptr<SocketStream> sock, int fd, std::uint64_t size);
 
 
 
@@ -8,8 +8,6 @@
 
 #include "http_static_page.h"
 
-#include <fstream>
-
 namespace coroserver {
 
 namespace http {
@@ -58,19 +56,12 @@ cocls::future<bool> StaticPage::operator ()(ServerRequest &req, std::string_view
     }
 
     std::string fp=p;
-
-    std::ifstream in(fp);
-    if (!in) return cocls::future<bool>::set_value(false);
-
-    in.seekg(0, std::ios::end);
-    auto sz = in.tellg();
-    in.seekg(0);
+    if (!std::filesystem::is_regular_file(p, ec)) return cocls::future<bool>::set_value(false);
 
     req(strtable::hdr_etag, etag);
     if (_cache_seconds) req.caching(_cache_seconds);
     req.content_type_from_extension(fp);
-    req(strtable::hdr_content_length, std::size_t(sz));
-    return req.send_stream(std::move(in));
+    return req.send_file(fp);
 
 
 
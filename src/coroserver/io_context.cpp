@@ -9,6 +9,7 @@
 #include "io_context.h"
 #include "ipoller.h"
 #include "poller_epoll.h"
+#include "poller_uring.h"
 
 #include "socket_stream.h"
 
@@ -22,19 +23,41 @@
 #include <netinet/tcp.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <linux/filter.h>
+#include <algorithm>
 #include <thread>
 namespace coroserver {
 
 
-ContextIOImpl::ContextIOImpl(std::shared_ptr<cocls::thread_pool> pool)
-        :_pool(pool)
-        ,_disp(std::make_unique<Poller_epoll>(*pool)) {
+static std::unique_ptr<IPoller<SocketHandle> > create_poller(cocls::thread_pool &pool, PollerType type) {
+    if (type == PollerType::uring) {
+        try {
+            return std::make_unique<Poller_uring>(pool);
+        } catch (const std::system_error &) {
+            //io_uring is not available (old kernel, disabled by sysctl or seccomp)
+        }
+    }
+    return std::make_unique<Poller_epoll>(pool, type == PollerType::epoll_edge);
+}
+
+static std::size_t reactor_count(std::size_t reactors) {
+    return reactors?reactors:std::max<std::size_t>(1, std::thread::hardware_concurrency());
+}
 
+ContextIOImpl::ContextIOImpl(std::shared_ptr<cocls::thread_pool> pool, PollerType type, std::size_t reactors)
+        :_pool(pool)
+        ,_coro_arena(std::make_shared<CoroArenaControl>(CoroArenaControl::Config{})) {
+    reactors = reactor_count(reactors);
+    _reactors.reserve(reactors);
+    for (std::size_t i = 0; i < reactors; ++i) {
+        _reactors.push_back(std::make_unique<Reactor>(create_poller(*pool, type), _coro_arena));
+    }
 }
 
 
-ContextIOImpl::ContextIOImpl(std::size_t iothreads)
-    :ContextIOImpl(std::make_shared<cocls::thread_pool>(iothreads))
+ContextIOImpl::ContextIOImpl(std::size_t iothreads, PollerType type, std::size_t reactors)
+    //each reactor needs a thread to wait for events
+    :ContextIOImpl(std::make_shared<cocls::thread_pool>(iothreads?std::max(iothreads, reactor_count(reactors)):0), type, reactors)
 {
 
 }
@@ -45,19 +68,66 @@ ContextIOImpl::~ContextIOImpl() {
 
 
 void ContextIOImpl::close(SocketHandle h) {
+    reactor_for(h).close(h);
+}
+
+AsyncSupport ContextIOImpl::get_reactor(std::size_t idx) {
+    //aliasing constructor - reactor holds reference to whole context
+    return AsyncSupport(std::shared_ptr<IAsyncSupport>(shared_from_this(), _reactors[idx].get()));
+}
+
+AsyncSupport ContextIOImpl::next_reactor() {
+    return get_reactor(_next_reactor.fetch_add(1, std::memory_order_relaxed) % _reactors.size());
+}
+
+ContextIOImpl::Reactor::Reactor(std::unique_ptr<IPoller<SocketHandle> > disp, std::shared_ptr<CoroArenaControl> coro_arena)
+    :_disp(std::move(disp))
+    ,_coro_arena(std::move(coro_arena)) {
+
+}
+
+void ContextIOImpl::Reactor::close(SocketHandle h) {
     _disp->handle_closed(h);
     ::close(h);
 }
 
+static void set_socket_option(SocketHandle sock, int level, int opt, int val, const char *name) {
+    if (::setsockopt(sock, level, opt, reinterpret_cast<char *>(&val), sizeof(int)))
+        throw std::system_error(errno, std::system_category(), std::string("setsockopt(").append(name).append(")"));
+}
+
+static bool is_tcp_family(int family) {
+    return family == AF_INET || family == AF_INET6;
+}
+
+//options common for listening and connected sockets
+static void apply_socket_options(SocketHandle sock, int family, const SocketOptions &opts) {
+    if (opts.rcvbuf) set_socket_option(sock, SOL_SOCKET, SO_RCVBUF, opts.rcvbuf, "SO_RCVBUF");
+    if (opts.sndbuf) set_socket_option(sock, SOL_SOCKET, SO_SNDBUF, opts.sndbuf, "SO_SNDBUF");
+    if (!is_tcp_family(family)) return;
+    if (opts.nodelay) set_socket_option(sock, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+    if (opts.notsent_lowat) set_socket_option(sock, IPPROTO_TCP, TCP_NOTSENT_LOWAT, opts.notsent_lowat, "TCP_NOTSENT_LOWAT");
+    if (opts.keepalive) {
+        set_socket_option(sock, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE");
+        if (opts.keepalive_idle) set_socket_option(sock, IPPROTO_TCP, TCP_KEEPIDLE, opts.keepalive_idle, "TCP_KEEPIDLE");
+        if (opts.keepalive_interval) set_socket_option(sock, IPPROTO_TCP, TCP_KEEPINTVL, opts.keepalive_interval, "TCP_KEEPINTVL");
+        if (opts.keepalive_count) set_socket_option(sock, IPPROTO_TCP, TCP_KEEPCNT, opts.keepalive_count, "TCP_KEEPCNT");
+    }
+}
+
 SocketHandle ContextIO::create_connected_socket(const PeerName &addr) {
+    return create_connected_socket(addr, get_socket_options(addr.get_group_id()));
+}
+
+SocketHandle ContextIO::create_connected_socket(const PeerName &addr, const SocketOptions &opts) {
     return addr.use_sockaddr([&](const sockaddr *saddr, socklen_t slen) {
         int sock = ::socket(saddr->sa_family, SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC, saddr->sa_family == AF_UNIX?0:IPPROTO_TCP);
         if (sock < 0) throw std::system_error(errno, std::system_category(), "::listen - create_socket");
         try {
-            int flag = 1;
-            if (saddr->sa_family == AF_INET || saddr->sa_family == AF_INET6) {
-                if (::setsockopt(sock,IPPROTO_TCP,TCP_NODELAY,reinterpret_cast<char *>(&flag),sizeof(int)))
-                    throw std::system_error(errno, std::system_category(), "setsockopt(TCP_NODELAY)");
+            apply_socket_options(sock, saddr->sa_family, opts);
+            if (opts.fastopen && is_tcp_family(saddr->sa_family)) {
+                //SYN is sent with the first write
+                set_socket_option(sock, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1, "TCP_FASTOPEN_CONNECT");
             }
             if (::connect(sock,saddr, slen)) {
                 int err = errno;
@@ -74,25 +144,29 @@ SocketHandle ContextIO::create_connected_socket(const PeerName &addr) {
 
 }
 
-ListeningSocketHandle ContextIO::listen_socket(const PeerName &addr) {
+ListeningSocketHandle ContextIO::listen_socket(const PeerName &addr, bool reuse_port) {
+    return listen_socket(addr, get_socket_options(addr.get_group_id()), reuse_port);
+}
+
+ListeningSocketHandle ContextIO::listen_socket(const PeerName &addr, const SocketOptions &opts, bool reuse_port) {
     return addr.use_sockaddr([&](const sockaddr *saddr, socklen_t slen) {
         int sock = ::socket(saddr->sa_family, SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC, saddr->sa_family == AF_UNIX?0:IPPROTO_TCP);
         if (sock < 0) throw std::system_error(errno, std::system_category(), "::listen - create_socket");
         try {
-            int flag = 1;
             if (saddr->sa_family == AF_INET6) {
-                if (::setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast<char *>(&flag), sizeof(int)))
-                    throw std::system_error(errno, std::system_category(), "setsockopt(IPV6_V6ONLY)");
+                set_socket_option(sock, IPPROTO_IPV6, IPV6_V6ONLY, opts.v6only?1:0, "IPV6_V6ONLY");
             }
-            if (saddr->sa_family == AF_INET || saddr->sa_family == AF_INET6) {
-                if (::setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<char *>(&flag), sizeof(int)))
-                    throw std::system_error(errno, std::system_category(), "setsockopt(SO_REUSEADDR)");
-                if (::setsockopt(sock,IPPROTO_TCP,TCP_NODELAY,reinterpret_cast<char *>(&flag),sizeof(int)))
-                    throw std::system_error(errno, std::system_category(), "setsockopt(TCP_NODELAY)");
+            //accepted connections inherit these options
+            apply_socket_options(sock, saddr->sa_family, opts);
+            if (is_tcp_family(saddr->sa_family)) {
+                if (opts.reuse_addr) set_socket_option(sock, SOL_SOCKET, SO_REUSEADDR, 1, "SO_REUSEADDR");
+                if (reuse_port) set_socket_option(sock, SOL_SOCKET, SO_REUSEPORT, 1, "SO_REUSEPORT");
+                if (opts.defer_accept) set_socket_option(sock, IPPROTO_TCP, TCP_DEFER_ACCEPT, opts.defer_accept, "TCP_DEFER_ACCEPT");
+                if (opts.fastopen) set_socket_option(sock, IPPROTO_TCP, TCP_FASTOPEN, opts.fastopen, "TCP_FASTOPEN");
             }
             if (::bind(sock,saddr, slen))
                 throw std::system_error(errno, std::system_category(), "bind");
-            if (::listen(sock, SOMAXCONN))
+            if (::listen(sock, opts.backlog?opts.backlog:SOMAXCONN))
                 throw std::system_error(errno, std::system_category(), "listen");
             return sock;
         } catch (...) {
@@ -103,55 +177,113 @@ ListeningSocketHandle ContextIO::listen_socket(const PeerName &addr) {
 
 }
 
+void ContextIOImpl::set_socket_options(int group_id, const SocketOptions &opts) {
+    std::lock_guard _(_socket_options_mx);
+    _socket_options[group_id] = opts;
+}
+
+SocketOptions ContextIOImpl::get_socket_options(int group_id) const {
+    std::lock_guard _(_socket_options_mx);
+    auto iter = _socket_options.find(group_id);
+    if (iter == _socket_options.end()) return {};
+    return iter->second;
+}
+
 cocls::suspend_point<void> ContextIOImpl::mark_closing(SocketHandle s) {
-    return _disp->mark_closing(s);
+    return reactor_for(s).mark_closing(s);
 }
 
 
 cocls::suspend_point<void> ContextIOImpl::stop() {
-    if (_disp) {
-        return _disp->mark_closing_all();
-    } else {
-        return {};
+    cocls::suspend_point<void> r;
+    for (auto &x: _reactors) {
+        r << x->stop();
     }
+    return r;
 }
 
+cocls::suspend_point<void> ContextIOImpl::Reactor::mark_closing(SocketHandle s) {
+    return _disp->mark_closing(s);
+}
+
+cocls::suspend_point<void> ContextIOImpl::Reactor::stop() {
+    return _disp->mark_closing_all();
+}
+
+
+//connections accepted at once, connections not yielded are closed on destruction
+class AcceptBatch {
+public:
+    AcceptBatch(std::size_t size):_size(size) {_items.reserve(size);}
+    AcceptBatch(const AcceptBatch &) = delete;
+    AcceptBatch &operator=(const AcceptBatch &) = delete;
+    ~AcceptBatch() {clear();}
+
+    bool full() const {return _items.size() >= _size;}
+    bool empty() const {return _pos >= _items.size();}
+    void push(SocketHandle s, PeerName peer) {_items.push_back({s, std::move(peer)});}
+    std::pair<SocketHandle, PeerName> pop() {return std::move(_items[_pos++]);}
+    void clear() {
+        for (std::size_t i = _pos; i < _items.size(); ++i) ::close(_items[i].first);
+        _items.clear();
+        _pos = 0;
+    }
+
+protected:
+    std::vector<std::pair<SocketHandle, PeerName> > _items;
+    std::size_t _pos = 0;
+    std::size_t _size;
+};
 
 static cocls::generator<Stream> listen_generator(AsyncSupport ctx,
         TimeoutSettings tmcfg,
         std::stop_token stoken,
         ListeningSocketHandle h,
-        int group_id) {
+        int group_id,
+        std::size_t batch_size,
+        std::size_t zerocopy_threshold) {
 
     std::stop_callback stopcb(stoken, [&]{
         ctx.mark_closing(h);
     });
 
+    AcceptBatch batch(batch_size);
     bool run = true;
-    while (run) {
-        WaitResult res = co_await ctx.io_wait(h,AsyncOperation::accept,std::chrono::system_clock::time_point::max());
+    while (run && !stoken.stop_requested()) {
+        //accept all waiting connections first (up to batch size), the
+        //connection can be already waiting (edge triggered poller doesn't report it again)
+        int err = 0;
+        while (!batch.full()) {
+            sockaddr_storage addr;
+            socklen_t slen = sizeof(addr);
+            int s = ::accept4(h, reinterpret_cast<sockaddr *>(&addr), &slen,
+                    SOCK_NONBLOCK|SOCK_CLOEXEC);
+            if (s < 0) {
+                err = errno;
+                if (err == EINTR) continue;
+                break;
+            }
+            batch.push(s, PeerName::from_sockaddr(&addr).set_group_id(group_id));
+        }
+        bool drained = !batch.full();
+        while (!batch.empty()) {
+            auto [s, peer] = batch.pop();
+            auto stream = std::make_shared<SocketStream>(ctx, s, std::move(peer), tmcfg);
+            if (zerocopy_threshold) stream->enable_zerocopy(zerocopy_threshold);
+            co_yield Stream(std::move(stream));
+        }
+        batch.clear();
+        //batch was full, there can be more connections
+        if (!drained) continue;
+        //someone else accepted the connection (shared listener)
+        if (err != EAGAIN && err != EWOULDBLOCK) {
+            throw std::system_error(err, std::system_category(), "::accept4");
+        }
+        WaitResult res = co_await ctx.io_wait(h,AsyncOperation::accept,TimePoint::max());
         switch (res) {
             case WaitResult::timeout:
             case WaitResult::closed: run = false; break;
-            default:
-            case WaitResult::complete:
-            case WaitResult::error: {
-                sockaddr_storage addr;
-                socklen_t slen = sizeof(addr);
-                int s = ::accept4(h, reinterpret_cast<sockaddr *>(&addr), &slen,
-                        SOCK_NONBLOCK|SOCK_CLOEXEC);
-                if (s>=0) {
-                    co_yield Stream ( std::make_shared<SocketStream>(ctx, s,
-                            PeerName::from_sockaddr(&addr).set_group_id(group_id),
-                            tmcfg));
-                } else {
-
-                    int e = errno;
-                    if (e != EINTR) {
-                        throw std::system_error(errno, std::system_category(), "::accept4");
-                    }
-                }
-            };break;
+            default: break;
         }
     }
     ctx.close(h);
@@ -159,19 +291,76 @@ static cocls::generator<Stream> listen_generator(AsyncSupport ctx,
 
 
 
+static bool is_inet(const PeerName &addr) {
+    return addr.use_sockaddr([](const sockaddr *saddr, socklen_t) {
+        return saddr->sa_family == AF_INET || saddr->sa_family == AF_INET6;
+    });
+}
+
+//installs program, which selects listener of reuseport group by cpu, which received the connection
+static void attach_cpu_steering(SocketHandle h, std::size_t count) {
+    sock_filter code[] = {
+            {BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<std::uint32_t>(SKF_AD_OFF + SKF_AD_CPU)},
+            {BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<std::uint32_t>(count)},
+            {BPF_RET | BPF_A, 0, 0, 0}
+    };
+    sock_fprog prog = {static_cast<unsigned short>(std::size(code)), code};
+    if (::setsockopt(h, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)))
+        throw std::system_error(errno, std::system_category(), "setsockopt(SO_ATTACH_REUSEPORT_CBPF)");
+}
+
 cocls::generator<Stream> ContextIO::accept(std::vector<PeerName> &list,
-                                std::stop_token token, TimeoutSettings tms) {
+                                std::stop_token token, TimeoutSettings tms,
+                                std::optional<SocketOptions> opts) {
 
     std::vector<cocls::generator<Stream> > gens;
     std::vector<SocketHandle> handles;
     AsyncSupport sup = *this;
+    std::size_t reactors = _ptr->get_reactor_count();
+    std::size_t batch = _ptr->get_accept_batch();
     for (PeerName &x: list) {
         try {
-            SocketHandle h = ContextIO::listen_socket(x);
             int id =x.get_group_id();
-            x = PeerName::from_socket(h,false).set_group_id(id);
-            gens.push_back(listen_generator(sup, tms, token, h, id));
-            handles.push_back(h);
+            SocketOptions sopts = opts.has_value()?*opts:get_socket_options(id);
+            if (reactors > 1 && is_inet(x)) {
+                //open one listener per reactor, the kernel distributes connections
+                PeerName addr = x;
+                SocketHandle first = -1;
+                for (std::size_t i = 0; i < reactors; ++i) {
+                    SocketHandle h = ContextIO::listen_socket(addr, sopts, true);
+                    handles.push_back(h);
+                    if (i == 0) {
+                        //when random port is requested, other listeners must use the same port
+                        first = h;
+                        addr = PeerName::from_socket(h,false);
+                        x = PeerName(addr).set_group_id(id);
+                    }
+                    gens.push_back(listen_generator(_ptr->get_reactor(i), tms, token, h, id, batch, sopts.zerocopy_threshold));
+                }
+                if (_ptr->get_cpu_steering()) {
+                    attach_cpu_steering(first, reactors);
+                }
+            } else if (reactors > 1) {
+                //listener can't be opened multiple times, share it by all reactors
+                //each reactor has own descriptor, only one reactor is woken up (EPOLLEXCLUSIVE)
+                SocketHandle h = ContextIO::listen_socket(x, sopts);
+                handles.push_back(h);
+                x = PeerName::from_socket(h,false).set_group_id(id);
+                for (std::size_t i = 0; i < reactors; ++i) {
+                    SocketHandle d = h;
+                    if (i) {
+                        d = ::fcntl(h, F_DUPFD_CLOEXEC, 0);
+                        if (d < 0) throw std::system_error(errno, std::system_category(), "fcntl(F_DUPFD_CLOEXEC)");
+                        handles.push_back(d);
+                    }
+                    gens.push_back(listen_generator(_ptr->get_reactor(i), tms, token, d, id, batch, sopts.zerocopy_threshold));
+                }
+            } else {
+                SocketHandle h = ContextIO::listen_socket(x, sopts);
+                handles.push_back(h);
+                x = PeerName::from_socket(h,false).set_group_id(id);
+                gens.push_back(listen_generator(_ptr->next_reactor(), tms, token, h, id, batch, sopts.zerocopy_threshold));
+            }
         } catch (...) {
             for (SocketHandle x: handles) {
                 sup.close(x);
@@ -184,8 +373,9 @@ cocls::generator<Stream> ContextIO::accept(std::vector<PeerName> &list,
 }
 
 cocls::generator<Stream> ContextIO::accept(std::vector<PeerName> &&list,
-                                std::stop_token token, TimeoutSettings tms) {
-    return accept(list,std::move(token),std::move(tms));
+                                std::stop_token token, TimeoutSettings tms,
+                                std::optional<SocketOptions> opts) {
+    return accept(list,std::move(token),std::move(tms),std::move(opts));
 }
 
 
@@ -196,13 +386,14 @@ struct ConnectInfo {
 
 //coroutine which waits f
 static cocls::async<void> wait_connect(ContextIO ctx,
+            AsyncSupport supp,
             const PeerName &peer,
+            const std::optional<SocketOptions> &opts,
             int delay_sec,
             int timeout,
             std::stop_token stop,
             cocls::queue<ConnectInfo> &result) {
 
-    AsyncSupport supp = ctx;
     SocketHandle socket = -1;
 
     WaitResult res;
@@ -228,7 +419,8 @@ static cocls::async<void> wait_connect(ContextIO ctx,
     }
     try {
         //create socket
-        socket = ctx.create_connected_socket(peer);
+        socket = opts.has_value()?ctx.create_connected_socket(peer, *opts)
+                                 :ctx.create_connected_socket(peer);
     } catch (...) {
         //failed to create socket - report failure
         result.push(ConnectInfo{peer, {}});
@@ -243,7 +435,7 @@ static cocls::async<void> wait_connect(ContextIO ctx,
         //check stop request now, we can continue, if there is no stop request
         if (!stop.stop_requested()) {
             //wait for connect
-            res = co_await supp.io_wait(socket,AsyncOperation::connect, TimeoutSettings::from_duration(timeout));
+            res = co_await supp.io_wait(socket,AsyncOperation::connect, TimeoutSettings::from_duration(supp.now(), timeout));
         }
     }
     //if connection is complete,
@@ -261,17 +453,20 @@ static cocls::async<void> wait_connect(ContextIO ctx,
     co_await result.push(ConnectInfo{peer, {}});
 }
 
-cocls::future<Stream> ContextIO::connect(std::vector<PeerName> list, int timeout_ms, TimeoutSettings tms) {
+cocls::future<Stream> ContextIO::connect(std::vector<PeerName> list, int timeout_ms, TimeoutSettings tms,
+                                        std::optional<SocketOptions> opts) {
     //queue collects results for multiple sockets
     cocls::queue<ConnectInfo> results;
     //stop source to stop futher waiting
     std::stop_source stop;
     std::size_t i;
     std::size_t cnt = list.size();
+    //the connection is handled by single reactor
+    AsyncSupport supp = _ptr->next_reactor();
     //start coroutines, each for one peer
     for (i = 0; i < cnt; i++) {
         //coroutine is detached, because each put result to queue
-        wait_connect(*this, list[i], i, timeout_ms, stop.get_token(), results).detach();
+        wait_connect(*this, supp, list[i], opts, i, timeout_ms, stop.get_token(), results).detach();
     }
     //contains connected stream
     std::optional<Stream> connected;
@@ -284,13 +479,17 @@ cocls::future<Stream> ContextIO::connect(std::vector<PeerName> list, int timeout
             //but if we don't have stream
             if (!connected.has_value()) {
                 //create it now
-                connected = Stream(std::make_shared<SocketStream>(*this, *nfo.socket, nfo.peer, tms));
+                auto stream = std::make_shared<SocketStream>(supp, *nfo.socket, nfo.peer, tms);
+                std::size_t zc = opts.has_value()?opts->zerocopy_threshold
+                                :get_socket_options(nfo.peer.get_group_id()).zerocopy_threshold;
+                if (zc) stream->enable_zerocopy(zc);
+                connected = Stream(std::move(stream));
                 //and stop other attempts
                 stop.request_stop();
             } else {
                 //this can happen as race condition when two connections are ready at the same time
                 //so close any other connection
-                _ptr->close(*nfo.socket);
+                supp.close(*nfo.socket);
             }
         }
     }
@@ -301,12 +500,12 @@ cocls::future<Stream> ContextIO::connect(std::vector<PeerName> list, int timeout
 }
 
 
-ContextIO ContextIO::create(std::shared_ptr<cocls::thread_pool> pool) {
-    return ContextIO(std::make_shared<ContextIOImpl>(pool));
+ContextIO ContextIO::create(std::shared_ptr<cocls::thread_pool> pool, PollerType type, std::size_t reactors) {
+    return ContextIO(std::make_shared<ContextIOImpl>(pool, type, reactors));
 }
 
-ContextIO ContextIO::create(std::size_t iothreads){
-    return ContextIO(std::make_shared<ContextIOImpl>(iothreads));
+ContextIO ContextIO::create(std::size_t iothreads, PollerType type, std::size_t reactors){
+    return ContextIO(std::make_shared<ContextIOImpl>(iothreads, type, reactors));
 }
 
 cocls::suspend_point<void> ContextIO::stop() {
@@ -321,21 +520,86 @@ cocls::suspend_point<void> ContextIO::stop() {
 
 
 cocls::future<WaitResult> ContextIOImpl::io_wait(SocketHandle handle,
-        AsyncOperation op, std::chrono::system_clock::time_point timeout) {
+        AsyncOperation op, TimePoint timeout) {
+    return reactor_for(handle).io_wait(handle, op, timeout);
+}
+
+cocls::future<WaitResult> ContextIOImpl::wait_until(
+        TimePoint tp, const void *ident) {
+    return reactor_for(ident).wait_until(tp, ident);
+}
+
+cocls::suspend_point<bool> ContextIOImpl::cancel_wait(const void *ident) {
+    return reactor_for(ident).cancel_wait(ident);
+}
+
+bool ContextIOImpl::completion_io() const {
+    //borrowed buffers belong to the reactor, so completion I/O is available only through
+    //the reactor itself, unless there is only one reactor
+    return _reactors.size() == 1 && _reactors.front()->completion_io();
+}
+
+cocls::future<IOResult> ContextIOImpl::io_read(SocketHandle handle, std::size_t size,
+        TimePoint timeout) {
+    return reactor_for(handle).io_read(handle, size, timeout);
+}
+
+cocls::future<IOResult> ContextIOImpl::io_write(SocketHandle handle, std::string_view data,
+        TimePoint timeout) {
+    return reactor_for(handle).io_write(handle, data, timeout);
+}
+
+void ContextIOImpl::release_buffer(int buffer_id) {
+    //see completion_io()
+    _reactors.front()->release_buffer(buffer_id);
+}
+
+BufferPool &ContextIOImpl::get_buffer_pool() {
+    //streams not bound to a reactor share the pool of the first reactor
+    return _reactors.front()->get_buffer_pool();
+}
+
+CoroArena ContextIOImpl::create_coro_arena() {
+    return CoroArena(_coro_arena);
+}
+
+void ContextIOImpl::set_buffer_pool_config(const BufferPool::Config &cfg) {
+    for (auto &r: _reactors) r->get_buffer_pool().set_config(cfg);
+}
+
+cocls::future<WaitResult> ContextIOImpl::Reactor::io_wait(SocketHandle handle,
+        AsyncOperation op, TimePoint timeout) {
 
     return [&](auto p){_disp->async_wait(op, handle, std::move(p), timeout);};
 }
 
-cocls::future<WaitResult> ContextIOImpl::wait_until(
-        std::chrono::system_clock::time_point tp, const void *ident) {
+cocls::future<WaitResult> ContextIOImpl::Reactor::wait_until(
+        TimePoint tp, const void *ident) {
     return [&](auto promise) {
         _disp->schedule(ident, std::move(promise), tp);
     };
 }
 
-cocls::suspend_point<bool> ContextIOImpl::cancel_wait(const void *ident) {
+cocls::suspend_point<bool> ContextIOImpl::Reactor::cancel_wait(const void *ident) {
     return _disp->cancel_schedule(ident);
 }
 
+bool ContextIOImpl::Reactor::completion_io() const {
+    return _disp->completion_io();
+}
+
+cocls::future<IOResult> ContextIOImpl::Reactor::io_read(SocketHandle handle, std::size_t size,
+        TimePoint timeout) {
+    return [&](auto p){_disp->async_read(handle, size, std::move(p), timeout);};
 }
 
+cocls::future<IOResult> ContextIOImpl::Reactor::io_write(SocketHandle handle, std::string_view data,
+        TimePoint timeout) {
+    return [&](auto p){_disp->async_write(handle, data, std::move(p), timeout);};
+}
+
+void ContextIOImpl::Reactor::release_buffer(int buffer_id) {
+    _disp->release_buffer(buffer_id);
+}
+
+}
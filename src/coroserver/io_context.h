@@ -12,11 +12,18 @@
 #include "ipoller.h"
 #include "stream.h"
 #include "peername.h"
+#include "socket_options.h"
 
 #include <cocls/thread_pool.h>
 #include <cocls/generator.h>
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <optional>
 #include <stop_token>
+#include <unordered_map>
+#include <vector>
 
 using coroserver::PeerName;
 
@@ -26,8 +33,18 @@ using coroserver::PeerName;
 
 namespace coroserver {
 
+///Type of poller used by the context
+enum class PollerType {
+    ///poller based on epoll (default)
+    epoll,
+    ///poller based on epoll, descriptors are registered once in edge triggered mode.
+    ///This saves epoll_ctl calls on busy connections
+    epoll_edge,
+    ///poller based on io_uring. If the io_uring is not available, epoll is used
+    uring
+};
 
-class ContextIOImpl: public IAsyncSupport {
+class ContextIOImpl: public IAsyncSupport, public std::enable_shared_from_this<ContextIOImpl> {
 public:
 
 
@@ -36,15 +53,22 @@ public:
     using AcceptResult = std::pair<SocketHandle, PeerName>;
 
 
-    ContextIOImpl(std::shared_ptr<cocls::thread_pool> pool);
-    ContextIOImpl(std::size_t iothreads = 0);
+    ///Construct context
+    /**
+     * @param pool thread pool
+     * @param type type of poller
+     * @param reactors count of reactors. Each reactor has own poller, own table of
+     * descriptors and own timers. Value 0 creates one reactor per hardware thread
+     */
+    ContextIOImpl(std::shared_ptr<cocls::thread_pool> pool, PollerType type = PollerType::epoll, std::size_t reactors = 1);
+    ContextIOImpl(std::size_t iothreads = 0, PollerType type = PollerType::epoll, std::size_t reactors = 1);
     ~ContextIOImpl();
 
     virtual void close(SocketHandle h) override;
     virtual cocls::suspend_point<void> mark_closing(SocketHandle s) override;
     virtual cocls::future<WaitResult> io_wait(SocketHandle handle,
                                     AsyncOperation op,
-                                    std::chrono::system_clock::time_point timeout) override;
+                                    TimePoint timeout) override;
 
 
 
@@ -62,22 +86,172 @@ public:
      */
 
 
-    virtual cocls::future<WaitResult> wait_until(std::chrono::system_clock::time_point tp, const void *ident) override;
+    virtual cocls::future<WaitResult> wait_until(TimePoint tp, const void *ident) override;
     template<typename Dur>
     cocls::future<WaitResult> wait_for(Dur duration, const void *ident) {
-        return wait_until(std::chrono::system_clock::now()+duration, ident);
+        return wait_until(reactor_for(ident).now()+duration, ident);
     }
 
     cocls::suspend_point<bool> cancel_wait(const void *ident) override;
 
+    virtual bool completion_io() const override;
+    virtual cocls::future<IOResult> io_read(SocketHandle handle, std::size_t size,
+                                    TimePoint timeout) override;
+    virtual cocls::future<IOResult> io_write(SocketHandle handle, std::string_view data,
+                                    TimePoint timeout) override;
+    virtual void release_buffer(int buffer_id) override;
+    virtual BufferPool &get_buffer_pool() override;
+    virtual CoroArena create_coro_arena() override;
+
 
     cocls::thread_pool &get_pool() {
         return *_pool;
     }
 
+    ///Retrieve count of reactors
+    std::size_t get_reactor_count() const {
+        return _reactors.size();
+    }
+
+    ///Retrieve async support bound to given reactor
+    /**
+     * @param idx index of reactor
+     * @return async support. All operations are handled by the reactor. The object
+     * also holds reference to the context
+     */
+    AsyncSupport get_reactor(std::size_t idx);
+
+    ///Retrieve async support of next reactor (round robin)
+    AsyncSupport next_reactor();
+
+    ///Retrieve metrics of the reactor
+    /**
+     * @param idx index of reactor
+     * @return snapshot of counters of the reactor
+     */
+    ReactorMetrics get_metrics(std::size_t idx) const {
+        return _reactors[idx]->get_metrics();
+    }
+
+    ///Retrieve statistics of the pool of read buffers of the reactor
+    /**
+     * @param idx index of reactor
+     * @return statistics
+     */
+    BufferPool::Stats get_buffer_pool_stats(std::size_t idx) const {
+        return _reactors[idx]->get_buffer_pool().get_stats();
+    }
+
+    ///Configure pools of read buffers of all reactors
+    /**
+     * @param cfg new configuration
+     */
+    void set_buffer_pool_config(const BufferPool::Config &cfg);
+
+    ///Retrieve statistics of arenas of coroutine frames
+    CoroArenaControl::Stats get_coro_arena_stats() const {
+        return _coro_arena->get_stats();
+    }
+
+    ///Configure arenas of coroutine frames
+    /**
+     * @param cfg new configuration, affects connections created after this call
+     */
+    void set_coro_arena_config(const CoroArenaControl::Config &cfg) {
+        _coro_arena->set_config(cfg);
+    }
+
+    ///Enables steering of incoming connections by CPU
+    /**
+     * When enabled, the listeners of each port are chained by BPF program which selects
+     * listener according to the CPU which received the connection (cpu % reactors).
+     * Affects only listeners created after this call.
+     */
+    void set_cpu_steering(bool enable) {_cpu_steering = enable;}
+
+    ///Determines, whether the CPU steering is enabled
+    bool get_cpu_steering() const {return _cpu_steering;}
+
+    ///Sets max count of connections accepted at once
+    /**
+     * The listener accepts waiting connections until there is no more connection
+     * or until the batch is full, then it yields accepted connections in a burst.
+     * Affects only listeners created after this call.
+     * @param count count of connections (minimum is 1)
+     */
+    void set_accept_batch(std::size_t count) {_accept_batch = std::max<std::size_t>(count, 1);}
+
+    ///Retrieve max count of connections accepted at once
+    std::size_t get_accept_batch() const {return _accept_batch;}
+
+    ///Sets socket options for given group of peers
+    /**
+     * @param group_id group id (see PeerName::set_group_id)
+     * @param opts options used for listeners and connections of the group,
+     * unless the options are specified explicitly
+     */
+    void set_socket_options(int group_id, const SocketOptions &opts);
+
+    ///Retrieve socket options of the group
+    /**
+     * @param group_id group id
+     * @return options of the group, or default options, if not set
+     */
+    SocketOptions get_socket_options(int group_id) const;
+
 protected:
+
+    ///Reactor - the poller with its own descriptors and timers
+    class Reactor: public IAsyncSupport {
+    public:
+        Reactor(std::unique_ptr<IPoller<SocketHandle> > disp, std::shared_ptr<CoroArenaControl> coro_arena);
+
+        virtual void close(SocketHandle h) override;
+        virtual cocls::suspend_point<void> mark_closing(SocketHandle s) override;
+        virtual cocls::future<WaitResult> io_wait(SocketHandle handle,
+                                        AsyncOperation op,
+                                        TimePoint timeout) override;
+        virtual cocls::future<WaitResult> wait_until(TimePoint tp, const void *ident) override;
+        virtual cocls::suspend_point<bool> cancel_wait(const void *ident) override;
+        virtual bool completion_io() const override;
+        virtual cocls::future<IOResult> io_read(SocketHandle handle, std::size_t size,
+                                        TimePoint timeout) override;
+        virtual cocls::future<IOResult> io_write(SocketHandle handle, std::string_view data,
+                                        TimePoint timeout) override;
+        virtual void release_buffer(int buffer_id) override;
+        virtual BufferPool &get_buffer_pool() override {return _buffer_pool;}
+        virtual CoroArena create_coro_arena() override {return CoroArena(_coro_arena);}
+        virtual TimePoint now() const override {return _disp->now();}
+
+        cocls::suspend_point<void> stop();
+
+        ReactorMetrics get_metrics() const {return _disp->get_metrics();}
+        const BufferPool &get_buffer_pool() const {return _buffer_pool;}
+
+    protected:
+        std::unique_ptr<IPoller<SocketHandle> > _disp;
+        BufferPool _buffer_pool;
+        std::shared_ptr<CoroArenaControl> _coro_arena;
+    };
+
     std::shared_ptr<cocls::thread_pool> _pool;
-    std::unique_ptr<IPoller<SocketHandle> > _disp;
+    ///shared by all reactors
+    std::shared_ptr<CoroArenaControl> _coro_arena;
+    std::vector<std::unique_ptr<Reactor> > _reactors;
+    std::atomic<std::size_t> _next_reactor = 0;
+    bool _cpu_steering = false;
+    std::size_t _accept_batch = 16;
+    std::unordered_map<int, SocketOptions> _socket_options;
+    mutable std::mutex _socket_options_mx;
+
+    ///reactor which handles descriptors not bound to a reactor
+    Reactor &reactor_for(SocketHandle h) {
+        return *_reactors[static_cast<std::size_t>(h) % _reactors.size()];
+    }
+    ///reactor which handles timers not bound to a reactor
+    Reactor &reactor_for(const void *ident) {
+        return *_reactors[std::hash<const void *>()(ident) % _reactors.size()];
+    }
 };
 
 
@@ -108,6 +282,11 @@ public:
      * @param dispatcherCount count dispatchers. In most of cases, 1 is enough, but
      * if you expect a lot of connections, you can increase count of dispatchers. Each
      * dispatcher allocates one thread
+     * @param type type of poller. When PollerType::uring is requested and io_uring
+     * is not available, the context silently falls back to epoll
+     * @param reactors count of reactors. Each reactor has own poller, so
+     * the descriptors are spread among reactors. Value 0 creates one reactor per
+     * hardware thread. Thread pool should have at least one thread per reactor
      *
      * @return instance (shared)
      *
@@ -116,24 +295,139 @@ public:
      *
      * @see start
      */
-    static ContextIO create(std::shared_ptr<cocls::thread_pool> pool);
-    static ContextIO create(std::size_t iothreads = 0);
+    static ContextIO create(std::shared_ptr<cocls::thread_pool> pool, PollerType type = PollerType::epoll, std::size_t reactors = 1);
+    static ContextIO create(std::size_t iothreads = 0, PollerType type = PollerType::epoll, std::size_t reactors = 1);
 
     ///Create listening socket at given peer
-    ListeningSocketHandle listen_socket(const PeerName &addr);
+    /**
+     * @param addr address
+     * @param reuse_port set SO_REUSEPORT, allows to open multiple listeners on the same port
+     * @return listening socket
+     */
+    ListeningSocketHandle listen_socket(const PeerName &addr, bool reuse_port = false);
+    ///Create listening socket at given peer
+    /**
+     * @param addr address
+     * @param opts socket options
+     * @param reuse_port set SO_REUSEPORT, allows to open multiple listeners on the same port
+     * @return listening socket
+     */
+    ListeningSocketHandle listen_socket(const PeerName &addr, const SocketOptions &opts, bool reuse_port = false);
     ///Create connected socket. Connection is asynchronous, you need to check status of socket
     SocketHandle create_connected_socket(const PeerName &addr);
+    ///Create connected socket with given options. Connection is asynchronous, you need to check status of socket
+    SocketHandle create_connected_socket(const PeerName &addr, const SocketOptions &opts);
 
     operator AsyncSupport() const {
         return AsyncSupport(_ptr);
     }
 
+    ///Retrieve count of reactors
+    std::size_t get_reactor_count() const {
+        return _ptr->get_reactor_count();
+    }
+
+    ///Retrieve async support bound to given reactor
+    AsyncSupport get_reactor(std::size_t idx) const {
+        return _ptr->get_reactor(idx);
+    }
+
+    ///Retrieve metrics of the reactor
+    /**
+     * Metrics are always collected, reading them is cheap. Counters are
+     * monotonic, so compare two snapshots to calculate rates.
+     *
+     * @param idx index of reactor (0 - get_reactor_count()-1)
+     * @return snapshot of counters of the reactor
+     */
+    ReactorMetrics get_metrics(std::size_t idx) const {
+        return _ptr->get_metrics(idx);
+    }
+
+    ///Retrieve statistics of the pool of read buffers of the reactor
+    /**
+     * @param idx index of reactor (0 - get_reactor_count()-1)
+     * @return statistics
+     */
+    BufferPool::Stats get_buffer_pool_stats(std::size_t idx) const {
+        return _ptr->get_buffer_pool_stats(idx);
+    }
+
+    ///Retrieve statistics of arenas of coroutine frames
+    /**
+     * Each connection allocates its coroutine frames from own arena. The
+     * heap_frames counts frames which didn't fit to the arena. It should stop
+     * growing once the size of the block adapts to the load
+     *
+     * @return statistics
+     */
+    CoroArenaControl::Stats get_coro_arena_stats() const {
+        return _ptr->get_coro_arena_stats();
+    }
+
+    ///Configure arenas of coroutine frames
+    /**
+     * @param cfg configuration (initial and maximum size of the block)
+     * @see CoroArena
+     */
+    void set_coro_arena_config(const CoroArenaControl::Config &cfg) {
+        _ptr->set_coro_arena_config(cfg);
+    }
+
+    ///Configure pools of read buffers of all reactors
+    /**
+     * @param cfg configuration (sizes of buffers, limit of free buffers)
+     * @see BufferPool
+     */
+    void set_buffer_pool_config(const BufferPool::Config &cfg) {
+        _ptr->set_buffer_pool_config(cfg);
+    }
+
+    ///Enables steering of incoming connections by CPU
+    /**
+     * @param enable true to enable
+     * @see ContextIOImpl::set_cpu_steering
+     */
+    void set_cpu_steering(bool enable) {
+        _ptr->set_cpu_steering(enable);
+    }
+
+    ///Sets socket options for given group of peers
+    /**
+     * Listeners and connections created for a PeerName with given group id use
+     * these options, unless the options are passed explicitly
+     *
+     * @param group_id group id (see PeerName::set_group_id)
+     * @param opts socket options
+     */
+    void set_socket_options(int group_id, const SocketOptions &opts) {
+        _ptr->set_socket_options(group_id, opts);
+    }
+
+    ///Retrieve socket options of the group
+    SocketOptions get_socket_options(int group_id) const {
+        return _ptr->get_socket_options(group_id);
+    }
+
+    ///Sets max count of connections accepted at once
+    /**
+     * @param count count of connections
+     * @see ContextIOImpl::set_accept_batch
+     */
+    void set_accept_batch(std::size_t count) {
+        _ptr->set_accept_batch(count);
+    }
+
     ///Create accept generator
     /**
      * Accept generator opens one or more ports at given addresses,
      * and starts listening on it. Each generator call returns cocls::future which
      * is resolved by connected stream.
      *
+     * When the context has multiple reactors, each TCP port is opened by
+     * one listener per reactor (SO_REUSEPORT). The connection is then handled by
+     * the reactor which accepted it for whole its life.
+     *
      * The listening can be stopped by one of following ways. You can use
      * supplied stop token, or you can stop whole context, which also stops the generator
      *
@@ -146,12 +440,16 @@ public:
      *
      * @param tms timeouts sets on resulting stream
      *
+     * @param opts socket options of listeners. If not set, options of the group
+     * of each address are used (see set_socket_options)
+     *
      * @return generator
      */
     cocls::generator<Stream> accept(
             std::vector<PeerName> &list,
             std::stop_token token = {},
-            TimeoutSettings tms = {defaultTimeout,defaultTimeout});
+            TimeoutSettings tms = {defaultTimeout,defaultTimeout},
+            std::optional<SocketOptions> opts = {});
 
     ///Create accept generator
     /**
@@ -170,17 +468,30 @@ public:
      *
      * @param tms timeouts sets on resulting stream
      *
+     * @param opts socket options of listeners. If not set, options of the group
+     * of each address are used (see set_socket_options)
+     *
      * @return generator
      */
     cocls::generator<Stream> accept(
             std::vector<PeerName> &&list,
             std::stop_token token = {},
-            TimeoutSettings tms = {defaultTimeout,defaultTimeout});
+            TimeoutSettings tms = {defaultTimeout,defaultTimeout},
+            std::optional<SocketOptions> opts = {});
 
 
     ///Connect stream to one of given addresses
-
-    cocls::future<Stream> connect(std::vector<PeerName> list, int timeout_ms = defaultTimeout, TimeoutSettings tms = {defaultTimeout,defaultTimeout});
+    /**
+     * @param list list of addresses, connection is made to the first address which accepts it
+     * @param timeout_ms timeout of the connection
+     * @param tms timeouts sets on resulting stream
+     * @param opts socket options. If not set, options of the group of each address
+     * are used (see set_socket_options)
+     * @return future with connected stream
+     */
+    cocls::future<Stream> connect(std::vector<PeerName> list, int timeout_ms = defaultTimeout,
+            TimeoutSettings tms = {defaultTimeout,defaultTimeout},
+            std::optional<SocketOptions> opts = {});
 
 
 
@@ -233,8 +544,9 @@ public:
     CXX20_REQUIRES(std::invocable<Fn, Stream>)
     cocls::future<void> tcp_server(Fn &&main_fn, std::vector<PeerName> lsn_peers,
             std::stop_token stoptoken = {},
-            TimeoutSettings tms = {defaultTimeout, defaultTimeout}) {
-        auto gen = accept(std::move(lsn_peers),stoptoken, tms);
+            TimeoutSettings tms = {defaultTimeout, defaultTimeout},
+            std::optional<SocketOptions> opts = {}) {
+        auto gen = accept(std::move(lsn_peers),stoptoken, tms, std::move(opts));
         auto fn = [](cocls::generator<Stream> gen, Fn main_fn) -> cocls::async<void> {
             while (co_await gen.next()) {
                 main_fn(std::move(gen.value()));
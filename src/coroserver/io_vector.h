@@ -0,0 +1,78 @@
+/*
+ * io_vector.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_IO_VECTOR_H_
+#define SRC_COROSERVER_IO_VECTOR_H_
+
+#include <sys/uio.h>
+#include <climits>
+
+#include <algorithm>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace coroserver {
+
+///List of buffers for vectored I/O (writev, sendmsg)
+/**
+ * Holds copy of the list of buffers (not the data) and tracks, how much data
+ * has been already written. Empty buffers are skipped
+ */
+class IOVector {
+public:
+
+    ///Assign new list of buffers
+    void assign(std::span<const std::string_view> buffers) {
+        _iov.clear();
+        _pos = 0;
+        for (const auto &b: buffers) {
+            if (!b.empty()) _iov.push_back({const_cast<char *>(b.data()), b.size()});
+        }
+    }
+
+    ///Returns true, when all data has been consumed
+    bool empty() const {return _pos >= _iov.size();}
+
+    ///Pointer to first iovec which was not yet fully written
+    const iovec *data() const {return _iov.data()+_pos;}
+
+    ///Count of remaining iovecs, limited to IOV_MAX (can be passed to writev)
+    int count() const {
+        return static_cast<int>(std::min<std::size_t>(_iov.size() - _pos, IOV_MAX));
+    }
+
+    ///First remaining buffer
+    std::string_view front() const {
+        return std::string_view(static_cast<const char *>(_iov[_pos].iov_base), _iov[_pos].iov_len);
+    }
+
+    ///Mark data as written
+    /**
+     * @param sz count of bytes written
+     */
+    void consume(std::size_t sz) {
+        while (sz && _pos < _iov.size()) {
+            iovec &v = _iov[_pos];
+            if (sz >= v.iov_len) {
+                sz -= v.iov_len;
+                ++_pos;
+            } else {
+                v.iov_base = static_cast<char *>(v.iov_base) + sz;
+                v.iov_len -= sz;
+                sz = 0;
+            }
+        }
+    }
+
+protected:
+    std::vector<iovec> _iov;
+    std::size_t _pos = 0;
+};
+
+}
+
+#endif /* SRC_COROSERVER_IO_VECTOR_H_ */
@@ -9,6 +9,7 @@
 #define SRC_USERVER_IPOLLER_H_
 
 #include "async_support.h"
+#include "reactor_metrics.h"
 
 #include <cocls/future.h>
 
@@ -39,6 +40,7 @@ class IPoller {
 public:
 
     using Promise = cocls::promise_with_default_v<WaitResult, WaitResult::closed>;
+    using IOPromise = cocls::promise<IOResult>;
 
 
     ///wait for read, resolve promise when done
@@ -48,7 +50,7 @@ public:
      * @param p promise to resolve
      * @param timeout time point when timeout is reported
      */
-    virtual void async_wait(AsyncOperation op, SocketHandle s, Promise p, std::chrono::system_clock::time_point timeout = std::chrono::system_clock::time_point::max()) = 0;
+    virtual void async_wait(AsyncOperation op, SocketHandle s, Promise p, TimePoint timeout = TimePoint::max()) = 0;
 
     ///timeout wait, use poller as scheduler
     /**
@@ -56,7 +58,7 @@ public:
      * @param p promise to resolve
      * @param timeout time point when promise is resolved
      */
-    virtual void schedule(const void *ident, Promise p, std::chrono::system_clock::time_point timeout)= 0;
+    virtual void schedule(const void *ident, Promise p, TimePoint timeout)= 0;
 
     ///cancels specified timer
     /**
@@ -95,6 +97,52 @@ public:
      */
     virtual void handle_closed(SocketHandle s) = 0;
 
+    ///Determines, whether poller supports completion based I/O
+    /**
+     * @retval true poller supports async_read() and async_write()
+     * @retval false poller supports readiness notification only
+     */
+    virtual bool completion_io() const {return false;}
+
+    ///Read data into a buffer borrowed from the poller, resolve promise when done
+    /**
+     * @param s handle to read
+     * @param size max size to read
+     * @param p promise to resolve
+     * @param timeout time point when timeout is reported
+     *
+     * @note buffer must be returned by release_buffer()
+     */
+    virtual void async_read(SocketHandle s, std::size_t size, IOPromise p, TimePoint timeout) {
+        (void)s;(void)size;(void)timeout;
+        p(IOResult{WaitResult::error, ENOTSUP});
+    }
+
+    ///Write data, resolve promise when done
+    /**
+     * @param s handle to write
+     * @param data data to write, must be valid until completion
+     * @param p promise to resolve
+     * @param timeout time point when timeout is reported
+     */
+    virtual void async_write(SocketHandle s, std::string_view data, IOPromise p, TimePoint timeout) {
+        (void)s;(void)data;(void)timeout;
+        p(IOResult{WaitResult::error, ENOTSUP});
+    }
+
+    ///Return buffer borrowed by async_read
+    virtual void release_buffer(int buffer_id) {(void)buffer_id;}
+
+    ///Retrieve metrics of the poller
+    virtual ReactorMetrics get_metrics() const {return {};}
+
+    ///Retrieve time of the current iteration of the poller
+    /**
+     * @return time published by the poller, or current time, if the poller doesn't publish it
+     * @see Clock::Source
+     */
+    virtual TimePoint now() const {return Clock::now();}
+
 
 	virtual ~IPoller() {}
 };
@@ -8,44 +8,148 @@
 #ifndef SRC_COROSERVER_LIMITED_STREAM_H_
 #define SRC_COROSERVER_LIMITED_STREAM_H_
 
-#include "stream.h"
+#include "static_stream.h"
 
+#include <cocls/async.h>
 #include <cocls/generator.h>
 
+#include <algorithm>
+#include <vector>
+
 namespace coroserver {
 
+///Limited stream layer
+/**
+ * Allows to read and write limited count of bytes from the lower layer
+ * @tparam Lower lower layer
+ * @see static_stream.h
+ */
+template<typename Lower>
+class Limited: public StreamLayer<Lower> {
+public:
+
+    ///Construct the layer
+    /**
+     * @param limit_read count of bytes allowed to read
+     * @param limit_write count of bytes allowed to write
+     * @param args arguments of the lower layer
+     */
+    template<typename ... Args>
+    Limited(std::size_t limit_read, std::size_t limit_write, Args && ... args)
+        :StreamLayer<Lower>(std::forward<Args>(args)...)
+        ,_limit_read(limit_read)
+        ,_limit_write(limit_write)
+        ,_read_awt(*this) {}
+
+    ///Unfinished stream breaks the lower stream, so it is shut down
+    ~Limited() {
+        if (!is_complete()) this->_lower.shutdown();
+    }
+
+    ///Reinitialize the layer
+    void reset(std::size_t limit_read, std::size_t limit_write) {
+        _limit_read = limit_read;
+        _limit_write = limit_write;
+        this->_putback_buffer = {};
+    }
+
+    ///Determines, whether all allowed data has been read and written
+    bool is_complete() const {
+        return !_limit_read && !_limit_write;
+    }
+
+    cocls::future<std::string_view> read() {
+        auto buff = this->read_putback_buffer();
+        if (!buff.empty() || !_limit_read) return cocls::future<std::string_view>::set_value(buff);
+        return [&](auto promise) {
+            _read_result = std::move(promise);
+            _read_awt << [&]{return this->_lower.read();}; //continue by join
+        };
+    }
+
+    cocls::future<bool> write(std::string_view buffer) {
+        if (buffer.empty()) return cocls::future<bool>::set_value(true);
+        auto b = buffer.substr(0, _limit_write);
+        if (b.empty()) return cocls::future<bool>::set_value(false);
+        _limit_write-=b.size();
+        return this->_lower.write(b);
+    }
+
+    cocls::future<bool> write(std::span<const std::string_view> buffers) {
+        _write_parts.clear();
+        bool truncated = false;
+        for (const auto &b: buffers) {
+            auto p = b.substr(0, _limit_write);
+            truncated = truncated || p.size() < b.size();
+            if (p.empty()) continue;
+            _limit_write-=p.size();
+            _write_parts.push_back(p);
+        }
+        if (_write_parts.empty()) return cocls::future<bool>::set_value(!truncated);
+        //the list is copied by the lower layer
+        return this->_lower.write(std::span<const std::string_view>(_write_parts));
+    }
+
+    ///Writes zeroes up to the limit
+    cocls::future<bool> write_eof() {
+        if (_limit_write) {
+            return pad_to_limit();
+        } else {
+            return cocls::future<bool>::set_value(true);
+        }
+    }
+
+protected:
+
+    std::size_t _limit_read;
+    std::size_t _limit_write;
+    std::vector<std::string_view> _write_parts;
+
+    cocls::suspend_point<void> join_read(cocls::future<std::string_view> &fut) noexcept {
+        try {
+            std::string_view data = *fut;
+            auto ret = data.substr(0, _limit_read);
+            this->_lower.put_back(data.substr(ret.size()));
+            _limit_read -= ret.size();
+            return _read_result(ret);
+        } catch (...) {
+            return _read_result(std::current_exception());
+        }
+    }
+    cocls::call_fn_future_awaiter<&Limited::join_read> _read_awt;
+    cocls::promise<std::string_view> _read_result;
+
+    cocls::async<bool> pad_to_limit() {
+        static constexpr char zeroes[1024] = {};
+        while (_limit_write) {
+            std::size_t sz = std::min(_limit_write, sizeof(zeroes));
+            bool ret = co_await this->_lower.write(std::string_view(zeroes, sz));
+            if (!ret) co_return ret;
+            _limit_write -= sz;
+        }
+        co_return true;
+    }
+};
+
 ///Limited stream
-class LimitedStream: public AbstractProxyStream {
+class LimitedStream: public StaticStream<Limited<StreamRef> > {
 public:
 
     LimitedStream(std::shared_ptr<IStream> proxied,
                 std::size_t limit_read,
-                std::size_t limit_write);
+                std::size_t limit_write)
+        :StaticStream(limit_read, limit_write, std::move(proxied)) {}
 
-    virtual cocls::future<std::string_view> read() override;
-    virtual cocls::future<bool> write(std::string_view buffer) override;
-    virtual cocls::future<bool> write_eof() override;
+    using StaticStream::read;
+    using StaticStream::write;
 
-    ///Create chunked stream for reading
+    ///Create limited stream for reading
     static Stream read(Stream target, std::size_t limit_read);
-    ///Create chunked stream for writing
+    ///Create limited stream for writing
     static Stream write(Stream target, std::size_t limit_write);
-    ///Create chunked stream for both reading and writing
+    ///Create limited stream for both reading and writing
     static Stream read_and_write(Stream target, std::size_t limit_read, std::size_t limit_write);
 
-
-
-    ~LimitedStream();
-
-protected:
-
-
-    std::size_t _limit_read;
-    std::size_t _limit_write;
-
-    cocls::suspend_point<void> join_read(cocls::future<std::string_view> &fut) noexcept;
-    cocls::call_fn_future_awaiter<&LimitedStream::join_read> _read_awt;
-    cocls::promise<std::string_view> _read_result;
 };
 
 
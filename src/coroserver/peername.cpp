@@ -98,31 +98,7 @@ std::vector<PeerName> PeerName::lookup(std::string_view name, std::string_view d
                     continue;
             }
 
-            std::string_view host;
-            std::string_view port;
-
-            if (item[0] == '[') {//ipv6
-                auto spos = item.find(']');
-                if (spos != item.npos) {
-                    host = item.substr(1,spos-1);
-                    spos = item.find(':', spos);
-                    if (spos == item.npos) {
-                        port = def_port;
-                    } else {
-                        port = item.substr(spos+1);
-                    }
-                }
-            }
-            if (host.empty()) {
-                auto spos = item.rfind(':');
-                if (spos == item.npos) {
-                    port = def_port;
-                    host = item;
-                } else {
-                    port = item.substr(spos+1);
-                    host = item.substr(0,spos);
-                }
-            }
+            auto [host, port] = split_host_port(item, def_port);
 
             if (port.empty()) {
                 list.push_back(Error{std::make_exception_ptr(PortIsRequiredException())});
@@ -133,16 +109,49 @@ std::vector<PeerName> PeerName::lookup(std::string_view name, std::string_view d
             list.push_back(Error{std::current_exception()});
         }
     }
+    return check_lookup_result(std::move(list));
+}
+
+std::vector<PeerName> PeerName::check_lookup_result(std::vector<PeerName> &&list) {
     if (list.empty()) {
         throw std::invalid_argument("PeerName::lookup(\"\") can't be resolved");
     }
-    for (const auto &x: list) if (x.valid()) return list;
+    for (const auto &x: list) if (x.valid()) return std::move(list);
     const Error *e = list[0].get_error() ;
     if (e) std::rethrow_exception(e->e);
     throw std::runtime_error("Not valid address returned");
 
 }
 
+std::pair<std::string_view, std::string_view> PeerName::split_host_port(std::string_view item, std::string_view def_port) {
+    std::string_view host;
+    std::string_view port;
+
+    if (!item.empty() && item[0] == '[') {//ipv6
+        auto spos = item.find(']');
+        if (spos != item.npos) {
+            host = item.substr(1,spos-1);
+            spos = item.find(':', spos);
+            if (spos == item.npos) {
+                port = def_port;
+            } else {
+                port = item.substr(spos+1);
+            }
+        }
+    }
+    if (host.empty()) {
+        auto spos = item.rfind(':');
+        if (spos == item.npos) {
+            port = def_port;
+            host = item;
+        } else {
+            port = item.substr(spos+1);
+            host = item.substr(0,spos);
+        }
+    }
+    return {host, port};
+}
+
 void PeerName::nslookup(std::string &&host, std::string &&port, std::vector<PeerName> &list) {
     addrinfo hint = {};
     addrinfo *result;
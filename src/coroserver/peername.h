@@ -14,6 +14,7 @@
 #include <exception>
 #include <filesystem>
 #include <string>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -83,6 +84,22 @@ public:
 
     static std::vector<PeerName> lookup(std::initializer_list<std::string_view> name, std::string_view def_port = {});
 
+    ///Split single address to host and port
+    /**
+     * @param item address in form host:port or [ipv6]:port
+     * @param def_port default port, returned when the address has no port
+     * @return pair of host and port
+     */
+    static std::pair<std::string_view, std::string_view> split_host_port(std::string_view item, std::string_view def_port = {});
+
+    ///Checks result of lookup
+    /**
+     * @param list list of found peers (can contain errors)
+     * @return the list, if it contains at least one valid peer. Otherwise,
+     * the first error is thrown
+     */
+    static std::vector<PeerName> check_lookup_result(std::vector<PeerName> &&list);
+
 
     ///constructs sockaddr from peer, to perform low-level network access
     /**
@@ -1,6 +1,7 @@
 #include "pipe.h"
 
 #include <fcntl.h>
+#include <sys/uio.h>
 namespace coroserver {
 
 static int set_nonblocking(int fd) {
@@ -32,8 +33,10 @@ PipeStream::~PipeStream() {
 cocls::generator<std::string_view> PipeStream::start_read() {
     while (true) {
         std::string_view data;
+        //previous data has been processed, return the buffer
+        _read_buffer.release();
         while (!_is_eof && data.empty()) {
-            _read_buffer.resize(_new_buffer_size);
+            if (_read_buffer.empty()) _read_buffer = _ctx.get_buffer_pool().get(_new_buffer_size);
             int r = ::read(_fdread, _read_buffer.data(), _read_buffer.size());
             if (r > 0) {
                 _cntr.read+=r;
@@ -42,6 +45,8 @@ cocls::generator<std::string_view> PipeStream::start_read() {
                 bool was_full = sz == _read_buffer.size();
                 if (_last_read_full) {
                     _new_buffer_size = _last_read_full+r;
+                } else if (sz < _read_buffer.size() / 4) {
+                    _new_buffer_size = std::max<std::size_t>(_new_buffer_size / 2, 1);
                 }
                 _last_read_full = was_full?_read_buffer.size():0;
 
@@ -51,8 +56,10 @@ cocls::generator<std::string_view> PipeStream::start_read() {
                 int err = errno;
                 if (err == EWOULDBLOCK || err == EAGAIN) {
                     _last_read_full = 0;
+                    //don't hold the buffer while waiting
+                    _read_buffer.release();
                     WaitResult w = co_await _ctx.io_wait(_fdread,AsyncOperation::read,
-                            _tms.from_duration(_tms.read_timeout_ms));
+                            _tms.from_duration(_ctx.now(), _tms.read_timeout_ms));
                     switch (w) {
                         case WaitResult::closed:
                             _is_eof = true;
@@ -82,15 +89,17 @@ cocls::future<std::string_view> PipeStream::read() {
 std::string_view PipeStream::read_nb() {
     auto buff = read_putback_buffer();
     if (!buff.empty() || _is_eof) return buff;
+    if (_read_buffer.empty()) _read_buffer = _ctx.get_buffer_pool().get(_new_buffer_size);
     int r = ::read(_fdread, _read_buffer.data(), _read_buffer.size());
-    if (r >= 0) {
-        _is_eof = r == 0;
+    if (r > 0) {
         _cntr.read+=r;
         buff = std::string_view(_read_buffer.data(), r);
         return buff;
     } else {
         int err = errno;
-        if (err == EWOULDBLOCK || err == EAGAIN) {
+        _read_buffer.release();
+        _is_eof = r == 0;
+        if (_is_eof || err == EWOULDBLOCK || err == EAGAIN) {
             return buff;
         } else {
             throw std::system_error(err, std::system_category(), "recv()");
@@ -103,8 +112,12 @@ bool PipeStream::is_read_timeout() const {
 }
 
 cocls::future<bool> PipeStream::write(std::string_view buffer) {
+    return write(std::span<const std::string_view>(&buffer, 1));
+}
+
+cocls::future<bool> PipeStream::write(std::span<const std::string_view> buffers) {
     if (_writer.done()) return cocls::future<bool>::set_value(false);
-    return [&]{return _writer(buffer);};
+    return [&]{return _writer(buffers);};
 }
 
 cocls::future<bool> PipeStream::write_eof() {
@@ -192,20 +205,22 @@ Stream PipeStream::stdio(AsyncSupport context, TimeoutSettings tms, bool duplica
     return Stream(std::make_shared<PipeStream>(context, rd, wr, tms));
 }
 
-cocls::generator<bool, std::string_view> PipeStream::start_write() {
-    std::string_view buff = co_yield nullptr;
+cocls::generator<bool, std::span<const std::string_view> > PipeStream::start_write() {
+    std::span<const std::string_view> buffers = co_yield nullptr;
     while (true) {
-        while (!_is_closed && !buff.empty()) {
-            int r = ::write(_fdwrite, buff.data(), buff.size());
+        //copy the list, caller can release it
+        _write_vector.assign(buffers);
+        while (!_is_closed && !_write_vector.empty()) {
+            int r = ::writev(_fdwrite, _write_vector.data(), _write_vector.count());
             if (r >= 0) {
                 _cntr.write+=r;
-                buff = buff.substr(r);
+                _write_vector.consume(r);
                 _is_closed = r == 0;
             } else {
                 int err = errno;
                 if (err == EWOULDBLOCK || err == EAGAIN) {
                     WaitResult w = co_await _ctx.io_wait(_fdwrite, AsyncOperation::write,
-                            _tms.from_duration(_tms.write_timeout_ms));
+                            _tms.from_duration(_ctx.now(), _tms.write_timeout_ms));
                     switch(w) {
                         case WaitResult::timeout:
                         case WaitResult::closed:
@@ -217,11 +232,11 @@ cocls::generator<bool, std::string_view> PipeStream::start_write() {
                 } else if (err == EPIPE) {
                     _is_closed = true;
                 } else {
-                    throw std::system_error(err, std::system_category(), "send()");
+                    throw std::system_error(err, std::system_category(), "writev()");
                 }
             }
         }
-        buff = co_yield !_is_closed;
+        buffers = co_yield !_is_closed;
     }
 }
 
@@ -11,6 +11,8 @@
 
 #include "async_support.h"
 #include "defs.h"
+#include "descriptor_stream.h"
+#include "io_vector.h"
 #include "stream.h"
 #include <cocls/generator.h>
 
@@ -18,7 +20,7 @@ namespace coroserver {
 
 class ContextIOImpl;
 
-class PipeStream: public AbstractStreamWithMetadata {
+class PipeStream: public AbstractStreamWithMetadata, public IDescriptorStream {
 public:
     PipeStream(AsyncSupport context, int fdread, int fdwrite,TimeoutSettings tms);
     ~PipeStream();
@@ -26,10 +28,18 @@ public:
     virtual std::string_view read_nb() override;
     virtual bool is_read_timeout() const override;
     virtual cocls::future<bool> write(std::string_view buffer) override;
+    virtual cocls::future<bool> write(std::span<const std::string_view> buffers) override;
     virtual cocls::future<bool> write_eof() override;
     virtual cocls::suspend_point<void> shutdown() override;
     virtual Counters get_counters() const noexcept override;
     virtual PeerName get_peer_name() const override;
+    virtual int get_read_fd() const override {return _fdread;}
+    virtual int get_write_fd() const override {return _fdwrite;}
+    virtual AsyncSupport get_context() const override {return _ctx;}
+    virtual void add_counters(std::size_t read, std::size_t write) override {
+        _cntr.read += read;
+        _cntr.write += write;
+    }
 
     ///Create pipe
     /**
@@ -96,9 +106,11 @@ protected:
     int _fdwrite;
     Counters _cntr;
     cocls::generator<std::string_view> _reader;
-    cocls::generator<bool, std::string_view> _writer; //writer
+    cocls::generator<bool, std::span<const std::string_view> > _writer; //writer
+    IOVector _write_vector;
 
-    std::vector<char> _read_buffer;
+    ///read buffer borrowed from the pool, held only while the data are processed
+    BufferPool::Buffer _read_buffer;
     bool _is_timeout = false;
     bool _is_eof = false;
     bool _is_closed = false;
@@ -108,7 +120,7 @@ protected:
 
 
     cocls::generator<std::string_view> start_read();
-    cocls::generator<bool, std::string_view> start_write();
+    cocls::generator<bool, std::span<const std::string_view> > start_write();
 };
 
 
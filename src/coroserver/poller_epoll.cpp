@@ -13,6 +13,15 @@
 #include <fcntl.h>
 #include <cerrno>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <memory>
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -29,32 +38,64 @@ static int init_epoll_object() {
     return e;
 }
 
-static int init_signaled_handle() {
-    int fd[2];
-    int r = pipe2(fd, O_CLOEXEC);
-    if (r <0)  {
+//key of eventfd, descriptors are never negative
+static constexpr std::uint64_t event_fd_key = ~std::uint64_t(0);
+
+//count of descriptors which can be stored in the table
+static std::size_t max_descriptors() {
+    rlimit lim;
+    std::size_t n = 0;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0) {
+        n = lim.rlim_max == RLIM_INFINITY?~std::size_t(0):static_cast<std::size_t>(lim.rlim_max);
+    }
+    return std::clamp<std::size_t>(n, 65536, 1<<24);
+}
+
+//retrieves pending error of the socket, EPOLLERR can also signal a message in the error queue
+static int socket_error(int fd) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len)) return errno;
+    return err;
+}
+
+static int init_signaled_handle(int epoll_fd) {
+    int fd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+    if (fd <0)  {
         int e = errno;
-        throw std::system_error(e,std::generic_category(), "socket/notify");
+        throw std::system_error(e,std::generic_category(), "eventfd");
     }
-    ::close(fd[1]);
-    return fd[0];
+    //registered once for whole lifetime
+    epoll_event ev ={};
+    ev.events = EPOLLIN;
+    ev.data.u64 = event_fd_key;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        int e = errno;
+        ::close(fd);
+        throw std::system_error(e,std::generic_category(), "epoll_ctl/eventfd");
+    }
+    return fd;
 
 }
 
 
-Poller_epoll::Poller_epoll(cocls::thread_pool &pool)
+Poller_epoll::Poller_epoll(cocls::thread_pool &pool, bool edge_triggered)
 :epoll_fd(-1)
 ,event_fd(-1)
-,first_timeout(std::chrono::system_clock::time_point::min())
+,_edge_triggered(edge_triggered)
+,first_timeout(TimePoint::min())
 
 {
     try {
         epoll_fd = init_epoll_object();
-        event_fd = init_signaled_handle();
+        event_fd = init_signaled_handle(epoll_fd);
     } catch (...) {
         if (event_fd>=0) ::close(event_fd);
         if (epoll_fd>=0) ::close(epoll_fd);
+        throw;
     }
+    _block_count = (max_descriptors() + block_size - 1) / block_size;
+    _blocks = std::make_unique<std::atomic<Block *>[]>(_block_count);
 
     _running << [&]{return worker(pool).start();};
 }
@@ -67,7 +108,9 @@ Poller_epoll::~Poller_epoll() {
         {
             std::lock_guard _(_mx);
             _exit = true;
-            notify();
+            //always signal, poller can be just before sleep
+            _sleeping = false;
+            eventfd_write(event_fd, 1);
         }
 
         _running.wait();
@@ -77,45 +120,179 @@ Poller_epoll::~Poller_epoll() {
         ::close(event_fd);
         ::close(epoll_fd);
     });
+    for (std::size_t i = 0; i < _block_count; i++) {
+        Block *b = _blocks[i].load();
+        if (!b) continue;
+        for (auto &x: *b) delete x.load();
+        delete b;
+    }
+    for (auto &c: _pending_chunks) delete [] c.load();
 }
 
+Poller_epoll::RegList *Poller_epoll::find_slot(SocketHandle fd) const {
+    std::size_t idx = static_cast<std::size_t>(fd);
+    if (fd < 0 || idx / block_size >= _block_count) return nullptr;
+    Block *b = _blocks[idx / block_size].load(std::memory_order_acquire);
+    if (!b) return nullptr;
+    return (*b)[idx % block_size].load(std::memory_order_acquire);
+}
 
-void Poller_epoll::async_wait(AsyncOperation op, SocketHandle s, Promise p, std::chrono::system_clock::time_point timeout) {
-    std::lock_guard _(_mx);
-    if (_stopped || mclosing_map.find(s) != mclosing_map.end()) {
+Poller_epoll::RegList *Poller_epoll::get_slot(SocketHandle fd) {
+    std::size_t idx = static_cast<std::size_t>(fd);
+    if (fd < 0 || idx / block_size >= _block_count) return nullptr;
+    auto &blk = _blocks[idx / block_size];
+    Block *b = blk.load(std::memory_order_acquire);
+    if (!b) {
+        //block is allocated once, first thread wins
+        Block *nb = new Block{};
+        if (blk.compare_exchange_strong(b, nb, std::memory_order_acq_rel)) {
+            b = nb;
+        } else {
+            delete nb;
+        }
+    }
+    auto &slot = (*b)[idx % block_size];
+    RegList *lst = slot.load(std::memory_order_acquire);
+    if (!lst) {
+        //state of the descriptor is allocated once, first thread wins
+        RegList *nl = new RegList;
+        if (slot.compare_exchange_strong(lst, nl, std::memory_order_acq_rel)) {
+            lst = nl;
+        } else {
+            delete nl;
+        }
+    }
+    return lst;
+}
+
+Poller_epoll::PendingReg *Poller_epoll::pending_at(std::uint32_t idx) const {
+    std::uint32_t q = idx / pool_chunk_base + 1;
+    std::size_t k = std::bit_width(q) - 1;
+    PendingReg *chunk = _pending_chunks[k].load(std::memory_order_acquire);
+    return chunk + (idx - pool_chunk_base * ((1U << k) - 1));
+}
+
+Poller_epoll::PendingReg *Poller_epoll::alloc_pending() {
+    std::uint64_t head = _free_pending.load(std::memory_order_acquire);
+    while (static_cast<std::uint32_t>(head)) {
+        PendingReg *r = pending_at(static_cast<std::uint32_t>(head) - 1);
+        std::uint64_t next = (((head >> 32) + 1) << 32) | r->next_free.load(std::memory_order_relaxed);
+        if (_free_pending.compare_exchange_weak(head, next, std::memory_order_acquire)) return r;
+    }
+    //free list is empty, take next node of the pool
+    std::lock_guard _(_pool_mx);
+    std::uint32_t idx = _pending_count;
+    std::size_t k = std::bit_width(idx / pool_chunk_base + 1) - 1;
+    if (k >= pool_max_chunks) throw std::bad_alloc();
+    if (!_pending_chunks[k].load(std::memory_order_relaxed)) {
+        std::uint32_t count = pool_chunk_base << k;
+        std::uint32_t first = pool_chunk_base * ((1U << k) - 1);
+        PendingReg *chunk = new PendingReg[count];
+        for (std::uint32_t i = 0; i < count; ++i) chunk[i].idx = first + i;
+        _pending_chunks[k].store(chunk, std::memory_order_release);
+    }
+    ++_pending_count;
+    return pending_at(idx);
+}
+
+void Poller_epoll::free_pending(PendingReg *r) {
+    std::uint64_t head = _free_pending.load(std::memory_order_relaxed);
+    std::uint64_t next;
+    do {
+        r->next_free.store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+        next = (((head >> 32) + 1) << 32) | (r->idx + 1);
+    } while (!_free_pending.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+}
+
+
+void Poller_epoll::async_wait(AsyncOperation op, SocketHandle s, Promise p, TimePoint timeout) {
+    if (_stopped) {
         p.set_value(WaitResult::closed);
         return;
     }
-    auto opindex = static_cast<int>(op);
-    Reg reg{timeout, std::move(p)};
-    bool first;
-
-    auto iter = fd_map.find(s);
-    if (iter == fd_map.end()) {
-        RegList lst;
-        lst[opindex] = std::move(reg);
-        iter = fd_map.emplace(s, std::move(lst)).first;
-        first = true;
-    } else {
-        first = false;
-        iter->second[opindex] = std::move(reg);
+    RegList *slot = get_slot(s);
+    if (!slot) {
+        p.set_value(WaitResult::error);
+        return;
+    }
+    //registration is processed by the poller, no lock is needed
+    PendingReg *r = alloc_pending();
+    r->op = op;
+    r->fd = s;
+    r->reg = {timeout, std::move(p)};
+    r->next = _pending.load(std::memory_order_relaxed);
+    while (!_pending.compare_exchange_weak(r->next, r));
+    wake();
+}
+
+void Poller_epoll::apply_pending(cocls::suspend_point<void> &spt) {
+    PendingReg *lst = _pending.exchange(nullptr);
+    //reverse the stack to process registrations in order
+    PendingReg *fifo = nullptr;
+    while (lst) {
+        PendingReg *n = lst->next;
+        lst->next = fifo;
+        fifo = lst;
+        lst = n;
+    }
+    while (fifo) {
+        PendingReg *r = fifo;
+        fifo = fifo->next;
+        Reg reg = std::move(r->reg);
+        Op op = r->op;
+        SocketHandle fd = r->fd;
+        //release the node, it can be reused now
+        free_pending(r);
+
+        RegList &lst = *find_slot(fd);
+        if (_stopped || lst.closing) {
+            spt << reg.cb(WaitResult::closed);
+            continue;
+        }
+        //readiness has been already observed, consume it
+        std::uint32_t mask = op == Op::errqueue?EPOLLERR
+                            :(op == Op::read || op == Op::accept)?EPOLLIN:EPOLLOUT;
+        if (lst.ready & mask) {
+            lst.ready &= ~mask;
+            spt << reg.cb(WaitResult::complete);
+            continue;
+        }
+        lst[static_cast<int>(op)] = std::move(reg);
+        rearm_fd(fd, lst, spt);
+    }
+}
+
+void Poller_epoll::unregister(SocketHandle fd, RegList &lst, cocls::suspend_point<void> &spt) {
+    epoll_event ev ={};
+    for (Reg &x: lst) {
+        spt << x.cb(WaitResult::closed);
+        x.timeout = TimePoint::max();
+    }
+    remove_timer(lst);
+    lst.timeout = TimePoint::max();
+    if (lst.registered) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+        lst.registered = false;
+        lst.persistent = false;
+        ReactorCounters::sub(_counters.registered_fds, 1);
+        //events of previous registration are ignored
+        ++lst.gen;
     }
-    rearm_fd(first, iter);
+    lst.ready = 0;
 }
 
 cocls::suspend_point<void> Poller_epoll::mark_closing(SocketHandle s) {
     return cocls::coro_queue::create_suspend_point([&]{
-        RegList tmp;
-         epoll_event ev ={};
+        cocls::suspend_point<void> spt;
         {
             std::lock_guard _(_mx);
-            auto iter = fd_map.find(s);
-            if (iter != fd_map.end()) {
-                std::swap(tmp,iter->second);
-                fd_map.erase(iter);
-                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, s, &ev);
+            //registrations made before this call must be processed first
+            apply_pending(spt);
+            RegList *lst = find_slot(s);
+            if (lst) {
+                unregister(s, *lst, spt);
+                lst->closing = true;
             }
-            mclosing_map.emplace(s);
         }
     });
 
@@ -123,33 +300,21 @@ cocls::suspend_point<void> Poller_epoll::mark_closing(SocketHandle s) {
 }
 
 
-void Poller_epoll::notify() {
-	epoll_event ev ={};
-	ev.events = EPOLLIN|EPOLLONESHOT;
-	ev.data.fd = event_fd;
-	int r = epoll_ctl(epoll_fd, EPOLL_CTL_MOD, event_fd, &ev);
-	if (r < 0) {
-		int e = errno;
-		if (e == ENOENT) {
-			r = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &ev);
-			if (r < 0) {
-				int e = errno;
-				throw std::system_error(e, std::generic_category(), "notify()");
-			}
-		} else {
-			throw std::system_error(e, std::generic_category(), "notify_mod()");
-		}
-	}
+void Poller_epoll::wake() {
+    //only the first caller signals the sleeping poller
+    if (_sleeping.exchange(false)) {
+        ReactorCounters::inc(_counters.notifies);
+        eventfd_write(event_fd, 1);
+    }
 }
 
 
-void Poller_epoll::rearm_fd(bool first_call, FDMap::iterator iter) {
+void Poller_epoll::rearm_fd(SocketHandle fd, RegList &lst, cocls::suspend_point<void> &spt) {
 	epoll_event ev ={};
 	ev.events = 0;
-	ev.data.fd = iter->first;
-	RegList &lst = iter->second;
-	//const std::chrono::system_clock::time_point maxtm = std::chrono::system_clock::time_point::max();
-	lst.timeout = std::chrono::system_clock::time_point::max();
+	ev.data.u64 = make_key(fd, lst);
+	//const TimePoint maxtm = TimePoint::max();
+	lst.timeout = TimePoint::max();
 
 	for (const Reg &x: lst) if (x.cb) {
 			lst.timeout = std::min(lst.timeout, x.timeout);
@@ -159,22 +324,57 @@ void Poller_epoll::rearm_fd(bool first_call, FDMap::iterator iter) {
 			    case Op::accept: ev.events |= EPOLLIN; break;
                 case Op::connect:
 				case Op::write: ev.events |= EPOLLOUT; break;
+				case Op::errqueue: ev.events |= EPOLLERR; break;
 				default:break;
 			}
 	}
-	if (ev.events) {
+	update_timer(fd, lst);
+	int r = 0;
+	if (!lst.registered && lst[static_cast<int>(Op::accept)].cb) {
+		//listening socket is registered once for whole lifetime
+		//when it is shared by multiple pollers, only one poller is woken up
+		ev.events = EPOLLIN|EPOLLET|EPOLLEXCLUSIVE;
+		r = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+		lst.registered = lst.persistent = r == 0;
+		if (lst.registered) ReactorCounters::add(_counters.registered_fds, 1);
+	} else if (lst.persistent) {
+		//already registered
+	} else if (_edge_triggered || (lst.ready & EPOLLERR)) {
+		//register once for whole lifetime
+		//descriptor with unread message in error queue is switched to this mode, because
+		//level triggered registration would report the message again and again
+		ev.events = EPOLLIN|EPOLLOUT|EPOLLRDHUP|EPOLLET;
+		if (lst.registered) {
+			r = epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+			lst.persistent = r == 0;
+		} else {
+			r = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+			lst.registered = lst.persistent = r == 0;
+			if (lst.registered) ReactorCounters::add(_counters.registered_fds, 1);
+		}
+	} else if (ev.events) {
 		ev.events |= EPOLLONESHOT;
-		int r = epoll_ctl(epoll_fd, first_call?EPOLL_CTL_ADD:EPOLL_CTL_MOD, ev.data.fd, &ev);
-		if (r < 0) {
-			int e = errno;
-			throw std::system_error(e, std::generic_category(), "epoll_ctl");
+		if (lst.registered) {
+			r = epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+		} else {
+			r = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+			lst.registered = r == 0;
+			if (lst.registered) ReactorCounters::add(_counters.registered_fds, 1);
 		}
-
-		if (lst.timeout < first_timeout) {
-		    first_timeout = lst.timeout;
+	}
+	if (r < 0) {
+		//descriptor can't be monitored (closed or not supported)
+		for (Reg &x: lst) {
+			spt << x.cb(WaitResult::error);
 		}
-        notify();
-
+		lst.timeout = TimePoint::max();
+		update_timer(fd, lst);
+		return;
+	}
+	if (lst.timeout < first_timeout) {
+	    first_timeout = lst.timeout;
+	    //poller must recalculate its timeout
+	    wake();
 	}
 }
 
@@ -182,65 +382,107 @@ void Poller_epoll::rearm_fd(bool first_call, FDMap::iterator iter) {
 cocls::suspend_point<void> Poller_epoll::mark_closing_all() {
     //enter to coro-mode - flush all corouties before exit
     return cocls::coro_queue::create_suspend_point([&]{
-        FDMap tmp;
         Scheduler<Promise> sch_tmp;
-        epoll_event ev ={};
+        cocls::suspend_point<void> spt;
         {
             std::lock_guard _(_mx);
-            for (auto &x: fd_map) {
-                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, x.first, &ev);
+            _stopped = true;
+            //pending registrations are resolved as closed
+            apply_pending(spt);
+            for (std::size_t i = 0; i < _block_count; i++) {
+                Block *b = _blocks[i].load(std::memory_order_acquire);
+                if (!b) continue;
+                for (std::size_t j = 0; j < block_size; j++) {
+                    RegList *lst = (*b)[j].load(std::memory_order_acquire);
+                    if (lst && lst->registered) {
+                        unregister(static_cast<SocketHandle>(i * block_size + j), *lst, spt);
+                    }
+                }
             }
-            std::swap(tmp ,fd_map);
             std::swap(sch_tmp, _sch);
-            _stopped = true;
-            notify();
+            _timers.clear();
+            wake();
         }
     });
 
 }
 
-std::chrono::system_clock::time_point Poller_epoll::clear_timeouts(cocls::suspend_point<void> &spt, std::chrono::system_clock::time_point now) {
-    //performing full row scan to search timeouted descriptor
-    FDMap::iterator iter = fd_map.begin();
-    //longest timeout is max
-    auto max = std::chrono::system_clock::time_point::max();
-    //until end of map reached
-    while (iter != fd_map.end()) {
-        //the registration contains nearest timeout for all events
-        //if reached
-        if (iter->second.timeout < now) {
-            //try to find valid event for thi registration
-            for (auto &x: iter->second) if (x.cb) {
-                //any timeout event is resolved
-                if (x.timeout < now) {
-                    spt << x.cb(WaitResult::timeout);
-                }
+void Poller_epoll::update_timer(SocketHandle fd, RegList &lst) {
+    if (lst.timeout == TimePoint::max()) {
+        remove_timer(lst);
+    } else if (lst.timer == TimerMap::npos) {
+        lst.timer = _timers.insert(lst.timeout, fd);
+    } else {
+        _timers.update(lst.timer, lst.timeout);
+    }
+}
+
+void Poller_epoll::remove_timer(RegList &lst) {
+    if (lst.timer != TimerMap::npos) {
+        _timers.remove(lst.timer);
+        lst.timer = TimerMap::npos;
+    }
+}
+
+TimePoint Poller_epoll::clear_timeouts(cocls::suspend_point<void> &spt, TimePoint now) {
+    //process descriptors in order of their timeouts
+    while (_timers.top_time() < now) {
+        SocketHandle fd = _timers[_timers.top()];
+        RegList &lst = *find_slot(fd);
+        //try to find valid event for this registration
+        for (auto &x: lst) if (x.cb) {
+            //any timeout event is resolved
+            if (x.timeout < now) {
+                spt << x.cb(WaitResult::timeout);
             }
-            //rearm the descriptor according new state
-            rearm_fd(false, iter);
-            //rearm shoudl update iter->second.timeout
         }
-        //calculate nearest timeout point
-        max = std::min(max,iter->second.timeout);
-        //move next item
-        ++iter;
+        //rearm the descriptor according new state
+        //rearm also updates or removes the timer
+        rearm_fd(fd, lst, spt);
     }
     //return next timeout point
-    return max;
+    return _timers.top_time();
 }
 
 
 
+int Poller_epoll::wait_events(epoll_event *events, int count, std::int64_t timeout_ns) {
+#ifdef SYS_epoll_pwait2
+    if (_pwait2) {
+        timespec ts = {};
+        timespec *pts = nullptr;
+        if (timeout_ns >= 0) {
+            ts.tv_sec = timeout_ns / 1000000000;
+            ts.tv_nsec = timeout_ns % 1000000000;
+            pts = &ts;
+        }
+        int r = static_cast<int>(syscall(SYS_epoll_pwait2, epoll_fd, events, count, pts, nullptr, 0));
+        if (r >= 0 || errno != ENOSYS) return r;
+        //kernel is older than 5.11
+        _pwait2 = false;
+    }
+#endif
+    int ms = -1;
+    if (timeout_ns >= 0) {
+        //round up, timer must not be signaled before its timeout
+        ms = static_cast<int>(std::min<std::int64_t>((timeout_ns + 999999) / 1000000, std::numeric_limits<int>::max()));
+    }
+    return epoll_wait(epoll_fd, events, count, ms);
+}
+
 cocls::async<void> Poller_epoll::worker(cocls::thread_pool &pool) {
     try {
 
         std::unique_lock lock(_mx);
-        auto now = std::chrono::system_clock::now();
+        auto now = _clock.update();
+        auto woken = now;
         bool any_queued = true;
         while (!_exit) {
             //release current thread, if there is any queued coroutines
             if (any_queued) {
                 lock.unlock();
+                //time is not published while the thread is released
+                _clock.invalidate();
                 co_await pool;
                 lock.lock();
             }
@@ -248,7 +490,11 @@ cocls::async<void> Poller_epoll::worker(cocls::thread_pool &pool) {
             int r;
 
             do {
-                int timeout = -1;
+                //read the clock again, processing could take some time
+                now = _clock.update();
+                ReactorCounters::add_time(_counters.processing_ns, now - woken);
+                //timeout in nanoseconds, -1 = infinite
+                std::int64_t timeout = -1;
                 any_queued = pool.any_enqueued();
                 //ask the pool, if there is a task in queue
                 if (any_queued) {
@@ -258,16 +504,27 @@ cocls::async<void> Poller_epoll::worker(cocls::thread_pool &pool) {
                     timeout = 0;
                 } else {
                     //if not, we can continue in blocking operation
-                    if (first_timeout == std::chrono::system_clock::time_point::max()) {
+                    if (first_timeout == TimePoint::max()) {
                         timeout = -1;
-                    } else if (first_timeout < now) {
+                    } else if (first_timeout <= now) {
+                        timeout = 0;
+                    } else {
+                        timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(first_timeout - now).count();
+                    }
+                }
+                if (timeout != 0) {
+                    //announce sleeping, then check registrations arrived meanwhile
+                    _sleeping = true;
+                    if (_pending.load() != nullptr) {
+                        _sleeping = false;
                         timeout = 0;
                     } else {
-                        timeout = std::chrono::duration_cast<std::chrono::milliseconds>(first_timeout - now).count();
+                        //time is not published during sleep
+                        _clock.invalidate();
                     }
                 }
                 lock.unlock();
-                r = epoll_wait(epoll_fd, events, 16, timeout);
+                r = wait_events(events, 16, timeout);
                 if (r < 0) {
                     int e = errno;
                     if (e != EINTR) {
@@ -275,12 +532,75 @@ cocls::async<void> Poller_epoll::worker(cocls::thread_pool &pool) {
                     }
                 }
                 lock.lock();
+                _sleeping = false;
+                woken = _clock.update();
+                ReactorCounters::add_time(_counters.blocked_ns, woken - now);
             } while (r < 0);
-            now = std::chrono::system_clock::now();
+            now = woken;
+            ReactorCounters::add(_counters.iterations, 1);
+            ReactorCounters::add(_counters.events, r);
 
             cocls::suspend_point<void> spt;
 
-            if (r == 0) {
+            //process registrations
+            apply_pending(spt);
+
+            for (int i = 0; i < r; i++) {
+                auto &e = events[i];
+                if (e.data.u64 == event_fd_key) {
+                    eventfd_t val;
+                    eventfd_read(event_fd, &val);
+                } else {
+                    SocketHandle fd = static_cast<SocketHandle>(e.data.u64 & 0xFFFFFFFF);
+                    RegList *slot = find_slot(fd);
+                    //ignore events of previous registration of the descriptor
+                    if (slot && slot->registered && e.data.u64 == make_key(fd, *slot)) {
+                        RegList &regs = *slot;
+                        std::uint32_t events = e.events;
+                        //hangup is reported as readiness, the operation reports eof or error
+                        if (events & EPOLLHUP) events |= EPOLLIN|EPOLLOUT;
+                        if (events & EPOLLRDHUP) events |= EPOLLIN;
+                        //remember readiness, it is consumed by a waiter
+                        if (regs.persistent) regs.ready |= events & (EPOLLIN|EPOLLOUT|EPOLLERR);
+                        if (events & EPOLLERR) {
+                            auto &xe = regs[static_cast<int>(Op::errqueue)];
+                            if (xe.cb) {
+                                //message in error queue, other operations are not affected
+                                regs.ready &= ~EPOLLERR;
+                                spt << xe.cb(WaitResult::complete);
+                            } else if (socket_error(fd)) {
+                                for (auto &x: regs) {
+                                    spt << x.cb(WaitResult::error);
+                                }
+                                events |= EPOLLIN|EPOLLOUT;
+                            } else {
+                                //message in error queue (zero copy notification) nobody
+                                //waits for, keep it for the next errqueue waiter
+                                regs.ready |= EPOLLERR;
+                            }
+                        }
+                        if (events & EPOLLIN) {
+                            auto &xa = regs[static_cast<int>(Op::accept)];
+                            auto &xr = regs[static_cast<int>(Op::read)];
+                            if (xa.cb || xr.cb) regs.ready &= ~EPOLLIN;
+                            spt << xa.cb(WaitResult::complete);
+                            spt << xr.cb(WaitResult::complete);
+                        }
+                        if (events & EPOLLOUT) {
+                            auto &xc = regs[static_cast<int>(Op::connect)];
+                            auto &xw = regs[static_cast<int>(Op::write)];
+                            if (xc.cb || xw.cb) regs.ready &= ~EPOLLOUT;
+                            spt << xc.cb(WaitResult::complete);
+                            spt << xw.cb(WaitResult::complete);
+                        }
+                        rearm_fd(fd, regs, spt);
+                    }
+
+                }
+            }
+            //timeouts are checked even if there are events, so busy poller
+            //can't starve them
+            if (r == 0 || first_timeout <= now) {
                 //clean any timeout in descriptor map
                 auto tm1 = clear_timeouts(spt, now);
                 //clean any timeout in scheduler map
@@ -291,43 +611,17 @@ cocls::async<void> Poller_epoll::worker(cocls::thread_pool &pool) {
                     expr = _sch.check_expired(now);
                 }
 
-                auto tm2 = std::get<std::chrono::system_clock::time_point>(expr);
+                auto tm2 = std::get<TimePoint>(expr);
                 //calculate nearest timeout point
                 first_timeout = std::min(tm1, tm2);
-            } else {
-                for (int i = 0; i < r; i++) {
-                    auto &e = events[i];
-                    int fd = e.data.fd;
-                    if (fd != event_fd) {
-                        auto iter = fd_map.find(fd);
-                        if (iter != fd_map.end()) {
-                            RegList &regs = fd_map[fd];
-                            if (e.events & EPOLLERR) {
-                                for (auto &x: regs) {
-                                    spt << x.cb(WaitResult::error);
-                                }
-                            }
-                            if (e.events & EPOLLIN) {
-                                auto &xa = regs[static_cast<int>(Op::accept)];
-                                auto &xr = regs[static_cast<int>(Op::read)];
-                                spt << xa.cb(WaitResult::complete);
-                                spt << xr.cb(WaitResult::complete);
-                            }
-                            if (e.events & EPOLLOUT) {
-                                auto &xc = regs[static_cast<int>(Op::connect)];
-                                auto &xw = regs[static_cast<int>(Op::write)];
-                                spt << xc.cb(WaitResult::complete);
-                                spt << xw.cb(WaitResult::complete);
-                            }
-                            rearm_fd(false, iter);
-                        }
-
-                    }
-                }
             }
+            ReactorCounters::set(_counters.timers, _timers.size() + _sch.size());
+            ReactorCounters::add(_counters.resumes, 1);
+            if (pool.any_enqueued()) ReactorCounters::add(_counters.resumes_backlogged, 1);
             pool.resume(spt);
             any_queued = pool.any_enqueued();
         }
+        _clock.invalidate();
         lock.unlock();
     } catch (const cocls::await_canceled_exception &) {
         //thread pool has been stoped, we can't run further
@@ -336,19 +630,24 @@ cocls::async<void> Poller_epoll::worker(cocls::thread_pool &pool) {
 
 
 
+ReactorMetrics Poller_epoll::get_metrics() const {
+    return _counters.snapshot();
+}
+
 void Poller_epoll::handle_closed(SocketHandle s) {
     mark_closing(s);
     std::lock_guard _(_mx);
-    mclosing_map.erase(s);
+    RegList *lst = find_slot(s);
+    if (lst) lst->closing = false;
 }
 
-void Poller_epoll::schedule(const void *ident, Promise p, std::chrono::system_clock::time_point timeout) {
+void Poller_epoll::schedule(const void *ident, Promise p, TimePoint timeout) {
     std::lock_guard _(_mx);
     if (_stopped) p(WaitResult::closed);
     _sch.schedule(ident, std::move(p), timeout);
     if (timeout < first_timeout) {
         first_timeout = timeout;
-        notify();
+        wake();
     }
 }
 
@@ -12,20 +12,22 @@
 
 
 #include "scheduler.h"
+#include "timer_heap.h"
 
 #include <cocls/thread_pool.h>
 
 #include <array>
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <mutex>
+#include <memory>
 #include <optional>
-#include <queue>
-#include <unordered_map>
-#include <set>
 #include <utility>
 
 
+struct epoll_event;
+
 namespace coroserver {
 
 
@@ -34,11 +36,23 @@ public:
 
     using SocketHandle = int;
 
-	Poller_epoll(cocls::thread_pool &pool);
+	///Construct poller
+	/**
+	 * @param pool thread pool
+	 * @param edge_triggered enables edge triggered mode. In this mode, each descriptor
+	 * is registered only once for its lifetime. The poller remembers readiness of each
+	 * descriptor, so waiting on already signaled descriptor returns immediately. The
+	 * caller must always try the I/O operation before it starts to wait.
+	 *
+	 * Listening sockets (waiting for accept) are always registered this way with
+	 * EPOLLEXCLUSIVE, so when the listener is shared by multiple pollers, a connection
+	 * wakes only one of them.
+	 */
+	Poller_epoll(cocls::thread_pool &pool, bool edge_triggered = false);
 	virtual ~Poller_epoll() override;
 
 	///wait for read, resolve promise when done
-    virtual void async_wait(AsyncOperation op, SocketHandle s, Promise p, std::chrono::system_clock::time_point timeout = std::chrono::system_clock::time_point::max()) override;
+    virtual void async_wait(AsyncOperation op, SocketHandle s, Promise p, TimePoint timeout = TimePoint::max()) override;
 
     ///cancel read, and all further reads, socket is marked as closed
     virtual cocls::suspend_point<void> mark_closing(SocketHandle s) override;
@@ -50,11 +64,17 @@ public:
     virtual void handle_closed(SocketHandle s) override;
 
     ///timeout wait, use poller as scheduler
-    virtual void schedule(const void *ident, Promise p, std::chrono::system_clock::time_point timeout) override;
+    virtual void schedule(const void *ident, Promise p, TimePoint timeout) override;
 
     ///cancels specified timer
     virtual cocls::suspend_point<bool> cancel_schedule(const void *ident) override;
 
+    ///retrieve metrics of the poller
+    virtual ReactorMetrics get_metrics() const override;
+
+    ///retrieve time of the current iteration
+    virtual TimePoint now() const override {return _clock.now();}
+
 
 protected:
 
@@ -64,37 +84,124 @@ protected:
     using Op = AsyncOperation;
 
 	struct Reg {
-		std::chrono::system_clock::time_point timeout;
+		TimePoint timeout;
 		Promise cb;
 	};
 
+	using TimerMap = TimerHeap<SocketHandle>;
+
+	///Registration waiting to be processed by the poller
+	/**
+	 * Nodes are taken from the free list, so there is no allocation once the
+	 * list contains enough nodes
+	 */
+	struct PendingReg {
+		PendingReg *next = nullptr;
+		Op op = Op::read;
+		SocketHandle fd = -1;
+		Reg reg;
+		///index of the node in the pool
+		std::uint32_t idx = 0;
+		///index+1 of next node in the free list (0 = end)
+		std::atomic<std::uint32_t> next_free = 0;
+	};
+
 	class RegList: public std::array<Reg,  static_cast<int>(Op::_count)>{
 	public:
-		std::chrono::system_clock::time_point timeout;
+		TimePoint timeout;
+		///handle of timer in the timer map
+		TimerMap::Handle timer = TimerMap::npos;
+		///generation, changed when descriptor is closed. Events with different generation are ignored
+		std::uint32_t gen = 0;
+		///descriptor is registered in epoll
+		bool registered = false;
+		///descriptor is registered for whole lifetime (edge triggered), readiness is tracked
+		bool persistent = false;
+		///descriptor is marked closing
+		bool closing = false;
+		///observed readiness not yet consumed by a waiter (persistent registration)
+		std::uint32_t ready = 0;
 	};
 
-	using FDMap = std::unordered_map<SocketHandle, RegList>;
-	using MarkedClosingMap = std::set<SocketHandle>;
+	///Table of descriptors is allocated by blocks, so it never moves
+	/**
+	 * Slot contains only a pointer to the state of the descriptor. The state is allocated
+	 * when the descriptor is used by this poller for the first time. Descriptors
+	 * are spread over multiple pollers, so most of slots remain empty
+	 */
+	static constexpr std::size_t block_size = 256;
+	using Block = std::array<std::atomic<RegList *>, block_size>;
 
+	///Nodes of the pool are allocated by chunks, chunk k contains pool_chunk_base << k nodes
+	static constexpr std::uint32_t pool_chunk_base = 64;
+	static constexpr std::size_t pool_max_chunks = 26;
 
 	int epoll_fd;
 	int event_fd;
+	bool _edge_triggered;
+	///use epoll_pwait2 (timeout with nanosecond resolution)
+	bool _pwait2 = true;
+
+	///stack of pending registrations (multiple producers, single consumer)
+	std::atomic<PendingReg *> _pending = nullptr;
+	///free list of registration nodes, index+1 of the first node in lower 32 bits,
+	///upper 32 bits contains a tag changed by each operation (prevents ABA problem)
+	std::atomic<std::uint64_t> _free_pending = 0;
+	///chunks of registration nodes, never released until the poller is destroyed
+	std::array<std::atomic<PendingReg *>, pool_max_chunks> _pending_chunks = {};
+	///count of allocated registration nodes
+	std::uint32_t _pending_count = 0;
+	///guards allocation of chunks
+	std::mutex _pool_mx;
+	///poller is sleeping in epoll_wait (or is going to sleep)
+	std::atomic<bool> _sleeping = false;
 
 	std::mutex _mx;
 
-	FDMap fd_map;
-	MarkedClosingMap mclosing_map;
-	std::chrono::system_clock::time_point first_timeout;
+	///table of descriptors (indexed by descriptor / block_size)
+	std::unique_ptr<std::atomic<Block *>[]> _blocks;
+	std::size_t _block_count = 0;
+	///timeouts of registered descriptors ordered by time
+	TimerMap _timers;
+	TimePoint first_timeout;
+
 
+	ReactorCounters _counters;
+	///time of the current iteration
+	Clock::Source _clock;
 
 	cocls::future<void> _running;
 	std::atomic<bool> _stopped = false;
 	std::atomic<bool> _exit = false;
 
-	void notify();
-	void rearm_fd(bool first_call, FDMap::iterator iter);
-
-	std::chrono::system_clock::time_point clear_timeouts(cocls::suspend_point<void> &spt, std::chrono::system_clock::time_point now);
+	///Retrieve slot of the descriptor, allocates block when needed
+	/**
+	 * @param fd descriptor
+	 * @return pointer to slot, or nullptr, if the descriptor is out of range
+	 */
+	RegList *get_slot(SocketHandle fd);
+	///Retrieve slot of the descriptor, doesn't allocate
+	RegList *find_slot(SocketHandle fd) const;
+	///Take registration node from the free list, allocates node when the list is empty
+	PendingReg *alloc_pending();
+	///Return registration node to the free list
+	void free_pending(PendingReg *r);
+	///Retrieve node of the pool by its index
+	PendingReg *pending_at(std::uint32_t idx) const;
+
+	void wake();
+	///wait for events, timeout is in nanoseconds (-1 = infinite)
+	int wait_events(epoll_event *events, int count, std::int64_t timeout_ns);
+	void apply_pending(cocls::suspend_point<void> &spt);
+	void rearm_fd(SocketHandle fd, RegList &lst, cocls::suspend_point<void> &spt);
+	void update_timer(SocketHandle fd, RegList &lst);
+	void remove_timer(RegList &lst);
+	void unregister(SocketHandle fd, RegList &lst, cocls::suspend_point<void> &spt);
+	static std::uint64_t make_key(SocketHandle fd, const RegList &lst) {
+		return (static_cast<std::uint64_t>(lst.gen) << 32) | static_cast<std::uint32_t>(fd);
+	}
+
+	TimePoint clear_timeouts(cocls::suspend_point<void> &spt, TimePoint now);
 
 
 	Scheduler<Promise> _sch;
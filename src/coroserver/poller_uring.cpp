@@ -0,0 +1,674 @@
+/*
+ * poller_uring.cpp
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef _WIN32
+
+#include "poller_uring.h"
+
+#include <unistd.h>
+#include <poll.h>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+namespace coroserver {
+
+///user data of requests, which completion is not reported (nop, cancel, provide buffers)
+static constexpr std::uint64_t ignore_user_data = ~std::uint64_t(0);
+///group of provided buffers
+static constexpr std::uint16_t buffer_group = 0;
+
+//retrieves pending error of the socket, POLLERR can also signal a message in the error queue
+static int socket_error(int fd) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len)) return errno;
+    return err;
+}
+
+static unsigned int load_acquire(unsigned int *ptr) {
+    return std::atomic_ref<unsigned int>(*ptr).load(std::memory_order_acquire);
+}
+
+static void store_release(unsigned int *ptr, unsigned int val) {
+    std::atomic_ref<unsigned int>(*ptr).store(val, std::memory_order_release);
+}
+
+template<typename T>
+static T *ring_ptr(void *base, unsigned int offset) {
+    return reinterpret_cast<T *>(reinterpret_cast<char *>(base) + offset);
+}
+
+Poller_uring::Poller_uring(cocls::thread_pool &pool)
+:Poller_uring(pool, Config())
+{
+
+}
+
+Poller_uring::Poller_uring(cocls::thread_pool &pool, const Config &cfg)
+:_cfg(cfg)
+{
+    try {
+        init_ring();
+    } catch (...) {
+        close_ring();
+        throw;
+    }
+    if (_cfg.buffer_count && _cfg.buffer_size) {
+        _buffers = std::make_unique<char[]>(static_cast<std::size_t>(_cfg.buffer_count) * _cfg.buffer_size);
+        provide_buffer(0, _cfg.buffer_count);
+    }
+
+    _running << [&]{return worker(pool).start();};
+}
+
+Poller_uring::~Poller_uring() {
+
+    cocls::coro_queue::disable_queue([&]{
+
+        {
+            std::lock_guard _(_mx);
+            _exit = true;
+            //always submit nop, poller can be just before sleep
+            prep_nop();
+            flush();
+        }
+
+        _running.wait();
+
+        Poller_uring::mark_closing_all();
+
+        //wait for requests still processed by the kernel, because they can still
+        //access to the memory of buffers
+        std::unique_lock lock(_mx);
+        while (_free_slots.size() < _slots.size()) {
+            cocls::suspend_point<void> spt;
+            unsigned int n = std::exchange(_to_submit, 0);
+            lock.unlock();
+            int r = enter(n, 1, IORING_ENTER_GETEVENTS);
+            int e = r < 0?errno:0;
+            lock.lock();
+            if (r < 0 && e != EINTR) break;
+            process_cq(spt);
+            lock.unlock();
+            spt = {};
+            lock.lock();
+        }
+        lock.unlock();
+
+        close_ring();
+    });
+}
+
+void Poller_uring::init_ring() {
+    io_uring_params params = {};
+    _ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, _cfg.queue_size, &params));
+    if (_ring_fd < 0) {
+        int e = errno;
+        throw std::system_error(e, std::generic_category(), "io_uring_setup");
+    }
+    //timeout of the wait is passed as extended argument
+    if (!(params.features & IORING_FEAT_EXT_ARG)) {
+        throw std::system_error(ENOTSUP, std::generic_category(), "io_uring_setup (IORING_FEAT_EXT_ARG)");
+    }
+
+    _sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    _cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        _sq_size = _cq_size = std::max(_sq_size, _cq_size);
+    }
+
+    void *ptr = ::mmap(nullptr, _sq_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, _ring_fd, IORING_OFF_SQ_RING);
+    if (ptr == MAP_FAILED) {
+        int e = errno;
+        throw std::system_error(e, std::generic_category(), "io_uring mmap(sq)");
+    }
+    _sq_ptr = ptr;
+    if (single_mmap) {
+        _cq_ptr = _sq_ptr;
+    } else {
+        ptr = ::mmap(nullptr, _cq_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, _ring_fd, IORING_OFF_CQ_RING);
+        if (ptr == MAP_FAILED) {
+            int e = errno;
+            throw std::system_error(e, std::generic_category(), "io_uring mmap(cq)");
+        }
+        _cq_ptr = ptr;
+    }
+    _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    ptr = ::mmap(nullptr, _sqes_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, _ring_fd, IORING_OFF_SQES);
+    if (ptr == MAP_FAILED) {
+        int e = errno;
+        throw std::system_error(e, std::generic_category(), "io_uring mmap(sqes)");
+    }
+    _sqes = reinterpret_cast<io_uring_sqe *>(ptr);
+
+    _sq_head = ring_ptr<unsigned int>(_sq_ptr, params.sq_off.head);
+    _sq_tail = ring_ptr<unsigned int>(_sq_ptr, params.sq_off.tail);
+    _sq_mask = *ring_ptr<unsigned int>(_sq_ptr, params.sq_off.ring_mask);
+    _sq_entries = *ring_ptr<unsigned int>(_sq_ptr, params.sq_off.ring_entries);
+    _sq_array = ring_ptr<unsigned int>(_sq_ptr, params.sq_off.array);
+    _cq_head = ring_ptr<unsigned int>(_cq_ptr, params.cq_off.head);
+    _cq_tail = ring_ptr<unsigned int>(_cq_ptr, params.cq_off.tail);
+    _cq_mask = *ring_ptr<unsigned int>(_cq_ptr, params.cq_off.ring_mask);
+    _cqes = ring_ptr<io_uring_cqe>(_cq_ptr, params.cq_off.cqes);
+}
+
+void Poller_uring::close_ring() {
+    if (_sqes) ::munmap(_sqes, _sqes_size);
+    if (_cq_ptr && _cq_ptr != _sq_ptr) ::munmap(_cq_ptr, _cq_size);
+    if (_sq_ptr) ::munmap(_sq_ptr, _sq_size);
+    if (_ring_fd >= 0) ::close(_ring_fd);
+    _sqes = nullptr;
+    _cq_ptr = _sq_ptr = nullptr;
+    _ring_fd = -1;
+}
+
+int Poller_uring::enter(unsigned int to_submit, unsigned int min_complete, unsigned int flags, const void *arg, std::size_t argsz) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, _ring_fd, to_submit, min_complete, flags, arg, argsz));
+}
+
+io_uring_sqe *Poller_uring::get_sqe() {
+    //tail is modified only by us under the lock
+    unsigned int tail = *_sq_tail;
+    if (tail - load_acquire(_sq_head) >= _sq_entries) {
+        flush();
+        if (tail - load_acquire(_sq_head) >= _sq_entries) {
+            throw std::system_error(EBUSY, std::generic_category(), "io_uring - submission queue is full");
+        }
+    }
+    unsigned int idx = tail & _sq_mask;
+    io_uring_sqe *sqe = _sqes + idx;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = ignore_user_data;
+    _sq_array[idx] = idx;
+    store_release(_sq_tail, tail+1);
+    ++_to_submit;
+    return sqe;
+}
+
+void Poller_uring::flush() {
+    if (_to_submit) {
+        unsigned int n = std::exchange(_to_submit, 0);
+        int r = enter(n, 0, 0);
+        if (r < 0) {
+            int e = errno;
+            _to_submit += n;
+            if (e != EINTR && e != EAGAIN && e != EBUSY) {
+                throw std::system_error(e, std::generic_category(), "io_uring_enter");
+            }
+        } else if (static_cast<unsigned int>(r) < n) {
+            _to_submit += n - r;
+        }
+    }
+}
+
+void Poller_uring::commit(TimePoint timeout) {
+    bool earlier = timeout < _first_timeout;
+    if (earlier) _first_timeout = timeout;
+    //when poller is not sleeping, requests are submitted by the poller
+    if (_sleeping) {
+        //poller must recalculate its timeout
+        if (earlier) {
+            ReactorCounters::inc(_counters.notifies);
+            prep_nop();
+        }
+        flush();
+    }
+}
+
+std::uint64_t Poller_uring::user_data(int idx) const {
+    return (static_cast<std::uint64_t>(_slots[idx].gen) << 32) | static_cast<std::uint32_t>(idx);
+}
+
+int Poller_uring::alloc_slot(SocketHandle fd, Op op, SlotType type, TimePoint timeout) {
+    int idx;
+    if (_free_slots.empty()) {
+        idx = static_cast<int>(_slots.size());
+        _slots.emplace_back();
+    } else {
+        idx = _free_slots.back();
+        _free_slots.pop_back();
+    }
+    Slot &s = _slots[idx];
+    s.fd = fd;
+    s.op = op;
+    s.type = type;
+    s.busy = true;
+    s.canceled = false;
+    s.timed_out = false;
+    s.ready = false;
+    set_timer(idx, timeout);
+    return idx;
+}
+
+void Poller_uring::set_timer(int idx, TimePoint timeout) {
+    Slot &s = _slots[idx];
+    s.timeout = timeout;
+    if (timeout == TimePoint::max()) {
+        if (s.timer != TimerMap::npos) {
+            _timers.remove(s.timer);
+            s.timer = TimerMap::npos;
+        }
+    } else if (s.timer == TimerMap::npos) {
+        s.timer = _timers.insert(timeout, idx);
+    } else {
+        _timers.update(s.timer, timeout);
+    }
+}
+
+void Poller_uring::free_slot(int idx) {
+    Slot &s = _slots[idx];
+    auto iter = _fd_map.find(s.fd);
+    if (iter != _fd_map.end()) {
+        int &sid = iter->second.slots[static_cast<int>(s.op)];
+        if (sid == idx) sid = -1;
+    }
+    set_timer(idx, TimePoint::max());
+    s.wait = Promise();
+    s.io = IOPromise();
+    s.busy = false;
+    ++s.gen;
+    _free_slots.push_back(idx);
+}
+
+void Poller_uring::prep_poll(int idx) {
+    const Slot &s = _slots[idx];
+    unsigned int events = 0;
+    switch (s.op) {
+        case Op::read:
+        case Op::accept: events = POLLIN; break;
+        case Op::connect:
+        case Op::write: events = POLLOUT; break;
+        case Op::errqueue: events = POLLERR; break;
+        default: break;
+    }
+#if __BYTE_ORDER == __BIG_ENDIAN
+    events = (events << 16) | (events >> 16);
+#endif
+    io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = s.fd;
+    sqe->poll32_events = events;
+    if (s.type == SlotType::poll_multi) sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = user_data(idx);
+}
+
+void Poller_uring::prep_cancel(int idx) {
+    io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = user_data(idx);
+    _slots[idx].canceled = true;
+}
+
+void Poller_uring::prep_nop() {
+    io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_NOP;
+}
+
+void Poller_uring::provide_buffer(int buffer_id, unsigned int count) {
+    io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = static_cast<int>(count);
+    sqe->addr = reinterpret_cast<std::uintptr_t>(_buffers.get() + static_cast<std::size_t>(buffer_id) * _cfg.buffer_size);
+    sqe->len = _cfg.buffer_size;
+    sqe->off = static_cast<unsigned int>(buffer_id);
+    sqe->buf_group = buffer_group;
+}
+
+void Poller_uring::async_wait(AsyncOperation op, SocketHandle s, Promise p, TimePoint timeout) {
+    std::lock_guard _(_mx);
+    if (_stopped || _mclosing_map.find(s) != _mclosing_map.end()) {
+        p.set_value(WaitResult::closed);
+        return;
+    }
+    int &sid = _fd_map[s].slots[static_cast<int>(op)];
+    if (op == Op::accept) {
+        //listening socket is registered only once
+        if (sid >= 0) {
+            Slot &sl = _slots[sid];
+            if (sl.type == SlotType::poll_multi && !sl.canceled) {
+                if (sl.ready) {
+                    sl.ready = false;
+                    p(WaitResult::complete);
+                } else {
+                    sl.wait = std::move(p);
+                    set_timer(sid, timeout);
+                    commit(timeout);
+                }
+                return;
+            }
+        }
+        prep_poll(sid = alloc_slot(s, op, SlotType::poll_multi, timeout));
+    } else {
+        prep_poll(sid = alloc_slot(s, op, SlotType::poll, timeout));
+    }
+    _slots[sid].wait = std::move(p);
+    commit(timeout);
+}
+
+void Poller_uring::async_read(SocketHandle s, std::size_t size, IOPromise p, TimePoint timeout) {
+    std::lock_guard _(_mx);
+    if (_stopped || _mclosing_map.find(s) != _mclosing_map.end()) {
+        p(IOResult{WaitResult::closed});
+        return;
+    }
+    if (!_buffers) {
+        p(IOResult{WaitResult::error, ENOBUFS});
+        return;
+    }
+    io_uring_sqe *sqe = get_sqe();
+    int idx = alloc_slot(s, Op::read, SlotType::read, timeout);
+    _fd_map[s].slots[static_cast<int>(Op::read)] = idx;
+    _slots[idx].io = std::move(p);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = s;
+    sqe->len = static_cast<unsigned int>(std::min<std::size_t>(size, _cfg.buffer_size));
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = buffer_group;
+    sqe->user_data = user_data(idx);
+    commit(timeout);
+}
+
+void Poller_uring::async_write(SocketHandle s, std::string_view data, IOPromise p, TimePoint timeout) {
+    std::lock_guard _(_mx);
+    if (_stopped || _mclosing_map.find(s) != _mclosing_map.end()) {
+        p(IOResult{WaitResult::closed});
+        return;
+    }
+    io_uring_sqe *sqe = get_sqe();
+    int idx = alloc_slot(s, Op::write, SlotType::write, timeout);
+    _fd_map[s].slots[static_cast<int>(Op::write)] = idx;
+    _slots[idx].io = std::move(p);
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = s;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(data.data());
+    sqe->len = static_cast<unsigned int>(data.size());
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = user_data(idx);
+    commit(timeout);
+}
+
+void Poller_uring::release_buffer(int buffer_id) {
+    if (buffer_id < 0) return;
+    std::lock_guard _(_mx);
+    provide_buffer(buffer_id, 1);
+    //buffers are returned in batch, unless the poller is sleeping
+    if (_sleeping) flush();
+}
+
+cocls::suspend_point<void> Poller_uring::cancel_slot(int idx, WaitResult res) {
+    cocls::suspend_point<void> spt;
+    if (!_slots[idx].canceled) prep_cancel(idx);
+    //timeout is no longer needed
+    set_timer(idx, TimePoint::max());
+    Slot &s = _slots[idx];
+    switch (s.type) {
+        case SlotType::poll:
+        case SlotType::poll_multi:
+            if (s.wait) spt << s.wait(res);
+            break;
+        case SlotType::read:
+            //the request can still complete with data, resolved on completion
+            break;
+        case SlotType::write:
+            //kernel can still access the data, resolved on completion
+            break;
+    }
+    return spt;
+}
+
+cocls::suspend_point<void> Poller_uring::mark_closing(SocketHandle s) {
+    cocls::suspend_point<void> spt;
+    std::lock_guard _(_mx);
+    auto iter = _fd_map.find(s);
+    if (iter != _fd_map.end()) {
+        for (int idx: iter->second.slots) {
+            if (idx >= 0) spt << cancel_slot(idx, WaitResult::closed);
+        }
+    }
+    _mclosing_map.emplace(s);
+    if (_sleeping) flush();
+    return spt;
+}
+
+cocls::suspend_point<void> Poller_uring::mark_closing_all() {
+    //enter to coro-mode - flush all corouties before exit
+    return cocls::coro_queue::create_suspend_point([&]{
+        Scheduler<Promise> sch_tmp;
+        cocls::suspend_point<void> spt;
+        std::lock_guard _(_mx);
+        for (std::size_t i = 0; i < _slots.size(); ++i) {
+            if (_slots[i].busy) spt << cancel_slot(static_cast<int>(i), WaitResult::closed);
+        }
+        //all timers are removed by cancel_slot()
+        std::swap(sch_tmp, _sch);
+        _stopped = true;
+        flush();
+    });
+}
+
+void Poller_uring::handle_closed(SocketHandle s) {
+    mark_closing(s);
+    std::lock_guard _(_mx);
+    _mclosing_map.erase(s);
+    _fd_map.erase(s);
+}
+
+void Poller_uring::schedule(const void *ident, Promise p, TimePoint timeout) {
+    std::lock_guard _(_mx);
+    if (_stopped) {
+        p(WaitResult::closed);
+        return;
+    }
+    _sch.schedule(ident, std::move(p), timeout);
+    commit(timeout);
+}
+
+cocls::suspend_point<bool> Poller_uring::cancel_schedule(const void *ident) {
+    std::lock_guard _(_mx);
+    auto p =_sch.cancel_schedule(ident);
+    if (p.has_value()) {
+        return (*p)(WaitResult::complete);
+    } else {
+        return false;
+    }
+}
+
+void Poller_uring::process_cqe(const io_uring_cqe &cqe, cocls::suspend_point<void> &spt) {
+    int buffer_id = (cqe.flags & IORING_CQE_F_BUFFER)?static_cast<int>(cqe.flags >> IORING_CQE_BUFFER_SHIFT):-1;
+    std::uint32_t idx = static_cast<std::uint32_t>(cqe.user_data);
+    std::uint32_t gen = static_cast<std::uint32_t>(cqe.user_data >> 32);
+    if (cqe.user_data == ignore_user_data || idx >= _slots.size()
+            || !_slots[idx].busy || _slots[idx].gen != gen) {
+        if (buffer_id >= 0) provide_buffer(buffer_id, 1);
+        return;
+    }
+    Slot &s = _slots[idx];
+    WaitResult canceled = s.timed_out?WaitResult::timeout:WaitResult::closed;
+    switch (s.type) {
+        case SlotType::poll: {
+            WaitResult wr = cqe.res < 0?(cqe.res == -ECANCELED?canceled:WaitResult::error)
+                                   :((cqe.res & POLLERR) && s.op != Op::errqueue && socket_error(s.fd))?WaitResult::error
+                                   :WaitResult::complete;
+            if (s.wait) spt << s.wait(wr);
+        } break;
+        case SlotType::poll_multi:
+            if (cqe.res >= 0) {
+                if (s.wait) {
+                    spt << s.wait(WaitResult::complete);
+                    set_timer(static_cast<int>(idx), TimePoint::max());
+                } else {
+                    s.ready = true;
+                }
+            } else if (s.wait) {
+                spt << s.wait(cqe.res == -ECANCELED?WaitResult::closed:WaitResult::error);
+            }
+            break;
+        case SlotType::read: {
+            IOResult r;
+            if (cqe.res >= 0) {
+                r.state = WaitResult::complete;
+                r.result = cqe.res;
+                if (buffer_id >= 0) {
+                    r.buffer_id = buffer_id;
+                    r.data = std::string_view(_buffers.get() + static_cast<std::size_t>(buffer_id) * _cfg.buffer_size, cqe.res);
+                }
+            } else if (cqe.res == -ECANCELED) {
+                r.state = canceled;
+            } else {
+                r.state = WaitResult::error;
+                r.result = -cqe.res;
+            }
+            if (s.io) spt << s.io(r);
+            else if (buffer_id >= 0) provide_buffer(buffer_id, 1);
+        } break;
+        case SlotType::write: {
+            IOResult r;
+            if (cqe.res >= 0) {
+                r.state = WaitResult::complete;
+                r.result = cqe.res;
+            } else if (cqe.res == -ECANCELED) {
+                r.state = canceled;
+            } else {
+                r.state = WaitResult::error;
+                r.result = -cqe.res;
+            }
+            if (s.io) spt << s.io(r);
+        } break;
+    }
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        free_slot(static_cast<int>(idx));
+    }
+}
+
+void Poller_uring::process_cq(cocls::suspend_point<void> &spt) {
+    unsigned int head = *_cq_head;
+    unsigned int tail = load_acquire(_cq_tail);
+    ReactorCounters::add(_counters.events, tail - head);
+    while (head != tail) {
+        process_cqe(_cqes[head & _cq_mask], spt);
+        ++head;
+    }
+    store_release(_cq_head, head);
+}
+
+TimePoint Poller_uring::check_timeouts(cocls::suspend_point<void> &spt, TimePoint now) {
+    //process requests in order of their timeouts
+    while (_timers.top_time() <= now) {
+        int idx = _timers[_timers.top()];
+        Slot &s = _slots[idx];
+        if (s.type == SlotType::poll_multi) {
+            //multishot poll remains registered, only waiter is resolved
+            set_timer(idx, TimePoint::max());
+            if (s.wait) spt << s.wait(WaitResult::timeout);
+        } else {
+            //also removes the timer
+            s.timed_out = true;
+            spt << cancel_slot(idx, WaitResult::timeout);
+        }
+    }
+    return _timers.top_time();
+}
+
+ReactorMetrics Poller_uring::get_metrics() const {
+    return _counters.snapshot();
+}
+
+cocls::async<void> Poller_uring::worker(cocls::thread_pool &pool) {
+    try {
+
+        std::unique_lock lock(_mx);
+        bool any_queued = true;
+        auto woken = _clock.update();
+        while (!_exit) {
+            //release current thread, if there is any queued coroutines
+            if (any_queued) {
+                lock.unlock();
+                //time is not published while the thread is released
+                _clock.invalidate();
+                co_await pool;
+                lock.lock();
+            }
+            //expired timeout shortens the wait to zero, it is processed below
+            auto now = _clock.update();
+
+            __kernel_timespec ts = {};
+            io_uring_getevents_arg arg = {};
+            unsigned int wait_nr = 0;
+            //ask the pool, if there is a task in queue
+            any_queued = pool.any_enqueued();
+            //if there is, just collect completions without blocking
+            if (!any_queued) {
+                wait_nr = 1;
+                if (_first_timeout != TimePoint::max()) {
+                    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(_first_timeout - now).count();
+                    if (ns < 0) ns = 0;
+                    ts.tv_sec = ns / 1000000000;
+                    ts.tv_nsec = ns % 1000000000;
+                    arg.ts = reinterpret_cast<std::uintptr_t>(&ts);
+                }
+            }
+            //submit pending requests and wait in single syscall
+            unsigned int n = std::exchange(_to_submit, 0);
+            _sleeping = wait_nr != 0;
+            auto wait_start = _clock.update();
+            ReactorCounters::add_time(_counters.processing_ns, wait_start - woken);
+            //time is not published during sleep
+            if (wait_nr) _clock.invalidate();
+            lock.unlock();
+            int r = enter(n, wait_nr, IORING_ENTER_GETEVENTS|IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+            int e = r < 0?errno:0;
+            lock.lock();
+            _sleeping = false;
+            woken = _clock.update();
+            ReactorCounters::add_time(_counters.blocked_ns, woken - wait_start);
+            ReactorCounters::add(_counters.iterations, 1);
+            if (r < 0) {
+                _to_submit += n;
+                if (e != EINTR && e != ETIME && e != EAGAIN && e != EBUSY) {
+                    throw std::system_error(e, std::generic_category(), "io_uring_enter");
+                }
+            } else if (static_cast<unsigned int>(r) < n) {
+                _to_submit += n - r;
+            }
+
+            cocls::suspend_point<void> spt;
+            process_cq(spt);
+            //timeouts are resumed in the same batch as the completions
+            if (_first_timeout <= woken) {
+                //clean any timeout in requests
+                auto tm1 = check_timeouts(spt, woken);
+                //clean any timeout in scheduler map
+                auto expr = _sch.check_expired(woken);
+                while (std::holds_alternative<Promise>(expr)) {
+                    spt << std::get<Promise>(expr)(WaitResult::timeout);
+                    expr = _sch.check_expired(woken);
+                }
+                auto tm2 = std::get<TimePoint>(expr);
+                //calculate nearest timeout point
+                _first_timeout = std::min(tm1, tm2);
+            }
+            ReactorCounters::set(_counters.registered_fds, _slots.size() - _free_slots.size());
+            ReactorCounters::set(_counters.timers, _timers.size() + _sch.size());
+            ReactorCounters::add(_counters.resumes, 1);
+            if (pool.any_enqueued()) ReactorCounters::add(_counters.resumes_backlogged, 1);
+            pool.resume(spt);
+            any_queued = pool.any_enqueued();
+        }
+        _clock.invalidate();
+        lock.unlock();
+    } catch (const cocls::await_canceled_exception &) {
+        //thread pool has been stoped, we can't run further
+    }
+}
+
+}
+#endif
@@ -0,0 +1,192 @@
+/*
+ * poller_uring.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_POLLER_URING_H_
+#define SRC_COROSERVER_POLLER_URING_H_
+
+#include "ipoller.h"
+
+#include "scheduler.h"
+#include "timer_heap.h"
+
+#include <cocls/thread_pool.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace coroserver {
+
+///Poller based on io_uring
+/**
+ * The poller submits all requests into the submission queue. Requests are submitted
+ * in a batch, when the poller's thread enters to the kernel to wait for completions. When
+ * the poller's thread is sleeping, the request is submitted immediately by the
+ * calling thread.
+ *
+ * Waiting for accept uses multishot poll, so listening socket is registered only once.
+ *
+ * The poller also supports completion based I/O. Reading uses buffers provided by the
+ * poller (buffer select), so pending read doesn't need a buffer until data arrives.
+ */
+class Poller_uring: public IPoller<int> {
+public:
+
+    using SocketHandle = int;
+
+    struct Config {
+        ///count of entries of submission queue
+        unsigned int queue_size = 1024;
+        ///count of buffers provided for reading
+        unsigned int buffer_count = 256;
+        ///size of single buffer
+        unsigned int buffer_size = 16384;
+    };
+
+    Poller_uring(cocls::thread_pool &pool);
+    Poller_uring(cocls::thread_pool &pool, const Config &cfg);
+    virtual ~Poller_uring() override;
+
+    virtual void async_wait(AsyncOperation op, SocketHandle s, Promise p, TimePoint timeout = TimePoint::max()) override;
+    virtual cocls::suspend_point<void> mark_closing(SocketHandle s) override;
+    virtual cocls::suspend_point<void> mark_closing_all() override;
+    virtual void handle_closed(SocketHandle s) override;
+    virtual void schedule(const void *ident, Promise p, TimePoint timeout) override;
+    virtual cocls::suspend_point<bool> cancel_schedule(const void *ident) override;
+
+    virtual bool completion_io() const override {return true;}
+    virtual void async_read(SocketHandle s, std::size_t size, IOPromise p, TimePoint timeout) override;
+    virtual void async_write(SocketHandle s, std::string_view data, IOPromise p, TimePoint timeout) override;
+    virtual void release_buffer(int buffer_id) override;
+    virtual ReactorMetrics get_metrics() const override;
+    virtual Clock::time_point now() const override {return _clock.now();}
+
+protected:
+
+    using Op = AsyncOperation;
+    using TimePoint = Clock::time_point;
+
+    using TimerMap = TimerHeap<int>;
+
+    enum class SlotType: std::uint8_t {
+        poll,
+        poll_multi,
+        read,
+        write
+    };
+
+    ///Slot contains state of single request submitted to the kernel
+    struct Slot {
+        Promise wait;
+        IOPromise io;
+        TimePoint timeout = TimePoint::max();
+        ///handle of timer in the timer map
+        TimerMap::Handle timer = TimerMap::npos;
+        SocketHandle fd = -1;
+        std::uint32_t gen = 0;
+        SlotType type = SlotType::poll;
+        Op op = Op::read;
+        bool busy = false;
+        ///cancel request has been submitted
+        bool canceled = false;
+        ///request has been canceled because timeout
+        bool timed_out = false;
+        ///multishot poll has been signaled without a waiter
+        bool ready = false;
+    };
+
+    struct FDInfo {
+        std::array<int, static_cast<int>(Op::_count)> slots;
+        FDInfo() {slots.fill(-1);}
+    };
+
+    using FDMap = std::unordered_map<SocketHandle, FDInfo>;
+    using MarkedClosingMap = std::set<SocketHandle>;
+
+    Config _cfg;
+    int _ring_fd = -1;
+
+    void *_sq_ptr = nullptr;
+    std::size_t _sq_size = 0;
+    void *_cq_ptr = nullptr;
+    std::size_t _cq_size = 0;
+    io_uring_sqe *_sqes = nullptr;
+    std::size_t _sqes_size = 0;
+
+    unsigned int *_sq_head = nullptr;
+    unsigned int *_sq_tail = nullptr;
+    unsigned int *_sq_array = nullptr;
+    unsigned int _sq_mask = 0;
+    unsigned int _sq_entries = 0;
+    unsigned int *_cq_head = nullptr;
+    unsigned int *_cq_tail = nullptr;
+    unsigned int _cq_mask = 0;
+    io_uring_cqe *_cqes = nullptr;
+
+    ///count of prepared but not yet submitted requests
+    unsigned int _to_submit = 0;
+    ///poller's thread is waiting in the kernel
+    bool _sleeping = false;
+
+    std::unique_ptr<char[]> _buffers;
+
+    std::mutex _mx;
+    std::vector<Slot> _slots;
+    std::vector<int> _free_slots;
+    FDMap _fd_map;
+    MarkedClosingMap _mclosing_map;
+    ///timeouts of pending requests ordered by time
+    TimerMap _timers;
+    ReactorCounters _counters;
+    ///time of the current iteration
+    Clock::Source _clock;
+    TimePoint _first_timeout = TimePoint::max();
+    Scheduler<Promise> _sch;
+
+    cocls::future<void> _running;
+    std::atomic<bool> _stopped = false;
+    std::atomic<bool> _exit = false;
+
+    void init_ring();
+    void close_ring();
+
+    int enter(unsigned int to_submit, unsigned int min_complete, unsigned int flags, const void *arg = nullptr, std::size_t argsz = 0);
+    io_uring_sqe *get_sqe();
+    void flush();
+
+    int alloc_slot(SocketHandle fd, Op op, SlotType type, TimePoint timeout);
+    void free_slot(int idx);
+    void set_timer(int idx, TimePoint timeout);
+    void prep_poll(int idx);
+    void prep_cancel(int idx);
+    void prep_nop();
+    void provide_buffer(int buffer_id, unsigned int count);
+    void commit(TimePoint timeout);
+    std::uint64_t user_data(int idx) const;
+
+    cocls::suspend_point<void> cancel_slot(int idx, WaitResult res);
+    void process_cqe(const io_uring_cqe &cqe, cocls::suspend_point<void> &spt);
+    void process_cq(cocls::suspend_point<void> &spt);
+    TimePoint check_timeouts(cocls::suspend_point<void> &spt, TimePoint now);
+
+    cocls::async<void> worker(cocls::thread_pool &pool);
+
+};
+
+}
+
+
+
+#endif /* SRC_COROSERVER_POLLER_URING_H_ */
@@ -0,0 +1,104 @@
+/*
+ * reactor_metrics.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_REACTOR_METRICS_H_
+#define SRC_COROSERVER_REACTOR_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace coroserver {
+
+///Snapshot of metrics of single reactor
+/**
+ * Counters are monotonic since the reactor was created, so the rates
+ * can be calculated from the difference of two snapshots
+ */
+struct ReactorMetrics {
+    ///count of iterations of the loop
+    std::uint64_t iterations = 0;
+    ///count of events (descriptors signaled). Events per wakeup is events/iterations
+    std::uint64_t events = 0;
+    ///total time spent by waiting for events
+    std::chrono::nanoseconds blocked_time = {};
+    ///total time spent by processing of events
+    std::chrono::nanoseconds processing_time = {};
+    ///count of notifications of sleeping poller (registrations, new timers)
+    std::uint64_t notifies = 0;
+    ///count of batches of coroutines resumed in the thread pool
+    /** Coroutines woken by single iteration are resumed in single batch, so it
+     * is equal to iterations */
+    std::uint64_t resumes = 0;
+    ///count of resumes, when thread pool already had enqueued coroutines
+    /** High ratio to resumes means, that thread pool is too small */
+    std::uint64_t resumes_backlogged = 0;
+    ///count of registered descriptors (io_uring: count of requests in flight)
+    std::uint64_t registered_fds = 0;
+    ///count of active timers (timeouts and scheduled waits)
+    std::uint64_t timers = 0;
+};
+
+///Counters of the reactor
+/**
+ * Counters are updated by the poller's worker only (under its lock), so they
+ * are not updated atomically, they are just stored with relaxed ordering. The
+ * only exception is notifies, which is incremented by any thread.
+ */
+struct ReactorCounters {
+    using Counter = std::atomic<std::uint64_t>;
+
+    Counter iterations = 0;
+    Counter events = 0;
+    Counter blocked_ns = 0;
+    Counter processing_ns = 0;
+    Counter notifies = 0;
+    Counter resumes = 0;
+    Counter resumes_backlogged = 0;
+    Counter registered_fds = 0;
+    Counter timers = 0;
+
+    ///add value to the counter (single writer)
+    static void add(Counter &c, std::uint64_t val) {
+        c.store(c.load(std::memory_order_relaxed) + val, std::memory_order_relaxed);
+    }
+    ///subtract value from the counter (single writer)
+    static void sub(Counter &c, std::uint64_t val) {
+        c.store(c.load(std::memory_order_relaxed) - val, std::memory_order_relaxed);
+    }
+    ///add duration to the counter (single writer)
+    template<typename Dur>
+    static void add_time(Counter &c, Dur dur) {
+        add(c, std::chrono::duration_cast<std::chrono::nanoseconds>(dur).count());
+    }
+    ///set value of the counter (single writer)
+    static void set(Counter &c, std::uint64_t val) {
+        c.store(val, std::memory_order_relaxed);
+    }
+    ///increment the counter (multiple writers)
+    static void inc(Counter &c) {
+        c.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ReactorMetrics snapshot() const {
+        auto ld = [](const Counter &c) {return c.load(std::memory_order_relaxed);};
+        return ReactorMetrics{
+            ld(iterations),
+            ld(events),
+            std::chrono::nanoseconds(ld(blocked_ns)),
+            std::chrono::nanoseconds(ld(processing_ns)),
+            ld(notifies),
+            ld(resumes),
+            ld(resumes_backlogged),
+            ld(registered_fds),
+            ld(timers)
+        };
+    }
+};
+
+}
+
+#endif /* SRC_COROSERVER_REACTOR_METRICS_H_ */
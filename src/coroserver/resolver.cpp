@@ -0,0 +1,584 @@
+#include "resolver.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+
+namespace coroserver {
+
+static constexpr std::uint16_t dns_type_a = 1;
+static constexpr std::uint16_t dns_type_cname = 5;
+static constexpr std::uint16_t dns_type_soa = 6;
+static constexpr std::uint16_t dns_type_aaaa = 28;
+static constexpr std::uint16_t dns_class_in = 1;
+static constexpr int dns_rcode_nxdomain = 3;
+static constexpr std::uint32_t no_ttl = ~std::uint32_t(0);
+
+///Single address without port
+struct ResolvedAddress {
+    int family;
+    unsigned char bytes[16];
+};
+
+///Parsed answer of the name server
+struct DnsAnswer {
+    int rcode = 0;
+    std::vector<ResolvedAddress> addrs;
+    ///minimal TTL of the answer records
+    std::uint32_t ttl = no_ttl;
+    ///TTL of the negative answer (from SOA record)
+    std::uint32_t negative_ttl = no_ttl;
+};
+
+static std::uint16_t get16(std::string_view msg, std::size_t pos) {
+    return static_cast<std::uint16_t>((static_cast<unsigned char>(msg[pos]) << 8)
+                                     | static_cast<unsigned char>(msg[pos+1]));
+}
+
+static std::uint32_t get32(std::string_view msg, std::size_t pos) {
+    return (static_cast<std::uint32_t>(get16(msg, pos)) << 16) | get16(msg, pos+2);
+}
+
+static void put16(std::string &out, std::uint16_t v) {
+    out.push_back(static_cast<char>(v >> 8));
+    out.push_back(static_cast<char>(v & 0xFF));
+}
+
+static bool iequal(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+static std::string normalize_name(std::string_view name) {
+    if (!name.empty() && name.back() == '.') name = name.substr(0, name.size()-1);
+    std::string out;
+    out.reserve(name.size());
+    for (char c: name) out.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+    return out;
+}
+
+static bool valid_hostname(std::string_view name) {
+    if (name.empty() || name.size() > 253) return false;
+    while (!name.empty()) {
+        auto sep = name.find('.');
+        auto label = name.substr(0, sep);
+        if (label.empty() || label.size() > 63) return false;
+        if (sep == name.npos) break;
+        name = name.substr(sep+1);
+        if (name.empty()) return false;
+    }
+    return true;
+}
+
+static std::string build_query(std::uint16_t id, std::string_view name, std::uint16_t qtype) {
+    std::string out;
+    out.reserve(name.size() + 18);
+    put16(out, id);
+    put16(out, 0x0100);     //standard query, recursion desired
+    put16(out, 1);          //qdcount
+    put16(out, 0);
+    put16(out, 0);
+    put16(out, 0);
+    while (!name.empty()) {
+        auto sep = name.find('.');
+        auto label = name.substr(0, sep);
+        out.push_back(static_cast<char>(label.size()));
+        out.append(label);
+        name = sep == name.npos?std::string_view():name.substr(sep+1);
+    }
+    out.push_back(0);
+    put16(out, qtype);
+    put16(out, dns_class_in);
+    return out;
+}
+
+///Reads (possibly compressed) name
+/**
+ * @param msg whole message
+ * @param pos position of the name, it is moved after the name
+ * @param out receives the name (can be nullptr to skip the name)
+ * @retval true success
+ * @retval false malformed message
+ */
+static bool read_name(std::string_view msg, std::size_t &pos, std::string *out) {
+    std::size_t p = pos;
+    bool jumped = false;
+    int hops = 0;
+    if (out) out->clear();
+    while (true) {
+        if (p >= msg.size()) return false;
+        unsigned char len = static_cast<unsigned char>(msg[p]);
+        if ((len & 0xC0) == 0xC0) {
+            if (p + 1 >= msg.size() || ++hops > 32) return false;
+            if (!jumped) pos = p + 2;
+            jumped = true;
+            p = ((len & 0x3F) << 8) | static_cast<unsigned char>(msg[p+1]);
+        } else if (len & 0xC0) {
+            return false;
+        } else if (len == 0) {
+            if (!jumped) pos = p + 1;
+            return true;
+        } else {
+            if (p + 1 + len > msg.size()) return false;
+            if (out) {
+                if (!out->empty()) out->push_back('.');
+                out->append(msg.substr(p + 1, len));
+            }
+            p += 1 + len;
+        }
+    }
+}
+
+///Parses response of the name server
+/**
+ * @param msg received message
+ * @param id id of the query
+ * @param qname queried name
+ * @param qtype queried type
+ * @param ans receives the answer. Only records which belongs to the queried
+ * name or to its aliases (CNAME chain) are accepted
+ * @retval true message is answer to the query
+ * @retval false message is not answer to the query or it is malformed
+ */
+static bool parse_response(std::string_view msg, std::uint16_t id, std::string_view qname, std::uint16_t qtype, DnsAnswer &ans) {
+    if (msg.size() < 12 || get16(msg, 0) != id) return false;
+    std::uint16_t flags = get16(msg, 2);
+    if (!(flags & 0x8000) || get16(msg, 4) != 1) return false;
+    ans.rcode = flags & 0xF;
+    unsigned int ancount = get16(msg, 6);
+    unsigned int nscount = get16(msg, 8);
+    std::size_t pos = 12;
+    std::string name;
+    if (!read_name(msg, pos, &name) || pos + 4 > msg.size()) return false;
+    if (!iequal(name, qname) || get16(msg, pos) != qtype || get16(msg, pos+2) != dns_class_in) return false;
+    pos += 4;
+
+    struct Record {
+        std::string owner;
+        std::uint16_t type;
+        std::uint32_t ttl;
+        std::string_view rdata;
+        std::size_t rdpos;
+    };
+    std::vector<Record> answers;
+    for (unsigned int i = 0; i < ancount + nscount; i++) {
+        Record r;
+        if (!read_name(msg, pos, &r.owner) || pos + 10 > msg.size()) return false;
+        r.type = get16(msg, pos);
+        std::uint16_t cls = get16(msg, pos+2);
+        r.ttl = get32(msg, pos+4);
+        std::uint16_t rdlen = get16(msg, pos+8);
+        pos += 10;
+        if (pos + rdlen > msg.size()) return false;
+        r.rdata = msg.substr(pos, rdlen);
+        r.rdpos = pos;
+        pos += rdlen;
+        if (cls != dns_class_in) continue;
+        if (i < ancount) {
+            answers.push_back(std::move(r));
+        } else if (r.type == dns_type_soa && rdlen >= 22) {
+            ans.negative_ttl = std::min({ans.negative_ttl, r.ttl, get32(msg, pos - 4)});
+        }
+    }
+    //collect aliases, records can be in any order
+    std::vector<std::string> aliases = {normalize_name(qname)};
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto &r: answers) {
+            if (r.type != dns_type_cname) continue;
+            std::string owner = normalize_name(r.owner);
+            if (std::find(aliases.begin(), aliases.end(), owner) == aliases.end()) continue;
+            std::size_t tpos = r.rdpos;
+            std::string target;
+            if (!read_name(msg, tpos, &target)) return false;
+            target = normalize_name(target);
+            if (std::find(aliases.begin(), aliases.end(), target) == aliases.end()) {
+                aliases.push_back(std::move(target));
+                ans.ttl = std::min(ans.ttl, r.ttl);
+                changed = true;
+            }
+        }
+    }
+    std::size_t addr_size = qtype == dns_type_a?4:16;
+    for (const auto &r: answers) {
+        if (r.type != qtype || r.rdata.size() != addr_size) continue;
+        if (std::find(aliases.begin(), aliases.end(), normalize_name(r.owner)) == aliases.end()) continue;
+        ResolvedAddress a = {};
+        a.family = qtype == dns_type_a?AF_INET:AF_INET6;
+        std::memcpy(a.bytes, r.rdata.data(), addr_size);
+        ans.addrs.push_back(a);
+        ans.ttl = std::min(ans.ttl, r.ttl);
+    }
+    return true;
+}
+
+static bool parse_numeric(const std::string &addr, ResolvedAddress &out) {
+    out = {};
+    if (inet_pton(AF_INET, addr.c_str(), out.bytes) == 1) {
+        out.family = AF_INET;
+        return true;
+    }
+    if (inet_pton(AF_INET6, addr.c_str(), out.bytes) == 1) {
+        out.family = AF_INET6;
+        return true;
+    }
+    return false;
+}
+
+static PeerName make_peer(const ResolvedAddress &addr, std::uint16_t port) {
+    if (addr.family == AF_INET) {
+        sockaddr_in sin = {};
+        sin.sin_family = AF_INET;
+        sin.sin_port = htons(port);
+        std::memcpy(&sin.sin_addr, addr.bytes, 4);
+        return PeerName::from_sockaddr(&sin);
+    } else {
+        sockaddr_in6 sin6 = {};
+        sin6.sin6_family = AF_INET6;
+        sin6.sin6_port = htons(port);
+        std::memcpy(&sin6.sin6_addr, addr.bytes, 16);
+        return PeerName::from_sockaddr(&sin6);
+    }
+}
+
+static std::uint16_t parse_port(std::string_view port) {
+    if (port == "*") return 0;
+    if (std::all_of(port.begin(), port.end(), [](char c){return c >= '0' && c <= '9';})) {
+        unsigned int v = 0;
+        for (char c: port) {
+            v = v * 10 + (c - '0');
+            if (v > 65535) throw PeerName::LookupException(EAI_SERVICE);
+        }
+        return static_cast<std::uint16_t>(v);
+    }
+    std::string name(port);
+    servent se;
+    servent *res = nullptr;
+    char buff[1024];
+    if (getservbyname_r(name.c_str(), "tcp", &se, buff, sizeof(buff), &res) != 0 || res == nullptr) {
+        throw PeerName::LookupException(EAI_SERVICE);
+    }
+    return ntohs(static_cast<std::uint16_t>(res->s_port));
+}
+
+///Determines, whether the host can be resolved without name server
+static bool is_direct(std::string_view host) {
+    if (host.empty() || host == "localhost" || host == "0" || host == "*") return true;
+    //ipv6 address (names never contain ':')
+    if (host.find(':') != host.npos) return true;
+    ResolvedAddress tmp;
+    return parse_numeric(std::string(host), tmp);
+}
+
+class Resolver::Impl: public std::enable_shared_from_this<Resolver::Impl> {
+public:
+
+    struct Entry {
+        std::vector<ResolvedAddress> addrs;
+        ///error code (EAI_xxx), if the name was not resolved
+        int error = 0;
+        TimePoint expires;
+    };
+
+    using EntryPtr = std::shared_ptr<const Entry>;
+
+    Impl(AsyncSupport ctx, Config cfg);
+
+    static cocls::future<std::vector<PeerName> > lookup(std::shared_ptr<Impl> me, std::string names, std::string def_port);
+    cocls::future<EntryPtr> resolve(const std::string &host);
+    void clear_cache();
+
+protected:
+    AsyncSupport _ctx;
+    Config _cfg;
+    ///content of hosts file (immutable)
+    std::unordered_map<std::string, EntryPtr> _hosts;
+    std::mutex _mx;
+    std::unordered_map<std::string, EntryPtr> _cache;
+    std::unordered_map<std::string, std::vector<cocls::promise<EntryPtr> > > _pending;
+    std::mt19937 _rnd;
+
+    void load_hosts();
+    void load_resolv_conf();
+    std::uint16_t next_id();
+    void finish(const std::string &host, EntryPtr e);
+    EntryPtr make_entry(int error, const std::vector<DnsAnswer> &answers) const;
+    static cocls::async<void> query(std::shared_ptr<Impl> me, std::string host);
+    cocls::future<int> exchange(const PeerName &server, const std::string &host,
+                                const std::vector<std::uint16_t> &types, std::vector<DnsAnswer> &answers);
+};
+
+Resolver::Impl::Impl(AsyncSupport ctx, Config cfg)
+    :_ctx(std::move(ctx)),_cfg(std::move(cfg)),_rnd(std::random_device()()) {
+    load_hosts();
+    if (_cfg.servers.empty()) load_resolv_conf();
+    if (_cfg.attempts == 0) _cfg.attempts = 1;
+}
+
+void Resolver::Impl::load_hosts() {
+    if (_cfg.hosts_file.empty()) return;
+    std::ifstream f(_cfg.hosts_file);
+    if (!f) return;
+    std::unordered_map<std::string, Entry> tmp;
+    std::string line;
+    while (std::getline(f, line)) {
+        auto cmt = line.find('#');
+        if (cmt != line.npos) line.resize(cmt);
+        std::istringstream ln(line);
+        std::string addr;
+        if (!(ln >> addr)) continue;
+        ResolvedAddress a;
+        if (!parse_numeric(addr, a)) continue;
+        std::string name;
+        while (ln >> name) {
+            Entry &e = tmp[normalize_name(name)];
+            e.addrs.push_back(a);
+            e.expires = TimePoint::max();
+        }
+    }
+    for (auto &[k,v]: tmp) _hosts.emplace(k, std::make_shared<const Entry>(std::move(v)));
+}
+
+void Resolver::Impl::load_resolv_conf() {
+    std::ifstream f(_cfg.resolv_conf);
+    std::string line;
+    while (f && std::getline(f, line)) {
+        std::istringstream ln(line);
+        std::string kw, addr;
+        if (!(ln >> kw >> addr) || kw != "nameserver") continue;
+        //strip zone index, it is not supported
+        auto zone = addr.find('%');
+        if (zone != addr.npos) addr.resize(zone);
+        ResolvedAddress a;
+        if (parse_numeric(addr, a)) _cfg.servers.push_back(make_peer(a, 53));
+    }
+    if (_cfg.servers.empty()) {
+        ResolvedAddress a;
+        parse_numeric("127.0.0.1", a);
+        _cfg.servers.push_back(make_peer(a, 53));
+    }
+}
+
+std::uint16_t Resolver::Impl::next_id() {
+    std::lock_guard _(_mx);
+    return static_cast<std::uint16_t>(_rnd());
+}
+
+void Resolver::Impl::clear_cache() {
+    std::lock_guard _(_mx);
+    _cache.clear();
+}
+
+cocls::future<Resolver::Impl::EntryPtr> Resolver::Impl::resolve(const std::string &host) {
+    return [&](cocls::promise<EntryPtr> p) {
+        auto h = _hosts.find(host);
+        if (h != _hosts.end()) {
+            p(h->second);
+            return;
+        }
+        std::unique_lock lk(_mx);
+        auto c = _cache.find(host);
+        if (c != _cache.end()) {
+            if (c->second->expires > _ctx.now()) {
+                EntryPtr e = c->second;
+                lk.unlock();
+                p(std::move(e));
+                return;
+            }
+            _cache.erase(c);
+        }
+        auto &waiting = _pending[host];
+        bool first = waiting.empty();
+        waiting.push_back(std::move(p));
+        lk.unlock();
+        //only first request sends the query, others just wait for the result
+        if (first) query(shared_from_this(), host).detach();
+    };
+}
+
+void Resolver::Impl::finish(const std::string &host, EntryPtr e) {
+    std::vector<cocls::promise<EntryPtr> > waiting;
+    {
+        std::lock_guard _(_mx);
+        //failures of the name servers are not cached
+        if (e->error != EAI_AGAIN) {
+            if (_cache.size() >= _cfg.max_cache_entries) {
+                auto now = _ctx.now();
+                std::erase_if(_cache, [&](const auto &x){return x.second->expires <= now;});
+                if (_cache.size() >= _cfg.max_cache_entries) _cache.clear();
+            }
+            _cache[host] = e;
+        }
+        auto iter = _pending.find(host);
+        if (iter != _pending.end()) {
+            waiting = std::move(iter->second);
+            _pending.erase(iter);
+        }
+    }
+    for (auto &p: waiting) p(e);
+}
+
+Resolver::Impl::EntryPtr Resolver::Impl::make_entry(int error, const std::vector<DnsAnswer> &answers) const {
+    auto e = std::make_shared<Entry>();
+    auto now = _ctx.now();
+    if (error) {
+        e->error = error;
+        e->expires = now;
+        return e;
+    }
+    std::uint32_t ttl = no_ttl;
+    std::uint32_t neg_ttl = no_ttl;
+    for (const auto &a: answers) {
+        if (!a.addrs.empty()) {
+            e->addrs.insert(e->addrs.end(), a.addrs.begin(), a.addrs.end());
+            ttl = std::min(ttl, a.ttl);
+        }
+        neg_ttl = std::min(neg_ttl, a.negative_ttl);
+    }
+    if (e->addrs.empty()) {
+        e->error = EAI_NONAME;
+        auto t = neg_ttl == no_ttl?_cfg.negative_ttl:std::chrono::seconds(neg_ttl);
+        e->expires = now + std::min(t, _cfg.max_ttl);
+    } else {
+        e->expires = now + std::min(std::chrono::seconds(ttl), _cfg.max_ttl);
+    }
+    return e;
+}
+
+cocls::async<void> Resolver::Impl::query(std::shared_ptr<Impl> me, std::string host) {
+    std::vector<std::uint16_t> types = {dns_type_a};
+    if (me->_cfg.ipv6) types.push_back(dns_type_aaaa);
+    std::vector<DnsAnswer> answers(types.size());
+    int error = EAI_AGAIN;
+    for (const PeerName &srv: me->_cfg.servers) {
+        for (unsigned int i = 0; i < me->_cfg.attempts && error == EAI_AGAIN; i++) {
+            error = co_await me->exchange(srv, host, types, answers);
+        }
+        if (error != EAI_AGAIN) break;
+    }
+    me->finish(host, me->make_entry(error, answers));
+}
+
+cocls::future<int> Resolver::Impl::exchange(const PeerName &server, const std::string &host,
+                            const std::vector<std::uint16_t> &types, std::vector<DnsAnswer> &answers) {
+    SocketHandle s = server.use_sockaddr([&](const sockaddr *sa, socklen_t len) {
+        int fd = ::socket(sa->sa_family, SOCK_DGRAM|SOCK_NONBLOCK|SOCK_CLOEXEC, 0);
+        if (fd >= 0 && ::connect(fd, sa, len) < 0) {
+            ::close(fd);
+            fd = -1;
+        }
+        return fd;
+    });
+    if (s < 0) co_return EAI_AGAIN;
+
+    std::vector<std::uint16_t> ids;
+    for (auto t: types) {
+        ids.push_back(next_id());
+        std::string q = build_query(ids.back(), host, t);
+        if (::send(s, q.data(), q.size(), 0) < 0) {
+            ::close(s);
+            co_return EAI_AGAIN;
+        }
+    }
+
+    std::vector<bool> received(types.size(), false);
+    std::size_t remain = types.size();
+    TimePoint deadline = _ctx.now() + _cfg.timeout;
+    int result = 0;
+    char buff[4096];
+    while (remain && result == 0) {
+        int r = ::recv(s, buff, sizeof(buff), 0);
+        if (r < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                WaitResult w = co_await _ctx.io_wait(s, AsyncOperation::read, deadline);
+                if (w != WaitResult::complete) result = EAI_AGAIN;
+            } else {
+                //ECONNREFUSED - no server is listening
+                result = EAI_AGAIN;
+            }
+            continue;
+        }
+        std::string_view msg(buff, r);
+        for (std::size_t i = 0; i < types.size(); i++) {
+            if (received[i]) continue;
+            DnsAnswer ans;
+            if (!parse_response(msg, ids[i], host, types[i], ans)) continue;
+            if (ans.rcode != 0 && ans.rcode != dns_rcode_nxdomain) {
+                //SERVFAIL, REFUSED, etc - try other server
+                result = EAI_AGAIN;
+            } else {
+                answers[i] = std::move(ans);
+                received[i] = true;
+                --remain;
+            }
+            break;
+        }
+    }
+    _ctx.close(s);
+    co_return result;
+}
+
+cocls::future<std::vector<PeerName> > Resolver::Impl::lookup(std::shared_ptr<Impl> me, std::string names, std::string def_port) {
+    std::vector<PeerName> list;
+    std::string_view name = names;
+    while (!name.empty()) {
+        std::string_view item;
+        auto sep = name.find(' ');
+        if (sep == name.npos) {
+            item = name;
+            name = {};
+        } else {
+            item = name.substr(0, sep);
+            name = name.substr(sep+1);
+        }
+        if (item.empty()) continue;
+
+        try {
+            auto [host, port] = PeerName::split_host_port(item, def_port);
+            if (item.compare(0, PeerName::unix_prefix.size(), PeerName::unix_prefix) == 0 || is_direct(host)) {
+                //no name server is needed
+                auto r = PeerName::lookup(item, def_port);
+                for (auto &x: r) list.push_back(std::move(x));
+                continue;
+            }
+            if (port.empty()) throw PeerName::PortIsRequiredException();
+            std::uint16_t portnum = parse_port(port);
+            std::string h = normalize_name(host);
+            if (!valid_hostname(h)) throw PeerName::LookupException(EAI_NONAME);
+            EntryPtr e = co_await me->resolve(h);
+            if (e->error) throw PeerName::LookupException(e->error);
+            for (const auto &a: e->addrs) list.push_back(make_peer(a, portnum));
+        } catch (...) {
+            list.push_back(PeerName::Error{std::current_exception()});
+        }
+    }
+    co_return PeerName::check_lookup_result(std::move(list));
+}
+
+Resolver::Resolver(AsyncSupport ctx):Resolver(std::move(ctx), Config()) {}
+
+Resolver::Resolver(AsyncSupport ctx, Config cfg)
+    :_impl(std::make_shared<Impl>(std::move(ctx), std::move(cfg))) {}
+
+cocls::future<std::vector<PeerName> > Resolver::lookup(std::string_view name, std::string_view def_port) {
+    return Impl::lookup(_impl, std::string(name), std::string(def_port));
+}
+
+void Resolver::clear_cache() {
+    _impl->clear_cache();
+}
+
+}
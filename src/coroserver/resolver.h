@@ -0,0 +1,97 @@
+/*
+ * resolver.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_RESOLVER_H_
+#define SRC_COROSERVER_RESOLVER_H_
+
+#include "async_support.h"
+#include "peername.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace coroserver {
+
+///Asynchronous DNS resolver with cache
+/**
+ * Resolves names without blocking any thread. Queries are sent over UDP to
+ * configured name servers and the answers are awaited through the reactor. The
+ * resolver reads the hosts file (once, during construction) and caches answers
+ * of the name servers respecting their TTL. Negative answers (NXDOMAIN, no data)
+ * are cached too. When multiple coroutines ask for the same name at the same
+ * time, only one query is sent and all of them receive its result.
+ *
+ * The object is a shared reference, copies share the cache. Don't store the
+ * resolver inside of objects owned by the context, because the resolver holds
+ * reference to the context.
+ *
+ * @note Resolver sends absolute names only, search domains are not applied. Truncated
+ * answers are not repeated over TCP, addresses from truncated answer are used as they are.
+ */
+class Resolver {
+public:
+
+    struct Config {
+        ///list of name servers. If empty, name servers are read from resolv_conf
+        std::vector<PeerName> servers;
+        ///path to hosts file. Set empty to skip hosts file
+        std::string hosts_file = "/etc/hosts";
+        ///path to resolv.conf, used when servers are not specified
+        std::string resolv_conf = "/etc/resolv.conf";
+        ///timeout of single attempt
+        std::chrono::milliseconds timeout = std::chrono::milliseconds(2000);
+        ///count of attempts per server
+        unsigned int attempts = 2;
+        ///also ask for IPv6 addresses (AAAA)
+        bool ipv6 = true;
+        ///maximum time to cache positive answer
+        std::chrono::seconds max_ttl = std::chrono::seconds(3600);
+        ///time to cache negative answer, when the server doesn't specify it
+        std::chrono::seconds negative_ttl = std::chrono::seconds(30);
+        ///maximum count of cached names
+        std::size_t max_cache_entries = 10000;
+    };
+
+    ///Construct resolver with default configuration
+    /**
+     * @param ctx context used to perform asynchronous operations
+     */
+    explicit Resolver(AsyncSupport ctx);
+
+    ///Construct resolver
+    /**
+     * @param ctx context used to perform asynchronous operations
+     * @param cfg configuration
+     */
+    Resolver(AsyncSupport ctx, Config cfg);
+
+    ///Lookup for peer (asynchronous)
+    /**
+     * Has same semantics as PeerName::lookup(). Numeric addresses, unix sockets
+     * and special names ("localhost", "*", "0") are resolved directly, other
+     * names are resolved through the hosts file, the cache and the name servers
+     *
+     * @param name name to resolve. It can contain multiple names separated by space
+     * @param def_port default port, if not specified in the name
+     * @return future with list of peers
+     * @exception LookupException name was not found
+     */
+    cocls::future<std::vector<PeerName> > lookup(std::string_view name, std::string_view def_port = {});
+
+    ///Clear the cache
+    void clear_cache();
+
+protected:
+    class Impl;
+    std::shared_ptr<Impl> _impl;
+};
+
+}
+
+#endif /* SRC_COROSERVER_RESOLVER_H_ */
@@ -0,0 +1,267 @@
+/*
+ * route_trie.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_ROUTE_TRIE_H_
+#define SRC_COROSERVER_ROUTE_TRIE_H_
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace coroserver {
+
+///Maximum count of parameters of a route
+constexpr std::size_t max_route_params = 8;
+
+///Parameter extracted from the path
+struct RouteParam {
+    std::string_view name;
+    std::string_view value;
+};
+
+///Compressed radix trie of routes
+/**
+ * @tparam T type of value associated with the route
+ *
+ * The route is a prefix of the path. It can contain parameters
+ *
+ * - {name} - matches non-empty segment of the path (up to next /), it must be followed by / or be last part of the route
+ * - {name*} - matches rest of the path (can be empty), it must be last part of the route
+ *
+ * Lookup walks the path once, it returns all routes which match a prefix of the path.
+ * Values of parameters are returned as string_views to the searched path, nothing
+ * is allocated
+ */
+template<typename T>
+class RouteTrie {
+public:
+
+    ///Maximum count of results returned by find()
+    static constexpr std::size_t max_results = 10;
+
+    struct Value {
+        ///route as it was inserted
+        std::string path;
+        ///names of parameters
+        std::vector<std::string> params;
+        T payload;
+    };
+
+    ///Route matching the path
+    struct Match {
+        const Value *value;
+        ///length of matching part of the path
+        std::size_t length;
+        ///values of parameters, in order of value->params
+        std::array<std::string_view, max_route_params> args;
+
+        std::size_t param_count() const {return value->params.size();}
+        RouteParam param(std::size_t idx) const {return {value->params[idx], args[idx]};}
+    };
+
+    ///Contains result
+    /** Can contain up 10 matches. It is sorted from the least specific to the most specific,
+     * so it can be used as stack, where top item is the most specific match. Longer match
+     * is more specific, in case of the same length, the match with less parameters is
+     * more specific. If there are more matches, the least specific are dropped
+     */
+    struct Result {
+        //not initialized, only first _count items are valid
+        union {
+            Match _nodes[max_results];
+        };
+        std::size_t _count = 0;
+        Result() {}
+        auto begin() const {return _nodes;}
+        auto end() const {return _nodes + _count;}
+        void push(const Value &v, std::size_t length, const std::array<std::string_view, max_route_params> &args) {
+            std::size_t pos = 0;
+            while (pos < _count && less(_nodes[pos], v, length)) ++pos;
+            if (_count == max_results) {
+                if (pos == 0) return;
+                std::move(_nodes+1, _nodes+pos, _nodes);
+                --pos;
+            } else {
+                std::move_backward(_nodes+pos, _nodes+_count, _nodes+_count+1);
+                ++_count;
+            }
+            Match &m = _nodes[pos];
+            m.value = &v;
+            m.length = length;
+            std::copy_n(args.begin(), v.params.size(), m.args.begin());
+        }
+        bool empty() const {return _count == 0;}
+        const Match &top() const {return _nodes[_count-1];}
+        void pop() {
+            --_count;
+        }
+        std::size_t size() const {return _count;}
+
+        static bool less(const Match &m, const Value &v, std::size_t length) {
+            return m.length < length || (m.length == length && m.value->params.size() > v.params.size());
+        }
+    };
+
+    RouteTrie() = default;
+    RouteTrie(RouteTrie &&) = default;
+    RouteTrie &operator=(RouteTrie &&) = default;
+    ///Copy the trie, the values are copied
+    RouteTrie(const RouteTrie &other):_root(clone(other._root)) {}
+    RouteTrie &operator=(const RouteTrie &other) {
+        if (this != &other) _root = clone(other._root);
+        return *this;
+    }
+
+    ///Insert route
+    /**
+     * @param route route
+     * @return reference to the value associated with the route. If the route already
+     * exists, returns the existing value, otherwise new value is default constructed.
+     * Routes which differ only by names of parameters share the value, the names
+     * of the first inserted route are kept. They are never changed, because results
+     * of previous lookups can still refer them
+     *
+     * @exception std::invalid_argument invalid route
+     */
+    T &insert(std::string_view route) {
+        Node *n = &_root;
+        std::vector<std::string> params;
+        std::string_view p = route;
+        while (!p.empty()) {
+            auto b = p.find('{');
+            n = insert_literal(n, p.substr(0, b));
+            if (b == p.npos) break;
+            auto e = p.find('}', b);
+            if (e == p.npos) throw std::invalid_argument("Route parameter is not terminated");
+            if (params.size() == max_route_params) throw std::invalid_argument("Too many route parameters");
+            std::string_view name = p.substr(b+1, e-b-1);
+            p = p.substr(e+1);
+            if (!name.empty() && name.back() == '*') {
+                if (!p.empty()) throw std::invalid_argument("Wildcard must be last part of the route");
+                name.remove_suffix(1);
+                if (name.empty()) throw std::invalid_argument("Route parameter has no name");
+                n = get_child(n->wildcard);
+            } else {
+                if (name.empty()) throw std::invalid_argument("Route parameter has no name");
+                if (!p.empty() && p.front() != '/') throw std::invalid_argument("Route parameter must be followed by '/'");
+                n = get_child(n->param);
+            }
+            params.emplace_back(name);
+        }
+        if (!n->value) {
+            n->value = std::make_unique<Value>(Value{std::string(route), std::move(params), T()});
+        }
+        return n->value->payload;
+    }
+
+    ///Search routes matching the path
+    /**
+     * @param path path
+     * @return up to 10 matching routes
+     */
+    Result find(std::string_view path) const {
+        Result res;
+        std::array<std::string_view, max_route_params> args;
+        search(&_root, path, 0, args, 0, res);
+        return res;
+    }
+
+protected:
+
+    struct Node {
+        ///text of the edge leading to this node
+        std::string label;
+        ///first characters of labels of static children
+        std::string first;
+        std::vector<std::unique_ptr<Node> > children;
+        ///child after {name}
+        std::unique_ptr<Node> param;
+        ///child after {name*}
+        std::unique_ptr<Node> wildcard;
+        std::unique_ptr<Value> value;
+    };
+
+    Node _root;
+
+    static Node clone(const Node &n) {
+        Node r;
+        r.label = n.label;
+        r.first = n.first;
+        r.children.reserve(n.children.size());
+        for (const auto &c: n.children) r.children.push_back(std::make_unique<Node>(clone(*c)));
+        if (n.param) r.param = std::make_unique<Node>(clone(*n.param));
+        if (n.wildcard) r.wildcard = std::make_unique<Node>(clone(*n.wildcard));
+        if (n.value) r.value = std::make_unique<Value>(*n.value);
+        return r;
+    }
+
+    static Node *get_child(std::unique_ptr<Node> &ptr) {
+        if (!ptr) ptr = std::make_unique<Node>();
+        return ptr.get();
+    }
+
+    static Node *insert_literal(Node *n, std::string_view text) {
+        while (!text.empty()) {
+            auto idx = n->first.find(text.front());
+            if (idx == n->first.npos) {
+                auto c = std::make_unique<Node>();
+                c->label = std::string(text);
+                n->first.push_back(text.front());
+                n->children.push_back(std::move(c));
+                return n->children.back().get();
+            }
+            Node *c = n->children[idx].get();
+            std::size_t common = 1;
+            std::size_t len = std::min(text.size(), c->label.size());
+            while (common < len && text[common] == c->label[common]) ++common;
+            if (common < c->label.size()) {
+                //split the edge
+                auto mid = std::make_unique<Node>();
+                mid->label = c->label.substr(0, common);
+                c->label.erase(0, common);
+                mid->first.push_back(c->label.front());
+                mid->children.push_back(std::move(n->children[idx]));
+                n->children[idx] = std::move(mid);
+                c = n->children[idx].get();
+            }
+            text.remove_prefix(common);
+            n = c;
+        }
+        return n;
+    }
+
+    static void search(const Node *n, std::string_view path, std::size_t pos,
+                       std::array<std::string_view, max_route_params> &args, std::size_t nargs, Result &res) {
+        while (n) {
+            if (n->value) res.push(*n->value, pos, args);
+            if (n->wildcard && n->wildcard->value) {
+                args[nargs] = path.substr(pos);
+                res.push(*n->wildcard->value, path.size(), args);
+            }
+            if (pos == path.size()) break;
+            if (n->param) {
+                std::size_t e = std::min(path.find('/', pos), path.size());
+                if (e > pos) {
+                    args[nargs] = path.substr(pos, e - pos);
+                    search(n->param.get(), path, e, args, nargs+1, res);
+                }
+            }
+            auto idx = n->first.find(path[pos]);
+            if (idx == n->first.npos) break;
+            n = n->children[idx].get();
+            if (path.compare(pos, n->label.size(), n->label) != 0) break;
+            pos += n->label.size();
+        }
+    }
+
+};
+
+}
+
+#endif /* SRC_COROSERVER_ROUTE_TRIE_H_ */
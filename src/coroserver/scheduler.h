@@ -9,8 +9,10 @@
 #define SRC_USERVER_SCHEDULER_H_
 
 #include "ipoller.h"
+#include "timer_heap.h"
 
 #include <optional>
+#include <unordered_map>
 #include <variant>
 
 namespace coroserver {
@@ -21,70 +23,69 @@ class Scheduler {
 public:
 
     ///timeout wait, use poller as scheduler
-    void schedule(const void *ident, Promise p, std::chrono::system_clock::time_point timeout);
+    void schedule(const void *ident, Promise p, TimePoint timeout);
 
     ///cancels specified timer
     std::optional<Promise> cancel_schedule(const void *ident);
 
-    std::variant<Promise, std::chrono::system_clock::time_point> check_expired(std::chrono::system_clock::time_point now);
+    ///count of scheduled timers
+    std::size_t size() const {return _scheduled.size();}
+
+    std::variant<Promise, TimePoint> check_expired(TimePoint now);
 
 protected:
 
     struct SchItem {
-        std::chrono::system_clock::time_point _tp;
         Promise _p;
         const void *_ident;
     };
 
-    using SchVector = std::vector<SchItem>;
-    SchVector _scheduled;
+    using Heap = TimerHeap<SchItem>;
+    using IdentMap = std::unordered_multimap<const void *, typename Heap::Handle>;
 
-    static bool compare_item(const SchItem &a, const SchItem &b) {
-        return a._tp > b._tp;
-    }
+    Heap _scheduled;
+    IdentMap _idents;
 
-    void pop_item();
+    void erase_ident(const void *ident, typename Heap::Handle h);
 
 };
 
 template<typename Promise>
 inline void Scheduler<Promise>::schedule(const void *ident, Promise p,
-        std::chrono::system_clock::time_point timeout) {
-    _scheduled.push_back({timeout, std::move(p), ident});
-    std::push_heap(_scheduled.begin(), _scheduled.end(), compare_item);
+        TimePoint timeout) {
+    auto h = _scheduled.insert(timeout, {std::move(p), ident});
+    _idents.emplace(ident, h);
 }
 
 template<typename Promise>
 inline std::optional<Promise> Scheduler<Promise>::cancel_schedule(const void *ident) {
-    while (_scheduled.empty() && _scheduled[0]._ident == ident) {
-        auto p = std::move(_scheduled[0]._p);
-        pop_item();
-        if (p) return p;
-    }
-    for (SchItem &item: _scheduled) {
-        if (item._ident == ident) {
-            auto p = std::move(item._p);
-            if (p) return p;
-        }
-    }
-    return {};
+    auto iter = _idents.find(ident);
+    if (iter == _idents.end()) return {};
+    auto h = iter->second;
+    _idents.erase(iter);
+    return std::move(_scheduled.remove(h)._p);
 }
 
 template<typename Promise>
-inline void Scheduler<Promise>::pop_item() {
-    std::pop_heap(_scheduled.begin(), _scheduled.end(), compare_item);
-    _scheduled.pop_back();
+inline void Scheduler<Promise>::erase_ident(const void *ident, typename Heap::Handle h) {
+    auto rng = _idents.equal_range(ident);
+    for (auto iter = rng.first; iter != rng.second; ++iter) {
+        if (iter->second == h) {
+            _idents.erase(iter);
+            return;
+        }
+    }
 }
 
 template<typename Promise>
-inline std::variant<Promise, std::chrono::system_clock::time_point> Scheduler<Promise>::check_expired(std::chrono::system_clock::time_point now) {
-    while (!_scheduled.empty() && (_scheduled[0]._tp <= now || !_scheduled[0]._p)) {
-        auto p = std::move(_scheduled[0]._p);
-        pop_item();
+inline std::variant<Promise, TimePoint> Scheduler<Promise>::check_expired(TimePoint now) {
+    while (_scheduled.top_time() <= now) {
+        auto h = _scheduled.top();
+        erase_ident(_scheduled[h]._ident, h);
+        auto p = std::move(_scheduled.pop()._p);
         if (p) return p;
     }
-    if (_scheduled.empty()) return std::chrono::system_clock::time_point::max();
-    else return _scheduled[0]._tp;
+    return _scheduled.top_time();
 }
 
 
@@ -0,0 +1,54 @@
+/*
+ * socket_options.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_SOCKET_OPTIONS_H_
+#define SRC_COROSERVER_SOCKET_OPTIONS_H_
+
+#include <cstddef>
+
+namespace coroserver {
+
+///Options applied on newly created sockets
+/**
+ * Options of listening socket are inherited by accepted connections (buffers,
+ * keepalive, nodelay, etc). TCP options are ignored for non-TCP sockets.
+ * Value 0 means, that system default is used
+ */
+struct SocketOptions {
+    ///backlog of listening socket (0 = SOMAXCONN)
+    int backlog = 0;
+    ///set SO_REUSEADDR on listening socket
+    bool reuse_addr = true;
+    ///set IPV6_V6ONLY on IPv6 listening socket
+    bool v6only = true;
+    ///set TCP_NODELAY
+    bool nodelay = true;
+    ///size of receive buffer (SO_RCVBUF)
+    int rcvbuf = 0;
+    ///size of send buffer (SO_SNDBUF)
+    int sndbuf = 0;
+    ///limit of unsent data in send buffer (TCP_NOTSENT_LOWAT)
+    int notsent_lowat = 0;
+    ///listener: wake up only when data arrive, seconds (TCP_DEFER_ACCEPT)
+    int defer_accept = 0;
+    ///listener: length of queue of TCP Fast Open requests (TCP_FASTOPEN).
+    ///connection: any nonzero value enables Fast Open (TCP_FASTOPEN_CONNECT)
+    int fastopen = 0;
+    ///enable keepalive (SO_KEEPALIVE)
+    bool keepalive = false;
+    ///seconds of idle before first keepalive probe (TCP_KEEPIDLE)
+    int keepalive_idle = 0;
+    ///seconds between keepalive probes (TCP_KEEPINTVL)
+    int keepalive_interval = 0;
+    ///count of probes before the connection is dropped (TCP_KEEPCNT)
+    int keepalive_count = 0;
+    ///writes of this size and larger are sent with MSG_ZEROCOPY (0 = disabled)
+    std::size_t zerocopy_threshold = 0;
+};
+
+}
+
+#endif /* SRC_COROSERVER_SOCKET_OPTIONS_H_ */
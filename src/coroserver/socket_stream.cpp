@@ -1,7 +1,12 @@
 #include "socket_stream.h"
 #include "io_context.h"
 
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <cstring>
 namespace coroserver {
 
 
@@ -10,20 +15,78 @@ SocketStream::SocketStream(AsyncSupport context, SocketHandle h, PeerName peer,
 ,_ctx(std::move(context))
 ,_h(h)
 ,_peer(std::move(peer))
-,_reader(start_read())
-,_writer(start_write())
+,_completion(_ctx.completion_io())
+,_arena(_ctx.create_coro_arena())
+,_reader(start_read(_arena))
+,_writer(start_write(_arena))
 {
 
 }
 
 SocketStream::~SocketStream() {
     _ctx.close(_h);
+    _ctx.release_buffer(_borrowed_buffer);
 }
-cocls::generator<std::string_view> SocketStream::start_read() {
+cocls::with_allocator<CoroArena, cocls::generator<std::string_view> > SocketStream::start_read(CoroArena &) {
     while (true) {
         std::string_view data;
+        //previous data has been processed, return the buffer
+        if (_borrowed_buffer >= 0) {
+            _ctx.release_buffer(std::exchange(_borrowed_buffer, -1));
+        }
+        _read_buffer.release();
+        bool use_completion = _completion;
+        //unless more data are expected (previous read was full or nothing was
+        //read yet), wait for readiness first, so idle connection doesn't hold a buffer
+        bool wait_first = !_last_read_full && _cntr.read;
         while (!_is_eof && data.empty()) {
-            _read_buffer.resize(_new_buffer_size);
+            if (use_completion) {
+                IOResult r = co_await _ctx.io_read(_h, _new_buffer_size,
+                        _tms.from_duration(_ctx.now(), _tms.read_timeout_ms));
+                switch (r.state) {
+                    case WaitResult::complete:
+                        if (r.result == 0) {
+                            _is_eof = true;
+                        } else {
+                            _cntr.read+=r.result;
+                            data = r.data;
+                            _borrowed_buffer = r.buffer_id;
+                        }
+                        break;
+                    case WaitResult::closed:
+                        _is_eof = true;
+                        break;
+                    case WaitResult::timeout:
+                        _is_timeout = true;
+                        co_yield std::string_view();
+                        _is_timeout = false;
+                        break;
+                    default:
+                        //no free buffer in the context, read to own buffer
+                        if (r.result == ENOBUFS) use_completion = false;
+                        else throw std::system_error(r.result, std::system_category(), "recv()");
+                        break;
+                }
+                continue;
+            }
+            if (wait_first) {
+                wait_first = false;
+                WaitResult w = co_await _ctx.io_wait(_h,AsyncOperation::read,
+                        _tms.from_duration(_ctx.now(), _tms.read_timeout_ms));
+                switch (w) {
+                    case WaitResult::closed:
+                        _is_eof = true;
+                        break;
+                    case WaitResult::timeout:
+                        _is_timeout = true;
+                        co_yield std::string_view();
+                        _is_timeout = false;
+                    default:
+                        break;
+                }
+                continue;
+            }
+            if (_read_buffer.empty()) _read_buffer = _ctx.get_buffer_pool().get(_new_buffer_size);
             int r = ::recv(_h, _read_buffer.data(), _read_buffer.size(), MSG_DONTWAIT|MSG_NOSIGNAL);
             if (r > 0) {
                 _cntr.read+=r;
@@ -32,6 +95,9 @@ cocls::generator<std::string_view> SocketStream::start_read() {
                 bool was_full = sz == _read_buffer.size();
                 if (_last_read_full) {
                     _new_buffer_size = _last_read_full+r;
+                } else if (sz < _read_buffer.size() / 4) {
+                    //buffer is too large for this connection, shrink it
+                    _new_buffer_size = std::max<std::size_t>(_new_buffer_size / 2, 1);
                 }
                 _last_read_full = was_full?_read_buffer.size():0;
 
@@ -41,19 +107,8 @@ cocls::generator<std::string_view> SocketStream::start_read() {
                 int err = errno;
                 if (err == EWOULDBLOCK || err == EAGAIN) {
                     _last_read_full = 0;
-                    WaitResult w = co_await _ctx.io_wait(_h,AsyncOperation::read,
-                            _tms.from_duration(_tms.read_timeout_ms));
-                    switch (w) {
-                        case WaitResult::closed:
-                            _is_eof = true;
-                            break;
-                        case WaitResult::timeout:
-                            _is_timeout = true;
-                            co_yield std::string_view();
-                            _is_timeout = false;
-                        default:
-                            break;
-                    }
+                    _read_buffer.release();
+                    wait_first = true;
                 } else {
                     throw std::system_error(err, std::system_category(), "recv()");
                 }
@@ -72,15 +127,17 @@ cocls::future<std::string_view> SocketStream::read() {
 std::string_view SocketStream::read_nb() {
     auto buff = read_putback_buffer();
     if (!buff.empty() || _is_eof) return buff;
+    if (_read_buffer.empty()) _read_buffer = _ctx.get_buffer_pool().get(_new_buffer_size);
     int r = ::recv(_h, _read_buffer.data(), _read_buffer.size(), MSG_DONTWAIT|MSG_NOSIGNAL);
-    if (r >= 0) {
-        _is_eof = r == 0;
+    if (r > 0) {
         _cntr.read+=r;
         buff = std::string_view(_read_buffer.data(), r);
         return buff;
     } else {
         int err = errno;
-        if (err == EWOULDBLOCK || err == EAGAIN) {
+        _read_buffer.release();
+        _is_eof = r == 0;
+        if (_is_eof || err == EWOULDBLOCK || err == EAGAIN) {
             return buff;
         } else {
             throw std::system_error(err, std::system_category(), "recv()");
@@ -93,8 +150,12 @@ bool SocketStream::is_read_timeout() const {
 }
 
 cocls::future<bool> SocketStream::write(std::string_view buffer) {
+    return write(std::span<const std::string_view>(&buffer, 1));
+}
+
+cocls::future<bool> SocketStream::write(std::span<const std::string_view> buffers) {
     if (_writer.done()) return cocls::future<bool>::set_value(false);
-    return [&]{return _writer(buffer);};
+    return [&]{return _writer(buffers);};
 }
 
 cocls::future<bool> SocketStream::write_eof() {
@@ -111,20 +172,65 @@ cocls::suspend_point<void> SocketStream::shutdown() {
     return _ctx.mark_closing(_h);
 }
 
-cocls::generator<bool, std::string_view> SocketStream::start_write() {
-    std::string_view buff = co_yield nullptr;
+cocls::with_allocator<CoroArena, cocls::generator<bool, std::span<const std::string_view> > > SocketStream::start_write(CoroArena &) {
+    std::span<const std::string_view> buffers = co_yield nullptr;
     while (true) {
-        while (!_is_closed && !buff.empty()) {
-            int r = ::send(_h, buff.data(), buff.size(), MSG_DONTWAIT|MSG_NOSIGNAL);
+        //copy the list, caller can release it
+        _write_vector.assign(buffers);
+        //completion mode: multiple buffers are sent by sendmsg first,
+        //the remaining data are sent through the context
+        bool try_sendmsg = _write_vector.count() > 1;
+        bool zerocopy = false;
+        if (_zerocopy_threshold) {
+            std::size_t total = 0;
+            for (const auto &b: buffers) total += b.size();
+            zerocopy = total >= _zerocopy_threshold;
+        }
+        while (!_is_closed && !_write_vector.empty()) {
+            if (_completion && !try_sendmsg && !zerocopy) {
+                IOResult r = co_await _ctx.io_write(_h, _write_vector.front(),
+                        _tms.from_duration(_ctx.now(), _tms.write_timeout_ms));
+                switch (r.state) {
+                    case WaitResult::complete:
+                        _cntr.write+=r.result;
+                        _write_vector.consume(r.result);
+                        _is_closed = r.result == 0;
+                        break;
+                    case WaitResult::error:
+                        if (r.result != EPIPE) {
+                            throw std::system_error(r.result, std::system_category(), "send()");
+                        }
+                        [[fallthrough]];
+                    default:
+                        _is_closed = true;
+                        break;
+                }
+                continue;
+            }
+            try_sendmsg = false;
+            msghdr msg = {};
+            msg.msg_iov = const_cast<iovec *>(_write_vector.data());
+            msg.msg_iovlen = _write_vector.count();
+            int r = ::sendmsg(_h, &msg, MSG_DONTWAIT|MSG_NOSIGNAL|(zerocopy?MSG_ZEROCOPY:0)|(_cork?MSG_MORE:0));
+            _more_pending = _cork;
             if (r >= 0) {
+                //each successful zero copy send is confirmed separately
+                if (zerocopy) ++_zerocopy_pending;
                 _cntr.write+=r;
-                buff = buff.substr(r);
+                _write_vector.consume(r);
                 _is_closed = r == 0;
             } else {
                 int err = errno;
-                if (err == EWOULDBLOCK || err == EAGAIN) {
+                if (zerocopy && err == ENOBUFS) {
+                    //limit of locked pages reached, copy the rest
+                    zerocopy = false;
+                } else if (_completion && !zerocopy && (err == EWOULDBLOCK || err == EAGAIN)) {
+                    continue;
+                } else if (err == EWOULDBLOCK || err == EAGAIN) {
+                    //drain confirmations, so error queue doesn't wake the poller
+                    while (_zerocopy_pending && read_zerocopy_completions());
                     WaitResult w = co_await _ctx.io_wait(_h, AsyncOperation::write,
-                            _tms.from_duration(_tms.write_timeout_ms));
+                            _tms.from_duration(_ctx.now(), _tms.write_timeout_ms));
                     switch(w) {
                         case WaitResult::timeout:
                         case WaitResult::closed:
@@ -136,12 +242,115 @@ cocls::generator<bool, std::string_view> SocketStream::start_write() {
                 } else if (err == EPIPE) {
                     _is_closed = true;
                 } else {
-                    throw std::system_error(err, std::system_category(), "send()");
+                    throw std::system_error(err, std::system_category(), "sendmsg()");
                 }
             }
         }
-        buff = co_yield !_is_closed;
+        //caller can release the data after the kernel confirms zero copy sends
+        while (_zerocopy_pending && !_is_closed) {
+            if (!read_zerocopy_completions()) {
+                WaitResult w = co_await _ctx.io_wait(_h, AsyncOperation::errqueue,
+                        _tms.from_duration(_ctx.now(), _tms.write_timeout_ms));
+                switch(w) {
+                    case WaitResult::timeout:
+                    case WaitResult::closed:
+                        _is_closed = true;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+        buffers = co_yield !_is_closed;
+    }
+}
+
+cocls::future<bool> SocketStream::write_file(int fd, std::uint64_t offset, std::uint64_t count) {
+    return write_file_coro(_arena, fd, offset, count);
+}
+
+cocls::with_allocator<CoroArena, cocls::async<bool> > SocketStream::write_file_coro(CoroArena &, int fd, std::uint64_t offset, std::uint64_t count) {
+    //limit of single sendfile call, so the counters are updated continuously
+    constexpr std::uint64_t max_chunk = 1<<30;
+    off_t off = static_cast<off_t>(offset);
+    while (!_is_closed && count) {
+        ssize_t r = ::sendfile(_h, fd, &off, std::min(count, max_chunk));
+        if (r > 0) {
+            _cntr.write+=r;
+            count -= r;
+        } else if (r == 0) {
+            //end of file reached
+            co_return false;
+        } else {
+            int err = errno;
+            if (err == EWOULDBLOCK || err == EAGAIN) {
+                WaitResult w = co_await _ctx.io_wait(_h, AsyncOperation::write,
+                        _tms.from_duration(_ctx.now(), _tms.write_timeout_ms));
+                switch(w) {
+                    case WaitResult::timeout:
+                    case WaitResult::closed:
+                        _is_closed = true;
+                        break;
+                    default:
+                        break;
+                }
+            } else if (err == EPIPE) {
+                _is_closed = true;
+            } else {
+                throw std::system_error(err, std::system_category(), "sendfile()");
+            }
+        }
+    }
+    co_return !_is_closed;
+}
+
+bool SocketStream::enable_zerocopy(std::size_t threshold) {
+    if (threshold) {
+        int one = 1;
+        if (::setsockopt(_h, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) < 0) return false;
+    }
+    _zerocopy_threshold = threshold;
+    return true;
+}
+
+void SocketStream::set_cork(bool enable) {
+    if (_cork == enable) return;
+    _cork = enable;
+    if (_completion) {
+        //completion writes can't carry MSG_MORE
+        int v = enable?1:0;
+        ::setsockopt(_h, IPPROTO_TCP, TCP_CORK, &v, sizeof(v));
+    } else if (!enable && std::exchange(_more_pending, false)) {
+        //push data held by the last MSG_MORE
+        int v = 0;
+        ::setsockopt(_h, IPPROTO_TCP, TCP_CORK, &v, sizeof(v));
+    }
+}
+
+bool SocketStream::read_zerocopy_completions() {
+    char control[128];
+    msghdr msg = {};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    int r = ::recvmsg(_h, &msg, MSG_ERRQUEUE|MSG_DONTWAIT);
+    if (r < 0) {
+        int err = errno;
+        if (err == EWOULDBLOCK || err == EAGAIN) return false;
+        throw std::system_error(err, std::system_category(), "recvmsg(MSG_ERRQUEUE)");
+    }
+    for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+        if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+                || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))) continue;
+        sock_extended_err serr;
+        std::memcpy(&serr, CMSG_DATA(cm), sizeof(serr));
+        if (serr.ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr.ee_errno != 0) continue;
+        //notification contains range of confirmed sends
+        std::uint32_t cnt = serr.ee_data - serr.ee_info + 1;
+        _zerocopy_pending -= std::min(cnt, _zerocopy_pending);
+        //the kernel had to copy the data, zero copy has no benefit
+        if (serr.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) _zerocopy_threshold = 0;
     }
+    return true;
 }
 
 SocketStream::Counters SocketStream::get_counters() const noexcept {
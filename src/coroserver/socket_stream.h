@@ -10,8 +10,12 @@
 
 #include "async_support.h"
 #include "defs.h"
+#include "descriptor_stream.h"
+#include "io_vector.h"
 #include "stream.h"
+#include <cocls/async.h>
 #include <cocls/generator.h>
+#include <cocls/with_allocator.h>
 
 namespace coroserver {
 
@@ -19,7 +23,7 @@ class ContextIOImpl;
 
 
 
-class SocketStream: public AbstractStreamWithMetadata {
+class SocketStream: public AbstractStreamWithMetadata, public IDescriptorStream {
 public:
     SocketStream(AsyncSupport context, SocketHandle h, PeerName peer, TimeoutSettings tms);
     ~SocketStream();
@@ -27,30 +31,94 @@ public:
     virtual std::string_view read_nb() override;
     virtual bool is_read_timeout() const override;
     virtual cocls::future<bool> write(std::string_view buffer) override;
+    virtual cocls::future<bool> write(std::span<const std::string_view> buffers) override;
     virtual cocls::future<bool> write_eof() override;
     virtual cocls::suspend_point<void> shutdown() override;
     virtual Counters get_counters() const noexcept override;
     virtual PeerName get_peer_name() const override;
 
+    ///Writes content of the file directly to the socket (sendfile)
+    /**
+     * The data are not copied to the user space. The function must not be
+     * called while other write is pending
+     *
+     * @param fd file descriptor of the file
+     * @param offset offset in the file
+     * @param count count of bytes to write
+     * @retval true success
+     * @retval false failed, connection closed or timeouted, or the file is shorter
+     */
+    cocls::future<bool> write_file(int fd, std::uint64_t offset, std::uint64_t count);
+
+    ///Enables zero copy transmit mode (MSG_ZEROCOPY)
+    /**
+     * Writes larger than threshold are sent without copying the data to the kernel.
+     * The write is resolved after the kernel reports, that it no longer needs
+     * the data. If the kernel reports, that the data had to be copied anyway
+     * (for example loopback), zero copy mode is disabled
+     *
+     * @param threshold minimal size of the write. Set 0 to disable
+     * @retval true enabled
+     * @retval false not supported
+     */
+    bool enable_zerocopy(std::size_t threshold);
+
+    ///Hint, that more data will follow (corking)
+    /**
+     * While enabled, writes are sent with MSG_MORE (TCP_CORK in completion mode),
+     * so the kernel doesn't send partially filled segments. Disabling pushes
+     * data which are pending in the kernel
+     *
+     * @param enable true to enable, false to disable
+     */
+    void set_cork(bool enable);
+
+    virtual int get_read_fd() const override {return _h;}
+    virtual int get_write_fd() const override {return _h;}
+    virtual AsyncSupport get_context() const override {return _ctx;}
+    virtual void add_counters(std::size_t read, std::size_t write) override {
+        _cntr.read += read;
+        _cntr.write += write;
+    }
+    virtual CoroArena get_coro_arena() const override {return _arena;}
+
 protected:
     AsyncSupport _ctx;
     SocketHandle _h;
     Counters _cntr;
     PeerName _peer;
+    ///context supports completion based I/O
+    bool _completion;
+    ///arena for coroutine frames of the connection, must be initialized before generators
+    CoroArena _arena;
     cocls::generator<std::string_view> _reader;
-    cocls::generator<bool, std::string_view> _writer; //writer
+    cocls::generator<bool, std::span<const std::string_view> > _writer; //writer
+    IOVector _write_vector;
 
-    std::vector<char> _read_buffer;
+    ///read buffer borrowed from the pool, held only while the data are processed
+    BufferPool::Buffer _read_buffer;
     bool _is_timeout = false;
     bool _is_eof = false;
     bool _is_closed = false;
     std::size_t _last_read_full = 0;
     std::size_t _new_buffer_size = 1024;
+    ///id of buffer borrowed from the context, -1 if none
+    int _borrowed_buffer = -1;
+    ///minimal size of write sent with MSG_ZEROCOPY (0 - disabled)
+    std::size_t _zerocopy_threshold = 0;
+    ///count of zero copy sends not yet confirmed by the kernel
+    std::uint32_t _zerocopy_pending = 0;
+    ///writes are sent with MSG_MORE
+    bool _cork = false;
+    ///last write was sent with MSG_MORE, data can be pending in the kernel
+    bool _more_pending = false;
 
 
 
-    cocls::generator<std::string_view> start_read();
-    cocls::generator<bool, std::string_view> start_write();
+    cocls::with_allocator<CoroArena, cocls::generator<std::string_view> > start_read(CoroArena &);
+    cocls::with_allocator<CoroArena, cocls::generator<bool, std::span<const std::string_view> > > start_write(CoroArena &);
+    cocls::with_allocator<CoroArena, cocls::async<bool> > write_file_coro(CoroArena &, int fd, std::uint64_t offset, std::uint64_t count);
+    bool read_zerocopy_completions();
 };
 
 }
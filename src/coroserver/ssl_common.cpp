@@ -133,6 +133,29 @@ void Context::set_certificate(const Certificate &cert) {
     }
 }
 
+//protocols in wire format (length prefixed)
+static constexpr unsigned char alpn_http2[] = {2,'h','2',8,'h','t','t','p','/','1','.','1'};
+static constexpr unsigned char alpn_http1[] = {8,'h','t','t','p','/','1','.','1'};
+
+template<const unsigned char *protos, unsigned int protos_len>
+static int alpn_select(SSL *, const unsigned char **out, unsigned char *outlen,
+                       const unsigned char *in, unsigned int inlen, void *) {
+    unsigned char *sel;
+    if (SSL_select_next_proto(&sel, outlen, in, inlen, protos, protos_len) != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    *out = sel;
+    return SSL_TLSEXT_ERR_OK;
+}
+
+void Context::set_alpn_http(bool http2) {
+    if (http2) {
+        SSL_CTX_set_alpn_select_cb(*this, alpn_select<alpn_http2, sizeof(alpn_http2)>, nullptr);
+    } else {
+        SSL_CTX_set_alpn_select_cb(*this, alpn_select<alpn_http1, sizeof(alpn_http1)>, nullptr);
+    }
+}
+
 
 }
 }
@@ -155,6 +155,16 @@ namespace ssl {
          */
         void set_certificate(const Certificate &cert);
 
+        ///Enable ALPN negotiation of HTTP protocols (server)
+        /**
+         * The server selects the first protocol offered by the client, which is
+         * also supported by the server.
+         * @param http2 true to support "h2" and "http/1.1", false to support "http/1.1" only
+         *
+         * @note HTTP/2 must be enabled on the http::Server (it is disabled by default)
+         */
+        void set_alpn_http(bool http2 = true);
+
         ///initialize ssl libraries
         /** it is called automatically when init_server() or init_client() is called*/
         static void initSSL();
@@ -6,16 +6,24 @@
 
 namespace coroserver {
 
+static http::ServerRequest secure_request(Stream s, const ssl::Context &ctx) {
+    //request of pipelined or HTTP/2 connection, SSL is already established
+    if (dynamic_cast<IMultiplexedStream *>(s.getStreamDevice().get())) {
+        return http::ServerRequest(std::move(s), true);
+    }
+    return http::ServerRequest(ssl::Stream::accept(std::move(s), ctx), true);
+}
+
 http::Server::RequestFactory http::Server::secure(ssl::Context &ctx, int group_id , bool mask) {
     if (!group_id) {
         return [ctx](Stream s) {
-            return http::ServerRequest(ssl::Stream::accept(std::move(s), ctx), true);
+            return secure_request(std::move(s), ctx);
         };
     } else if (mask){
         return [ctx, group_id](Stream s) {
             auto id = s.get_peer_name().get_group_id();
             if (id == group_id) {
-                return http::ServerRequest(ssl::Stream::accept(std::move(s), ctx), true);
+                return secure_request(std::move(s), ctx);
             } else {
                 return http::ServerRequest(std::move(s));
             }
@@ -24,7 +32,7 @@ http::Server::RequestFactory http::Server::secure(ssl::Context &ctx, int group_i
         return [ctx, group_id](Stream s) {
             auto id = s.get_peer_name().get_group_id();
             if ((id & group_id) == group_id) {
-                return http::ServerRequest(ssl::Stream::accept(std::move(s), ctx), true);
+                return secure_request(std::move(s), ctx);
             } else {
                 return http::ServerRequest(std::move(s));
             }
@@ -0,0 +1,153 @@
+/*
+ * static_stream.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_STATIC_STREAM_H_
+#define SRC_COROSERVER_STATIC_STREAM_H_
+
+#include "stream.h"
+
+namespace coroserver {
+
+///Statically composed stream stack
+/**
+ * Stream layers (Limited, Chunked) are templates parametrized by the type of the
+ * lower layer. The lower layer is stored inline in the upper layer and called
+ * directly, so the whole stack is single object without virtual calls between
+ * the layers. For example Limited<Chunked<StreamRef> > reads limited count of
+ * bytes from chunked stream, which reads from type erased stream.
+ *
+ * The stack is converted to IStream by StaticStream (single allocation for whole
+ * stack, single virtual call per operation).
+ *
+ * Each layer's constructor accepts own arguments followed by arguments of the lower layer.
+ * A layer must implement read(), write(std::span), write(std::string_view), write_eof()
+ * and reset(own arguments). Data put back by the upper layer are kept in the layer
+ * (they are already decoded), so read() must return read_putback_buffer() first. The
+ * metadata are forwarded to the lower layer by the StreamLayer.
+ */
+
+///The bottom of the stack - type erased stream
+class StreamRef {
+public:
+    StreamRef(std::shared_ptr<IStream> s):_s(std::move(s)) {}
+
+    cocls::future<std::string_view> read() {return _s->read();}
+    std::string_view read_nb() {return _s->read_nb();}
+    void put_back(std::string_view buff) {_s->put_back(buff);}
+    bool is_read_timeout() const {return _s->is_read_timeout();}
+    cocls::future<bool> write(std::string_view buffer) {return _s->write(buffer);}
+    cocls::future<bool> write(std::span<const std::string_view> buffers) {return _s->write(buffers);}
+    cocls::future<bool> write_eof() {return _s->write_eof();}
+    void set_timeouts(const TimeoutSettings &tm) {_s->set_timeouts(tm);}
+    TimeoutSettings get_timeouts() {return _s->get_timeouts();}
+    IStream::Counters get_counters() const noexcept {return _s->get_counters();}
+    PeerName get_peer_name() const {return _s->get_peer_name();}
+    cocls::suspend_point<void> shutdown() {return _s->shutdown();}
+
+    const std::shared_ptr<IStream> &get_stream_device() const {return _s;}
+
+protected:
+    std::shared_ptr<IStream> _s;
+};
+
+///Base class of the layers. Forwards operations, which are not handled by the layer
+template<typename Lower>
+class StreamLayer {
+public:
+    template<typename ... Args>
+    StreamLayer(Args && ... args):_lower(std::forward<Args>(args)...) {}
+    StreamLayer(const StreamLayer &) = delete;
+    StreamLayer &operator=(const StreamLayer &) = delete;
+
+    std::string_view read_nb() {return read_putback_buffer();}
+    void put_back(std::string_view buff) {_putback_buffer = buff;}
+    bool is_read_timeout() const {return _lower.is_read_timeout();}
+    void set_timeouts(const TimeoutSettings &tm) {_lower.set_timeouts(tm);}
+    TimeoutSettings get_timeouts() {return _lower.get_timeouts();}
+    IStream::Counters get_counters() const noexcept {return _lower.get_counters();}
+    PeerName get_peer_name() const {return _lower.get_peer_name();}
+    cocls::suspend_point<void> shutdown() {return _lower.shutdown();}
+
+    ///Access to the lower layer
+    Lower &lower() {return _lower;}
+
+protected:
+    Lower _lower;
+    std::string_view _putback_buffer;
+
+    std::string_view read_putback_buffer() {
+        return std::exchange(_putback_buffer,std::string_view());
+    }
+};
+
+///Makes IStream from the statically composed stack
+template<typename Stack>
+class StaticStream: public AbstractStream {
+public:
+    template<typename ... Args>
+    StaticStream(Args && ... args):_stack(std::forward<Args>(args)...) {}
+
+    virtual cocls::future<std::string_view> read() override {
+        auto buff = read_putback_buffer();
+        if (!buff.empty()) return cocls::future<std::string_view>::set_value(buff);
+        return _stack.read();
+    }
+    virtual std::string_view read_nb() override {
+        auto buff = read_putback_buffer();
+        if (!buff.empty()) return buff;
+        return _stack.read_nb();
+    }
+    virtual cocls::future<bool> write(std::string_view buffer) override {
+        return _stack.write(buffer);
+    }
+    virtual cocls::future<bool> write(std::span<const std::string_view> buffers) override {
+        return _stack.write(buffers);
+    }
+    virtual cocls::future<bool> write_eof() override {
+        return _stack.write_eof();
+    }
+    virtual bool is_read_timeout() const override {
+        return _stack.is_read_timeout();
+    }
+    virtual void set_timeouts(const TimeoutSettings &tm) override {
+        _stack.set_timeouts(tm);
+    }
+    virtual TimeoutSettings get_timeouts() override {
+        return _stack.get_timeouts();
+    }
+    virtual Counters get_counters() const noexcept override {
+        return _stack.get_counters();
+    }
+    virtual PeerName get_peer_name() const override {
+        return _stack.get_peer_name();
+    }
+    virtual cocls::suspend_point<void> shutdown() override {
+        return _stack.shutdown();
+    }
+
+    ///Reinitialize the top layer to be reused
+    /**
+     * @param args arguments of the top layer (same as constructor without arguments
+     * of lower layers)
+     *
+     * @note there must be no pending operation
+     */
+    template<typename ... Args>
+    void reset(Args && ... args) {
+        _putback_buffer = {};
+        _stack.reset(std::forward<Args>(args)...);
+    }
+
+    ///Access to the stack
+    Stack &get_stack() {return _stack;}
+
+protected:
+    Stack _stack;
+};
+
+}
+
+#endif /* SRC_COROSERVER_STATIC_STREAM_H_ */
@@ -21,6 +21,24 @@ public:
     virtual cocls::suspend_point<void> shutdown() override;
 };
 
+cocls::future<bool> IStream::write(std::span<const std::string_view> buffers) {
+    if (buffers.size() == 1) co_return co_await write(buffers[0]);
+    std::string data;
+    for (const auto &b: buffers) data.append(b);
+    co_return co_await write(std::string_view(data));
+}
+
+cocls::future<bool> AbstractStream::write(std::span<const std::string_view> buffers) {
+    if (buffers.size() == 1) return write(buffers[0]);
+    std::size_t sz = 0;
+    for (const auto &b: buffers) sz += b.size();
+    //large write would keep the memory for whole lifetime of the stream
+    if (sz > max_gather_size) return IStream::write(buffers);
+    _gather_buffer.clear();
+    for (const auto &b: buffers) _gather_buffer.append(b);
+    return write(std::string_view(_gather_buffer));
+}
+
 Stream Stream::null_stream() {
     static Stream s(std::make_shared<NullStream>());
     return s;
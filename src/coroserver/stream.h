@@ -8,6 +8,7 @@
 #ifndef SRC_COROSERVER_STREAM_H_
 #define SRC_COROSERVER_STREAM_H_
 
+#include "clock.h"
 #include "peername.h"
 #include "strutils.h"
 
@@ -16,6 +17,7 @@
 #include <cocls/async.h>
 #include <cocls/with_allocator.h>
 #include <chrono>
+#include <span>
 
 namespace coroserver {
 
@@ -23,9 +25,19 @@ struct TimeoutSettings {
     unsigned int read_timeout_ms = -1;
     unsigned int write_timeout_ms = -1;
 
-    static std::chrono::system_clock::time_point from_duration(unsigned int dur) {
-        if (dur == static_cast<unsigned int>(-1)) return std::chrono::system_clock::time_point::max();
-        else return std::chrono::system_clock::now()+std::chrono::milliseconds(dur);
+    static TimePoint from_duration(unsigned int dur) {
+        return from_duration(TimePoint(), dur);
+    }
+    ///Calculate deadline from given current time
+    /**
+     * @param now current time, for example IAsyncSupport::now(). Default value
+     * reads the clock only when the deadline is finite
+     * @param dur duration in milliseconds, -1 for infinite
+     */
+    static TimePoint from_duration(TimePoint now, unsigned int dur) {
+        if (dur == static_cast<unsigned int>(-1)) return TimePoint::max();
+        if (now == TimePoint()) now = Clock::now();
+        return now+std::chrono::milliseconds(dur);
     }
 };
 
@@ -47,6 +59,13 @@ public:
     virtual bool is_read_timeout() const = 0;
 
     virtual cocls::future<bool> write(std::string_view buffer) = 0;
+    ///Write multiple buffers at once
+    /**
+     * Default implementation gathers the buffers into temporary buffer and writes
+     * it by write(std::string_view). Streams which can write buffers without copying
+     * should override it
+     */
+    virtual cocls::future<bool> write(std::span<const std::string_view> buffers);
     virtual cocls::future<bool> write_eof() = 0;
 
     virtual void set_timeouts(const TimeoutSettings &tm) = 0;
@@ -65,20 +84,32 @@ public:
 
 class AbstractStream: public IStream {
 public:
+    using IStream::write;
+
     virtual void put_back(std::string_view buff) override {
         _putback_buffer = buff;
     }
     virtual std::string_view read_nb() override {
         return read_putback_buffer();
     }
+    ///Default implementation of vectored write
+    /**
+     * Copies the buffers into single buffer and writes it at once. Small writes reuse
+     * buffer of the stream, larger writes use temporary buffer released after the write
+     */
+    virtual cocls::future<bool> write(std::span<const std::string_view> buffers) override;
 
 protected:
 
+    ///Maximum size of data gathered into buffer of the stream
+    static constexpr std::size_t max_gather_size = 16384;
+
     std::string_view read_putback_buffer() {
         return std::exchange(_putback_buffer,std::string_view());
     }
 
     std::string_view _putback_buffer;
+    std::string _gather_buffer;
 };
 
 class AbstractStreamWithMetadata: public AbstractStream {
@@ -122,6 +153,16 @@ protected:
 
 };
 
+///Marks a stream of a request multiplexed over a connection
+/**
+ * Streams of pipelined HTTP/1.1 requests and of HTTP/2 requests are carried by
+ * the connection, which has been already prepared (for example, SSL has been established)
+ */
+class IMultiplexedStream {
+public:
+    virtual ~IMultiplexedStream() = default;
+};
+
 class ReadUntilFuture;
 
 ///Generic stream
@@ -201,6 +242,14 @@ public:
      *
      */
     cocls::future<bool> write(std::string_view buffer) {return _stream->write(buffer);}
+    ///writes multiple buffers at once
+    /**
+     * Sends the buffers in a single operation, if it is possible (writev, sendmsg)
+     * @param buffers list of buffers. Only the data must remain valid until
+     * the operation completes, the list itself can be released once the function returns
+     * @return a future which is eventually resolved with status of operation. See write()
+     */
+    cocls::future<bool> write(std::span<const std::string_view> buffers) {return _stream->write(buffers);}
     ///Writes eof and closes the stream
     /**
      * @retval true stream closed
@@ -0,0 +1,189 @@
+/*
+ * timer_heap.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_COROSERVER_TIMER_HEAP_H_
+#define SRC_COROSERVER_TIMER_HEAP_H_
+
+#include <chrono>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace coroserver {
+
+///Binary heap of timers, where each timer can be addressed by a handle
+/**
+ * The handle stays valid until the timer is removed or popped. It can be used to change
+ * the time of the timer or to remove it from the heap in O(log n). Storage
+ * of removed timers is reused, so there is no allocation in steady state.
+ *
+ * @tparam T type of value associated with the timer
+ * @tparam TimePoint type of time point
+ */
+template<typename T, typename TimePoint = std::chrono::steady_clock::time_point>
+class TimerHeap {
+public:
+
+    using Handle = std::size_t;
+    ///invalid handle
+    static constexpr Handle npos = ~Handle(0);
+
+    ///Insert the timer
+    /**
+     * @param tp time point
+     * @param value associated value
+     * @return handle of the timer
+     */
+    Handle insert(TimePoint tp, T value);
+
+    ///Change time of the timer
+    /**
+     * @param h handle
+     * @param tp new time point
+     */
+    void update(Handle h, TimePoint tp);
+
+    ///Remove the timer
+    /**
+     * @param h handle of the timer
+     * @return associated value
+     */
+    T remove(Handle h);
+
+    ///Remove the first timer
+    /**
+     * @return associated value
+     * @note heap must not be empty
+     */
+    T pop() {return remove(_heap.front());}
+
+    ///Retrieve handle of the first timer
+    /**
+     * @return handle of the first timer or npos if heap is empty
+     */
+    Handle top() const {return _heap.empty()?npos:_heap.front();}
+
+    ///Retrieve time of the first timer
+    /**
+     * @return time of the first timer or TimePoint::max() if heap is empty
+     */
+    TimePoint top_time() const {return _heap.empty()?TimePoint::max():_slots[_heap.front()].tp;}
+
+    ///Retrieve time of the timer
+    TimePoint get_time(Handle h) const {return _slots[h].tp;}
+
+    ///Access to the value of the timer
+    T &operator[](Handle h) {return _slots[h].value;}
+    ///Access to the value of the timer
+    const T &operator[](Handle h) const {return _slots[h].value;}
+
+    bool empty() const {return _heap.empty();}
+    std::size_t size() const {return _heap.size();}
+
+    ///Remove all timers
+    void clear() {
+        _slots.clear();
+        _free.clear();
+        _heap.clear();
+    }
+
+    ///Preallocate memory for given count of timers
+    void reserve(std::size_t count) {
+        _slots.reserve(count);
+        _free.reserve(count);
+        _heap.reserve(count);
+    }
+
+protected:
+
+    struct Slot {
+        TimePoint tp;
+        T value;
+        std::size_t pos;
+    };
+
+    std::vector<Slot> _slots;
+    std::vector<Handle> _free;
+    std::vector<Handle> _heap;
+
+    void place(std::size_t pos, Handle h) {
+        _heap[pos] = h;
+        _slots[h].pos = pos;
+    }
+
+    bool sift_up(std::size_t pos);
+    void sift_down(std::size_t pos);
+};
+
+template<typename T, typename TimePoint>
+inline typename TimerHeap<T, TimePoint>::Handle TimerHeap<T, TimePoint>::insert(TimePoint tp, T value) {
+    Handle h;
+    if (_free.empty()) {
+        h = _slots.size();
+        _slots.push_back(Slot{tp, std::move(value), 0});
+    } else {
+        h = _free.back();
+        _free.pop_back();
+        _slots[h].tp = tp;
+        _slots[h].value = std::move(value);
+    }
+    _heap.push_back(h);
+    place(_heap.size()-1, h);
+    sift_up(_heap.size()-1);
+    return h;
+}
+
+template<typename T, typename TimePoint>
+inline void TimerHeap<T, TimePoint>::update(Handle h, TimePoint tp) {
+    _slots[h].tp = tp;
+    if (!sift_up(_slots[h].pos)) sift_down(_slots[h].pos);
+}
+
+template<typename T, typename TimePoint>
+inline T TimerHeap<T, TimePoint>::remove(Handle h) {
+    std::size_t pos = _slots[h].pos;
+    Handle last = _heap.back();
+    _heap.pop_back();
+    if (last != h) {
+        place(pos, last);
+        if (!sift_up(pos)) sift_down(pos);
+    }
+    _free.push_back(h);
+    return std::move(_slots[h].value);
+}
+
+template<typename T, typename TimePoint>
+inline bool TimerHeap<T, TimePoint>::sift_up(std::size_t pos) {
+    Handle h = _heap[pos];
+    std::size_t start = pos;
+    while (pos > 0) {
+        std::size_t parent = (pos - 1) / 2;
+        if (!(_slots[h].tp < _slots[_heap[parent]].tp)) break;
+        place(pos, _heap[parent]);
+        pos = parent;
+    }
+    place(pos, h);
+    return pos != start;
+}
+
+template<typename T, typename TimePoint>
+inline void TimerHeap<T, TimePoint>::sift_down(std::size_t pos) {
+    Handle h = _heap[pos];
+    std::size_t sz = _heap.size();
+    while (true) {
+        std::size_t child = pos * 2 + 1;
+        if (child >= sz) break;
+        if (child + 1 < sz && _slots[_heap[child+1]].tp < _slots[_heap[child]].tp) ++child;
+        if (!(_slots[_heap[child]].tp < _slots[h].tp)) break;
+        place(pos, _heap[child]);
+        pos = child;
+    }
+    place(pos, h);
+}
+
+}
+
+#endif /* SRC_COROSERVER_TIMER_HEAP_H_ */
@@ -0,0 +1,45 @@
+#include "check.h"
+#include <coroserver/buffer_pool.h>
+
+using namespace coroserver;
+
+int main() {
+    BufferPool::Config cfg;
+    cfg.min_size = 1024;
+    cfg.max_size = 16384;
+    cfg.max_free_bytes = 8192;
+    BufferPool pool(cfg);
+
+    {
+        //sizes are rounded to size classes and capped
+        auto b1 = pool.get(10);
+        auto b2 = pool.get(3000);
+        auto b3 = pool.get(100000);
+        CHECK_EQUAL(b1.size(), 1024U);
+        CHECK_EQUAL(b2.size(), 4096U);
+        CHECK_EQUAL(b3.size(), 16384U);
+        CHECK_EQUAL(pool.get_stats().borrowed, 3U);
+        CHECK_EQUAL(pool.get_stats().borrowed_bytes, 1024U+4096U+16384U);
+
+        //moved buffer is returned once
+        BufferPool::Buffer b4 = std::move(b1);
+        CHECK(b1.empty());
+        CHECK_EQUAL(b4.size(), 1024U);
+    }
+    //16K buffer exceeds the limit of free bytes, so it was released
+    auto st = pool.get_stats();
+    CHECK_EQUAL(st.borrowed, 0U);
+    CHECK_EQUAL(st.free_bytes, 1024U+4096U);
+
+    //free buffer is reused
+    char *p;
+    {
+        auto b = pool.get(4000);
+        p = b.data();
+        CHECK_EQUAL(pool.get_stats().free_bytes, 1024U);
+    }
+    CHECK(pool.get(4096).data() == p);
+
+    pool.trim();
+    CHECK_EQUAL(pool.get_stats().free_bytes, 0U);
+}
@@ -0,0 +1,116 @@
+#include "check.h"
+#include "test_stream.h"
+#include <coroserver/buffered_stream.h>
+#include <coroserver/io_context.h>
+#include <coroserver/socket_stream.h>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <chrono>
+
+using namespace coroserver;
+
+static std::pair<Stream, Stream> connect_pair(ContextIO ctx) {
+    auto addr = PeerName::lookup("127.0.0.1","*");
+    auto listener = ctx.accept(addr);
+    cocls::future<Stream> f([&]{return listener();});
+    Stream c = ctx.connect(addr).join();
+    return {c, f.join()};
+}
+
+static std::string read_n(Stream s, std::size_t n) {
+    std::string out;
+    while (out.size() < n) {
+        std::string_view data = s.read().join();
+        if (data.empty()) break;
+        out.append(data);
+    }
+    return out;
+}
+
+//buffered data are sent after the flush delay, flush cancels the timer
+void test_delayed_flush() {
+    ContextIO ctx = ContextIO::create(1);
+    auto [c, s] = connect_pair(ctx);
+    auto sock = std::dynamic_pointer_cast<SocketStream>(c.getStreamDevice());
+    BufferedStream::Config cfg;
+    cfg.flush_delay = std::chrono::milliseconds(10);
+    auto bs = BufferedStream::create(c, cfg, sock);
+
+    auto start = std::chrono::steady_clock::now();
+    CHECK(bs.write("hello").wait());
+    CHECK_EQUAL(read_n(s, 5), "hello");
+    CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(10));
+
+    //pending timer doesn't keep the stream alive after flush
+    cfg.flush_delay = std::chrono::seconds(10);
+    auto bs2 = BufferedStream::create(c, cfg, sock);
+    std::weak_ptr<IStream> weak = bs2.getStreamDevice();
+    CHECK(bs2.write("world").wait());
+    CHECK(BufferedStream::flush(bs2).wait());
+    bs2 = Stream(nullptr);
+    CHECK(weak.expired());
+    CHECK_EQUAL(read_n(s, 5), "world");
+}
+
+static int get_cork(const std::shared_ptr<SocketStream> &sock) {
+    int val = 0;
+    socklen_t len = sizeof(val);
+    ::getsockopt(sock->get_write_fd(), IPPROTO_TCP, TCP_CORK, &val, &len);
+    return val;
+}
+
+//destroyed stream doesn't uncork the socket used by next stream
+void test_cork() {
+    //completion based context sets TCP_CORK
+    ContextIO ctx = ContextIO::create(1, PollerType::uring);
+    auto [c, s] = connect_pair(ctx);
+    auto sock = std::dynamic_pointer_cast<SocketStream>(c.getStreamDevice());
+    BufferedStream::Config cfg;
+    cfg.buffer_size = 16;
+
+    auto bs1 = BufferedStream::create(c, cfg, sock);
+    CHECK(bs1.write("0123456789ABCDEFGHIJ").wait());
+    CHECK_EQUAL(get_cork(sock), 1);
+    CHECK(BufferedStream::flush(bs1).wait());
+    CHECK_EQUAL(get_cork(sock), 0);
+    CHECK_EQUAL(read_n(s, 20), "0123456789ABCDEFGHIJ");
+
+    auto bs2 = BufferedStream::create(c, cfg, sock);
+    CHECK(bs2.write("KLMNOPQRSTUVWXYZabcd").wait());
+    CHECK_EQUAL(get_cork(sock), 1);
+    bs1 = Stream(nullptr);
+    CHECK_EQUAL(get_cork(sock), 1);
+    CHECK(bs2.write_eof().wait());
+    CHECK_EQUAL(get_cork(sock), 0);
+    CHECK_EQUAL(read_n(s, 20), "KLMNOPQRSTUVWXYZabcd");
+}
+
+int main() {
+    test_delayed_flush();
+    test_cork();
+    std::string result;
+    auto s = TestStream<10>::create({}, &result);
+    BufferedStream::Config cfg;
+    cfg.buffer_size = 16;
+    auto bs = BufferedStream::create(s, cfg);
+
+    //small writes are collected
+    CHECK(bs.write("0123456789").wait());
+    CHECK(bs.write("ABCDE").wait());
+    CHECK_EQUAL(result, "");
+
+    //write which doesn't fit is sent along with the buffer
+    CHECK(bs.write("FGHIJ").wait());
+    CHECK_EQUAL(result, "0123456789ABCDEFGHIJ");
+
+    CHECK(bs.write("xy").wait());
+    CHECK_EQUAL(result, "0123456789ABCDEFGHIJ");
+    CHECK(BufferedStream::flush(bs).wait());
+    CHECK_EQUAL(result, "0123456789ABCDEFGHIJxy");
+
+    CHECK(bs.write("z").wait());
+    CHECK(bs.write_eof().wait());
+    CHECK_EQUAL(result, "0123456789ABCDEFGHIJxyz");
+}
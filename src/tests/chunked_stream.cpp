@@ -42,9 +42,38 @@ void test2() {
     CHECK_EQUAL(extra, "ExtraData");
 }
 
+void test3() {
+    std::string result;
+    std::string expected = "9\r\nabc123xyz\r\n3\r\nend\r\n0\r\n\r\n";
+
+    auto s = TestStream<100>::create({}, &result);
+    auto chs = coroserver::ChunkedStream::write(s);
+    std::string_view parts[] = {"abc", "", "123", "xyz"};
+    chs.write(std::span<const std::string_view>(parts)).wait();
+    chs.write("").wait();
+    chs.write("end").wait();
+    chs.write_eof().wait();
+    CHECK_EQUAL(result, expected);
+}
+
+void test4() {
+    std::string result;
+    std::string big(20000,'x');
+    std::string expected = "abc" + big + "123abc123";
+
+    auto s = TestStream<100>::create({}, &result);
+    std::string_view large[] = {"abc", big, "123"};
+    std::string_view small[] = {"abc", "", "123"};
+    s.write(std::span<const std::string_view>(large)).wait();
+    s.write(std::span<const std::string_view>(small)).wait();
+    CHECK_EQUAL(result, expected);
+}
+
 int main() {
     test1();
     test2();
+    test3();
+    test4();
 
 
 
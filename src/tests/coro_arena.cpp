@@ -0,0 +1,77 @@
+#include "check.h"
+#include <coroserver/coro_alloc.h>
+
+#include <cocls/async.h>
+#include <cocls/future.h>
+#include <cocls/with_allocator.h>
+
+#include <memory>
+
+using namespace coroserver;
+
+static cocls::with_allocator<CoroArena, cocls::async<int> > coro_fn(CoroArena &, int v) {
+    co_return v;
+}
+
+int main() {
+    CoroArenaControl::Config cfg;
+    cfg.initial_block_size = 256;
+    cfg.max_block_size = 4096;
+    auto ctl = std::make_shared<CoroArenaControl>(cfg);
+
+    {
+        CoroArena arena(ctl);
+        CHECK_EQUAL(ctl->get_stats().arenas, 1U);
+        CHECK_EQUAL(arena.get_stats().capacity, 256U);
+
+        void *p1 = arena.alloc(100);
+        void *p2 = arena.alloc(50);
+        CHECK(p2 > p1);
+        std::size_t used = arena.get_stats().used;
+        //released out of order, space is returned together with the top frame
+        CoroArena::dealloc(p1, 100);
+        CHECK_EQUAL(arena.get_stats().used, used);
+        CoroArena::dealloc(p2, 50);
+        CHECK_EQUAL(arena.get_stats().used, 0U);
+        //space is reused
+        void *p3 = arena.alloc(100);
+        CHECK_EQUAL(p3, p1);
+
+        //frame doesn't fit, it is allocated from the heap and the block grows
+        void *p4 = arena.alloc(300);
+        CHECK_EQUAL(arena.get_stats().heap_frames, 1U);
+        CHECK_EQUAL(ctl->get_stats().heap_frames, 1U);
+        CHECK_EQUAL(ctl->get_stats().block_size, 512U);
+        CoroArena::dealloc(p4, 300);
+        CoroArena::dealloc(p3, 100);
+
+        //frame of the coroutine
+        cocls::future<int> f = coro_fn(arena, 42);
+        CHECK_EQUAL(f.wait(), 42);
+        CHECK_EQUAL(arena.get_stats().arena_frames, 4U);
+
+        //next arena has larger block
+        CoroArena arena2(ctl);
+        CHECK_EQUAL(arena2.get_stats().capacity, 512U);
+    }
+    auto st = ctl->get_stats();
+    CHECK_EQUAL(st.arenas, 0U);
+    CHECK_EQUAL(st.arena_frames, 4U);
+
+    //the frame keeps the arena
+    void *p;
+    {
+        CoroArena arena(ctl);
+        p = arena.alloc(64);
+    }
+    CHECK_EQUAL(ctl->get_stats().arenas, 1U);
+    CoroArena::dealloc(p, 64);
+    CHECK_EQUAL(ctl->get_stats().arenas, 0U);
+
+    //empty arena uses the heap
+    CoroArena none;
+    p = none.alloc(64);
+    CoroArena::dealloc(p, 64);
+    CHECK_EQUAL(ctl->get_stats().heap_frames, 1U);
+
+}
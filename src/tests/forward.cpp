@@ -0,0 +1,103 @@
+#include "check.h"
+#include "test_stream.h"
+#include <coroserver/forward.h>
+#include <coroserver/io_context.h>
+#include <coroserver/pipe.h>
+
+#include <fcntl.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace coroserver;
+
+cocls::async<void> writer(Stream s, std::string data) {
+    std::string_view rest = data;
+    while (!rest.empty()) {
+        auto part = rest.substr(0, 10000);
+        co_await s.write(part);
+        rest = rest.substr(part.size());
+    }
+    co_await s.write_eof();
+}
+
+static std::string read_all(Stream s) {
+    std::string out;
+    for (std::string_view data = s.read().wait(); !data.empty(); data = s.read().wait()) {
+        out.append(data);
+    }
+    return out;
+}
+
+static std::pair<Stream, Stream> connect_pair(ContextIO ctx) {
+    auto addr = PeerName::lookup("127.0.0.1","*");
+    auto listener = ctx.accept(addr);
+    cocls::future<Stream> f([&]{return listener();});
+    Stream c = ctx.connect(addr).join();
+    return {c, f.join()};
+}
+
+int main() {
+    ContextIO ctx = ContextIO::create(1);
+    std::string data;
+    for (int i = 0; i < 300000; i++) data.push_back(static_cast<char>('A' + i % 26));
+
+    //pipe to pipe - splice
+    {
+        Stream src = PipeStream::create(ctx);
+        Stream dst = PipeStream::create(ctx);
+        auto wr = writer(src, data).start();
+        auto fwd = forward(src, dst);
+        std::string out = read_all(dst);
+        ForwardResult res = fwd.wait();
+        wr.wait();
+        CHECK(res.eof);
+        CHECK(res.zero_copy);
+        CHECK_EQUAL(res.bytes, data.size());
+        CHECK(out == data);
+        CHECK_EQUAL(dst.get_counters().write, data.size());
+    }
+    //generic stream to pipe - copy
+    {
+        Stream src = TestStream<0>::create({"Hello", " ", "World"});
+        Stream dst = PipeStream::create(ctx);
+        ForwardResult res = forward(src, dst).wait();
+        CHECK(res.eof);
+        CHECK(!res.zero_copy);
+        CHECK_EQUAL(res.bytes, 11U);
+        CHECK_EQUAL(read_all(dst), "Hello World");
+    }
+    //socket to socket - splice
+    {
+        auto [src_client, src] = connect_pair(ctx);
+        auto [dst, dst_server] = connect_pair(ctx);
+        auto wr = writer(src_client, data).start();
+        auto fwd = forward(src, dst);
+        std::string out = read_all(dst_server);
+        ForwardResult res = fwd.wait();
+        wr.wait();
+        CHECK(res.eof);
+        CHECK(res.zero_copy);
+        CHECK_EQUAL(res.bytes, data.size());
+        CHECK(out == data);
+    }
+    //splice to file opened for append fails with EINVAL - falls back to copy
+    {
+        std::string fname = "/tmp/coroserver_forward_test";
+        int fd = ::open(fname.c_str(), O_RDWR|O_CREAT|O_TRUNC|O_APPEND|O_CLOEXEC, 0666);
+        CHECK(fd >= 0);
+        Stream src = PipeStream::create(ctx);
+        Stream dst = PipeStream::create(ctx, fd);
+        auto wr = writer(src, data).start();
+        ForwardResult res = forward(src, dst).wait();
+        wr.wait();
+        CHECK(res.eof);
+        CHECK(!res.zero_copy);
+        CHECK_EQUAL(res.bytes, data.size());
+        std::ostringstream content;
+        content << std::ifstream(fname).rdbuf();
+        CHECK(content.str() == data);
+        std::remove(fname.c_str());
+    }
+    ctx.stop();
+}
@@ -0,0 +1,67 @@
+#include "check.h"
+#include <coroserver/head_scanner.h>
+#include <coroserver/http_common.h>
+
+#include <string>
+#include <vector>
+
+using namespace coroserver;
+
+void run_test() {
+    std::string head = "GET /index.html HTTP/1.1\r\n"
+                       "Host: www.example.com\r\n"
+                       "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)\r\n"
+                       "accept: text/html\r\n"
+                       "X-Empty:\r\n"
+                       "Cookie: a=1\r\n"
+                       "Referer: http://www.example.com:8080/\r\n"
+                       "cookie: b=2\r\n"
+                       "\r\n";
+    std::string text = head + "body";
+
+    CHECK_EQUAL(HeadScanner::find_end(text), head.size());
+    CHECK_EQUAL(HeadScanner::find_end(head.substr(0, head.size()-1)), HeadScanner::npos);
+    //incremental search, the separator starts before the offset
+    for (std::size_t i = head.size() - 4; i < head.size(); i++) {
+        CHECK_EQUAL(HeadScanner::find_end(text, i), head.size());
+    }
+
+    std::vector<std::pair<std::string_view, std::size_t> > lines;
+    HeadScanner::for_each_line("first line\nkey:value:x\r\nnocolon\r\nlast", [&](std::string_view ln, std::size_t colon) {
+        lines.push_back({ln, colon});
+        return true;
+    });
+    CHECK_EQUAL(lines.size(), 4U);
+    CHECK_EQUAL(lines[0].first, "first line");
+    CHECK_EQUAL(lines[1].first, "key:value:x");
+    CHECK_EQUAL(lines[1].second, 3U);
+    CHECK_EQUAL(lines[2].second, HeadScanner::npos);
+    CHECK_EQUAL(lines[3].first, "last");
+
+    http::HeaderMap hdrs;
+    std::string_view first_line;
+    CHECK(http::HeaderMap::headers(std::string_view(head).substr(0, head.size()-4), hdrs, first_line));
+    CHECK_EQUAL(first_line, "GET /index.html HTTP/1.1");
+    CHECK_EQUAL(hdrs.size(), 7U);
+    CHECK_EQUAL(hdrs["host"], "www.example.com");
+    CHECK_EQUAL(hdrs["Accept"], "text/html");
+    CHECK_EQUAL(hdrs["referer"], "http://www.example.com:8080/");
+    CHECK(hdrs["x-empty"].has_value());
+    //headers with the same name keep order
+    auto rng = hdrs.equal_range("Cookie");
+    CHECK_EQUAL(std::distance(rng.first, rng.second), 2);
+    CHECK_EQUAL(rng.first->second, "a=1");
+    CHECK_EQUAL((rng.first+1)->second, "b=2");
+
+    CHECK(!http::HeaderMap::headers("GET / HTTP/1.1\r\n: value", hdrs, first_line));
+    CHECK(!http::HeaderMap::headers("\r\nHost: x", hdrs, first_line));
+}
+
+int main() {
+    for (auto impl: {HeadScanner::Impl::scalar, HeadScanner::Impl::sse2, HeadScanner::Impl::avx2}) {
+        //implementation not supported by this CPU is skipped
+        if (HeadScanner::force_impl(impl)) run_test();
+    }
+    CHECK(HeadScanner::force_impl(HeadScanner::Impl::automatic));
+    run_test();
+}
@@ -0,0 +1,110 @@
+#include "check.h"
+#include <coroserver/hpack.h>
+
+#include <string>
+#include <vector>
+
+using namespace coroserver::http2;
+
+static std::string from_hex(std::string_view hex) {
+    std::string out;
+    auto val = [](char c) {return c <= '9'?c - '0':c - 'a' + 10;};
+    for (std::size_t i = 0; i + 1 < hex.size(); i+=2) {
+        out.push_back(static_cast<char>(val(hex[i]) * 16 + val(hex[i+1])));
+    }
+    return out;
+}
+
+static std::string dump(const std::vector<HeaderField> &flds) {
+    std::string out;
+    for (const auto &f: flds) {
+        out.append(f.name);
+        out.append(": ");
+        out.append(f.value);
+        out.append("\n");
+    }
+    return out;
+}
+
+int main() {
+    //RFC 7541 C.4.1 - request with huffman coding
+    {
+        HPackDecoder dec;
+        std::vector<HeaderField> flds;
+        CHECK(dec.decode(from_hex("828684418cf1e3c2e5f23a6ba0ab90f4ff"), flds));
+        CHECK_EQUAL(dump(flds), ":method: GET\n:scheme: http\n:path: /\n:authority: www.example.com\n");
+        //second request refers to the dynamic table (C.4.2)
+        flds.clear();
+        CHECK(dec.decode(from_hex("828684be5886a8eb10649cbf"), flds));
+        CHECK_EQUAL(dump(flds), ":method: GET\n:scheme: http\n:path: /\n:authority: www.example.com\ncache-control: no-cache\n");
+    }
+    //RFC 7541 C.6.1 - response with huffman coding
+    {
+        HPackDecoder dec(256);
+        std::vector<HeaderField> flds;
+        CHECK(dec.decode(from_hex("488264025885aec3771a4b6196d07abe941054d444a8200595040b8166e082a62d1bff6e919d29ad171863c78f0b97c8e9ae82ae43d3"), flds));
+        CHECK_EQUAL(dump(flds), ":status: 302\ncache-control: private\ndate: Mon, 21 Oct 2013 20:13:21 GMT\nlocation: https://www.example.com\n");
+    }
+    //huffman - all symbols
+    {
+        std::string all;
+        for (int i = 0; i < 256; i++) all.push_back(static_cast<char>(i));
+        std::string enc;
+        Huffman::encode(all, enc);
+        CHECK_EQUAL(enc.size(), Huffman::encoded_size(all));
+        std::string dec;
+        CHECK(Huffman::decode(enc, dec));
+        CHECK(dec == all);
+        //invalid padding
+        dec.clear();
+        CHECK(!Huffman::decode(from_hex("ffffffff"), dec));
+    }
+    //encoder and decoder share the dynamic table
+    {
+        HPackEncoder enc;
+        HPackDecoder dec;
+        std::vector<HeaderField> src = {
+                {":status","200"},
+                {"content-type","text/html;charset=utf-8"},
+                {"content-length","1234"},
+                {"x-custom","value"},
+                {"set-cookie","a=b"}
+        };
+        std::size_t first_size = 0;
+        for (int i = 0; i < 3; i++) {
+            std::string block;
+            for (const auto &f: src) enc.encode(f.name, f.value, block);
+            if (i == 0) first_size = block.size();
+            else CHECK_LESS(block.size(), first_size);
+            std::vector<HeaderField> flds;
+            CHECK(dec.decode(block, flds));
+            CHECK_EQUAL(dump(flds), dump(src));
+        }
+        enc.set_max_table_size(0);
+        std::string block;
+        enc.encode("x-custom","value", block);
+        std::vector<HeaderField> flds;
+        CHECK(dec.decode(block, flds));
+        CHECK_EQUAL(dump(flds), "x-custom: value\n");
+    }
+    //small block refers large field of the dynamic table many times
+    {
+        HPackDecoder dec;
+        dec.set_max_list_size(16384);
+        std::string block = from_hex("4001787f");
+        //length of the value 4000 (127 + 3873)
+        block.append(from_hex("a11e"));
+        block.append(4000, 'a');
+        block.append(1000, static_cast<char>(0xBE));
+        std::vector<HeaderField> flds;
+        CHECK(dec.decode(block, flds));
+        CHECK(dec.list_too_large());
+        CHECK_LESS(flds.size(), 5U);
+        //the table is still in sync
+        flds.clear();
+        CHECK(dec.decode(from_hex("be"), flds));
+        CHECK(!dec.list_too_large());
+        CHECK_EQUAL(flds.size(), 1U);
+        CHECK_EQUAL(flds[0].value.size(), 4000U);
+    }
+}
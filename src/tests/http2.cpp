@@ -0,0 +1,247 @@
+#include "check.h"
+#include "http2_client.h"
+#include "test_stream.h"
+#include <coroserver/http_server.h>
+#include <coroserver/io_context.h>
+
+#include <thread>
+
+using namespace coroserver;
+using namespace coroserver::http;
+
+static cocls::future<void> delay(int ms) {
+    return [=](auto promise) {
+        std::thread thr([ms, promise = std::move(promise)]() mutable {
+            std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+            promise();
+        });
+        thr.detach();
+    };
+}
+
+static cocls::async<void> echo(ServerRequest &req) {
+    Stream body = co_await req.get_body();
+    std::string b;
+    co_await body.read_block(b, 100000);
+    co_await req.send(std::move(b));
+}
+
+static cocls::async<void> send_stream(ServerRequest &req) {
+    Stream s = co_await req.send();
+    co_await s.write("first,");
+    co_await s.write("second");
+    co_await s.write_eof();
+}
+
+static cocls::async<void> slow(ServerRequest &req) {
+    co_await delay(200);
+    co_await req.send("slow");
+}
+
+static void setup(Server &server) {
+    server.set_http2(true);
+    server.set_handler("/hello", [](ServerRequest &req) -> cocls::future<bool> {
+        req.add_date(std::chrono::system_clock::from_time_t(1651236587));
+        req("Set-Cookie", "a=b");
+        return req.send("Hello world");
+    });
+    server.set_handler("/echo", Method::POST, [](ServerRequest &req) -> cocls::future<void> {
+        return echo(req);
+    });
+    server.set_handler("/stream", [](ServerRequest &req) -> cocls::future<void> {
+        return send_stream(req);
+    });
+    server.set_handler("/slow", [](ServerRequest &req) -> cocls::future<void> {
+        return slow(req);
+    });
+    server.set_handler("/large", [](ServerRequest &req) -> cocls::future<bool> {
+        return req.send(std::string(200000, 'x'));
+    });
+    server.set_handler("/header", [](ServerRequest &req) -> cocls::future<bool> {
+        return req.send(std::string(req[strtable::hdr_host].view()) + "|" + std::string(req["Cookie"].view()));
+    });
+}
+
+//whole conversation is passed at once, the server finishes requests after the client closes the connection
+void test_streams() {
+    Server server;
+    setup(server);
+    Http2TestClient client;
+    auto id1 = client.request("GET", "/hello");
+    auto id2 = client.request("POST", "/echo", {}, "request body");
+    auto id3 = client.request("POST", "/echo", {{"content-length", "4"}}, "abcd");
+    auto id4 = client.request("GET", "/stream");
+    auto id5 = client.request("HEAD", "/hello");
+    auto id6 = client.request("GET", "/notfound");
+    auto id7 = client.request("GET", "/header", {{"cookie", "x=1"}, {"cookie", "y=2"}});
+    auto id8 = client.request("GET", "/hello", {{"connection", "close"}});
+    std::string out;
+    auto s = TestStream<0>::create({client.output()}, &out);
+    server.serve_req(s).join();
+    CHECK(client.process(out));
+
+    CHECK_EQUAL(client[id1].status, 200);
+    CHECK_EQUAL(client[id1].body, "Hello world");
+    CHECK_EQUAL(client[id1].get("content-length"), "11");
+    CHECK_EQUAL(client[id1].get("date"), "Fri, 29 Apr 2022 12:49:47 GMT");
+    CHECK_EQUAL(client[id1].get("set-cookie"), "a=b");
+    CHECK_EQUAL(client[id2].body, "request body");
+    CHECK_EQUAL(client[id3].body, "abcd");
+    //chunked encoding is removed
+    CHECK_EQUAL(client[id4].status, 200);
+    CHECK_EQUAL(client[id4].body, "first,second");
+    CHECK(client[id4].get("transfer-encoding").empty());
+    CHECK(client[id4].complete);
+    CHECK_EQUAL(client[id5].status, 200);
+    CHECK(client[id5].body.empty());
+    CHECK(client[id5].complete);
+    CHECK_EQUAL(client[id6].status, 404);
+    CHECK_EQUAL(client[id7].body, "localhost|x=1; y=2");
+    //connection-specific header is error
+    CHECK(client[id8].is_reset);
+    CHECK_EQUAL(client[id8].reset, static_cast<std::uint32_t>(http2::ErrorCode::protocol_error));
+    CHECK_EQUAL(client.completed().size(), 8);
+}
+
+//PUSH_PROMISE from the client is connection error, the server sends GOAWAY
+void test_protocol_error() {
+    Server server;
+    setup(server);
+    Http2TestClient client;
+    client.frame(http2::FrameType::push_promise, 0, 1, "xxxx");
+    std::string out;
+    auto s = TestStream<0>::create({client.output()}, &out);
+    server.serve_req(s).join();
+    CHECK(client.process(out));
+    CHECK(client.goaway());
+    CHECK_EQUAL(client.goaway_error(), static_cast<std::uint32_t>(http2::ErrorCode::protocol_error));
+}
+
+//small header block which decodes to large header list is refused
+void test_header_list_size() {
+    Server server;
+    setup(server);
+    Http2TestClient client;
+    auto id1 = client.request("GET", "/hello");
+    //literal with indexing (x: 4000 bytes), then 100 references to it
+    std::string block;
+    http2::HPackEncoder enc;
+    enc.encode(":method", "GET", block);
+    enc.encode(":scheme", "http", block);
+    enc.encode(":path", "/hello", block);
+    block.append("\x40\x01x\x7f\xa1\x1e");
+    block.append(4000, 'a');
+    block.append(100, '\xbe');
+    client.frame(http2::FrameType::headers, http2::flags::end_headers|http2::flags::end_stream, 3, block);
+    std::string out;
+    auto s = TestStream<0>::create({client.output()}, &out);
+    server.serve_req(s).join();
+    CHECK(client.process(out));
+    CHECK_EQUAL(client[id1].body, "Hello world");
+    CHECK(client[3].is_reset);
+    CHECK_EQUAL(client[3].reset, static_cast<std::uint32_t>(http2::ErrorCode::enhance_your_calm));
+    CHECK(!client.goaway());
+}
+
+//invalid pseudo-headers and body not matching the content-length reset the stream
+void test_invalid_request() {
+    Server server;
+    setup(server);
+    Http2TestClient client;
+    auto id1 = client.request("GE T", "/hello");
+    auto id2 = client.request("GET", "/hello HTTP/1.1\r\nX-Injected: 1");
+    auto id3 = client.request("GET", "/hello world");
+    auto id4 = client.request("POST", "/echo", {{"content-length", "10"}}, "abcd");
+    auto id5 = client.request("POST", "/echo", {{"content-length", "2"}}, "abcd");
+    auto id6 = client.request("POST", "/echo", {{"content-length", "1"}});
+    auto id7 = client.request("POST", "/echo", {{"content-length", "4"}}, "abcd");
+    std::string out;
+    auto s = TestStream<0>::create({client.output()}, &out);
+    server.serve_req(s).join();
+    CHECK(client.process(out));
+    for (auto id: {id1, id2, id3, id4, id5, id6}) {
+        CHECK(client[id].is_reset);
+        CHECK_EQUAL(client[id].reset, static_cast<std::uint32_t>(http2::ErrorCode::protocol_error));
+    }
+    CHECK_EQUAL(client[id7].body, "abcd");
+    CHECK(!client.goaway());
+}
+
+//HTTP/2 is disabled by default, the preface is processed as HTTP/1 request
+void test_disabled() {
+    Server server;
+    server.set_handler("/hello", [](ServerRequest &req) -> cocls::future<bool> {
+        return req.send("Hello world");
+    });
+    Http2TestClient client;
+    client.request("GET", "/hello");
+    std::string out;
+    auto s = TestStream<0>::create({client.output()}, &out);
+    server.serve_req(s).join();
+    CHECK_EQUAL(out.substr(0,5), "HTTP/");
+}
+
+//preface arrives in short reads, streams are created by the request factory
+void test_short_preface() {
+    int created = 0;
+    Server server([&](Stream s) {
+        ++created;
+        return ServerRequest(std::move(s), false);
+    });
+    setup(server);
+    Http2TestClient client;
+    auto id1 = client.request("GET", "/hello");
+    auto id2 = client.request("POST", "/echo", {}, "request body");
+    std::string data = client.output();
+    std::string out;
+    auto s = TestStream<0>::create({data.substr(0,2), data.substr(2,1), data.substr(3)}, &out);
+    server.serve_req(s).join();
+    CHECK(client.process(out));
+    CHECK_EQUAL(client[id1].body, "Hello world");
+    CHECK_EQUAL(client[id2].body, "request body");
+    //connection + 2 streams
+    CHECK_EQUAL(created, 3);
+}
+
+//streams are multiplexed over real connection, large response needs flow control
+void test_loopback() {
+    ContextIO ctx = ContextIO::create(2);
+    auto addrs_listen = PeerName::lookup("127.0.0.1", "*");
+    auto listening = ctx.accept(addrs_listen);
+    auto addrs_connect = PeerName::lookup("localhost", addrs_listen[0].get_port());
+    auto wtconn = listening();
+    Stream s = ctx.connect(addrs_connect).join();
+    Stream r = wtconn.join();
+
+    Server server;
+    setup(server);
+    auto served = server.serve_req(std::move(r));
+    {
+        Http2TestClient client(std::move(s));
+        auto id1 = client.request("GET", "/slow");
+        auto id2 = client.request("GET", "/large");
+        auto id3 = client.request("GET", "/hello");
+        CHECK(client.run(3));
+        //slow request doesn't block others
+        CHECK_EQUAL(client.completed().back(), id1);
+        CHECK_EQUAL(client[id1].body, "slow");
+        CHECK_EQUAL(client[id2].body.size(), 200000);
+        CHECK_EQUAL(client[id3].body, "Hello world");
+        client.clear();
+        //next requests on the same connection
+        auto id4 = client.request("POST", "/echo", {}, std::string(30000, 'a'));
+        CHECK(client.run(1));
+        CHECK_EQUAL(client[id4].body.size(), 30000);
+    }
+    served.join();
+}
+
+int main() {
+    test_streams();
+    test_protocol_error();
+    test_header_list_size();
+    test_invalid_request();
+    test_disabled();
+    test_short_preface();
+    test_loopback();
+}
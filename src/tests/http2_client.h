@@ -0,0 +1,253 @@
+/*
+ * http2_client.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef SRC_TESTS_HTTP2_CLIENT_H_
+#define SRC_TESTS_HTTP2_CLIENT_H_
+
+#include <coroserver/hpack.h>
+#include <coroserver/http2.h>
+#include <coroserver/stream.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+///Simple HTTP/2 client for tests and benchmarks
+/**
+ * Frames are collected in the output buffer, which is written by flush(), or it can
+ * be retrieved by output() and passed to the server by other way. Received data are
+ * processed by process(). When the client is connected to a stream, run() reads the
+ * stream until requested count of responses is complete.
+ *
+ * The client doesn't track the send window, so request bodies must fit to the
+ * initial window of the server
+ */
+class Http2TestClient {
+public:
+
+    using FrameType = coroserver::http2::FrameType;
+    using FrameHeader = coroserver::http2::FrameHeader;
+    using HeaderField = coroserver::http2::HeaderField;
+
+    struct Response {
+        int status = 0;
+        std::vector<HeaderField> headers;
+        std::string body;
+        bool complete = false;
+        ///error code of RST_STREAM
+        std::uint32_t reset = 0;
+        bool is_reset = false;
+
+        std::string_view get(std::string_view name) const {
+            for (const auto &f: headers) if (f.name == name) return f.value;
+            return {};
+        }
+    };
+
+    ///Create client
+    /**
+     * @param s connection to the server
+     * @param window_update send WINDOW_UPDATE for received data. If false, the
+     * server is limited by the initial window
+     */
+    Http2TestClient(coroserver::Stream s = coroserver::Stream::null_stream(), bool window_update = true)
+        :_s(std::move(s)), _window_update(window_update) {
+        _out.append(coroserver::http2::client_preface);
+        frame(FrameType::settings, 0, 0, {});
+    }
+
+    ///Add request
+    /**
+     * @param method method
+     * @param path path
+     * @param headers additional headers (lowercase)
+     * @param body body of the request
+     * @param end_stream set false to keep the stream open for more data (see data())
+     * @return id of the stream
+     */
+    std::uint32_t request(std::string_view method, std::string_view path,
+                          const std::vector<HeaderField> &headers = {},
+                          std::string_view body = {}, bool end_stream = true) {
+        std::uint32_t id = _next_id;
+        _next_id += 2;
+        std::string block;
+        _enc.encode(":method", method, block);
+        _enc.encode(":scheme", "http", block);
+        _enc.encode(":path", path, block);
+        _enc.encode(":authority", "localhost", block);
+        for (const auto &f: headers) _enc.encode(f.name, f.value, block);
+        bool has_data = !body.empty();
+        frame(FrameType::headers, coroserver::http2::flags::end_headers
+                | (end_stream && !has_data?coroserver::http2::flags::end_stream:0), id, block);
+        _responses[id];
+        if (has_data) data(id, body, end_stream);
+        return id;
+    }
+
+    ///Add DATA frames
+    void data(std::uint32_t id, std::string_view body, bool end_stream) {
+        do {
+            std::string_view part = body.substr(0, 16384);
+            body.remove_prefix(part.size());
+            frame(FrameType::data, end_stream && body.empty()?coroserver::http2::flags::end_stream:0, id, part);
+        } while (!body.empty());
+    }
+
+    ///Add frame
+    void frame(FrameType type, std::uint8_t flags, std::uint32_t id, std::string_view payload) {
+        FrameHeader{static_cast<std::uint32_t>(payload.size()), type, flags, id}.write(_out);
+        _out.append(payload);
+    }
+
+    ///Retrieve collected frames
+    const std::string &output() const {return _out;}
+
+    ///Write collected frames to the stream
+    bool flush() {
+        if (_out.empty()) return true;
+        bool ok = _s.write(_out).join();
+        _out.clear();
+        return ok;
+    }
+
+    ///Process received data
+    /**
+     * @param data received data
+     * @retval true processed
+     * @retval false invalid data
+     */
+    bool process(std::string_view data) {
+        _in.append(data);
+        std::string_view rd(_in);
+        while (rd.size() >= FrameHeader::size) {
+            FrameHeader fh = FrameHeader::parse(rd);
+            if (rd.size() < FrameHeader::size + fh.length) break;
+            if (!process_frame(fh, rd.substr(FrameHeader::size, fh.length))) return false;
+            rd.remove_prefix(FrameHeader::size + fh.length);
+        }
+        _in.erase(0, _in.size() - rd.size());
+        return true;
+    }
+
+    ///Send collected frames and receive until count of responses is complete
+    bool run(std::size_t count) {
+        if (!flush()) return false;
+        while (_completed.size() < count) {
+            std::string_view data = _s.read().join();
+            if (data.empty()) return false;
+            if (!process(data) || !flush()) return false;
+        }
+        return true;
+    }
+
+    Response &operator[](std::uint32_t id) {return _responses[id];}
+    ///ids of streams in order of completion
+    const std::vector<std::uint32_t> &completed() const {return _completed;}
+    ///forget completed responses
+    void clear() {
+        for (auto id: _completed) _responses.erase(id);
+        _completed.clear();
+    }
+    ///true, if GOAWAY was received
+    bool goaway() const {return _goaway;}
+    std::uint32_t goaway_error() const {return _goaway_error;}
+
+protected:
+    coroserver::Stream _s;
+    bool _window_update;
+    std::string _out;
+    std::string _in;
+    coroserver::http2::HPackEncoder _enc;
+    coroserver::http2::HPackDecoder _dec;
+    std::uint32_t _next_id = 1;
+    std::map<std::uint32_t, Response> _responses;
+    std::vector<std::uint32_t> _completed;
+    std::string _block;
+    std::uint32_t _block_stream = 0;
+    bool _block_end = false;
+    bool _goaway = false;
+    std::uint32_t _goaway_error = 0;
+
+    static std::uint32_t get_u32(std::string_view data) {
+        std::uint32_t v = 0;
+        for (int i = 0; i < 4; i++) v = (v << 8) | static_cast<unsigned char>(data[i]);
+        return v;
+    }
+
+    void window_update(std::uint32_t id, std::uint32_t inc) {
+        std::string payload;
+        for (int i = 3; i >= 0; i--) payload.push_back(static_cast<char>((inc >> (i * 8)) & 0xFF));
+        frame(FrameType::window_update, 0, id, payload);
+    }
+
+    void complete(std::uint32_t id) {
+        auto &r = _responses[id];
+        if (!r.complete) {
+            r.complete = true;
+            _completed.push_back(id);
+        }
+    }
+
+    bool process_frame(const FrameHeader &fh, std::string_view payload) {
+        using namespace coroserver::http2;
+        switch (fh.type) {
+            case FrameType::settings:
+                if (!(fh.flags & flags::ack)) frame(FrameType::settings, flags::ack, 0, {});
+                return true;
+            case FrameType::ping:
+                if (!(fh.flags & flags::ack)) frame(FrameType::ping, flags::ack, 0, payload);
+                return true;
+            case FrameType::goaway:
+                _goaway = true;
+                _goaway_error = payload.size() >= 8?get_u32(payload.substr(4)):0;
+                return true;
+            case FrameType::rst_stream: {
+                auto &r = _responses[fh.stream_id];
+                r.is_reset = true;
+                r.reset = payload.size() >= 4?get_u32(payload):0;
+                complete(fh.stream_id);
+                return true;
+            }
+            case FrameType::headers:
+                _block_stream = fh.stream_id;
+                _block_end = (fh.flags & flags::end_stream) != 0;
+                _block.assign(payload);
+                return (fh.flags & flags::end_headers)?end_block():true;
+            case FrameType::continuation:
+                if (fh.stream_id != _block_stream) return false;
+                _block.append(payload);
+                return (fh.flags & flags::end_headers)?end_block():true;
+            case FrameType::data: {
+                _responses[fh.stream_id].body.append(payload);
+                if (_window_update && fh.length) {
+                    window_update(0, fh.length);
+                    if (!(fh.flags & flags::end_stream)) window_update(fh.stream_id, fh.length);
+                }
+                if (fh.flags & flags::end_stream) complete(fh.stream_id);
+                return true;
+            }
+            default:
+                return true;
+        }
+    }
+
+    bool end_block() {
+        std::vector<HeaderField> fields;
+        if (!_dec.decode(_block, fields)) return false;
+        auto &r = _responses[_block_stream];
+        //trailers are ignored
+        if (r.status == 0) {
+            for (auto &f: fields) {
+                if (f.name == ":status") r.status = std::stoi(f.value);
+                else r.headers.push_back(std::move(f));
+            }
+        }
+        if (_block_end) complete(_block_stream);
+        return true;
+    }
+};
+
+#endif /* SRC_TESTS_HTTP2_CLIENT_H_ */
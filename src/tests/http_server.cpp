@@ -2,6 +2,11 @@
 #include "test_stream.h"
 #include <coroserver/http_server_request.h>
 #include <coroserver/http_server.h>
+#include <coroserver/io_context.h>
+
+#include <atomic>
+#include <functional>
+#include <thread>
 
 using namespace coroserver;
 using namespace coroserver::http;
@@ -211,6 +216,243 @@ void test_server() {
     CHECK(c2);
 }
 
+static cocls::future<void> delay(int ms) {
+    return [=](auto promise) {
+        std::thread thr([ms, promise = std::move(promise)]() mutable {
+            std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+            promise();
+        });
+        thr.detach();
+    };
+}
+
+cocls::async<bool> delayed_send(ServerRequest &req, std::string text, int ms, std::function<void()> on_wake) {
+    co_await delay(ms);
+    on_wake();
+    co_return co_await req.send(std::move(text));
+}
+
+void test_pipeline() {
+    std::atomic<int> started = 0;
+    int started_before_slow = 0;
+    int created = 0;
+    //pipelined requests are created by the factory as well
+    coroserver::http::Server server([&](Stream s) {
+        ++created;
+        return ServerRequest(std::move(s));
+    });
+    server.set_handler("/", [&](ServerRequest &req, std::string_view vpath) -> cocls::future<bool> {
+        req.add_date(std::chrono::system_clock::from_time_t(1651236587));
+        ++started;
+        if (vpath == "/slow") {
+            return delayed_send(req, std::string(vpath), 100, [&]{started_before_slow = started;});
+        } else {
+            return req.send(std::string(vpath));
+        }
+    });
+
+    std::string out;
+    auto s = TestStream<0>::create({"GET /slow HTTP/1.1\r\nHost: example.com\r\n\r\n"
+                                    "GET /f1 HTTP/1.1\r\nHost: example.com\r\n\r\n"
+                                    "GET /f2 HTTP/1.1\r\nHost: example.com\r\nConnection: close\r\n\r\n"}, &out);
+    server.serve_req(s).join();
+    //all requests were started before the first one finished
+    CHECK_EQUAL(started_before_slow, 3);
+    CHECK_EQUAL(created, 3);
+    //responses are in order of requests
+    auto p1 = out.find("\r\n\r\n/slow");
+    auto p2 = out.find("\r\n\r\n/f1");
+    auto p3 = out.find("\r\n\r\n/f2");
+    CHECK(p1 != out.npos && p2 != out.npos && p3 != out.npos);
+    CHECK(p1 < p2 && p2 < p3);
+    CHECK(out.find("Connection: close") > p2);
+}
+
+//the connection is not read ahead, next request in separate read is processed after the first one
+void test_pipeline_separate_reads() {
+    std::atomic<int> started = 0;
+    int started_before_slow = 0;
+    coroserver::http::Server server;
+    server.set_handler("/", [&](ServerRequest &req, std::string_view vpath) -> cocls::future<bool> {
+        ++started;
+        if (vpath == "/slow") {
+            return delayed_send(req, std::string(vpath), 50, [&]{started_before_slow = started;});
+        } else {
+            return req.send(std::string(vpath));
+        }
+    });
+    std::string out;
+    auto s = TestStream<0>::create({"GET /slow HTTP/1.1\r\nHost: example.com\r\n\r\n",
+                                    "GET /f1 HTTP/1.1\r\nHost: example.com\r\nConnection: close\r\n\r\n"}, &out);
+    server.serve_req(s).join();
+    CHECK_EQUAL(started_before_slow, 1);
+    CHECK_EQUAL(started, 2);
+    CHECK(out.find("\r\n\r\n/slow") < out.find("\r\n\r\n/f1"));
+}
+
+void test_route_params() {
+    coroserver::http::Server server;
+    server.set_handler("/users/{id}/files/{file*}", [&](ServerRequest &req) -> cocls::future<bool> {
+        return req.send(std::string(req.get_route_param("id")) + "|" + std::string(req.get_route_param("file")));
+    });
+    server.set_handler("/users/{id}", [&](ServerRequest &req, std::string_view vpath) -> cocls::future<bool> {
+        return req.send(std::string(req.get_route_param("id")) + "|" + std::string(vpath));
+    });
+    server.set_handler("/users/me", [&](ServerRequest &req) -> cocls::future<bool> {
+        return req.send("me");
+    });
+    server.set_handler("error_404", [&](ServerRequest &req) -> cocls::future<bool> {
+        return req.send("custom 404");
+    });
+
+    std::string out;
+    auto s = TestStream<0>::create({"GET /users/42/files/a/b.txt HTTP/1.1\r\nHost: example.com\r\n\r\n"
+                                    "GET /users/42/other HTTP/1.1\r\nHost: example.com\r\n\r\n"
+                                    "GET /users/me HTTP/1.1\r\nHost: example.com\r\n\r\n"
+                                    "GET /unknown HTTP/1.1\r\nHost: example.com\r\nConnection: close\r\n\r\n"}, &out);
+    server.serve_req(s).join();
+    CHECK(out.find("\r\n\r\n42|a/b.txt") != out.npos);
+    CHECK(out.find("\r\n\r\n42|/other") != out.npos);
+    CHECK(out.find("\r\n\r\nme") != out.npos);
+    CHECK(out.find("404 Not Found") != out.npos);
+    CHECK(out.find("\r\n\r\ncustom 404") != out.npos);
+}
+
+//handlers can be changed while other thread dispatches requests
+void test_route_update() {
+    coroserver::http::Server server;
+    server.set_handler("/", [](ServerRequest &req) -> cocls::future<bool> {
+        return req.send("v1");
+    });
+    auto get = [&] {
+        std::string out;
+        server.serve_req(TestStream<0>::create({"GET /x HTTP/1.1\r\nHost: example.com\r\nConnection: close\r\n\r\n"}, &out)).join();
+        return out;
+    };
+    CHECK(get().find("\r\n\r\nv1") != std::string::npos);
+
+    std::atomic<bool> stop = false;
+    std::atomic<int> failed = 0;
+    std::thread thr([&]{
+        while (!stop) {
+            if (get().find(" 200 OK") == std::string::npos) ++failed;
+        }
+    });
+    for (int i = 0; i < 1000; i++) {
+        server.set_handler("/route" + std::to_string(i), [](ServerRequest &req) -> cocls::future<bool> {
+            return req.send("route");
+        });
+    }
+    server.set_handler("/", [](ServerRequest &req) -> cocls::future<bool> {
+        return req.send("v2");
+    });
+    stop = true;
+    thr.join();
+    CHECK_EQUAL(failed, 0);
+    CHECK(get().find("\r\n\r\nv2") != std::string::npos);
+    //replaced copies are released, when connections which held them are closed
+    CHECK_EQUAL(server.get_routes_copies(), 1);
+}
+
+//replaced copy of the routing table is kept while a connection uses it
+void test_route_release() {
+    coroserver::http::Server server;
+    std::atomic<bool> entered = false;
+    std::atomic<bool> leave = false;
+    server.set_handler("/slow/{id}", [&](ServerRequest &req) -> cocls::future<bool> {
+        entered = true;
+        while (!leave) std::this_thread::yield();
+        return req.send(std::string(req.get_route_param("id")));
+    });
+    server.set_handler("/fast", [](ServerRequest &req) -> cocls::future<bool> {
+        return req.send("fast");
+    });
+    auto get = [&](std::string_view path) {
+        std::string out;
+        std::string r = "GET ";
+        r.append(path).append(" HTTP/1.1\r\nHost: example.com\r\nConnection: close\r\n\r\n");
+        server.serve_req(TestStream<0>::create({r}, &out)).join();
+        return out;
+    };
+    CHECK(get("/fast").find("\r\n\r\nfast") != std::string::npos);
+    CHECK_EQUAL(server.get_routes_copies(), 1);
+    //no connection holds the copy, it is released immediately
+    server.set_handler("/other", [](ServerRequest &req) -> cocls::future<bool> {
+        return req.send("other");
+    });
+    CHECK_EQUAL(server.get_routes_copies(), 0);
+
+    std::string slow_out;
+    std::thread thr([&]{slow_out = get("/slow/42");});
+    while (!entered) std::this_thread::yield();
+    server.set_handler("/other", [](ServerRequest &req) -> cocls::future<bool> {
+        return req.send("other2");
+    });
+    CHECK(get("/other").find("\r\n\r\nother2") != std::string::npos);
+    //slow request still uses the old copy
+    CHECK_EQUAL(server.get_routes_copies(), 2);
+    leave = true;
+    thr.join();
+    //name of the parameter from the old copy is still valid
+    CHECK(slow_out.find("\r\n\r\n42") != std::string::npos);
+    CHECK_EQUAL(server.get_routes_copies(), 1);
+}
+
+//keep-alive connection moves to the new copy before next request, the old copy is released
+void test_route_refresh() {
+    coroserver::http::Server server;
+    server.set_pipeline_depth(0);
+    std::size_t copies = 0;
+    server.set_handler("/change", [&](ServerRequest &req) -> cocls::future<bool> {
+        server.set_handler("/new", [&](ServerRequest &req) -> cocls::future<bool> {
+            copies = server.get_routes_copies();
+            return req.send("new");
+        });
+        return req.send("changed");
+    });
+    std::string out;
+    server.serve_req(TestStream<0>::create({
+        "GET /change HTTP/1.1\r\nHost: example.com\r\n\r\n",
+        "GET /new HTTP/1.1\r\nHost: example.com\r\nConnection: close\r\n\r\n"}, &out)).join();
+    CHECK(out.find("\r\n\r\nchanged") != std::string::npos);
+    CHECK(out.find("\r\n\r\nnew") != std::string::npos);
+    CHECK_EQUAL(copies, 1);
+}
+
+//frames of keep-alive requests fit to the arena of the connection
+void test_arena_keepalive() {
+    ContextIO ctx = ContextIO::create(1);
+    Server server;
+    server.set_handler("/", [](ServerRequest &req) -> cocls::future<bool> {
+        return req.send("ok");
+    });
+    auto addrs_listen = PeerName::lookup("127.0.0.1", "*");
+    auto listening = ctx.accept(addrs_listen);
+
+    auto run_connection = [&](int requests) {
+        auto wtconn = listening();
+        Stream c = ctx.connect(addrs_listen).join();
+        auto served = server.serve_req(wtconn.join());
+        for (int i = 0; i < requests; i++) {
+            CHECK(c.write("GET /x HTTP/1.1\r\nHost: example.com\r\n\r\n").join());
+            std::string out;
+            while (out.find("\r\n\r\nok") == out.npos) {
+                std::string_view data = c.read().join();
+                CHECK(!data.empty());
+                out.append(data);
+            }
+        }
+        c.write_eof().join();
+        served.join();
+    };
+
+    //block size adapts to the demand
+    for (int i = 0; i < 4; i++) run_connection(10);
+    std::size_t heap_frames = ctx.get_coro_arena_stats().heap_frames;
+    for (int i = 0; i < 4; i++) run_connection(100);
+    CHECK_EQUAL(ctx.get_coro_arena_stats().heap_frames, heap_frames);
+}
+
 void testHeaderParser() {
 
     http::ForwardedHeader f("for=12.34.56.78; by=\"aaa;bbb\"; proto = https; proto = \"http\"");
@@ -232,5 +474,12 @@ int main() {
     test_POST_body_expect_discard().join();
     test_POST_body_discard().join();
     test_server();
+    test_pipeline();
+    test_pipeline_separate_reads();
+    test_route_params();
+    test_route_update();
+    test_route_release();
+    test_route_refresh();
+    test_arena_keepalive();
 }
 
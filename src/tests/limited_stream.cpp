@@ -1,6 +1,7 @@
 #include "check.h"
 #include "test_stream.h"
 #include <coroserver/limited_stream.h>
+#include <coroserver/chunked_stream.h>
 
 
 void test1() {
@@ -62,13 +63,34 @@ void test4() {
     CHECK_EQUAL(buff," Extra data");
 }
 
+void test5() {
+    using namespace coroserver;
+    auto s = TestStream<100>::create({"5\r\nHello\r\n6\r\n World\r\n0\r\n\r\nrest"});
+    auto dev = std::make_shared<StaticStream<Limited<Chunked<StreamRef> > > >(5, 0, true, false, s.getStreamDevice());
+    Stream ls(dev);
 
+    std::string buff;
+    bool r = ls.read_block(buff, 15)().wait();
+    CHECK(!r);
+    CHECK_EQUAL(buff,"Hello");
+    dev->reset(6, 0);
+    r = ls.read_block(buff, 15)().wait();
+    CHECK(!r);
+    CHECK_EQUAL(buff," World");
+    auto eof = dev->get_stack().lower().read().wait();
+    CHECK(eof.empty());
+    CHECK(dev->get_stack().lower().is_complete());
+    r = s.read_block(buff, 100)().wait();
+    CHECK(!r);
+    CHECK_EQUAL(buff,"rest");
+}
 
 int main() {
     test1();
     test2();
     test3();
     test4();
+    test5();
 
 
 
@@ -0,0 +1,101 @@
+#include "check.h"
+
+#include <coroserver/poller_epoll.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+
+using namespace coroserver;
+
+static cocls::future<WaitResult> wait_for(Poller_epoll &poller, AsyncOperation op, int fd,
+                                          TimePoint timeout = TimePoint::max()) {
+    return [&, op, fd, timeout](auto p) {poller.async_wait(op, fd, std::move(p), timeout);};
+}
+
+//registrations are pushed by many threads at the same time, each is resolved exactly once
+void test_concurrent_registration(bool edge) {
+    cocls::thread_pool pool(2);
+    Poller_epoll poller(pool, edge);
+    constexpr int threads = 8;
+    constexpr int iterations = 2000;
+    std::atomic<int> completed = 0;
+    std::atomic<int> closed = 0;
+    std::atomic<int> failed = 0;
+    std::vector<std::thread> thrs;
+    for (int t = 0; t < threads; t++) {
+        thrs.emplace_back([&, t]{
+            int fds[2];
+            if (::pipe2(fds, O_NONBLOCK|O_CLOEXEC) < 0) {
+                ++failed;
+                return;
+            }
+            for (int i = 0; i < iterations; i++) {
+                auto f = wait_for(poller, AsyncOperation::read, fds[0]);
+                if ((i + t) % 2) {
+                    //becomes readable
+                    if (::write(fds[1], "x", 1) != 1) ++failed;
+                    if (f.wait() == WaitResult::complete) ++completed; else ++failed;
+                    char c;
+                    if (::read(fds[0], &c, 1) != 1) ++failed;
+                } else {
+                    //unregistered
+                    poller.handle_closed(fds[0]);
+                    if (f.wait() == WaitResult::closed) ++closed; else ++failed;
+                }
+            }
+            poller.handle_closed(fds[0]);
+            ::close(fds[0]);
+            ::close(fds[1]);
+        });
+    }
+    for (auto &t: thrs) t.join();
+    CHECK_EQUAL(failed, 0);
+    CHECK_EQUAL(completed, threads * iterations / 2);
+    CHECK_EQUAL(closed, threads * iterations / 2);
+}
+
+//descriptor is closed while its file is still registered in epoll (duplicated), the number
+//is reused. Events of the old file must not resolve waiters of the new descriptor
+void test_fd_reuse(bool edge) {
+    cocls::thread_pool pool(1);
+    Poller_epoll poller(pool, edge);
+    int p1[2], p2[2];
+    CHECK(::pipe2(p1, O_NONBLOCK|O_CLOEXEC) == 0);
+    auto f1 = wait_for(poller, AsyncOperation::read, p1[0]);
+    //make sure that the registration was processed
+    CHECK(wait_for(poller, AsyncOperation::write, p1[1], Clock::now()+std::chrono::milliseconds(10)).wait() == WaitResult::complete);
+    //file stays in epoll's interest list, because it is still open
+    int dup_fd = ::dup(p1[0]);
+    ::close(p1[0]);
+    poller.handle_closed(p1[0]);
+    CHECK(f1.wait() == WaitResult::closed);
+
+    CHECK(::pipe2(p2, O_NONBLOCK|O_CLOEXEC) == 0);
+    CHECK_EQUAL(p2[0], p1[0]);
+    auto f2 = wait_for(poller, AsyncOperation::read, p2[0], Clock::now()+std::chrono::milliseconds(200));
+    //event of the old file
+    CHECK_EQUAL(::write(p1[1], "x", 1), 1);
+    CHECK(f2.wait() == WaitResult::timeout);
+
+    auto f3 = wait_for(poller, AsyncOperation::read, p2[0]);
+    CHECK_EQUAL(::write(p2[1], "x", 1), 1);
+    CHECK(f3.wait() == WaitResult::complete);
+
+    poller.handle_closed(p1[1]);
+    poller.handle_closed(p2[0]);
+    poller.handle_closed(p2[1]);
+    ::close(dup_fd);
+    ::close(p1[1]);
+    ::close(p2[0]);
+    ::close(p2[1]);
+}
+
+int main() {
+    test_concurrent_registration(false);
+    test_concurrent_registration(true);
+    test_fd_reuse(false);
+    test_fd_reuse(true);
+}
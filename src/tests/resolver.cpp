@@ -0,0 +1,163 @@
+#include "check.h"
+#include <coroserver/io_context.h>
+#include <coroserver/resolver.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+//Tests asynchronous resolver against stub name server running on loopback
+
+using namespace coroserver;
+
+static void put16(std::string &out, int v) {
+    out.push_back(static_cast<char>((v >> 8) & 0xFF));
+    out.push_back(static_cast<char>(v & 0xFF));
+}
+
+static void put32(std::string &out, int v) {
+    put16(out, v >> 16);
+    put16(out, v & 0xFFFF);
+}
+
+///Stub name server
+/**
+ * example.test, slow.test - A 10.1.2.3, no AAAA
+ * missing.test - NXDOMAIN
+ */
+class StubServer {
+public:
+    StubServer() {
+        _fd = ::socket(AF_INET, SOCK_DGRAM|SOCK_CLOEXEC, 0);
+        sockaddr_in sin = {};
+        sin.sin_family = AF_INET;
+        sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(_fd, reinterpret_cast<sockaddr *>(&sin), sizeof(sin));
+        timeval tv = {0, 100000};
+        ::setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        _addr = PeerName::from_socket(_fd, false);
+        _thr = std::thread([this]{worker();});
+    }
+    ~StubServer() {
+        _stop = true;
+        _thr.join();
+        ::close(_fd);
+    }
+    const PeerName &addr() const {return _addr;}
+    int queries() const {return _queries;}
+
+protected:
+    int _fd;
+    PeerName _addr;
+    std::atomic<bool> _stop = false;
+    std::atomic<int> _queries = 0;
+    std::thread _thr;
+
+    void worker() {
+        char buff[512];
+        while (!_stop) {
+            sockaddr_storage from;
+            socklen_t fromlen = sizeof(from);
+            int r = ::recvfrom(_fd, buff, sizeof(buff), 0, reinterpret_cast<sockaddr *>(&from), &fromlen);
+            if (r < 12) continue;
+            ++_queries;
+            std::string msg(buff, r);
+            std::string name;
+            std::size_t pos = 12;
+            while (pos < msg.size() && msg[pos]) {
+                if (!name.empty()) name.push_back('.');
+                name.append(msg.substr(pos + 1, msg[pos]));
+                pos += msg[pos] + 1;
+            }
+            int qtype = (static_cast<unsigned char>(msg[pos+1]) << 8) | static_cast<unsigned char>(msg[pos+2]);
+            std::string resp = msg.substr(0, pos + 5);
+            resp[2] = static_cast<char>(0x81);
+            resp[3] = static_cast<char>(0x80);
+            if (name == "slow.test") {
+                //gives time to other lookups to join
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            }
+            if (name == "missing.test") {
+                resp[3] = static_cast<char>(0x83);   //NXDOMAIN
+                resp[9] = 1;
+                resp.append("\xC0\x0C", 2);
+                put16(resp, 6);
+                put16(resp, 1);
+                put32(resp, 30);
+                put16(resp, 22);
+                resp.append(6, '\0');
+                put32(resp, 0);
+                put32(resp, 0);
+                put32(resp, 0);
+                put32(resp, 30);
+            } else if (qtype == 1) {
+                resp[7] = 1;
+                resp.append("\xC0\x0C", 2);
+                put16(resp, 1);
+                put16(resp, 1);
+                put32(resp, 60);
+                put16(resp, 4);
+                resp.append("\x0A\x01\x02\x03", 4);
+            }
+            ::sendto(_fd, resp.data(), resp.size(), 0, reinterpret_cast<sockaddr *>(&from), fromlen);
+        }
+    }
+};
+
+int main() {
+    StubServer server;
+    ContextIO ctx = ContextIO::create(1);
+
+    std::string hosts_file = "/tmp/coroserver_resolver_test_hosts";
+    std::ofstream(hosts_file) << "# comment\n10.9.8.7  MyHost.test myhost\n";
+
+    Resolver::Config cfg;
+    cfg.servers = {server.addr()};
+    cfg.hosts_file = hosts_file;
+    cfg.timeout = std::chrono::milliseconds(1000);
+    Resolver resolver(ctx, cfg);
+
+    auto lst = resolver.lookup("example.test", "80").wait();
+    CHECK_EQUAL(lst.size(), 1U);
+    CHECK_EQUAL(lst[0].to_string(), "10.1.2.3:80");
+    CHECK_EQUAL(server.queries(), 2);
+
+    //second lookup is served from the cache
+    lst = resolver.lookup("Example.Test:8080").wait();
+    CHECK_EQUAL(lst[0].to_string(), "10.1.2.3:8080");
+    CHECK_EQUAL(server.queries(), 2);
+
+    //concurrent lookups share single query
+    auto f1 = resolver.lookup("slow.test", "80");
+    auto f2 = resolver.lookup("slow.test", "81");
+    CHECK_EQUAL(f1.wait()[0].to_string(), "10.1.2.3:80");
+    CHECK_EQUAL(f2.wait()[0].to_string(), "10.1.2.3:81");
+    CHECK_EQUAL(server.queries(), 4);
+
+    //negative answer is cached
+    CHECK_EXCEPTION(PeerName::LookupException, resolver.lookup("missing.test", "80").wait());
+    CHECK_EQUAL(server.queries(), 6);
+    CHECK_EXCEPTION(PeerName::LookupException, resolver.lookup("missing.test", "80").wait());
+    CHECK_EQUAL(server.queries(), 6);
+
+    //hosts file and numeric addresses don't need name server
+    lst = resolver.lookup("myhost.test 127.0.0.1:90", "80").wait();
+    CHECK_EQUAL(lst.size(), 2U);
+    CHECK_EQUAL(lst[0].to_string(), "10.9.8.7:80");
+    CHECK_EQUAL(lst[1].to_string(), "127.0.0.1:90");
+    CHECK_EQUAL(server.queries(), 6);
+
+    //cleared cache asks again
+    resolver.clear_cache();
+    resolver.lookup("example.test", "80").wait();
+    CHECK_EQUAL(server.queries(), 8);
+
+    ctx.stop();
+    std::remove(hosts_file.c_str());
+}
@@ -0,0 +1,116 @@
+#include <coroserver/route_trie.h>
+#include "check.h"
+
+using coroserver::RouteTrie;
+
+static void test_find(const RouteTrie<int> &map, std::string_view path, std::initializer_list<int> list) {
+    auto r = map.find(path);
+    CHECK_EQUAL(r.size(), list.size());
+    auto it1 = r.begin();
+    auto it2 = list.begin();
+    while (it1 != r.end() && it2 != list.end()) {
+        CHECK_EQUAL(it1->value->payload, *it2);
+        ++it1;
+        ++it2;
+    }
+}
+
+//same results as PrefixMap
+void test_prefixes() {
+    RouteTrie<int> map;
+
+    map.insert("/aaa") = 10;
+    map.insert("/bbb") = 20;
+    map.insert("/bbb/ccc") = 30;
+    map.insert("/bbb/ddd") = 40;
+    map.insert("/abc") = 50;
+    map.insert("/abcd") = 60;
+    map.insert("/abcd/xyz") = 70;
+    map.insert("/abcd/xyw") = 80;
+    map.insert("/abcd/xyz/aaa") = 90;
+
+    test_find(map, "/123", {});
+    test_find(map, "/aaa", {10});
+    test_find(map, "/ab", {});
+    test_find(map, "/abc", {50});
+    test_find(map, "/abc123", {50});
+    test_find(map, "/abcd", {50,60});
+    test_find(map, "/abcd/xyz/123", {50,60,70});
+    test_find(map, "/abcd/xyw/123", {50,60,80});
+    test_find(map, "/bbb/ccc/xxx", {20,30});
+
+    //existing value is returned
+    CHECK_EQUAL(map.insert("/abcd"), 60);
+
+    //copy is independent on the original
+    RouteTrie<int> copy(map);
+    map.insert("/abcd") = 61;
+    map.insert("/abcd/xyz/bbb") = 100;
+    test_find(copy, "/abcd/xyz/bbb", {50,60,70});
+    test_find(map, "/abcd/xyz/bbb", {50,61,70,100});
+}
+
+void test_params() {
+    RouteTrie<int> map;
+
+    map.insert("/users/{id}") = 1;
+    map.insert("/users/me") = 2;
+    map.insert("/users/{id}/posts/{post}") = 3;
+    map.insert("/files/{path*}") = 4;
+    map.insert("/files/index.html") = 5;
+
+    //static route wins over the parameter
+    test_find(map, "/users/me", {1,2});
+    test_find(map, "/users/42", {1});
+    test_find(map, "/users/", {});
+    //backtracking from static route
+    test_find(map, "/users/me/posts/7", {1,2,3});
+
+    auto r = map.find("/users/me/posts/7");
+    const auto &m = r.top();
+    CHECK_EQUAL(m.value->path, "/users/{id}/posts/{post}");
+    CHECK_EQUAL(m.length, 17);
+    CHECK_EQUAL(m.param_count(), 2);
+    CHECK_EQUAL(m.param(0).name, "id");
+    CHECK_EQUAL(m.param(0).value, "me");
+    CHECK_EQUAL(m.param(1).name, "post");
+    CHECK_EQUAL(m.param(1).value, "7");
+
+    r = map.find("/files/a/b/c.txt");
+    CHECK_EQUAL(r.size(), 1);
+    CHECK_EQUAL(r.top().param(0).name, "path");
+    CHECK_EQUAL(r.top().param(0).value, "a/b/c.txt");
+    CHECK_EQUAL(r.top().length, 16);
+
+    test_find(map, "/files/index.html", {4,5});
+    r = map.find("/files/");
+    CHECK_EQUAL(r.size(), 1);
+    CHECK(r.top().param(0).value.empty());
+
+    //route with other names shares the value, names of existing route are kept
+    auto r2 = map.find("/users/me/posts/7");
+    std::string_view name = r2.top().param(0).name;
+    CHECK_EQUAL(map.insert("/users/{uid}/posts/{pid}"), 3);
+    CHECK_EQUAL(name, "id");
+    CHECK_EQUAL(r2.top().param(1).name, "post");
+    CHECK_EQUAL(map.find("/users/42/posts/7").top().param(0).name, "id");
+
+    for (std::string_view bad: {"/files/{path*}/x", "/file{id}.json", "/a/{id}x/b",
+                                "/a/{}", "/a/{}/b", "/a/{*}", "/a/{id"}) {
+        bool thrown = false;
+        try {
+            map.insert(bad);
+        } catch (const std::invalid_argument &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+    //parameter can be at the end or followed by '/'
+    CHECK_EQUAL(map.insert("/items/{id}"), 0);
+    CHECK_EQUAL(map.insert("/items/{id}/"), 0);
+}
+
+int main() {
+    test_prefixes();
+    test_params();
+}
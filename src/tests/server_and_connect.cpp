@@ -2,6 +2,15 @@
 
 #include <coroserver/stream.h>
 #include <coroserver/io_context.h>
+#include <coroserver/socket_stream.h>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
 
 using namespace coroserver;
 
@@ -38,9 +47,136 @@ void check2() {
     Stream r = wtconn1.join();
 }
 
+void check3() {
+    ContextIO ctx = ContextIO::create(4, PollerType::epoll, 4);
+    CHECK_EQUAL(ctx.get_reactor_count(), 4);
+
+    auto addrs_listen = PeerName::lookup("127.0.0.1", "*");
+    auto listening = ctx.accept(addrs_listen);
+    auto addrs_connect = PeerName::lookup("localhost", addrs_listen[0].get_port());
+
+    for (int i = 0; i < 16; i++) {
+        auto wtconn = listening();
+        Stream s = ctx.connect(addrs_connect).join();
+        Stream r = wtconn.join();
+        CHECK(s.write("x").join());
+        CHECK_EQUAL(r.read().join(), "x");
+    }
+}
+
+cocls::async<std::string> read_all(Stream s) {
+    std::string out;
+    std::string_view data = co_await s.read();
+    while (!data.empty()) {
+        out.append(data);
+        data = co_await s.read();
+    }
+    co_return out;
+}
+
+void check4() {
+    ContextIO ctx = ContextIO::create(1);
+
+    auto addrs_listen = PeerName::lookup("127.0.0.1", "*");
+    auto listening = ctx.accept(addrs_listen);
+    auto wtconn = listening();
+    Stream s = ctx.connect(addrs_listen).join();
+    Stream r = wtconn.join();
+    auto received = read_all(r).start();
+
+    std::string fname = "/tmp/coroserver_sendfile_test";
+    std::string content;
+    for (int i = 0; i < 1000000; i++) content.push_back(static_cast<char>('a' + i % 26));
+    std::ofstream(fname) << content;
+
+    std::string_view parts[] = {"head", "|"};
+    CHECK(s.write(std::span<const std::string_view>(parts)).join());
+    auto sock = std::dynamic_pointer_cast<SocketStream>(s.getStreamDevice());
+    CHECK(sock != nullptr);
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    CHECK(sock->write_file(fd, 0, content.size()).join());
+    ::close(fd);
+    s.write_eof().join();
+
+    CHECK(received.join() == "head|" + content);
+    std::remove(fname.c_str());
+}
+
+//more connections are waiting than fits to one batch
+void check5() {
+    ContextIO ctx = ContextIO::create(1);
+    ctx.set_accept_batch(4);
+
+    auto addrs_listen = PeerName::lookup("127.0.0.1", "*");
+    auto listening = ctx.accept(addrs_listen);
+    constexpr int count = 19;
+    std::vector<Stream> clients;
+    for (int i = 0; i < count; i++) {
+        clients.push_back(ctx.connect(addrs_listen).join());
+        CHECK(clients.back().write(std::to_string(i)).join());
+        clients.back().write_eof().join();
+    }
+    std::vector<bool> seen(count, false);
+    for (int i = 0; i < count; i++) {
+        Stream r = listening().join();
+        int id = std::stoi(read_all(r).start().join());
+        CHECK(id >= 0 && id < count);
+        CHECK(!seen[id]);
+        seen[id] = true;
+    }
+}
+
+static int get_int_option(const Stream &s, int level, int opt) {
+    int val = 0;
+    socklen_t len = sizeof(val);
+    auto sock = std::dynamic_pointer_cast<SocketStream>(s.getStreamDevice());
+    CHECK(sock != nullptr);
+    CHECK_EQUAL(::getsockopt(sock->get_read_fd(), level, opt, &val, &len), 0);
+    return val;
+}
+
+//socket options are applied on accepted and connected sockets
+void check6() {
+    ContextIO ctx = ContextIO::create(1);
+    SocketOptions lopts;
+    lopts.keepalive = true;
+    lopts.keepalive_idle = 77;
+    lopts.rcvbuf = 65536;
+    ctx.set_socket_options(1, lopts);
+
+    auto addrs_listen = PeerName::lookup("127.0.0.1", "*");
+    addrs_listen[0].set_group_id(1);
+    auto listening = ctx.accept(addrs_listen);
+    auto wtconn = listening();
+
+    SocketOptions copts;
+    copts.nodelay = false;
+    copts.keepalive = true;
+    copts.keepalive_count = 5;
+    Stream s = ctx.connect(addrs_listen, ContextIO::defaultTimeout,
+            {ContextIO::defaultTimeout, ContextIO::defaultTimeout}, copts).join();
+    Stream r = wtconn.join();
+    CHECK_EQUAL(r.get_peer_name().get_group_id(), 1);
+
+    //accepted connection inherits options of the listener
+    CHECK_EQUAL(get_int_option(r, SOL_SOCKET, SO_KEEPALIVE), 1);
+    CHECK_EQUAL(get_int_option(r, IPPROTO_TCP, TCP_KEEPIDLE), 77);
+    CHECK_GREATER_EQUAL(get_int_option(r, SOL_SOCKET, SO_RCVBUF), 65536);
+    CHECK_EQUAL(get_int_option(r, IPPROTO_TCP, TCP_NODELAY), 1);
+
+    //explicit options of the connection
+    CHECK_EQUAL(get_int_option(s, SOL_SOCKET, SO_KEEPALIVE), 1);
+    CHECK_EQUAL(get_int_option(s, IPPROTO_TCP, TCP_KEEPCNT), 5);
+    CHECK_EQUAL(get_int_option(s, IPPROTO_TCP, TCP_NODELAY), 0);
+}
+
 int main() {
 
     check1();
     check2();
+    check3();
+    check4();
+    check5();
+    check6();
 
 }
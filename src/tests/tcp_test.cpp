@@ -3,6 +3,8 @@
 #include <coroserver/character_io.h>
 #include <coroserver/io_context.h>
 
+#include <thread>
+
 
 cocls::async<void> write_task(coroserver::ContextIO ctx, std::string port) {
     coroserver::Stream stream = co_await ctx.connect(PeerName::lookup("localhost", port));
@@ -34,9 +36,9 @@ cocls::async<void> server_task(cocls::future<coroserver::Stream> &f) {
 
 }
 
-int main() {
+void run_test(coroserver::PollerType type) {
 
-    coroserver::ContextIO ctx = coroserver::ContextIO::create();
+    coroserver::ContextIO ctx = coroserver::ContextIO::create(0, type);
 
     auto addr = PeerName::lookup("127.0.0.1","*");
     auto listener = ctx.accept(addr);
@@ -47,5 +49,141 @@ int main() {
 
     server_task(f).join();
 
+    auto m = ctx.get_metrics(0);
+    CHECK_GREATER(m.iterations, 0U);
+    CHECK_GREATER(m.events, 0U);
+    CHECK_GREATER(m.resumes, 0U);
+
+}
+
+//data which arrive after a read timed out are returned by the next read
+void test_read_timeout(coroserver::PollerType type) {
+
+    coroserver::ContextIO ctx = coroserver::ContextIO::create(0, type);
+
+    auto addr = PeerName::lookup("127.0.0.1","*");
+    auto listener = ctx.accept(addr);
+    cocls::future<coroserver::Stream> f([&]{return listener();});
+    coroserver::Stream c = ctx.connect(PeerName::lookup("localhost", addr[0].get_port())).join();
+    coroserver::Stream s = f.join();
+
+    auto tms = s.get_timeouts();
+    tms.read_timeout_ms = 100;
+    s.set_timeouts(tms);
+    std::string_view data = s.read().join();
+    CHECK(data.empty());
+    CHECK(s.is_read_timeout());
+
+    CHECK(c.write("hello").join());
+    std::string received;
+    while (received.size() < 5) {
+        data = s.read().join();
+        if (data.empty()) break;
+        received.append(data);
+    }
+    CHECK_EQUAL(received, "hello");
+
+    //data arrive while reads time out, nothing is lost
+    tms.read_timeout_ms = 1;
+    s.set_timeouts(tms);
+    std::thread thr([&]{
+        for (int i = 0; i < 200; i++) {
+            c.write("0123456789").join();
+            std::this_thread::sleep_for(std::chrono::microseconds(500 + (i % 7) * 100));
+        }
+    });
+    received.clear();
+    int timeouts = 0;
+    while (received.size() < 2000 && timeouts < 5000) {
+        data = s.read().join();
+        if (data.empty()) {
+            if (!s.is_read_timeout()) break;
+            ++timeouts;
+        }
+        received.append(data);
+    }
+    thr.join();
+    CHECK_EQUAL(received.size(), 2000);
+}
+
+cocls::async<std::string> read_all(coroserver::Stream s) {
+    std::string out;
+    std::string_view data = co_await s.read();
+    while (!data.empty()) {
+        out.append(data);
+        data = co_await s.read();
+    }
+    co_return out;
+}
+
+//zero copy sends are confirmed through the error queue, it must not fail other waiters
+//(on loopback, the kernel copies the data and the stream falls back to copy)
+void test_zerocopy(coroserver::PollerType type) {
+
+    coroserver::ContextIO ctx = coroserver::ContextIO::create(0, type);
+
+    auto addr = PeerName::lookup("127.0.0.1","*");
+    auto listener = ctx.accept(addr);
+    cocls::future<coroserver::Stream> f([&]{return listener();});
+    coroserver::SocketOptions opts;
+    opts.zerocopy_threshold = 1;
+    coroserver::Stream c = ctx.connect(PeerName::lookup("localhost", addr[0].get_port()),
+            coroserver::ContextIO::defaultTimeout,
+            {coroserver::ContextIO::defaultTimeout, coroserver::ContextIO::defaultTimeout},
+            opts).join();
+    coroserver::Stream s = f.join();
+
+    //read is pending on the sending side, while the notifications arrive
+    cocls::future<std::string_view> pending_read([&]{return c.read();});
+    auto received = read_all(s).start();
+
+    std::string block;
+    for (int i = 0; i < 65536; i++) block.push_back(static_cast<char>('a' + i % 26));
+    for (int i = 0; i < 64; i++) {
+        CHECK(c.write(block).join());
+    }
+    c.write_eof().join();
+    std::string data = received.join();
+    CHECK_EQUAL(data.size(), 64*block.size());
+    CHECK(data.compare(0, block.size(), block) == 0);
+    CHECK(data.compare(data.size() - block.size(), block.size(), block) == 0);
+
+    //sending side receives eof, not an error
+    s.write_eof().join();
+    CHECK(pending_read.join().empty());
+}
 
+cocls::async<void> sleep_task(coroserver::AsyncSupport supp, int count) {
+    for (int i = 0; i < count; i++) {
+        auto tp = coroserver::Clock::now() + std::chrono::milliseconds(2);
+        coroserver::WaitResult r = co_await supp.wait_until(tp, &tp);
+        CHECK(r == coroserver::WaitResult::timeout);
+    }
+}
+
+//coroutines woken by single iteration are resumed once, not per phase of the iteration
+void test_metrics_counts(coroserver::PollerType type) {
+    coroserver::ContextIO ctx = coroserver::ContextIO::create(1, type);
+    sleep_task(ctx.get_reactor(0), 10).start().wait();
+    //let the reactor fall asleep, so the counters are stable
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto m = ctx.get_metrics(0);
+    CHECK_GREATER_EQUAL(m.iterations, 10U);
+    CHECK_EQUAL(m.resumes, m.iterations);
+    CHECK_LESS_EQUAL(m.resumes_backlogged, m.resumes);
+    CHECK_EQUAL(m.timers, 0U);
+    ctx.stop();
+}
+
+int main() {
+    run_test(coroserver::PollerType::epoll);
+    run_test(coroserver::PollerType::epoll_edge);
+    run_test(coroserver::PollerType::uring);
+    test_read_timeout(coroserver::PollerType::epoll);
+    test_read_timeout(coroserver::PollerType::uring);
+    test_zerocopy(coroserver::PollerType::epoll);
+    test_zerocopy(coroserver::PollerType::epoll_edge);
+    test_zerocopy(coroserver::PollerType::uring);
+    test_metrics_counts(coroserver::PollerType::epoll);
+    test_metrics_counts(coroserver::PollerType::uring);
 }
@@ -0,0 +1,87 @@
+#include "check.h"
+#include <coroserver/io_context.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+//Measures how late the timers are signaled, reports percentiles of the delay
+
+using namespace coroserver;
+
+cocls::async<std::vector<double> > measure(AsyncSupport supp, int count) {
+    std::vector<double> delays;
+    delays.reserve(count);
+    for (int i = 0; i < count; i++) {
+        //timeouts between 50us and 2ms
+        auto tp = std::chrono::steady_clock::now() + std::chrono::microseconds(50 + (i * 397) % 1950);
+        WaitResult r = co_await supp.wait_until(tp, &delays);
+        auto now = std::chrono::steady_clock::now();
+        CHECK(r == WaitResult::timeout);
+        delays.push_back(std::chrono::duration<double, std::micro>(now - tp).count());
+    }
+    co_return delays;
+}
+
+static double percentile(const std::vector<double> &v, double p) {
+    return v[std::min(v.size() - 1, static_cast<std::size_t>(p * v.size()))];
+}
+
+void run_test(const char *name, PollerType type) {
+    ContextIO ctx = ContextIO::create(1, type);
+    std::vector<double> delays = measure(ctx, 500).start().wait();
+    std::sort(delays.begin(), delays.end());
+    std::cout << name << " delay (us): p50=" << percentile(delays, 0.5)
+              << " p90=" << percentile(delays, 0.9)
+              << " p99=" << percentile(delays, 0.99)
+              << " max=" << delays.back() << std::endl;
+    //timer must never be signaled before its timeout
+    CHECK_GREATER_EQUAL(delays.front(), 0.0);
+    CHECK_LESS(percentile(delays, 0.5), 1000.0);
+    ctx.stop();
+}
+
+//time published by a reactor is visible to all threads until it is invalidated
+void test_clock_source() {
+    Clock::Source src;
+    //nothing is published, the clock is read directly
+    auto before = Clock::now();
+    CHECK(src.now() >= before);
+    auto published = src.update();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(src.now() == published);
+    std::thread thr([&]{
+        CHECK(src.now() == published);
+    });
+    thr.join();
+    auto refreshed = src.update();
+    CHECK(refreshed > published);
+    src.invalidate();
+    CHECK(src.now() >= refreshed);
+}
+
+//coroutine resumed by a reactor receives time of the reactor's iteration
+cocls::async<void> check_reactor_time(AsyncSupport supp) {
+    auto tp = Clock::now() + std::chrono::milliseconds(2);
+    WaitResult r = co_await supp.wait_until(tp, &tp);
+    CHECK(r == WaitResult::timeout);
+    auto t = supp.now();
+    //the timer was fired by iteration which started after the deadline
+    CHECK(t >= tp);
+    CHECK(t <= Clock::now());
+}
+
+void test_reactor_time(PollerType type) {
+    ContextIO ctx = ContextIO::create(1, type);
+    check_reactor_time(ctx.get_reactor(0)).start().wait();
+    ctx.stop();
+}
+
+int main() {
+    test_clock_source();
+    test_reactor_time(PollerType::epoll);
+    test_reactor_time(PollerType::uring);
+    run_test("epoll", PollerType::epoll);
+    run_test("io_uring", PollerType::uring);
+}
@@ -0,0 +1,67 @@
+#include "check.h"
+
+#include <coroserver/scheduler.h>
+#include <coroserver/timer_heap.h>
+
+#include <algorithm>
+#include <optional>
+#include <random>
+
+using namespace coroserver;
+
+void check_heap() {
+    TimerHeap<int> heap;
+    std::mt19937 rnd(1);
+    std::vector<TimerHeap<int>::Handle> handles;
+    std::vector<int> times;
+    for (int i = 0; i < 1000; i++) {
+        int t = rnd() % 10000;
+        times.push_back(t);
+        handles.push_back(heap.insert(Clock::time_point(std::chrono::milliseconds(t)), i));
+    }
+    //remove every third timer, move every fifth timer
+    std::vector<bool> removed(times.size(), false);
+    for (int i = 0; i < 1000; i+=3) {
+        CHECK_EQUAL(heap.remove(handles[i]), i);
+        removed[i] = true;
+    }
+    for (int i = 1; i < 1000; i+=5) if (!removed[i]) {
+        times[i] = rnd() % 10000;
+        heap.update(handles[i], Clock::time_point(std::chrono::milliseconds(times[i])));
+    }
+    std::vector<int> expect;
+    for (int i = 0; i < 1000; i++) if (!removed[i]) expect.push_back(times[i]);
+    std::sort(expect.begin(), expect.end());
+    CHECK_EQUAL(heap.size(), expect.size());
+    std::vector<int> result;
+    while (!heap.empty()) {
+        int v = heap.pop();
+        result.push_back(times[v]);
+    }
+    CHECK(result == expect);
+    CHECK(heap.top_time() == Clock::time_point::max());
+}
+
+void check_scheduler() {
+    Scheduler<std::optional<int> > sch;
+    int a,b,c;
+    Clock::time_point base;
+    sch.schedule(&a, 1, base + std::chrono::seconds(3));
+    sch.schedule(&b, 2, base + std::chrono::seconds(1));
+    sch.schedule(&c, 3, base + std::chrono::seconds(2));
+    auto p = sch.cancel_schedule(&c);
+    CHECK(p.has_value());
+    CHECK_EQUAL(**p, 3);
+    CHECK(!sch.cancel_schedule(&c).has_value());
+    auto r = sch.check_expired(base + std::chrono::seconds(5));
+    CHECK_EQUAL(*std::get<std::optional<int> >(r), 2);
+    r = sch.check_expired(base + std::chrono::seconds(2));
+    CHECK(std::get<Clock::time_point>(r) == base + std::chrono::seconds(3));
+    CHECK(!sch.cancel_schedule(&b).has_value());
+    CHECK(sch.cancel_schedule(&a).has_value());
+}
+
+int main() {
+    check_heap();
+    check_scheduler();
+}